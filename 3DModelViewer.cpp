@@ -1,6 +1,18 @@
 #include "engine.h"
+#include "benchmark.h"
+#include <string>
 
 int main(int argc, char** argv) {
+    // headless benchmark: 3DModelViewer --benchmark [options]
+    if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+        BenchmarkSettings settings;
+        if (!Benchmark::parseArguments(argc - 2, argv + 2, settings)) {
+            return 1;
+        }
+        Benchmark benchmark;
+        return benchmark.run(settings) ? 0 : 1;
+    }
+
     // define screen dimensions
     const int SCREEN_WIDTH = 1280;
     const int SCREEN_HEIGHT = 720;
@@ -8,6 +20,18 @@ int main(int argc, char** argv) {
     // initialize Engine
     Engine engine(SCREEN_WIDTH, SCREEN_HEIGHT);
 
+    // 3DModelViewer --record-camera file: record the camera for the benchmark mode
+    if (argc > 2 && std::string(argv[1]) == "--record-camera") {
+        engine.recordCameraPath(argv[2]);
+    }
+
+    // 3DModelViewer --check-allocations [frames]: fail if orbiting frames allocate
+    if (argc > 1 && std::string(argv[1]) == "--check-allocations") {
+        const int WARMUP_FRAMES = 60;
+        int frames = argc > 2 ? std::stoi(argv[2]) : 300;
+        return engine.checkAllocations(WARMUP_FRAMES, frames) ? 0 : 1;
+    }
+
     // begin main loop
     engine.loop();
 
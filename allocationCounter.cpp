@@ -0,0 +1,27 @@
+#include "allocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+// operator new calls of each thread, a plain increment on the allocation path
+static thread_local uint64_t allocationCount = 0;
+
+uint64_t AllocationCounter::getCount() {
+    return allocationCount;
+}
+
+// the array and nothrow forms of the standard library call this one
+void* operator new(size_t size) {
+    ++allocationCount;
+    if (void* pointer = std::malloc(size > 0 ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
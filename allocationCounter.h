@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Counts the heap allocations made through the global operator new, per thread, for the
+ * allocation check of the viewer (3DModelViewer --check-allocations). The operators are
+ * replaced by allocationCounter.cpp, only the executables that link it count allocations.
+ * ImGui, SDL and the GL driver allocate with malloc and are not counted.
+ */
+class AllocationCounter {
+public:
+    /**
+     * @return The number of operator new calls made by the calling thread so far.
+     */
+    static uint64_t getCount();
+};
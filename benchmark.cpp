@@ -0,0 +1,287 @@
+#include "benchmark.h"
+#include "fileUtils.h"
+#include "profiler.h"
+#include "stressScene.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Nearest-rank percentile of sorted values.
+ */
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+/**
+ * Quotes a string for JSON, paths may hold backslashes.
+ */
+static std::string jsonString(const std::string& value) {
+    std::string result = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+/**
+ * Keeps the largest per-frame counters, and the resident VRAM of the latest frame.
+ */
+static void accumulatePeakStats(RenderStats& peak, const RenderStats& frame) {
+    peak.drawCalls = std::max(peak.drawCalls, frame.drawCalls);
+    peak.triangles = std::max(peak.triangles, frame.triangles);
+    peak.vertices = std::max(peak.vertices, frame.vertices);
+    peak.meshesCulled = std::max(peak.meshesCulled, frame.meshesCulled);
+    peak.textureBinds = std::max(peak.textureBinds, frame.textureBinds);
+    peak.programSwitches = std::max(peak.programSwitches, frame.programSwitches);
+    peak.uniformUploads = std::max(peak.uniformUploads, frame.uniformUploads);
+    peak.bufferBytesUploaded = std::max(peak.bufferBytesUploaded, frame.bufferBytesUploaded);
+    peak.textureBytesUploaded = std::max(peak.textureBytesUploaded, frame.textureBytesUploaded);
+    peak.dynamicBytes = std::max(peak.dynamicBytes, frame.dynamicBytes);
+    peak.meshBytes = frame.meshBytes;
+    peak.textureBytes = frame.textureBytes;
+    peak.environmentBytes = frame.environmentBytes;
+}
+
+static void printUsage() {
+    std::cerr << "Usage: 3DModelViewer --benchmark [--model file|stress:...] [--environment file] [--width w] [--height h]\n"
+        << "                     [--frames n] [--warmup n] [--camera-path file] [--orbit-turns t]\n"
+        << "                     [--orbit-elevation radians] [--orbit-distance d] [--output file]" << std::endl;
+}
+
+bool Benchmark::parseArguments(int argc, char** argv, BenchmarkSettings& settings) {
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--model" && hasValue) settings.model = argv[++i];
+        else if (arg == "--environment" && hasValue) settings.environment = argv[++i];
+        else if (arg == "--width" && hasValue) settings.width = std::stoi(argv[++i]);
+        else if (arg == "--height" && hasValue) settings.height = std::stoi(argv[++i]);
+        else if (arg == "--frames" && hasValue) settings.frames = std::stoi(argv[++i]);
+        else if (arg == "--warmup" && hasValue) settings.warmupFrames = std::stoi(argv[++i]);
+        else if (arg == "--camera-path" && hasValue) settings.cameraPath = argv[++i];
+        else if (arg == "--orbit-turns" && hasValue) settings.orbitTurns = std::stof(argv[++i]);
+        else if (arg == "--orbit-elevation" && hasValue) settings.orbitElevation = std::stof(argv[++i]);
+        else if (arg == "--orbit-distance" && hasValue) settings.orbitDistance = std::stof(argv[++i]);
+        else if (arg == "--output" && hasValue) settings.output = argv[++i];
+        else {
+            printUsage();
+            return false;
+        }
+    }
+    if (settings.width <= 0 || settings.height <= 0 || settings.frames <= 0 || settings.warmupFrames < 0) {
+        printUsage();
+        return false;
+    }
+    return true;
+}
+
+bool Benchmark::readCameraPath(const std::string& filepath, std::vector<CameraPose>& poses) {
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open camera path " << filepath << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream lineStream(line);
+        CameraPose pose;
+        if (lineStream >> pose.azimuth >> pose.elevation >> pose.distance) {
+            poses.push_back(pose);
+        }
+    }
+    if (poses.empty()) {
+        std::cerr << "No camera pose in " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Benchmark::run(const BenchmarkSettings& settings) {
+    // models and environments default to the viewer's
+    FileUtils::ConfigMap configMap = FileUtils::readConfigFile("config.ini");
+    BenchmarkSettings resolved = settings;
+    if (resolved.model.empty()) {
+        std::string defaultModel = FileUtils::getValue(configMap, "default.model");
+        resolved.model = StressScene::isSource(defaultModel) ? defaultModel : FileUtils::getValue(configMap, "folder.models") + "/" + defaultModel;
+    }
+    if (resolved.environment.empty()) {
+        resolved.environment = FileUtils::getValue(configMap, "folder.environments") + "/" + FileUtils::getValue(configMap, "default.environment");
+    }
+
+    std::vector<CameraPose> path;
+    if (!settings.cameraPath.empty() && !readCameraPath(settings.cameraPath, path)) {
+        return false;
+    }
+
+    if (!_context.init(settings.width, settings.height)) {
+        return false;
+    }
+    Profiler::get().init(true);
+    _renderer.init(settings.width, settings.height);
+    _scene.init(&_eventBus, settings.width / (float)settings.height);
+
+    // the scene uploads its data through the renderer, as in Engine
+    _eventBus.subscribe(EventType::LoadGpuMeshes, [&](const Event& event) {
+        _renderer.loadMeshes(_scene.getMeshes());
+        });
+    _eventBus.subscribe(EventType::ClearGpuMeshesAndTextures, [&](const Event& event) {
+        _renderer.clearMeshes(_scene.getMeshes());
+        _renderer.clearTextures(_scene.getMaterials());
+        });
+    _eventBus.subscribe(EventType::LoadTextureRenderData, [&](const Event& event) {
+        _renderer.loadTextureData(event.get<TextureBindingEvent>());
+        });
+
+    // load phases, waited for so that GPU uploads are included
+    Clock::time_point start = Clock::now();
+    _renderer.loadEnvironment(resolved.environment);
+    _renderer.finishEnvironmentLoading();
+    glFinish();
+    double environmentMs = elapsedMs(start);
+
+    start = Clock::now();
+    bool loaded = StressScene::isSource(resolved.model) ? _scene.loadStressScene(resolved.model) : _scene.loadGlb(resolved.model);
+    _renderer.finishUploads();
+    glFinish();
+    double modelMs = elapsedMs(start);
+    if (!loaded) {
+        _context.cleanup();
+        return false;
+    }
+    // the loads are profiler frame 0
+    Profiler::get().endFrame();
+
+    std::cout << "Rendering " << settings.warmupFrames << " + " << settings.frames << " frames at "
+        << settings.width << "x" << settings.height << std::endl;
+    std::vector<double> frameTimes;
+    frameTimes.reserve(settings.frames);
+    std::map<std::string, double> phases;
+    RenderStats peakStats;
+    for (int frame = 0; frame < settings.warmupFrames + settings.frames; ++frame) {
+        int measured = frame - settings.warmupFrames;
+        CameraPose pose;
+        if (!path.empty()) {
+            pose = path[std::max(measured, 0) % path.size()];
+        }
+        else {
+            // warmup frames stay at the start of the orbit
+            pose.azimuth = 2.0f * 3.14159265f * settings.orbitTurns * std::max(measured, 0) / settings.frames;
+            pose.elevation = settings.orbitElevation;
+            pose.distance = settings.orbitDistance;
+        }
+        _scene.camera.setPose(pose);
+
+        double frameMs = renderFrame();
+        if (measured >= 0) {
+            frameTimes.push_back(frameMs);
+            accumulatePeakStats(peakStats, _renderer.getStats());
+        }
+
+        // frame 0 comes back from the profiler a few frames later
+        const ProfileFrame& profiled = Profiler::get().getLastFrame();
+        if (phases.empty() && profiled.index == 0) {
+            for (const ProfileSample& sample : profiled.samples) {
+                phases[sample.name] += sample.cpuEnd - sample.cpuStart;
+            }
+        }
+    }
+
+    bool written = writeResults(resolved, frameTimes, environmentMs, modelMs, phases, peakStats);
+    _renderer.clearMeshes(_scene.getMeshes());
+    _renderer.clearTextures(_scene.getMaterials());
+    _context.cleanup();
+    return written;
+}
+
+double Benchmark::renderFrame() {
+    Clock::time_point start = Clock::now();
+    {
+        PROFILE_GPU_SCOPE("frame");
+        _renderer.update();
+        _renderer.render(_scene.getMeshes(), _scene.getOpaqueMeshes(), _scene.getTransparentMeshes(), _scene.camera);
+        // no swap offscreen, wait for the GPU so that the frame time covers its work
+        glFinish();
+    }
+    double frameMs = elapsedMs(start);
+    Profiler::get().endFrame();
+    return frameMs;
+}
+
+bool Benchmark::writeResults(const BenchmarkSettings& settings, std::vector<double> frameTimes, double environmentMs, double modelMs,
+    const std::map<std::string, double>& phases, const RenderStats& peakStats) const {
+    std::sort(frameTimes.begin(), frameTimes.end());
+    double mean = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / std::max<size_t>(frameTimes.size(), 1);
+    double p50 = percentile(frameTimes, 50.0);
+    double p95 = percentile(frameTimes, 95.0);
+    double p99 = percentile(frameTimes, 99.0);
+
+    std::cout << "Frame time: mean " << mean << " ms, p50 " << p50 << " ms, p95 " << p95 << " ms, p99 " << p99 << " ms" << std::endl;
+    std::cout << "Load: environment " << environmentMs << " ms, model " << modelMs << " ms" << std::endl;
+
+    std::ofstream file(settings.output);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create " << settings.output << std::endl;
+        return false;
+    }
+    file << std::fixed << std::setprecision(3);
+    file << "{\n";
+    file << "  \"model\": " << jsonString(settings.model) << ",\n";
+    file << "  \"environment\": " << jsonString(settings.environment) << ",\n";
+    file << "  \"renderer\": " << jsonString((const char*)glGetString(GL_RENDERER)) << ",\n";
+    file << "  \"width\": " << settings.width << ",\n";
+    file << "  \"height\": " << settings.height << ",\n";
+    file << "  \"frames\": " << frameTimes.size() << ",\n";
+    file << "  \"cameraPath\": " << jsonString(settings.cameraPath.empty() ? "orbit" : settings.cameraPath) << ",\n";
+    file << "  \"frameMs\": { \"mean\": " << mean << ", \"min\": " << frameTimes.front() << ", \"p50\": " << p50
+        << ", \"p95\": " << p95 << ", \"p99\": " << p99 << ", \"max\": " << frameTimes.back() << " },\n";
+    file << "  \"loadMs\": {\n";
+    file << "    \"environment\": " << environmentMs << ",\n";
+    file << "    \"model\": " << modelMs << ",\n";
+    file << "    \"phases\": {";
+    bool first = true;
+    for (const auto& [name, ms] : phases) {
+        file << (first ? "\n" : ",\n") << "      " << jsonString(name) << ": " << ms;
+        first = false;
+    }
+    file << (first ? "}\n" : "\n    }\n");
+    file << "  },\n";
+    file << "  \"renderStats\": {\n";
+    file << "    \"drawCalls\": " << peakStats.drawCalls << ",\n";
+    file << "    \"triangles\": " << peakStats.triangles << ",\n";
+    file << "    \"vertices\": " << peakStats.vertices << ",\n";
+    file << "    \"meshesCulled\": " << peakStats.meshesCulled << ",\n";
+    file << "    \"textureBinds\": " << peakStats.textureBinds << ",\n";
+    file << "    \"programSwitches\": " << peakStats.programSwitches << ",\n";
+    file << "    \"uniformUploads\": " << peakStats.uniformUploads << ",\n";
+    file << "    \"bufferBytesUploaded\": " << peakStats.bufferBytesUploaded << ",\n";
+    file << "    \"textureBytesUploaded\": " << peakStats.textureBytesUploaded << ",\n";
+    file << "    \"dynamicBytes\": " << peakStats.dynamicBytes << ",\n";
+    file << "    \"meshBytes\": " << peakStats.meshBytes << ",\n";
+    file << "    \"textureBytes\": " << peakStats.textureBytes << ",\n";
+    file << "    \"environmentBytes\": " << peakStats.environmentBytes << "\n";
+    file << "  }\n";
+    file << "}\n";
+    std::cout << "Results written to " << settings.output << std::endl;
+    return (bool)file;
+}
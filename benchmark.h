@@ -0,0 +1,83 @@
+#pragma once
+#include "headlessContext.h"
+#include "event.h"
+#include "scene.h"
+#include "renderer.h"
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Settings of a benchmark run, from the command line.
+ */
+struct BenchmarkSettings {
+    std::string model;              // GLB file, default.model of config.ini when empty
+    std::string environment;        // HDR, EXR or IBL file, default.environment of config.ini when empty
+    int width = 1280;               // Framebuffer width in pixels
+    int height = 720;               // Framebuffer height in pixels
+    int frames = 300;               // Measured frames
+    int warmupFrames = 10;          // Frames rendered before measuring
+    std::string cameraPath;         // Recorded camera path, the procedural orbit is used when empty
+    float orbitTurns = 1.0f;        // Turns of the procedural orbit over the measured frames
+    float orbitElevation = 0.3f;    // Elevation of the procedural orbit in radians
+    float orbitDistance = 2.0f;     // Distance of the procedural orbit
+    std::string output = "benchmark.json"; // Results file
+};
+
+/**
+ * Headless benchmark: loads a model and an environment in an offscreen context, renders a
+ * fixed number of frames along a camera path and writes the frame time percentiles and
+ * the load phase timings as JSON, so that every commit gets a reproducible number.
+ */
+class Benchmark {
+public:
+    /**
+     * Parses the benchmark options.
+     * @param argc Number of arguments, argv[0] excluded.
+     * @param argv The arguments.
+     * @param settings The settings to fill, defaults are kept for missing options.
+     * @return false on an unknown or incomplete option, the usage is printed.
+     */
+    static bool parseArguments(int argc, char** argv, BenchmarkSettings& settings);
+
+    /**
+     * Reads a camera path recorded by the viewer (--record-camera), one
+     * "azimuth elevation distance" line per frame.
+     * @param filepath The path file.
+     * @param poses The poses read.
+     * @return false if the file cannot be read or holds no pose.
+     */
+    static bool readCameraPath(const std::string& filepath, std::vector<CameraPose>& poses);
+
+    /**
+     * Runs the benchmark and writes its results.
+     * @param settings The benchmark settings.
+     * @return false if the context, the model or the results file could not be created.
+     */
+    bool run(const BenchmarkSettings& settings);
+
+private:
+    HeadlessContext _context;
+    Renderer _renderer;
+    Scene _scene;
+    EventBus _eventBus;
+
+    /**
+     * Renders one frame and waits for the GPU to finish it.
+     * @return The frame time in milliseconds.
+     */
+    double renderFrame();
+
+    /**
+     * Writes the results file.
+     * @param settings The benchmark settings.
+     * @param frameTimes Measured frame times in milliseconds.
+     * @param environmentMs Environment load time, decode and bake.
+     * @param modelMs Model load time, import and upload.
+     * @param phases Total time of each profiler scope during the loads, in milliseconds.
+     * @param peakStats Largest per-frame render statistics of the measured frames, resident VRAM of the last one.
+     * @return false if the file cannot be written.
+     */
+    bool writeResults(const BenchmarkSettings& settings, std::vector<double> frameTimes, double environmentMs, double modelMs,
+        const std::map<std::string, double>& phases, const RenderStats& peakStats) const;
+};
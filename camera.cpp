@@ -1,5 +1,7 @@
 #include "camera.h"
 #include <iostream>
+#include <cmath>
+#include <cstdlib>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/scalar_constants.hpp>
 #include <glm/ext/matrix_clip_space.hpp>
@@ -24,7 +26,9 @@ void Camera::updateTransform() {
 }
 
 void Camera::zoom(int zoom) {
-    _distance *= 1 - (zoom * _zoomSpeed);
+    // one step per wheel notch, so that notches summed over a frame zoom as much as separate ones
+    float step = zoom > 0 ? 1 - _zoomSpeed : 1 + _zoomSpeed;
+    _distance *= std::pow(step, (float)std::abs(zoom));
     // avoid zooming reaching zero
     _distance = glm::max(_distance, .001f);
     updateTransform();
@@ -41,3 +45,18 @@ void Camera::move(glm::vec2 delta) {
 void Camera::updateRatio(float ratio) {
     _perspective = glm::perspective(glm::radians(45.0f), ratio, 0.1f, 100.0f);
 }
+
+CameraPose Camera::getPose() const {
+    CameraPose pose;
+    pose.azimuth = _azimuth;
+    pose.elevation = _elevation;
+    pose.distance = _distance;
+    return pose;
+}
+
+void Camera::setPose(const CameraPose& pose) {
+    _azimuth = pose.azimuth;
+    _elevation = glm::clamp(pose.elevation, -glm::half_pi<float>(), glm::half_pi<float>());
+    _distance = glm::max(pose.distance, .001f);
+    updateTransform();
+}
@@ -2,6 +2,15 @@
 #include <glm/glm.hpp>
 #include "event.h"
 
+/**
+ * Orbit of the camera around its target, as recorded and replayed by camera paths.
+ */
+struct CameraPose {
+    float azimuth = 0.0f;     // Horizontal rotation angle in radians
+    float elevation = 0.0f;   // Vertical rotation angle in radians
+    float distance = 2.0f;    // Distance from the target
+};
+
 /**
  * The Camera class manages the view and projection transformations for rendering.
  * It allows zooming, movement, and ratio adjustments.
@@ -16,7 +25,7 @@ public:
 
     /**
      * Adjusts the zoom level of the camera.
-     * @param zoom The zoom amount to apply; positive to zoom in, negative to zoom out.
+     * @param zoom The number of zoom steps to apply; positive to zoom in, negative to zoom out.
      */
     void zoom(int zoom);
 
@@ -50,6 +59,18 @@ public:
      */
     glm::vec3 getPosition() const { return _position; }
 
+    /**
+     * Retrieves the camera's orbit around its target.
+     * @return The current azimuth, elevation and distance.
+     */
+    CameraPose getPose() const;
+
+    /**
+     * Places the camera on its orbit, used to replay camera paths.
+     * @param pose The azimuth, elevation and distance to set, the elevation is clamped like move() does.
+     */
+    void setPose(const CameraPose& pose);
+
 private:
     /**
      * Updates the camera's transformation matrix based on its position, target, and orientation.
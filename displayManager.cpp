@@ -1,8 +1,11 @@
 #include "displayManager.h"
+#include "profiler.h"
+#include "glCapture.h"
 #include <iostream>
 #include <glad/glad.h>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_opengl3.h>
+#include <algorithm>
 #include <filesystem>
 
 void DisplayManager::init(int screenWidth, int screenHeight, EventBus* eventBus, std::string folderModels, std::string folderEnvironments, std::string defaultModel, std::string defaultEnv) {
@@ -49,7 +52,6 @@ void DisplayManager::init(int screenWidth, int screenHeight, EventBus* eventBus,
     style.FrameRounding = 4.f;
     style.WindowRounding = 4.f;
     _io = &ImGui::GetIO();
-    _io->Fonts->AddFontFromFileTTF("C:\\Windows\\Fonts\\Arial.ttf", 24.f);
 
     // directories
     _modelPath = folderModels;
@@ -58,6 +60,8 @@ void DisplayManager::init(int screenWidth, int screenHeight, EventBus* eventBus,
     _envFiles = getFilesInDirectory(_texturePath, ".hdr");
     std::vector exrFiles = getFilesInDirectory(_texturePath, ".exr");
     _envFiles.insert(_envFiles.end(), exrFiles.begin(), exrFiles.end());
+    std::vector iblFiles = getFilesInDirectory(_texturePath, ".ibl");
+    _envFiles.insert(_envFiles.end(), iblFiles.begin(), iblFiles.end());
 
     for (int n = 0; n < _files.size(); n++) {
         if (_files[n].c_str() == defaultModel) {
@@ -70,6 +74,11 @@ void DisplayManager::init(int screenWidth, int screenHeight, EventBus* eventBus,
             _envSelectedId = n; break;
         }
     }
+
+    // the stress scene panel starts from the default model when it is one
+    if (StressScene::isSource(defaultModel)) {
+        StressScene::parseSettings(defaultModel, _stressSettings);
+    }
 }
 
 void DisplayManager::cleanup() {
@@ -89,11 +98,32 @@ void DisplayManager::resizeWindow() {
     glViewport(0, 0, _screenHeight, _screenWidth);
 }
 
+void DisplayManager::setVsync(const std::string& mode) {
+    int interval = 1;
+    if (mode == "off") interval = 0;
+    else if (mode == "adaptive") interval = -1;
+    else if (mode != "on") std::cout << "Unknown vsync mode " << mode << ", using on" << std::endl;
+
+    if (SDL_GL_SetSwapInterval(interval) != 0 && interval == -1) {
+        std::cout << "Adaptive vsync is not supported, using on" << std::endl;
+        SDL_GL_SetSwapInterval(1);
+    }
+}
+
+void DisplayManager::setFont(const std::string& filepath, float size) {
+    if (!std::filesystem::is_regular_file(filepath)) {
+        std::cout << "Font not found: " << filepath << ", using the default font" << std::endl;
+        return;
+    }
+    _io->Fonts->AddFontFromFileTTF(filepath.c_str(), size);
+}
+
 void DisplayManager::swapWindows() {
     SDL_GL_SwapWindow(_sdlWindow);
 }
 
 void DisplayManager::displayGui() {
+    PROFILE_GPU_SCOPE("imgui");
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame();
     ImGui::NewFrame();
@@ -104,7 +134,8 @@ void DisplayManager::displayGui() {
     float itemWidth = 250;
 
     // render mode combo
-    const char* renderModeItems[15] = { "PBR", "Albedo", "Normal", "Metallic", "Roughness", "F", "kD", "diffuse", "ambient", "irradiance", "prefilteredColor", "brdf x", "brdf y", "specular", "PBR Lights"};
+    const char* renderModeItems[18] = { "PBR", "Albedo", "Normal", "Metallic", "Roughness", "F", "kD", "diffuse", "ambient", "irradiance", "prefilteredColor", "brdf x", "brdf y", "specular", "PBR Lights",
+        "Overdraw", "Triangle density", "Mesh cost"};
     const char* renderModeComboPreviewValue = renderModeItems[_renderModeSelectedId];
     ImGui::SetNextItemWidth(itemWidth);
     if (ImGui::BeginCombo("DisplayMode", renderModeComboPreviewValue, 0)) {
@@ -113,7 +144,7 @@ void DisplayManager::displayGui() {
             if (ImGui::Selectable(renderModeItems[n], is_selected)) {
                 _renderModeSelectedId = n;
                 // change display mode
-                _eventBus->publish(Event(EventType::ChangeDisplayMode, _renderModeSelectedId));
+                _eventBus->post(Event(EventType::ChangeDisplayMode, _renderModeSelectedId));
             }
             if (is_selected)
                 ImGui::SetItemDefaultFocus();
@@ -130,7 +161,7 @@ void DisplayManager::displayGui() {
             if (ImGui::Selectable(_files[n].c_str(), is_selected)) {
                 _fileSelectedId = n;
                 // load new model
-                _eventBus->publish(Event(EventType::LoadGlb, (_modelPath + "/" + _files[_fileSelectedId]).c_str()));
+                _eventBus->post(Event(EventType::LoadGlb, _modelPath + "/" + _files[_fileSelectedId]));
             }
             if (is_selected)
                 ImGui::SetItemDefaultFocus();
@@ -147,7 +178,7 @@ void DisplayManager::displayGui() {
             if (ImGui::Selectable(_envFiles[n].c_str(), is_selected)) {
                 _envSelectedId = n;
                 // load new environment
-                _eventBus->publish(Event(EventType::LoadEnvironment, (_texturePath + "/" + _envFiles[_envSelectedId]).c_str()));
+                _eventBus->post(Event(EventType::LoadEnvironment, _texturePath + "/" + _envFiles[_envSelectedId]));
             }
             if (is_selected)
                 ImGui::SetItemDefaultFocus();
@@ -157,26 +188,332 @@ void DisplayManager::displayGui() {
 
     ImGui::SetNextItemWidth(itemWidth);
     if (ImGui::SliderFloat("env intensity", &_intensity, 0.0f, 5.0f, "%.3f")) {
-        _eventBus->publish(Event(EventType::UpdateEnvIntensity, _intensity));
+        _eventBus->post(Event(EventType::UpdateEnvIntensity, _intensity));
     }
 
     // Check if the checkbox was toggled this frame
     if (ImGui::Checkbox("Show Background", &_showBackgroundState)) {
         std::cout << _showBackgroundState << std::endl;
-        _eventBus->publish(Event(EventType::ShowBackgroundState, _showBackgroundState));
+        _eventBus->post(Event(EventType::ShowBackgroundState, _showBackgroundState));
     }
 
     //ImGui::Text("Framerate: %g", _io->Framerate);
     ImGui::SetNextItemWidth(40);
     ImGui::InputFloat("FPS", &_io->Framerate, 0, 0, "%.0f", ImGuiInputTextFlags_ReadOnly);
 
+    // GL capture waiting for its start
+    GlCapture& capture = GlCapture::get();
+    if (capture.isCapturing()) {
+        ImGui::Text("Capturing GL frames...");
+    }
+    else if (capture.isEnabled() && ImGui::Button("Capture GL frames")) {
+        capture.captureFrames();
+    }
+
+    // work and VRAM of the last frame
+    if (_renderStats && ImGui::CollapsingHeader("Render statistics")) {
+        const RenderStats& stats = *_renderStats;
+        const double MB = 1024.0 * 1024.0;
+        ImGui::Text("draw calls: %d", stats.drawCalls);
+        ImGui::Text("triangles: %llu", (unsigned long long)stats.triangles);
+        ImGui::Text("vertices: %llu", (unsigned long long)stats.vertices);
+        ImGui::Text("meshes culled: %d", stats.meshesCulled);
+        ImGui::Text("texture binds: %d", stats.textureBinds);
+        ImGui::Text("program switches: %d", stats.programSwitches);
+        ImGui::Text("uniform uploads: %d", stats.uniformUploads);
+        ImGui::Text("uploaded: buffers %.2f MB, textures %.2f MB", stats.bufferBytesUploaded / MB, stats.textureBytesUploaded / MB);
+        ImGui::Text("dynamic data: %.1f KB", stats.dynamicBytes / 1024.0);
+        ImGui::Text("VRAM: meshes %.1f MB, textures %.1f MB, environments %.1f MB", stats.meshBytes / MB, stats.textureBytes / MB, stats.environmentBytes / MB);
+    }
+
+    // RAM and VRAM held by the scene and the renderer
+    if (_memoryReport && ImGui::CollapsingHeader("Memory")) {
+        const MemoryReport& report = *_memoryReport;
+        const double MB = 1024.0 * 1024.0;
+        static const char* const residencyNames[] = { "keep", "compress", "drop" };
+        auto sum = [](const std::vector<MemoryEntry>& entries, size_t MemoryEntry::* bytes) {
+            size_t total = 0;
+            for (const MemoryEntry& entry : entries) {
+                total += entry.*bytes;
+            }
+            return total;
+        };
+        // dropped geometry cannot come back, a compressed one is restored to be kept
+        ImGui::SetNextItemWidth(itemWidth);
+        if (ImGui::BeginCombo("geometry residency", residencyNames[(int)report.residency], 0)) {
+            for (int n = 0; n < IM_ARRAYSIZE(residencyNames); n++) {
+                const bool is_selected = ((int)report.residency == n);
+                const bool dropped = report.residency == GeometryResidency::Drop && !is_selected;
+                if (ImGui::Selectable(residencyNames[n], is_selected, dropped ? ImGuiSelectableFlags_Disabled : 0) && !is_selected) {
+                    _eventBus->post(Event(EventType::ChangeGeometryResidency, n));
+                }
+                if (is_selected)
+                    ImGui::SetItemDefaultFocus();
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::Text("meshes: RAM %.1f MB, VRAM %.1f MB", sum(report.meshes, &MemoryEntry::cpuBytes) / MB, sum(report.meshes, &MemoryEntry::gpuBytes) / MB);
+        ImGui::Text("textures: RAM %.1f MB, VRAM %.1f MB", sum(report.textures, &MemoryEntry::cpuBytes) / MB, sum(report.textures, &MemoryEntry::gpuBytes) / MB);
+        ImGui::Text("environments: RAM %.1f MB, VRAM %.1f MB", sum(report.environments, &MemoryEntry::cpuBytes) / MB, sum(report.environments, &MemoryEntry::gpuBytes) / MB);
+        ImGui::Text("total: RAM %.1f MB, VRAM %.1f MB", report.cpuBytes / MB, report.gpuBytes / MB);
+        // live, released objects wait in the pool for a load of the same sizes
+        const GpuResourceManager& resources = GpuResourceManager::get();
+        ImGui::Text("GPU objects: %.1f MB, pooled %.1f MB", resources.getUsedBytes() / MB, resources.getPooledBytes() / MB);
+        if (resources.getBudget() > 0) {
+            ImGui::Text("budget: %.1f MB%s", resources.getBudget() / MB, resources.isOverBudget() ? " (exceeded)" : "");
+        }
+        ImGui::Text("pool: %llu reused, %llu created", (unsigned long long)resources.getPoolHits(), (unsigned long long)resources.getPoolMisses());
+        ImGui::Checkbox("Details", &_showMemoryDetails);
+    }
+
+    // procedural scene, one axis at a time for scaling tests
+    if (ImGui::CollapsingHeader("Stress scene")) {
+        ImGui::SetNextItemWidth(itemWidth);
+        ImGui::InputInt("meshes", &_stressSettings.meshes);
+        ImGui::SetNextItemWidth(itemWidth);
+        ImGui::InputInt("triangles/mesh", &_stressSettings.trianglesPerMesh, 100, 1000);
+        ImGui::SetNextItemWidth(itemWidth);
+        ImGui::InputInt("materials", &_stressSettings.materials);
+        ImGui::SetNextItemWidth(itemWidth);
+        ImGui::InputInt("texture size", &_stressSettings.textureSize, 64, 512);
+        ImGui::SetNextItemWidth(itemWidth);
+        ImGui::SliderFloat("transparent", &_stressSettings.transparentFraction, 0.0f, 1.0f, "%.2f");
+        ImGui::SetNextItemWidth(itemWidth);
+        ImGui::InputInt("instances", &_stressSettings.instances);
+        _stressSettings.meshes = std::max(1, _stressSettings.meshes);
+        _stressSettings.trianglesPerMesh = std::max(1, _stressSettings.trianglesPerMesh);
+        _stressSettings.materials = std::max(1, _stressSettings.materials);
+        _stressSettings.textureSize = std::max(0, _stressSettings.textureSize);
+        _stressSettings.instances = std::max(1, _stressSettings.instances);
+        if (ImGui::Button("Generate")) {
+            _eventBus->post(Event(EventType::LoadStressScene, StressScene::toSource(_stressSettings)));
+        }
+    }
+
     ImGui::End();
 
+    if (Profiler::get().isEnabled()) {
+        displayProfiler();
+    }
+    if (_meshCosts && _renderModeSelectedId == Renderer::RENDER_MODE_MESH_COST) {
+        displayMeshCosts();
+    }
+    if (_memoryReport && _showMemoryDetails) {
+        displayMemoryReport();
+    }
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 // Function to get all files in a specified directory
+void DisplayManager::displayProfiler() {
+    Profiler& profiler = Profiler::get();
+    const ProfileFrame& frame = profiler.getLastFrame();
+
+    ImGui::Begin("Profiler");
+
+    // capture and export
+    bool capturing = profiler.isCapturing();
+    if (ImGui::Checkbox("Record", &capturing)) {
+        if (capturing) profiler.startCapture();
+        else profiler.stopCapture();
+    }
+    ImGui::SameLine();
+    ImGui::Text("%d frames", (int)profiler.getCapturedFrameCount());
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace")) {
+        if (profiler.exportChromeTrace(_traceFile)) {
+            std::cout << "Trace written to " << _traceFile << std::endl;
+        }
+    }
+
+    // timeline: main thread scopes by depth, then GPU scopes by depth
+    double start = 0.0, end = 0.0;
+    int maxDepth = 0;
+    bool first = true;
+    for (const ProfileSample& sample : frame.samples) {
+        if (sample.thread != 0) continue;
+        double sampleStart = sample.gpuStart >= 0.0 ? std::min(sample.cpuStart, sample.gpuStart) : sample.cpuStart;
+        double sampleEnd = std::max(sample.cpuEnd, sample.gpuEnd);
+        start = first ? sampleStart : std::min(start, sampleStart);
+        end = first ? sampleEnd : std::max(end, sampleEnd);
+        maxDepth = std::max(maxDepth, sample.depth);
+        first = false;
+    }
+
+    const float rowHeight = 18.0f;
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    float height = rowHeight * 2 * (maxDepth + 1);
+    ImGui::InvisibleButton("timeline", ImVec2(width, height));
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    double scale = end > start ? width / (end - start) : 0.0;
+    ImVec2 mouse = ImGui::GetMousePos();
+    for (const ProfileSample& sample : frame.samples) {
+        if (sample.thread != 0) continue;
+        for (int gpu = 0; gpu < 2; ++gpu) {
+            double sampleStart = gpu ? sample.gpuStart : sample.cpuStart;
+            double sampleEnd = gpu ? sample.gpuEnd : sample.cpuEnd;
+            if (sampleStart < 0.0) continue;
+            ImVec2 min(origin.x + (float)((sampleStart - start) * scale), origin.y + rowHeight * (gpu * (maxDepth + 1) + sample.depth));
+            ImVec2 max(std::max(min.x + 1.0f, origin.x + (float)((sampleEnd - start) * scale)), min.y + rowHeight - 1.0f);
+            // stable color per scope name, FNV-1a over the characters without building a string
+            unsigned int hash = 2166136261u;
+            for (const char* c = sample.name; *c; ++c) {
+                hash = (hash ^ (unsigned char)*c) * 16777619u;
+            }
+            drawList->AddRectFilled(min, max, IM_COL32(80 + hash % 128, 80 + (hash >> 8) % 128, 80 + (hash >> 16) % 128, 255));
+            drawList->AddText(ImVec2(min.x + 2.0f, min.y + 1.0f), IM_COL32(255, 255, 255, 255), sample.name);
+            if (ImGui::IsItemHovered() && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+                ImGui::SetTooltip("%s (%s): %.3f ms", sample.name, gpu ? "GPU" : "CPU", sampleEnd - sampleStart);
+            }
+        }
+    }
+
+    // per-pass table
+    if (ImGui::BeginTable("passes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Pass");
+        ImGui::TableSetupColumn("CPU ms");
+        ImGui::TableSetupColumn("GPU ms");
+        ImGui::TableHeadersRow();
+        for (const ProfileSample& sample : frame.samples) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%*s%s%s", sample.depth * 2, "", sample.name, sample.thread != 0 ? " (worker)" : "");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", sample.cpuEnd - sample.cpuStart);
+            ImGui::TableNextColumn();
+            if (sample.gpuStart >= 0.0) ImGui::Text("%.3f", sample.gpuEnd - sample.gpuStart);
+            else ImGui::TextDisabled("-");
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
+void DisplayManager::displayMeshCosts() {
+    const std::vector<MeshCost>& costs = *_meshCosts;
+    ImGui::Begin("Mesh cost");
+
+    double totalMs = 0.0;
+    for (const MeshCost& cost : costs) {
+        totalMs += cost.gpuMs;
+    }
+    ImGui::Text("%d meshes, %.3f ms GPU", (int)costs.size(), totalMs);
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("meshes", 5, flags)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Mesh");
+        ImGui::TableSetupColumn("Triangles");
+        ImGui::TableSetupColumn("Pixels");
+        ImGui::TableSetupColumn("GPU ms", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+        ImGui::TableSetupColumn("ns/pixel");
+        ImGui::TableHeadersRow();
+
+        // costs change every frame, sort every frame
+        _meshCostOrder.resize(costs.size());
+        for (size_t i = 0; i < costs.size(); ++i) {
+            _meshCostOrder[i] = (int)i;
+        }
+        ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs();
+        if (sortSpecs && sortSpecs->SpecsCount > 0) {
+            int column = sortSpecs->Specs[0].ColumnIndex;
+            bool ascending = sortSpecs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+            auto key = [&costs, column](int i) {
+                const MeshCost& cost = costs[i];
+                switch (column) {
+                case 1: return (double)cost.triangles;
+                case 2: return (double)cost.pixels;
+                case 3: return cost.gpuMs;
+                default: return cost.pixels > 0 ? cost.gpuMs * 1e6 / cost.pixels : 0.0;
+                }
+            };
+            // ties in mesh order, as a stable sort would without its temporary buffer
+            std::sort(_meshCostOrder.begin(), _meshCostOrder.end(), [&](int a, int b) {
+                if (column == 0) {
+                    int order = costs[a].name.compare(costs[b].name);
+                    if (order != 0) return ascending ? order < 0 : order > 0;
+                    return a < b;
+                }
+                double keyA = key(a), keyB = key(b);
+                if (keyA != keyB) return ascending ? keyA < keyB : keyB < keyA;
+                return a < b;
+                });
+        }
+
+        // scenes can have thousands of meshes, only the visible rows are submitted
+        ImGuiListClipper clipper;
+        clipper.Begin((int)_meshCostOrder.size());
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const MeshCost& cost = costs[_meshCostOrder[row]];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", cost.name.empty() ? "-" : cost.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", (int)cost.triangles);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)cost.pixels);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.4f", cost.gpuMs);
+                ImGui::TableNextColumn();
+                if (cost.pixels > 0) ImGui::Text("%.2f", cost.gpuMs * 1e6 / cost.pixels);
+                else ImGui::TextDisabled("-");
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
+void DisplayManager::displayMemoryReport() {
+    const MemoryReport& report = *_memoryReport;
+    const double MB = 1024.0 * 1024.0;
+    ImGui::Begin("Memory", &_showMemoryDetails);
+
+    // one table per category, in load order
+    auto displayEntries = [MB](const char* label, const std::vector<MemoryEntry>& entries) {
+        if (!ImGui::TreeNodeEx(label, ImGuiTreeNodeFlags_DefaultOpen, "%s (%d)", label, (int)entries.size())) {
+            return;
+        }
+        ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+        float height = ImGui::GetTextLineHeightWithSpacing() * (std::min<size_t>(entries.size(), 12) + 2);
+        if (ImGui::BeginTable(label, 3, flags, ImVec2(0.0f, height))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Name");
+            ImGui::TableSetupColumn("RAM MB");
+            ImGui::TableSetupColumn("VRAM MB");
+            ImGui::TableHeadersRow();
+            // scenes can have thousands of meshes, only the visible rows are submitted
+            ImGuiListClipper clipper;
+            clipper.Begin((int)entries.size());
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                    const MemoryEntry& entry = entries[row];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%s", entry.name.empty() ? "-" : entry.name.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", entry.cpuBytes / MB);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", entry.gpuBytes / MB);
+                }
+            }
+            ImGui::EndTable();
+        }
+        ImGui::TreePop();
+    };
+    displayEntries("Meshes", report.meshes);
+    displayEntries("Textures", report.textures);
+    displayEntries("Environments", report.environments);
+
+    ImGui::End();
+}
+
 std::vector<std::string> DisplayManager::getFilesInDirectory(const std::string& directory, const std::string& extension) {
     std::vector<std::string> files;
     for (const auto& entry : std::filesystem::directory_iterator(directory)) {
@@ -1,5 +1,7 @@
 #pragma once
 #include "event.h"
+#include "renderer.h"
+#include "stressScene.h"
 #include <imgui.h>
 #include <SDL.h>
 
@@ -41,11 +43,49 @@ public:
      */
     void swapWindows();
 
+    /**
+     * Selects how buffer swaps synchronize with the display refresh.
+     * @param mode "off", "on" (vsync) or "adaptive" (vsync that tears instead of waiting
+     * when a frame is late, falls back to "on" if the driver does not support it).
+     */
+    void setVsync(const std::string& mode);
+
     /**
      * Renders the GUI elements on the screen.
      */
     void displayGui();
 
+    /**
+     * Sets the file written by the profiler overlay's export button.
+     * @param filepath Path of the Chrome trace JSON file.
+     */
+    void setTraceFile(const std::string& filepath) { _traceFile = filepath; }
+
+    /**
+     * Sets the per-mesh costs listed while the mesh cost display mode is selected.
+     * @param meshCosts Costs measured by the renderer, must outlive the DisplayManager.
+     */
+    void setMeshCosts(const std::vector<MeshCost>* meshCosts) { _meshCosts = meshCosts; }
+
+    /**
+     * Sets the render statistics shown in the Config window.
+     * @param stats Statistics of the renderer, must outlive the DisplayManager.
+     */
+    void setRenderStats(const RenderStats* stats) { _renderStats = stats; }
+
+    /**
+     * Sets the memory report shown in the Config window and its details window.
+     * @param report Report kept up to date by the engine, must outlive the DisplayManager.
+     */
+    void setMemoryReport(const MemoryReport* report) { _memoryReport = report; }
+
+    /**
+     * Replaces ImGui's built-in font, must be called before the first displayGui().
+     * @param filepath Path of a TTF font file, the built-in font is kept if it does not exist.
+     * @param size Font size in pixels.
+     */
+    void setFont(const std::string& filepath, float size);
+
 private:
     SDL_Window* _sdlWindow;            // Pointer to the SDL window
     SDL_GLContext _openGlContext;      // OpenGL context associated with the SDL window
@@ -63,6 +103,28 @@ private:
     std::string _texturePath;          // Path to the selected texture file
     std::vector<std::string> _files;   // List of available model files
     std::vector<std::string> _envFiles; // List of available environment files
+    std::string _traceFile = "trace.json"; // Chrome trace written by the profiler overlay
+    StressSceneSettings _stressSettings; // settings of the stress scene panel
+    const std::vector<MeshCost>* _meshCosts = nullptr; // costs listed by the mesh cost window
+    const RenderStats* _renderStats = nullptr; // statistics of the last rendered frame
+    std::vector<int> _meshCostOrder;   // mesh indices in the sort order of the mesh cost table
+    const MemoryReport* _memoryReport = nullptr; // memory held per mesh, texture and environment
+    bool _showMemoryDetails = false;   // memory window state
+
+    /**
+     * Renders the profiler overlay: timeline and per-pass table of the last profiled frame.
+     */
+    void displayProfiler();
+
+    /**
+     * Renders the table of the most expensive meshes, sortable by any column.
+     */
+    void displayMeshCosts();
+
+    /**
+     * Renders the memory window: the CPU and GPU bytes of every mesh, texture and environment.
+     */
+    void displayMemoryReport();
 
     /**
      * Retrieves files from a specified directory with a given file extension.
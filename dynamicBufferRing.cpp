@@ -0,0 +1,130 @@
+#include "dynamicBufferRing.h"
+#include "glCapture.h"
+#include <algorithm>
+#include <iostream>
+
+// Longest wait for a region in beginFrame(), before checking again
+static const GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+void DynamicBufferRing::init(GLenum target, size_t frameBytes, size_t alignment, int frames) {
+    _target = target;
+    _alignment = std::max<size_t>(1, alignment);
+    _frames = std::max(1, frames);
+    // the capture cannot record writes to mapped memory
+    _captured = GlCapture::get().isEnabled();
+    _persistent = GLAD_GL_ARB_buffer_storage && !_captured;
+    allocate(frameBytes);
+}
+
+void DynamicBufferRing::allocate(size_t frameBytes) {
+    if (_buffer != 0) {
+        // deleting the buffer unmaps it, the GPU keeps it until the frames in flight are done with it
+        glDeleteBuffers(1, &_buffer);
+        _mapping = nullptr;
+    }
+    for (GLsync& fence : _fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    _fences.assign(_frames, nullptr);
+    _region = 0;
+    _frameBytes = (frameBytes + _alignment - 1) / _alignment * _alignment;
+
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(_target, _buffer);
+    if (_persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(_target, _frameBytes * _frames, nullptr, flags);
+        _mapping = (uint8_t*)glMapBufferRange(_target, 0, _frameBytes * _frames, flags);
+        if (!_mapping) {
+            std::cerr << "Failed to map the dynamic buffer persistently, orphaning it every frame instead" << std::endl;
+            glDeleteBuffers(1, &_buffer);
+            glGenBuffers(1, &_buffer);
+            glBindBuffer(_target, _buffer);
+            _persistent = false;
+        }
+    }
+    if (!_persistent) {
+        glBufferData(_target, _frameBytes, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void DynamicBufferRing::beginFrame(size_t bytes) {
+    _head = 0;
+    if (bytes > _frameBytes) {
+        allocate(std::max(bytes, _frameBytes * 2));
+    }
+
+    if (_persistent) {
+        // the region was last written _frames frames ago, the GPU is usually done with it
+        GLsync& fence = _fences[_region];
+        if (fence) {
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                ++_waits;
+                do {
+                    status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+                } while (status == GL_TIMEOUT_EXPIRED);
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    else {
+        // fresh storage, the previous one is released once the GPU is done with it
+        glBindBuffer(_target, _buffer);
+        glBufferData(_target, _frameBytes, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void* DynamicBufferRing::map(size_t bytes, GLintptr& offset) {
+    size_t start = (_head + _alignment - 1) / _alignment * _alignment;
+    if (start + bytes > _frameBytes) {
+        return nullptr;
+    }
+    _head = start + bytes;
+    offset = (GLintptr)((_persistent ? _region * _frameBytes : 0) + start);
+    _mappedOffset = offset;
+    _mappedBytes = bytes;
+
+    if (_persistent) {
+        return _mapping + offset;
+    }
+    if (_captured) {
+        _staging.resize(bytes);
+        return _staging.data();
+    }
+    // nothing drawn this frame reads the range yet
+    glBindBuffer(_target, _buffer);
+    void* pointer = glMapBufferRange(_target, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!pointer) {
+        _mappedBytes = 0;
+    }
+    return pointer;
+}
+
+void DynamicBufferRing::unmap() {
+    if (_mappedBytes == 0) {
+        return;
+    }
+    // coherent persistent mappings need no flush
+    if (_captured) {
+        glBindBuffer(_target, _buffer);
+        glBufferSubData(_target, _mappedOffset, _mappedBytes, _staging.data());
+    }
+    else if (!_persistent) {
+        glBindBuffer(_target, _buffer);
+        if (!glUnmapBuffer(_target)) {
+            std::cerr << "Dynamic buffer contents lost while mapped" << std::endl;
+        }
+    }
+    _mappedBytes = 0;
+}
+
+void DynamicBufferRing::endFrame() {
+    if (_persistent) {
+        _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        _region = (_region + 1) % _frames;
+    }
+}
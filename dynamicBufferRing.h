@@ -0,0 +1,103 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Ring of buffer regions for the data rewritten every frame (per-frame and per-draw uniforms),
+ * written without the implicit synchronization and driver copies of glBufferData and
+ * glBufferSubData on a buffer still used by the frames in flight.
+ * With ARB_buffer_storage the buffer holds one region per frame in flight, mapped once with
+ * persistent coherent storage; a fence per region tells when the GPU is done reading it, so a
+ * frame only waits when the GPU is that many frames behind. Without it (the GL 4.1 context on
+ * macOS) the buffer is orphaned at the start of every frame and written through unsynchronized
+ * mappings of its fresh storage.
+ * While the GL capture is enabled, the orphaned buffer is written with glBufferSubData so that
+ * the capture holds the data. The buffer is created directly, not by the GpuResourceManager:
+ * immutable storage cannot be pooled with the other buffers. GL thread only.
+ */
+class DynamicBufferRing {
+public:
+    DynamicBufferRing() = default;
+    DynamicBufferRing(const DynamicBufferRing&) = delete;
+    DynamicBufferRing& operator=(const DynamicBufferRing&) = delete;
+
+    /**
+     * Creates the buffer, the GL context must be current.
+     * @param target Binding point the data is used from, e.g. GL_UNIFORM_BUFFER.
+     * @param frameBytes Initial size of a frame's region, grown by beginFrame() as needed.
+     * @param alignment Alignment of the ranges returned by map(), e.g. GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+     * @param frames Frames in flight, one region each.
+     */
+    void init(GLenum target, size_t frameBytes, size_t alignment, int frames = 3);
+
+    /**
+     * Starts writing a frame: waits for the GPU to be done with the region if needed, or
+     * orphans the buffer. Ranges bound from the previous frames must not be used anymore.
+     * @param bytes Most bytes map() is called for during the frame, alignment included.
+     * A larger region is allocated if needed.
+     */
+    void beginFrame(size_t bytes);
+
+    /**
+     * Reserves a range of the frame's region, to be written sequentially then unmapped before
+     * the draws using it. The memory is write-only: it must not be read back.
+     * @param bytes Size of the range.
+     * @param offset Receives the offset of the range in the buffer, for glBindBufferRange.
+     * @return Where to write the range, nullptr if the frame's region is full.
+     */
+    void* map(size_t bytes, GLintptr& offset);
+
+    /**
+     * Makes the range returned by the last map() visible to the GPU.
+     */
+    void unmap();
+
+    /**
+     * Ends the frame, its region is reused once the GPU is done with it.
+     */
+    void endFrame();
+
+    /**
+     * @return The GL name of the buffer, it changes when beginFrame() grows it.
+     */
+    GLuint getBuffer() const { return _buffer; }
+
+    /**
+     * @return true if the buffer is persistently mapped, false if it is orphaned every frame.
+     */
+    bool isPersistent() const { return _persistent; }
+
+    /**
+     * @return The bytes reserved by map() since beginFrame().
+     */
+    size_t getBytesWritten() const { return _head; }
+
+    /**
+     * @return The frames that had to wait for the GPU to release their region since the start.
+     */
+    uint64_t getWaits() const { return _waits; }
+
+private:
+    GLenum _target = GL_UNIFORM_BUFFER;
+    GLuint _buffer = 0;
+    size_t _frameBytes = 0;
+    size_t _alignment = 1;
+    int _frames = 3;
+    int _region = 0;                    // Region of the frame being written
+    std::vector<GLsync> _fences;        // Fence of the last frame that used each region
+    uint8_t* _mapping = nullptr;        // Whole buffer, persistent mode only
+    bool _persistent = false;
+    bool _captured = false;             // Written with glBufferSubData for the GL capture
+    std::vector<uint8_t> _staging;      // Range being written in the capture mode
+    size_t _head = 0;                   // Bytes reserved in the frame's region
+    GLintptr _mappedOffset = 0;         // Range of the last map(), until unmap()
+    size_t _mappedBytes = 0;
+    uint64_t _waits = 0;
+
+    /**
+     * (Re)creates the buffer with a region of the given size per frame.
+     */
+    void allocate(size_t frameBytes);
+};
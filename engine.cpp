@@ -1,5 +1,19 @@
 #include "engine.h"
+#include "allocationCounter.h"
 #include "fileUtils.h"
+#include "glCapture.h"
+#include "profiler.h"
+#include "stressScene.h"
+#include <thread>
+
+// Frames rendered after the last input so that ImGui settles (hover, focus, popups)
+static const int UI_SETTLE_FRAMES = 3;
+// Longest idle wait, events posted by other threads are dispatched at least this often
+static const int IDLE_WAIT_MS = 100;
+// Wait while an environment is decoded on a worker thread, the bake needs frequent updates
+static const int LOADING_WAIT_MS = 1;
+// Mouse motion posted per iteration by the allocation check, in pixels
+static const float CHECK_ORBIT_STEP = 4.0f;
 
 Engine::Engine(int screenWidth, int screenHeight) {
 
@@ -10,11 +24,89 @@ Engine::Engine(int screenWidth, int screenHeight) {
 	std::string folderEnvironments = FileUtils::getValue(configMap, "folder.environments");
 	std::string defaultModel = FileUtils::getValue(configMap, "default.model");
 	std::string defaultEnvironment = FileUtils::getValue(configMap, "default.environment");
+	int environmentCacheMB = std::stoi(FileUtils::getValue(configMap, "environment.cacheBudgetMB", "512"));
+	int bakeStepsPerFrame = std::stoi(FileUtils::getValue(configMap, "environment.bakeStepsPerFrame", "4"));
+	_renderOnDemand = FileUtils::getValue(configMap, "display.renderOnDemand", "1") != "0";
+	int maxFps = std::stoi(FileUtils::getValue(configMap, "display.maxFps", "0"));
+	std::string vsync = FileUtils::getValue(configMap, "display.vsync");
+	bool profilerEnabled = FileUtils::getValue(configMap, "profiler.enabled", "1") != "0";
+	std::string traceFile = FileUtils::getValue(configMap, "profiler.traceFile", "trace.json");
+	std::string font = FileUtils::getValue(configMap, "display.font");
+	float fontSize = std::stof(FileUtils::getValue(configMap, "display.fontSize", "24"));
+	std::string captureFile = FileUtils::getValue(configMap, "capture.file");
+	int captureStartFrame = std::stoi(FileUtils::getValue(configMap, "capture.startFrame", "-1"));
+	int captureFrames = std::stoi(FileUtils::getValue(configMap, "capture.frames", "1"));
+	std::string statsFile = FileUtils::getValue(configMap, "stats.file");
+	std::string metricsFile = FileUtils::getValue(configMap, "metrics.file");
+	std::string metricsAddress = FileUtils::getValue(configMap, "metrics.address", "127.0.0.1");
+	int metricsPort = std::stoi(FileUtils::getValue(configMap, "metrics.port", "0"));
+	int metricsIntervalMs = std::stoi(FileUtils::getValue(configMap, "metrics.intervalMs", "10000"));
+	std::string geometryResidency = FileUtils::getValue(configMap, "geometry.residency", "keep");
+	int gpuBudgetMB = std::stoi(FileUtils::getValue(configMap, "gpu.budgetMB", "0"));
+	int gpuPoolMB = std::stoi(FileUtils::getValue(configMap, "gpu.poolMB", "256"));
+	int uploadMBPerFrame = std::stoi(FileUtils::getValue(configMap, "upload.bytesPerFrameMB", "16"));
+	bool textureCompression = FileUtils::getValue(configMap, "texture.compression", "1") != "0";
+	std::string textureCacheFolder = FileUtils::getValue(configMap, "texture.cacheFolder", "cache/textures");
+	bool textureStreaming = FileUtils::getValue(configMap, "texture.streaming", "1") != "0";
+	int streamingMinSize = std::stoi(FileUtils::getValue(configMap, "texture.streamingMinSize", "256"));
+	int streamingBudgetMB = std::stoi(FileUtils::getValue(configMap, "texture.streamingBudgetMB", "0"));
+	bool textureArrays = FileUtils::getValue(configMap, "texture.arrays", "0") != "0";
 
 	_displayManager.init(screenWidth, screenHeight, &_eventBus, folderModels, folderEnvironments, defaultModel, defaultEnvironment);
+	if (!vsync.empty()) {
+		_displayManager.setVsync(vsync);
+	}
+	if (!font.empty()) {
+		_displayManager.setFont(font, fontSize);
+	}
+	if (profilerEnabled) {
+		Profiler::get().init(true);
+	}
+	_displayManager.setTraceFile(traceFile);
+	// hooked before the renderer creates its objects, the captured frames need them
+	if (!captureFile.empty()) {
+		GlCapture::get().init(captureFile, captureStartFrame, captureFrames, screenWidth, screenHeight);
+	}
+	if (maxFps > 0) {
+		_frameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / maxFps));
+	}
+	if (!metricsFile.empty() || metricsPort > 0) {
+		_metrics.init(metricsFile, metricsAddress, metricsPort, metricsIntervalMs);
+	}
 	_inputManager.init(&_eventBus);
+	GpuResourceManager::get().setBudget((size_t)gpuBudgetMB * 1024 * 1024);
+	GpuResourceManager::get().setPoolLimit((size_t)gpuPoolMB * 1024 * 1024);
 	_renderer.init(screenWidth, screenHeight);
+	_renderer.setEnvironmentCacheBudget((size_t)environmentCacheMB * 1024 * 1024);
+	_renderer.setBakeStepsPerFrame(bakeStepsPerFrame);
+	_renderer.setUploadBudget((size_t)uploadMBPerFrame * 1024 * 1024);
+	_renderer.setTextureStreaming(textureStreaming, streamingMinSize, (size_t)streamingBudgetMB * 1024 * 1024);
+	_renderer.setMaterialTextureArrays(textureArrays);
+	_displayManager.setMeshCosts(&_renderer.getMeshCosts());
+	_displayManager.setRenderStats(&_renderer.getStats());
+	_displayManager.setMemoryReport(&_memoryReport);
+	if (!statsFile.empty()) {
+		_statsFile.open(statsFile);
+		if (_statsFile.is_open()) {
+			_statsFile << "frame,";
+			RenderStats::writeCsvHeader(_statsFile);
+		}
+		else {
+			std::cerr << "Failed to create " << statsFile << std::endl;
+		}
+	}
 	_scene.init(&_eventBus, screenWidth / (float)screenHeight);
+	if (geometryResidency == "compress") {
+		_scene.setGeometryResidency(GeometryResidency::Compress);
+	}
+	else if (geometryResidency == "drop") {
+		_scene.setGeometryResidency(GeometryResidency::Drop);
+	}
+	else if (geometryResidency != "keep") {
+		std::cerr << "Unknown geometry.residency " << geometryResidency << ", the geometry is kept" << std::endl;
+	}
+	// BC4 and BC5 are core, without BC7 the diffuse textures are uploaded uncompressed
+	_scene.setTextureCompression(textureCompression, Renderer::supportsBc7(), textureCacheFolder);
 
 	// Events management
 	// -----------------
@@ -24,11 +116,11 @@ Engine::Engine(int screenWidth, int screenHeight) {
 		});
 	// move view
 	_eventBus.subscribe(EventType::Move, [&](const Event& event) {
-		_scene.camera.move(event.vec2);
+		_scene.camera.move(event.get<glm::vec2>());
 		});
 	// zoom view
 	_eventBus.subscribe(EventType::Zoom, [&](const Event& event) {
-		_scene.camera.zoom(event.intValue);
+		_scene.camera.zoom(event.get<int>());
 		});
 	// resize sdl window
 	_eventBus.subscribe(EventType::ResizeSdlWindow, [&](const Event& event) {
@@ -36,28 +128,40 @@ Engine::Engine(int screenWidth, int screenHeight) {
 		});
 	// Resize camera
 	_eventBus.subscribe(EventType::ResizeWindow, [&](const Event& event) {
-		_renderer.resizeViewport(event.vec2);
-		_scene.camera.updateRatio(event.vec2.x / (float)event.vec2.y);
+		_renderer.resizeViewport(event.get<glm::vec2>());
+		_scene.camera.updateRatio(event.get<glm::vec2>().x / (float)event.get<glm::vec2>().y);
 		});
 	// load new 3D model
 	_eventBus.subscribe(EventType::LoadGlb, [&](const Event& event) {
-		_scene.loadGlb(event.strValue);
+		loadModel(event.get<std::string>());
+		});
+	// generate a stress scene
+	_eventBus.subscribe(EventType::LoadStressScene, [&](const Event& event) {
+		loadModel(event.get<std::string>());
 		});
 	// load new environment
 	_eventBus.subscribe(EventType::LoadEnvironment, [&](const Event& event) {
-		_renderer.loadEnvironment(event.strValue);
+		loadEnvironment(event.get<std::string>());
 		});
 	// change dipslay mode
 	_eventBus.subscribe(EventType::ChangeDisplayMode, [&](const Event& event) {
-		_renderer.setRenderMode(event.intValue);
+		_renderer.setRenderMode(event.get<int>());
 		});
 	// change background visibility
 	_eventBus.subscribe(EventType::ShowBackgroundState, [&](const Event& event) {
-		_renderer.setShowBackground(event.boolValue);
+		_renderer.setShowBackground(event.get<bool>());
 		});
 	// change environment intensity
 	_eventBus.subscribe(EventType::UpdateEnvIntensity, [&](const Event& event) {
-		_renderer.setEnvIntensity(event.floatValue);
+		_renderer.setEnvIntensity(event.get<float>());
+		});
+	// change what the meshes keep in RAM, applied once the uploads of a loading model are done
+	_eventBus.subscribe(EventType::ChangeGeometryResidency, [&](const Event& event) {
+		_scene.setGeometryResidency((GeometryResidency)event.get<int>());
+		if (!_modelUploading) {
+			_scene.applyGeometryResidency();
+			updateMemoryReport();
+		}
 		});
 	// load mesh data to GPU
 	_eventBus.subscribe(EventType::LoadGpuMeshes, [&](const Event& event) {
@@ -70,21 +174,157 @@ Engine::Engine(int screenWidth, int screenHeight) {
 		});
 	// load texture data to GPU
 	_eventBus.subscribe(EventType::LoadTextureRenderData, [&](const Event& event) {
-		_renderer.loadTextureData(event.textureBindingEvent);
+		_renderer.loadTextureData(event.get<TextureBindingEvent>());
 		});
 
 	// Load first environment and model
 	// --------------------------------
-	_renderer.loadEnvironment(folderEnvironments + "/" + defaultEnvironment);
-	_scene.loadGlb(folderModels + "/" + defaultModel);
+	// the first environment is waited for, later ones load in the background
+	loadEnvironment(folderEnvironments + "/" + defaultEnvironment);
+	_renderer.finishEnvironmentLoading();
+	_environmentLoading = false;
+	_metrics.observeEnvironmentLoad(std::chrono::duration<double>(std::chrono::steady_clock::now() - _environmentLoadStart).count());
+	loadModel(StressScene::isSource(defaultModel) ? defaultModel : folderModels + "/" + defaultModel);
+}
+
+void Engine::loadModel(const std::string& source) {
+	auto start = std::chrono::steady_clock::now();
+	bool loaded = StressScene::isSource(source) ? _scene.loadStressScene(source) : _scene.loadGlb(source);
+	_metrics.observeModelLoad(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), loaded);
+	_modelUploading = true;
+	updateMemoryReport();
+}
+
+void Engine::loadEnvironment(const std::string& filepath) {
+	_renderer.loadEnvironment(filepath);
+	// a newer request replaces the load in progress, it is measured from its own request
+	_environmentLoadStart = std::chrono::steady_clock::now();
+	_environmentLoading = true;
+}
+
+void Engine::updateMemoryReport() {
+	_renderer.reportMemory(_scene.getMeshes(), _scene.getGeometry(), _scene.getMaterials(), _memoryReport);
 }
 
 void Engine::loop() {
 	// main loop
 	while (_running) {
-		_inputManager.handleInputs();
+		runIteration();
+	}
+}
+
+bool Engine::checkAllocations(int warmupFrames, int frames) {
+	int allocatingFrames = 0;
+	uint64_t allocations = 0;
+	for (int i = 0; i < warmupFrames + frames && _running; ++i) {
+		uint64_t before = AllocationCounter::getCount();
+		// orbit as a mouse drag would
+		_eventBus.post(Event(EventType::Move, glm::vec2(CHECK_ORBIT_STEP, 0.0f)));
+		_dirty = true;
+		runIteration();
+		uint64_t count = AllocationCounter::getCount() - before;
+		if (i >= warmupFrames && count > 0) {
+			std::cerr << "Frame " << i - warmupFrames << ": " << count << " allocations" << std::endl;
+			++allocatingFrames;
+			allocations += count;
+		}
+	}
+	if (allocatingFrames > 0) {
+		std::cerr << allocatingFrames << " of " << frames << " frames allocated, " << allocations << " allocations" << std::endl;
+		return false;
+	}
+	std::cout << "No allocations in " << frames << " frames" << std::endl;
+	return true;
+}
+
+void Engine::runIteration() {
+	// captured and measured frames are rendered back to back
+	if (GlCapture::get().isCapturing() || _renderer.isMeasuringMeshCosts()) {
+		_dirty = true;
+	}
+
+	// nothing to draw: sleep in SDL until an input arrives
+	int waitMs = 0;
+	if (_renderOnDemand && !_dirty && _uiFramesLeft == 0) {
+		waitMs = _renderer.isLoadingEnvironment() || _renderer.isUploading() ? LOADING_WAIT_MS : IDLE_WAIT_MS;
+	}
+	if (_inputManager.handleInputs(waitMs)) {
+		_uiFramesLeft = UI_SETTLE_FRAMES;
+	}
+
+	// every event changes the camera, the scene, the environment or a setting
+	{
+		PROFILE_SCOPE("events");
+		if (_eventBus.dispatch() > 0) {
+			_dirty = true;
+		}
+	}
+	if (_renderer.update()) {
+		_dirty = true;
+	}
+	if (_environmentLoading && !_renderer.isLoadingEnvironment()) {
+		_environmentLoading = false;
+		_metrics.observeEnvironmentLoad(std::chrono::duration<double>(std::chrono::steady_clock::now() - _environmentLoadStart).count());
+		updateMemoryReport();
+	}
+	if (_modelUploading && !_renderer.isUploading()) {
+		_modelUploading = false;
+		_scene.applyGeometryResidency();
+		updateMemoryReport();
+	}
+
+	if (!_renderOnDemand || _dirty || _uiFramesLeft > 0) {
+		auto frameStart = std::chrono::steady_clock::now();
+		renderFrame();
+		_metrics.observeFrame(std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count());
+		_metrics.observeProfile(Profiler::get().getLastFrame());
+		_dirty = false;
+		_uiFramesLeft = std::max(0, _uiFramesLeft - 1);
+		limitFrameRate();
+	}
+	_metrics.update(_renderer);
+}
+
+void Engine::recordCameraPath(const std::string& filepath) {
+	_cameraPathFile.open(filepath);
+	if (!_cameraPathFile.is_open()) {
+		std::cerr << "Failed to create " << filepath << std::endl;
+		return;
+	}
+	_cameraPathFile << "# azimuth elevation distance" << std::endl;
+}
+
+void Engine::renderFrame() {
+	if (_cameraPathFile.is_open()) {
+		CameraPose pose = _scene.camera.getPose();
+		_cameraPathFile << pose.azimuth << " " << pose.elevation << " " << pose.distance << "\n";
+	}
+	{
+		PROFILE_GPU_SCOPE("frame");
 		_renderer.render(_scene.getMeshes(), _scene.getOpaqueMeshes(), _scene.getTransparentMeshes(), _scene.camera);
+		if (_statsFile.is_open()) {
+			_statsFile << _statsFrame++ << ",";
+			_renderer.getStats().writeCsvRow(_statsFile);
+		}
 		_displayManager.displayGui();
-		_displayManager.swapWindows();
+		{
+			PROFILE_SCOPE("swap");
+			_displayManager.swapWindows();
+		}
+	}
+	Profiler::get().endFrame();
+	GlCapture::get().endFrame();
+}
+
+void Engine::limitFrameRate() {
+	if (_frameInterval.count() == 0) {
+		return;
+	}
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	// restart the schedule after an idle period or a long frame instead of catching up
+	if (_nextFrameTime < now - _frameInterval) {
+		_nextFrameTime = now;
 	}
+	_nextFrameTime += _frameInterval;
+	std::this_thread::sleep_until(_nextFrameTime);
 }
\ No newline at end of file
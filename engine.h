@@ -4,6 +4,9 @@
 #include "event.h"
 #include "scene.h"
 #include "renderer.h"
+#include "metricsExporter.h"
+#include <chrono>
+#include <fstream>
 
 /**
  * The Engine class serves as the main controller for the application, managing
@@ -23,6 +26,22 @@ public:
 	 * Starts the main application loop
 	 */
 	void loop();
+
+	/**
+	 * Checks that steady-state frames do not allocate: orbits the camera for warmupFrames loop
+	 * iterations, for the buffers to reach their size, then counts the operator new calls of the
+	 * next iterations. ImGui allocates with malloc and is not counted.
+	 * @param warmupFrames iterations run before counting
+	 * @param frames iterations counted
+	 * @return true if none of the counted iterations allocated
+	 */
+	bool checkAllocations(int warmupFrames, int frames);
+
+	/**
+	 * Writes the camera pose of every rendered frame to a file, replayed by the benchmark mode.
+	 * @param filepath Path of the camera path file.
+	 */
+	void recordCameraPath(const std::string& filepath);
 private:
 	// Renderer responsible for rendering the scene onto the screen
 	Renderer _renderer;
@@ -42,5 +61,73 @@ private:
 	
 	// main loop condition
 	bool _running = true;
+
+	// render only when something changed, block waiting for input otherwise
+	bool _renderOnDemand = true;
+
+	// something changed since the last rendered frame
+	bool _dirty = true;
+
+	// frames still to render after the last input, ImGui needs a few to settle hover and focus states
+	int _uiFramesLeft = 0;
+
+	// minimum time between two frames, zero when the frame rate is not capped
+	std::chrono::steady_clock::duration _frameInterval{ 0 };
+
+	// earliest start of the next frame when the frame rate is capped
+	std::chrono::steady_clock::time_point _nextFrameTime;
+
+	// camera path being recorded, closed when not recording
+	std::ofstream _cameraPathFile;
+
+	// Prometheus metrics, disabled unless configured
+	MetricsExporter _metrics;
+
+	// start of the environment load in progress, for the metrics
+	std::chrono::steady_clock::time_point _environmentLoadStart;
+	bool _environmentLoading = false;
+
+	// the meshes and textures of the model are still uploading, its geometry residency is applied after
+	bool _modelUploading = false;
+
+	// per-frame render statistics log (stats.file), closed when not logging
+	std::ofstream _statsFile;
+	int _statsFrame = 0;
+
+	// memory held per mesh, texture and environment, rebuilt after the loads
+	MemoryReport _memoryReport;
+
+	/**
+	 * One iteration of the main loop: waits for or handles the inputs, dispatches the events
+	 * and renders a frame if needed.
+	 */
+	void runIteration();
+
+	/**
+	 * Renders the scene and the GUI and swaps the buffers.
+	 */
+	void renderFrame();
+
+	/**
+	 * Loads a GLB file or generates a stress scene, timed for the metrics.
+	 * @param source Path of the GLB file or "stress:" source.
+	 */
+	void loadModel(const std::string& source);
+
+	/**
+	 * Starts loading an environment, its duration is measured until the renderer finishes it.
+	 * @param filepath Path of the environment file.
+	 */
+	void loadEnvironment(const std::string& filepath);
+
+	/**
+	 * Rebuilds the memory report shown by the GUI.
+	 */
+	void updateMemoryReport();
+
+	/**
+	 * Sleeps until the next frame may start, according to display.maxFps.
+	 */
+	void limitFrameRate();
 };
 
@@ -0,0 +1,52 @@
+#pragma once
+#include "gpuResourceManager.h"
+#include "hdrImage.h"
+#include "iblFile.h"
+#include <glad/glad.h>
+#include <future>
+#include <string>
+#include <vector>
+
+// Struct to hold environment maps for IBL (Image-Based Lighting)
+struct Environment {
+	std::string filepath;           // Source file the maps were baked from
+	TextureHandle prefilterMap;     // Prefiltered environment map for reflections
+	TextureHandle irradianceMap;    // Low-resolution irradiance map for diffuse lighting
+	TextureHandle envCubemap;       // Original environment cubemap
+	size_t bytes = 0;               // VRAM used by the maps
+};
+
+// Passes of an environment bake, in execution order
+enum class BakePass {
+	Cubemap,            // equirectangular image to cubemap
+	CubemapMipmaps,     // mip chain of the cubemap, sampled by the prefilter pass
+	Irradiance,         // diffuse irradiance convolution
+	Prefilter           // specular GGX prefilter, one roughness per mip
+};
+
+// One unit of bake work: a square tile of one face of one mip level
+struct BakeStep {
+	BakePass pass;
+	int face = 0;                   // cubemap face, 0 to 5
+	int mip = 0;                    // mip level written
+	int faceSize = 0;               // size of that mip level in pixels
+	int x = 0, y = 0, size = 0;     // tile rectangle within the face
+};
+
+// What the worker thread read: an equirectangular image to bake, or maps baked offline (.ibl)
+struct EnvironmentSource {
+	HdrImage image;                 // empty if the file could not be read or is an .ibl file
+	BakedEnvironment baked;         // empty unless the file is an .ibl file
+};
+
+// An environment decoded on a worker thread, then baked a few steps per frame on the GL thread
+struct EnvironmentLoad {
+	std::future<EnvironmentSource> decode; // result of the worker thread
+	Environment environment;        // maps being baked
+	TextureHandle hdrTexture;       // uploaded equirectangular image
+	FramebufferHandle captureFBO;   // framebuffer the bake renders into
+	RenderbufferHandle captureRBO;  // depth attachment of the capture framebuffer
+	int captureRBOSize = 0;         // current size of the depth attachment
+	std::vector<BakeStep> steps;    // remaining work, filled once the decode is done
+	size_t nextStep = 0;            // index of the next step to run
+};
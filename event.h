@@ -1,8 +1,15 @@
 #pragma once
+#include "eventQueue.h"
 #include "mesh.h"
+#include "textureCompressor.h"
 #include <glm/glm.hpp>
 #include <SDL.h>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 #include <functional>
 #include <algorithm>
@@ -20,16 +27,19 @@ enum class EventType {
     ResizeSdlWindow,         // Event for resizing the SDL window
     ResizeWindow,            // Event for resizing the application's main window
     LoadGlb,                 // Event for loading a GLB model
+    LoadStressScene,         // Event for generating a procedural stress scene
     LoadGpuMeshes,           // Event for loading GPU mesh data
     LoadTextureRenderData,   // Event for loading texture data for rendering
     ClearGpuMeshesAndTextures, // Event for clearing GPU resources
     LoadEnvironment,         // Event for loading an environment texture
-    UpdateEnvIntensity       // Update Environment intensity
+    UpdateEnvIntensity,      // Update Environment intensity
+    ChangeGeometryResidency  // Event for changing what the meshes of the scene keep in RAM
 };
 
 /**
  * Structure representing the necessary information for binding a texture
- * to a material during rendering.
+ * to a material during rendering. The image is shared with the loader, so that a queued
+ * event keeps it alive after the loader has released its own reference.
  */
 struct TextureBindingEvent {
     TextureBindingEvent() {}
@@ -38,80 +48,77 @@ struct TextureBindingEvent {
      * Initializes a TextureBindingEvent with material and texture data.
      * @param material Pointer to the material to which the texture is bound.
      * @param type The type of the texture (e.g., diffuse, normal, etc.).
-     * @param imageData Pointer to the texture data in memory.
+     * @param imageData The texture data in memory, shared with the event.
      * @param channels Number of color channels in the texture.
      * @param width Width of the texture in pixels.
      * @param height Height of the texture in pixels.
      */
-    TextureBindingEvent(Material* material, TextureType type, unsigned char* imageData, int channels, int width, int height)
-        : material(material), type(type), imageData(imageData), channels(channels), width(width), height(height) {}
-
-    const unsigned char* imageData; // Pointer to the image data in memory
-    int width, height, channels;    // Width, height, and color channels of the image
-    Material* material;             // Pointer to the material associated with this texture
-    TextureType type;               // Type of texture (Diffuse, Normal, etc.)
+    TextureBindingEvent(Material* material, TextureType type, std::shared_ptr<const unsigned char> imageData, int channels, int width, int height)
+        : imageData(std::move(imageData)), width(width), height(height), channels(channels), material(material), type(type) {}
+
+    std::shared_ptr<const unsigned char> imageData; // Image data, null for a compressed texture
+    int width = 0, height = 0, channels = 0;        // Width, height, and color channels of the image
+    Material* material = nullptr;   // Material of the scene's model, cleared by a later event than this one
+    TextureType type = TextureType::Diffuse; // Type of texture (Diffuse, Normal, etc.)
+    std::shared_ptr<const CompressedTexture> compressed; // Block-compressed mip chain, uploaded instead of imageData if set
 };
 
+// Payload of an event, owned by the event so that it can be queued safely
+using EventPayload = std::variant<std::monostate, glm::vec2, bool, int, float, std::string, TextureBindingEvent>;
+
 /**
- * Structure representing an event with various possible types and data payloads,
- * allowing it to hold data relevant to a wide range of event types.
+ * Structure representing an event and its typed payload, allowing it to hold data
+ * relevant to a wide range of event types.
  */
 struct Event {
     EventType type;            // Type of event
-    glm::vec2 vec2;            // 2D vector, e.g., for movement or scaling
-    SDL_EventType sdlEvent;    // SDL-specific event type
-
-    bool boolValue;            // Boolean value payload, e.g. for show background
-    int intValue = 0;          // Integer value payload, e.g., for zoom level
-    float floatValue = 1.0f;   // Float value payload, e.g., for scaling
-    const char* strValue;      // String payload, e.g., for filenames
-    TextureBindingEvent textureBindingEvent; // Payload for texture binding events
+    EventPayload payload;      // Data of the event, read with get<T>()
 
     /**
-     * Constructor for generic Move events.
+     * Constructor for events without payload.
      * @param type The type of event.
      */
     Event(EventType type) : type(type) {}
 
     /**
-     * Constructor for events with a 2D vector payload.
+     * Constructor for events with a 2D vector payload, e.g., for movement or scaling.
      * @param type The type of event.
      * @param vec2 The 2D vector data associated with this event.
      */
     Event(EventType type, glm::vec2 vec2)
-        : type(type), vec2(vec2) {}
+        : type(type), payload(std::in_place_type<glm::vec2>, vec2) {}
 
     /**
-     * Constructor for events with a boolean payload.
+     * Constructor for events with a boolean payload, e.g. for show background.
      * @param type The type of event.
      * @param boolValue The boolean data associated with this event.
      */
     Event(EventType type, bool boolValue)
-        : type(type), boolValue(boolValue) {}
+        : type(type), payload(std::in_place_type<bool>, boolValue) {}
 
     /**
-     * Constructor for events with an integer payload.
+     * Constructor for events with an integer payload, e.g., for zoom level.
      * @param type The type of event.
      * @param intValue The integer data associated with this event.
      */
     Event(EventType type, int intValue)
-        : type(type), intValue(intValue) {}
+        : type(type), payload(std::in_place_type<int>, intValue) {}
 
     /**
-     * Constructor for events with a float payload.
+     * Constructor for events with a float payload, e.g., for scaling.
      * @param type The type of event.
      * @param floatValue The float data associated with this event.
      */
     Event(EventType type, float floatValue)
-        : type(type), floatValue(floatValue) {}
+        : type(type), payload(std::in_place_type<float>, floatValue) {}
 
     /**
-     * Constructor for events with a string payload.
+     * Constructor for events with a string payload, e.g., for filenames. The string is copied.
      * @param type The type of event.
      * @param strValue The string data associated with this event.
      */
-    Event(EventType type, const char* strValue)
-        : type(type), strValue(strValue) {}
+    Event(EventType type, std::string strValue)
+        : type(type), payload(std::in_place_type<std::string>, std::move(strValue)) {}
 
     /**
      * Constructor for events with a TextureBindingEvent payload.
@@ -119,7 +126,13 @@ struct Event {
      * @param textureBindingEvent The TextureBindingEvent data associated with this event.
      */
     Event(EventType type, TextureBindingEvent textureBindingEvent)
-        : type(type), textureBindingEvent(textureBindingEvent) {}
+        : type(type), payload(std::in_place_type<TextureBindingEvent>, std::move(textureBindingEvent)) {}
+
+    /**
+     * @return The payload, T must be the type the event was constructed with.
+     */
+    template <typename T>
+    const T& get() const { return std::get<T>(payload); }
 };
 
 /**
@@ -136,11 +149,12 @@ public:
      * @param callback The callback function to invoke when an event of this type is published.
      */
     void subscribe(EventType type, EventCallback callback) {
-        subscribers[type].push_back(callback);
+        subscribers[type].push_back(std::move(callback));
     }
 
     /**
-     * Publishes an event to all subscribers of the given event type.
+     * Publishes an event to all subscribers of the given event type, immediately.
+     * Only for the main (GL) thread, when the subscribers must run before the caller continues.
      * @param event The event to publish to subscribers.
      */
     void publish(const Event& event) const {
@@ -152,6 +166,30 @@ public:
         }
     }
 
+    /**
+     * Queues an event for the next dispatch(), callable from any thread.
+     * @param event The event to queue.
+     */
+    void post(Event event) {
+        if (!_queue.push(std::move(event))) {
+            std::cerr << "Event queue full, event dropped" << std::endl;
+        }
+    }
+
+    /**
+     * Publishes the queued events in order, called once per frame by the main thread.
+     * @return The number of events published.
+     */
+    size_t dispatch() {
+        size_t count = 0;
+        while (std::optional<Event> event = _queue.pop()) {
+            publish(*event);
+            ++count;
+        }
+        return count;
+    }
+
 private:
     std::unordered_map<EventType, std::vector<EventCallback>> subscribers; // Map of subscribers for each event type
+    EventQueue<Event, 1024> _queue;  // Events posted since the last dispatch
 };
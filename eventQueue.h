@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+/**
+ * Bounded lock-free queue for many producer threads and a single consumer thread.
+ * Each cell carries a sequence number telling whether it is free for the producer
+ * holding that position or filled for the consumer, so producers only contend on
+ * a compare-and-swap of the enqueue position and never wait for each other.
+ * @tparam T Type of the queued values.
+ * @tparam Capacity Number of cells, a power of two.
+ */
+template <typename T, size_t Capacity>
+class EventQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    EventQueue() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    EventQueue(const EventQueue&) = delete;
+    EventQueue& operator=(const EventQueue&) = delete;
+
+    /**
+     * Appends a value, callable from any thread.
+     * @param value The value to append.
+     * @return false if the queue is full, the value is then dropped.
+     */
+    bool push(T value) {
+        size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &_cells[position & (Capacity - 1)];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+            if (difference == 0) {
+                // the cell is free, claim the position
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (difference < 0) {
+                // the consumer has not freed this cell yet
+                return false;
+            }
+            else {
+                // another producer claimed it first
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Removes the oldest value, only from the consumer thread.
+     * @return The value, or nothing if the queue is empty.
+     */
+    std::optional<T> pop() {
+        Cell& cell = _cells[_dequeuePosition & (Capacity - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != _dequeuePosition + 1) {
+            return std::nullopt;
+        }
+        std::optional<T> value = std::move(cell.value);
+        cell.value.reset();
+        cell.sequence.store(_dequeuePosition + Capacity, std::memory_order_release);
+        ++_dequeuePosition;
+        return value;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        std::optional<T> value;
+    };
+
+    Cell _cells[Capacity];
+    // producers and the consumer write to separate cache lines
+    alignas(64) std::atomic<size_t> _enqueuePosition{ 0 };
+    alignas(64) size_t _dequeuePosition = 0;
+};
@@ -17,7 +17,7 @@ namespace FileUtils {
      * @param filename The path to the configuration file.
      * @return A ConfigMap containing all the key-value pairs from the file.
      */
-    ConfigMap readConfigFile(const std::string& filename) {
+    inline ConfigMap readConfigFile(const std::string& filename) {
         ConfigMap config;
         std::ifstream file(filename);   // Opens the file
         std::string line;
@@ -49,7 +49,7 @@ namespace FileUtils {
      * @param defaultValue The default value to return if the key is not found.
      * @return The value associated with the key, or the default value if not found.
      */
-    std::string getValue(const ConfigMap& config, const std::string& key, const std::string& defaultValue = "") {
+    inline std::string getValue(const ConfigMap& config, const std::string& key, const std::string& defaultValue = "") {
         auto it = config.find(key);  // Searches for the key
         if (it != config.end()) {
             return it->second;       // Returns the value if key is found
@@ -63,7 +63,7 @@ namespace FileUtils {
      * @param filename The path to the file.
      * @return A string containing the contents of the file, or an empty string if the file cannot be opened.
      */
-    std::string readFile(const std::string& filename) {
+    inline std::string readFile(const std::string& filename) {
         std::string result = "";
         std::string line = "";
         std::ifstream file(filename.c_str());
@@ -0,0 +1,31 @@
+#include "frameArena.h"
+#include <algorithm>
+
+FrameArena::FrameArena(size_t capacity) : _memory(new uint8_t[capacity]), _capacity(capacity) {
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    size_t start = (_offset + alignment - 1) & ~(alignment - 1);
+    if (start + size <= _capacity) {
+        _offset = start + size;
+        return _memory.get() + start;
+    }
+
+    // does not fit: heap block for this frame, counted for the next capacity
+    _overflow.emplace_back(new uint8_t[size + alignment]);
+    _overflowBytes += size + alignment;
+    uintptr_t address = (uintptr_t)_overflow.back().get();
+    return (void*)((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+void FrameArena::reset() {
+    if (!_overflow.empty()) {
+        // grow to the peak of the last frame, with room for it to vary
+        size_t needed = _offset + _overflowBytes;
+        _capacity = std::max(_capacity * 2, needed + needed / 2);
+        _memory.reset(new uint8_t[_capacity]);
+        _overflow.clear();
+        _overflowBytes = 0;
+    }
+    _offset = 0;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Linear allocator for the transient data of a frame (visible mesh lists, sort keys).
+ * Allocations bump an offset into one block and are all released at once by reset(), at the
+ * start of the next frame. When a frame needs more than the block, the excess is taken from
+ * the heap and the block grows to the frame's peak at the next reset(), so that steady-state
+ * frames do not touch the heap. GL thread only.
+ */
+class FrameArena {
+public:
+    /**
+     * @param capacity Initial size of the block in bytes.
+     */
+    explicit FrameArena(size_t capacity = 64 * 1024);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /**
+     * Allocates memory valid until the next reset().
+     * @param size Bytes to allocate.
+     * @param alignment Alignment of the memory, a power of two.
+     */
+    void* allocate(size_t size, size_t alignment);
+
+    /**
+     * Releases every allocation of the frame, grows the block if the frame overflowed it.
+     */
+    void reset();
+
+    /**
+     * @return The size of the block in bytes.
+     */
+    size_t getCapacity() const { return _capacity; }
+
+    /**
+     * @return The bytes allocated since the last reset(), overflow included.
+     */
+    size_t getUsed() const { return _offset + _overflowBytes; }
+
+private:
+    std::unique_ptr<uint8_t[]> _memory;
+    size_t _capacity;
+    size_t _offset = 0;
+    // Allocations that did not fit in the block, freed at the next reset()
+    std::vector<std::unique_ptr<uint8_t[]>> _overflow;
+    size_t _overflowBytes = 0;
+};
+
+/**
+ * STL allocator drawing from a FrameArena, deallocation is a no-op.
+ */
+template<typename T>
+class FrameAllocator {
+public:
+    using value_type = T;
+
+    FrameAllocator(FrameArena& arena) : _arena(&arena) {}
+
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& other) : _arena(other.getArena()) {}
+
+    T* allocate(size_t count) { return (T*)_arena->allocate(count * sizeof(T), alignof(T)); }
+    void deallocate(T*, size_t) {}
+
+    FrameArena* getArena() const { return _arena; }
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U>& other) const { return _arena == other.getArena(); }
+    template<typename U>
+    bool operator!=(const FrameAllocator<U>& other) const { return _arena != other.getArena(); }
+
+private:
+    FrameArena* _arena;
+};
+
+// Vector living in a FrameArena, valid until the arena's next reset()
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
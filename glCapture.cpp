@@ -0,0 +1,622 @@
+#include "glCapture.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// hooks
+// -----
+// Hooked functions as (Name, NAME): glad's entry point glad_glName of type PFNGLNAMEPROC is kept
+// in realName and replaced by captureName while the capture runs.
+#define GL_CAPTURE_FUNCTIONS(X) \
+    X(ActiveTexture, ACTIVETEXTURE) \
+    X(BlendFunc, BLENDFUNC) \
+    X(Clear, CLEAR) \
+    X(ClearColor, CLEARCOLOR) \
+    X(DepthFunc, DEPTHFUNC) \
+    X(DepthMask, DEPTHMASK) \
+    X(Disable, DISABLE) \
+    X(Enable, ENABLE) \
+    X(PixelStorei, PIXELSTOREI) \
+    X(Scissor, SCISSOR) \
+    X(Viewport, VIEWPORT) \
+    X(GenBuffers, GENBUFFERS) \
+    X(GenFramebuffers, GENFRAMEBUFFERS) \
+    X(GenRenderbuffers, GENRENDERBUFFERS) \
+    X(GenTextures, GENTEXTURES) \
+    X(GenVertexArrays, GENVERTEXARRAYS) \
+    X(DeleteBuffers, DELETEBUFFERS) \
+    X(DeleteFramebuffers, DELETEFRAMEBUFFERS) \
+    X(DeleteRenderbuffers, DELETERENDERBUFFERS) \
+    X(DeleteTextures, DELETETEXTURES) \
+    X(DeleteVertexArrays, DELETEVERTEXARRAYS) \
+    X(BindBuffer, BINDBUFFER) \
+    X(BindFramebuffer, BINDFRAMEBUFFER) \
+    X(BindRenderbuffer, BINDRENDERBUFFER) \
+    X(BindTexture, BINDTEXTURE) \
+    X(BindVertexArray, BINDVERTEXARRAY) \
+    X(BufferData, BUFFERDATA) \
+    X(TexImage2D, TEXIMAGE2D) \
+    X(TexParameteri, TEXPARAMETERI) \
+    X(GenerateMipmap, GENERATEMIPMAP) \
+    X(RenderbufferStorage, RENDERBUFFERSTORAGE) \
+    X(FramebufferRenderbuffer, FRAMEBUFFERRENDERBUFFER) \
+    X(FramebufferTexture2D, FRAMEBUFFERTEXTURE2D) \
+    X(VertexAttribPointer, VERTEXATTRIBPOINTER) \
+    X(EnableVertexAttribArray, ENABLEVERTEXATTRIBARRAY) \
+    X(CreateShader, CREATESHADER) \
+    X(ShaderSource, SHADERSOURCE) \
+    X(CompileShader, COMPILESHADER) \
+    X(DeleteShader, DELETESHADER) \
+    X(CreateProgram, CREATEPROGRAM) \
+    X(AttachShader, ATTACHSHADER) \
+    X(LinkProgram, LINKPROGRAM) \
+    X(ValidateProgram, VALIDATEPROGRAM) \
+    X(UseProgram, USEPROGRAM) \
+    X(GetUniformLocation, GETUNIFORMLOCATION) \
+    X(Uniform1i, UNIFORM1I) \
+    X(Uniform1f, UNIFORM1F) \
+    X(Uniform2fv, UNIFORM2FV) \
+    X(Uniform3fv, UNIFORM3FV) \
+    X(Uniform4fv, UNIFORM4FV) \
+    X(UniformMatrix4fv, UNIFORMMATRIX4FV) \
+    X(DrawArrays, DRAWARRAYS) \
+    X(DrawElements, DRAWELEMENTS) \
+    X(BufferSubData, BUFFERSUBDATA) \
+    X(TexSubImage2D, TEXSUBIMAGE2D) \
+    X(BindBufferRange, BINDBUFFERRANGE) \
+    X(GetUniformBlockIndex, GETUNIFORMBLOCKINDEX) \
+    X(UniformBlockBinding, UNIFORMBLOCKBINDING) \
+    X(CompressedTexImage2D, COMPRESSEDTEXIMAGE2D) \
+    X(CompressedTexSubImage2D, COMPRESSEDTEXSUBIMAGE2D) \
+    X(TexImage3D, TEXIMAGE3D) \
+    X(TexSubImage3D, TEXSUBIMAGE3D) \
+    X(CompressedTexImage3D, COMPRESSEDTEXIMAGE3D) \
+    X(CompressedTexSubImage3D, COMPRESSEDTEXSUBIMAGE3D)
+
+#define GL_CAPTURE_DECLARE_REAL(Name, NAME) static PFNGL##NAME##PROC real##Name = nullptr;
+GL_CAPTURE_FUNCTIONS(GL_CAPTURE_DECLARE_REAL)
+
+static void APIENTRY captureActiveTexture(GLenum texture) {
+    GlCapture::get().record(GlCommand::ActiveTexture, texture);
+    realActiveTexture(texture);
+}
+
+static void APIENTRY captureBlendFunc(GLenum sfactor, GLenum dfactor) {
+    GlCapture::get().record(GlCommand::BlendFunc, sfactor, dfactor);
+    realBlendFunc(sfactor, dfactor);
+}
+
+static void APIENTRY captureClear(GLbitfield mask) {
+    if (GlCapture::get().isRecordingDraws()) {
+        GlCapture::get().record(GlCommand::Clear, mask);
+    }
+    realClear(mask);
+}
+
+static void APIENTRY captureClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+    GlCapture::get().record(GlCommand::ClearColor, red, green, blue, alpha);
+    realClearColor(red, green, blue, alpha);
+}
+
+static void APIENTRY captureDepthFunc(GLenum func) {
+    GlCapture::get().record(GlCommand::DepthFunc, func);
+    realDepthFunc(func);
+}
+
+static void APIENTRY captureDepthMask(GLboolean flag) {
+    GlCapture::get().record(GlCommand::DepthMask, flag);
+    realDepthMask(flag);
+}
+
+static void APIENTRY captureDisable(GLenum cap) {
+    GlCapture::get().record(GlCommand::Disable, cap);
+    realDisable(cap);
+}
+
+static void APIENTRY captureEnable(GLenum cap) {
+    GlCapture::get().record(GlCommand::Enable, cap);
+    realEnable(cap);
+}
+
+static void APIENTRY capturePixelStorei(GLenum pname, GLint param) {
+    if (pname == GL_UNPACK_ALIGNMENT) {
+        GlCapture::get().setUnpackAlignment(param);
+    }
+    GlCapture::get().record(GlCommand::PixelStorei, pname, param);
+    realPixelStorei(pname, param);
+}
+
+static void APIENTRY captureScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    GlCapture::get().record(GlCommand::Scissor, x, y, width, height);
+    realScissor(x, y, width, height);
+}
+
+static void APIENTRY captureViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    GlCapture::get().record(GlCommand::Viewport, x, y, width, height);
+    realViewport(x, y, width, height);
+}
+
+// objects are recorded with the names the driver returned, the replayer maps them to its own
+static void recordNames(GlCommand command, GLsizei n, const GLuint* names) {
+    GlCapture::get().record(command, n);
+    GlCapture::get().writePointer(names, n * sizeof(GLuint), false);
+}
+
+static void APIENTRY captureGenBuffers(GLsizei n, GLuint* buffers) {
+    realGenBuffers(n, buffers);
+    recordNames(GlCommand::GenBuffers, n, buffers);
+}
+
+static void APIENTRY captureGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+    realGenFramebuffers(n, framebuffers);
+    recordNames(GlCommand::GenFramebuffers, n, framebuffers);
+}
+
+static void APIENTRY captureGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+    realGenRenderbuffers(n, renderbuffers);
+    recordNames(GlCommand::GenRenderbuffers, n, renderbuffers);
+}
+
+static void APIENTRY captureGenTextures(GLsizei n, GLuint* textures) {
+    realGenTextures(n, textures);
+    recordNames(GlCommand::GenTextures, n, textures);
+}
+
+static void APIENTRY captureGenVertexArrays(GLsizei n, GLuint* arrays) {
+    realGenVertexArrays(n, arrays);
+    recordNames(GlCommand::GenVertexArrays, n, arrays);
+}
+
+static void APIENTRY captureDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    recordNames(GlCommand::DeleteBuffers, n, buffers);
+    realDeleteBuffers(n, buffers);
+}
+
+static void APIENTRY captureDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    recordNames(GlCommand::DeleteFramebuffers, n, framebuffers);
+    realDeleteFramebuffers(n, framebuffers);
+}
+
+static void APIENTRY captureDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+    recordNames(GlCommand::DeleteRenderbuffers, n, renderbuffers);
+    realDeleteRenderbuffers(n, renderbuffers);
+}
+
+static void APIENTRY captureDeleteTextures(GLsizei n, const GLuint* textures) {
+    recordNames(GlCommand::DeleteTextures, n, textures);
+    realDeleteTextures(n, textures);
+}
+
+static void APIENTRY captureDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+    recordNames(GlCommand::DeleteVertexArrays, n, arrays);
+    realDeleteVertexArrays(n, arrays);
+}
+
+static void APIENTRY captureBindBuffer(GLenum target, GLuint buffer) {
+    if (target == GL_PIXEL_UNPACK_BUFFER) {
+        GlCapture::get().setPixelUnpackBuffer(buffer);
+    }
+    GlCapture::get().record(GlCommand::BindBuffer, target, buffer);
+    realBindBuffer(target, buffer);
+}
+
+static void APIENTRY captureBindFramebuffer(GLenum target, GLuint framebuffer) {
+    if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER) {
+        GlCapture::get().setDrawFramebuffer(framebuffer);
+    }
+    GlCapture::get().record(GlCommand::BindFramebuffer, target, framebuffer);
+    realBindFramebuffer(target, framebuffer);
+}
+
+static void APIENTRY captureBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+    GlCapture::get().record(GlCommand::BindRenderbuffer, target, renderbuffer);
+    realBindRenderbuffer(target, renderbuffer);
+}
+
+static void APIENTRY captureBindTexture(GLenum target, GLuint texture) {
+    GlCapture::get().record(GlCommand::BindTexture, target, texture);
+    realBindTexture(target, texture);
+}
+
+static void APIENTRY captureBindVertexArray(GLuint array) {
+    GlCapture::get().record(GlCommand::BindVertexArray, array);
+    realBindVertexArray(array);
+}
+
+static void APIENTRY captureBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    GlCapture::get().record(GlCommand::BufferData, target, (int64_t)size, usage);
+    GlCapture::get().writePointer(data, size, false);
+    realBufferData(target, size, data, usage);
+}
+
+static void APIENTRY captureTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+    GLenum format, GLenum type, const void* pixels) {
+    GlCapture& capture = GlCapture::get();
+    capture.record(GlCommand::TexImage2D, target, level, internalformat, width, height, border, format, type);
+    bool unpackBuffer = capture.isPixelUnpackBufferBound();
+    capture.writePointer(pixels, unpackBuffer ? 0 : capture.getImageSize(width, height, format, type), unpackBuffer);
+    realTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+static void APIENTRY captureBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    GlCapture::get().record(GlCommand::BufferSubData, target, (int64_t)offset, (int64_t)size);
+    GlCapture::get().writePointer(data, size, false);
+    realBufferSubData(target, offset, size, data);
+}
+
+static void APIENTRY captureTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+    GLenum format, GLenum type, const void* pixels) {
+    GlCapture& capture = GlCapture::get();
+    capture.record(GlCommand::TexSubImage2D, target, level, xoffset, yoffset, width, height, format, type);
+    bool unpackBuffer = capture.isPixelUnpackBufferBound();
+    capture.writePointer(pixels, unpackBuffer ? 0 : capture.getImageSize(width, height, format, type), unpackBuffer);
+    realTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+static void APIENTRY captureBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    GlCapture::get().record(GlCommand::BindBufferRange, target, index, buffer, (int64_t)offset, (int64_t)size);
+    realBindBufferRange(target, index, buffer, offset, size);
+}
+
+// block indices are recorded so that the replayer can map them to the ones of its programs
+static GLuint APIENTRY captureGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName) {
+    GLuint index = realGetUniformBlockIndex(program, uniformBlockName);
+    GlCapture::get().record(GlCommand::GetUniformBlockIndex, program, index);
+    GlCapture::get().writePointer(uniformBlockName, std::strlen(uniformBlockName) + 1, false);
+    return index;
+}
+
+static void APIENTRY captureUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+    GlCapture::get().record(GlCommand::UniformBlockBinding, program, uniformBlockIndex, uniformBlockBinding);
+    realUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+}
+
+static void APIENTRY captureCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+    GLint border, GLsizei imageSize, const void* data) {
+    GlCapture& capture = GlCapture::get();
+    capture.record(GlCommand::CompressedTexImage2D, target, level, internalformat, width, height, border, imageSize);
+    bool unpackBuffer = capture.isPixelUnpackBufferBound();
+    capture.writePointer(data, unpackBuffer ? 0 : imageSize, unpackBuffer);
+    realCompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+}
+
+static void APIENTRY captureCompressedTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+    GLenum format, GLsizei imageSize, const void* data) {
+    GlCapture& capture = GlCapture::get();
+    capture.record(GlCommand::CompressedTexSubImage2D, target, level, xoffset, yoffset, width, height, format, imageSize);
+    bool unpackBuffer = capture.isPixelUnpackBufferBound();
+    capture.writePointer(data, unpackBuffer ? 0 : imageSize, unpackBuffer);
+    realCompressedTexSubImage2D(target, level, xoffset, yoffset, width, height, format, imageSize, data);
+}
+
+// the layers of an image are consecutive rows
+static void APIENTRY captureTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+    GLint border, GLenum format, GLenum type, const void* pixels) {
+    GlCapture& capture = GlCapture::get();
+    capture.record(GlCommand::TexImage3D, target, level, internalformat, width, height, depth, border, format, type);
+    bool unpackBuffer = capture.isPixelUnpackBufferBound();
+    capture.writePointer(pixels, unpackBuffer ? 0 : capture.getImageSize(width, height * depth, format, type), unpackBuffer);
+    realTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+}
+
+static void APIENTRY captureTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+    GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels) {
+    GlCapture& capture = GlCapture::get();
+    capture.record(GlCommand::TexSubImage3D, target, level, xoffset, yoffset, zoffset, width, height, depth, format, type);
+    bool unpackBuffer = capture.isPixelUnpackBufferBound();
+    capture.writePointer(pixels, unpackBuffer ? 0 : capture.getImageSize(width, height * depth, format, type), unpackBuffer);
+    realTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+}
+
+static void APIENTRY captureCompressedTexImage3D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height,
+    GLsizei depth, GLint border, GLsizei imageSize, const void* data) {
+    GlCapture& capture = GlCapture::get();
+    capture.record(GlCommand::CompressedTexImage3D, target, level, internalformat, width, height, depth, border, imageSize);
+    bool unpackBuffer = capture.isPixelUnpackBufferBound();
+    capture.writePointer(data, unpackBuffer ? 0 : imageSize, unpackBuffer);
+    realCompressedTexImage3D(target, level, internalformat, width, height, depth, border, imageSize, data);
+}
+
+static void APIENTRY captureCompressedTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+    GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void* data) {
+    GlCapture& capture = GlCapture::get();
+    capture.record(GlCommand::CompressedTexSubImage3D, target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize);
+    bool unpackBuffer = capture.isPixelUnpackBufferBound();
+    capture.writePointer(data, unpackBuffer ? 0 : imageSize, unpackBuffer);
+    realCompressedTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data);
+}
+
+static void APIENTRY captureTexParameteri(GLenum target, GLenum pname, GLint param) {
+    GlCapture::get().record(GlCommand::TexParameteri, target, pname, param);
+    realTexParameteri(target, pname, param);
+}
+
+static void APIENTRY captureGenerateMipmap(GLenum target) {
+    GlCapture::get().record(GlCommand::GenerateMipmap, target);
+    realGenerateMipmap(target);
+}
+
+static void APIENTRY captureRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height) {
+    GlCapture::get().record(GlCommand::RenderbufferStorage, target, internalformat, width, height);
+    realRenderbufferStorage(target, internalformat, width, height);
+}
+
+static void APIENTRY captureFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer) {
+    GlCapture::get().record(GlCommand::FramebufferRenderbuffer, target, attachment, renderbuffertarget, renderbuffer);
+    realFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+}
+
+static void APIENTRY captureFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+    GlCapture::get().record(GlCommand::FramebufferTexture2D, target, attachment, textarget, texture, level);
+    realFramebufferTexture2D(target, attachment, textarget, texture, level);
+}
+
+// vertex attributes always come from a buffer object in a core context
+static void APIENTRY captureVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+    GlCapture::get().record(GlCommand::VertexAttribPointer, index, size, type, normalized, stride);
+    GlCapture::get().writePointer(pointer, 0, true);
+    realVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+static void APIENTRY captureEnableVertexAttribArray(GLuint index) {
+    GlCapture::get().record(GlCommand::EnableVertexAttribArray, index);
+    realEnableVertexAttribArray(index);
+}
+
+static GLuint APIENTRY captureCreateShader(GLenum type) {
+    GLuint shader = realCreateShader(type);
+    GlCapture::get().record(GlCommand::CreateShader, type, shader);
+    return shader;
+}
+
+// the strings are joined in a single source
+static void APIENTRY captureShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) {
+    std::string source;
+    for (GLsizei i = 0; i < count; ++i) {
+        if (length != nullptr && length[i] >= 0) {
+            source.append(string[i], length[i]);
+        }
+        else {
+            source.append(string[i]);
+        }
+    }
+    GlCapture::get().record(GlCommand::ShaderSource, shader);
+    GlCapture::get().writePointer(source.data(), source.size(), false);
+    realShaderSource(shader, count, string, length);
+}
+
+static void APIENTRY captureCompileShader(GLuint shader) {
+    GlCapture::get().record(GlCommand::CompileShader, shader);
+    realCompileShader(shader);
+}
+
+static void APIENTRY captureDeleteShader(GLuint shader) {
+    GlCapture::get().record(GlCommand::DeleteShader, shader);
+    realDeleteShader(shader);
+}
+
+static GLuint APIENTRY captureCreateProgram() {
+    GLuint program = realCreateProgram();
+    GlCapture::get().record(GlCommand::CreateProgram, program);
+    return program;
+}
+
+static void APIENTRY captureAttachShader(GLuint program, GLuint shader) {
+    GlCapture::get().record(GlCommand::AttachShader, program, shader);
+    realAttachShader(program, shader);
+}
+
+static void APIENTRY captureLinkProgram(GLuint program) {
+    GlCapture::get().record(GlCommand::LinkProgram, program);
+    realLinkProgram(program);
+}
+
+static void APIENTRY captureValidateProgram(GLuint program) {
+    GlCapture::get().record(GlCommand::ValidateProgram, program);
+    realValidateProgram(program);
+}
+
+static void APIENTRY captureUseProgram(GLuint program) {
+    GlCapture::get().record(GlCommand::UseProgram, program);
+    realUseProgram(program);
+}
+
+// locations are recorded so that the replayer can map them to the ones of its programs
+static GLint APIENTRY captureGetUniformLocation(GLuint program, const GLchar* name) {
+    GLint location = realGetUniformLocation(program, name);
+    GlCapture::get().record(GlCommand::GetUniformLocation, program, location);
+    GlCapture::get().writePointer(name, std::strlen(name) + 1, false);
+    return location;
+}
+
+static void APIENTRY captureUniform1i(GLint location, GLint v0) {
+    GlCapture::get().record(GlCommand::Uniform1i, location, v0);
+    realUniform1i(location, v0);
+}
+
+static void APIENTRY captureUniform1f(GLint location, GLfloat v0) {
+    GlCapture::get().record(GlCommand::Uniform1f, location, v0);
+    realUniform1f(location, v0);
+}
+
+static void APIENTRY captureUniform2fv(GLint location, GLsizei count, const GLfloat* value) {
+    GlCapture::get().record(GlCommand::Uniform2fv, location, count);
+    GlCapture::get().writePointer(value, count * 2 * sizeof(GLfloat), false);
+    realUniform2fv(location, count, value);
+}
+
+static void APIENTRY captureUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+    GlCapture::get().record(GlCommand::Uniform3fv, location, count);
+    GlCapture::get().writePointer(value, count * 3 * sizeof(GLfloat), false);
+    realUniform3fv(location, count, value);
+}
+
+static void APIENTRY captureUniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+    GlCapture::get().record(GlCommand::Uniform4fv, location, count);
+    GlCapture::get().writePointer(value, count * 4 * sizeof(GLfloat), false);
+    realUniform4fv(location, count, value);
+}
+
+static void APIENTRY captureUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    GlCapture::get().record(GlCommand::UniformMatrix4fv, location, count, transpose);
+    GlCapture::get().writePointer(value, count * 16 * sizeof(GLfloat), false);
+    realUniformMatrix4fv(location, count, transpose, value);
+}
+
+static void APIENTRY captureDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    if (GlCapture::get().isRecordingDraws()) {
+        GlCapture::get().record(GlCommand::DrawArrays, mode, first, count);
+    }
+    realDrawArrays(mode, first, count);
+}
+
+// indices always come from the element array buffer of the vertex array in a core context
+static void APIENTRY captureDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices) {
+    if (GlCapture::get().isRecordingDraws()) {
+        GlCapture::get().record(GlCommand::DrawElements, mode, count, type);
+        GlCapture::get().writePointer(indices, 0, true);
+    }
+    realDrawElements(mode, count, type, indices);
+}
+
+static void installHooks() {
+#define GL_CAPTURE_INSTALL(Name, NAME) real##Name = glad_gl##Name; glad_gl##Name = capture##Name;
+    GL_CAPTURE_FUNCTIONS(GL_CAPTURE_INSTALL)
+#undef GL_CAPTURE_INSTALL
+}
+
+static void removeHooks() {
+#define GL_CAPTURE_REMOVE(Name, NAME) glad_gl##Name = real##Name;
+    GL_CAPTURE_FUNCTIONS(GL_CAPTURE_REMOVE)
+#undef GL_CAPTURE_REMOVE
+}
+
+// capture
+// -------
+GlCapture& GlCapture::get() {
+    static GlCapture capture;
+    return capture;
+}
+
+bool GlCapture::init(const std::string& filepath, int startFrame, int frameCount, int width, int height) {
+    _file.open(filepath, std::ios::binary);
+    if (!_file.is_open()) {
+        std::cerr << "Failed to create GL capture " << filepath << std::endl;
+        return false;
+    }
+    _filepath = filepath;
+    // the calls before the first frame end create the objects, they cannot be looped
+    _startFrame = startFrame < 0 ? -1 : std::max(startFrame, 1);
+    _frameCount = std::max(frameCount, 1);
+
+    // the frame count is written once known
+    write(MAGIC);
+    write(VERSION);
+    write((int32_t)width);
+    write((int32_t)height);
+    write((int32_t)0);
+    flush();
+
+    installHooks();
+    _enabled = true;
+    std::cout << "GL capture started, " << _frameCount << " frame(s) to " << filepath << std::endl;
+    return true;
+}
+
+void GlCapture::captureFrames() {
+    if (_enabled && !_capturing) {
+        _startFrame = _frame + 1;
+    }
+}
+
+void GlCapture::endFrame() {
+    if (!_enabled) {
+        return;
+    }
+    if (_capturing) {
+        record(GlCommand::FrameEnd);
+        if (++_capturedFrames == _frameCount) {
+            finish();
+            return;
+        }
+    }
+    else if (++_frame >= _startFrame && _startFrame >= 0) {
+        record(GlCommand::CaptureBegin);
+        _capturing = true;
+    }
+    flush();
+}
+
+void GlCapture::writePointer(const void* pointer, size_t size, bool bufferBound) {
+    if (bufferBound) {
+        write(GlPointer::Offset);
+        write((uint64_t)(uintptr_t)pointer);
+    }
+    else if (pointer == nullptr) {
+        write(GlPointer::Null);
+    }
+    else {
+        write(GlPointer::Data);
+        write((uint64_t)size);
+        _buffer.insert(_buffer.end(), (const uint8_t*)pointer, (const uint8_t*)pointer + size);
+    }
+}
+
+size_t GlCapture::getImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type) const {
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+    size_t components = 4;
+    switch (format) {
+    case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: components = 1; break;
+    case GL_RG: case GL_RG_INTEGER: components = 2; break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+    }
+    size_t componentSize = 1;
+    switch (type) {
+    case GL_HALF_FLOAT: case GL_SHORT: case GL_UNSIGNED_SHORT: componentSize = 2; break;
+    case GL_FLOAT: case GL_INT: case GL_UNSIGNED_INT: componentSize = 4; break;
+    }
+    // every row but the last is padded to the unpack alignment
+    size_t rowSize = (size_t)width * components * componentSize;
+    size_t stride = (rowSize + _unpackAlignment - 1) / _unpackAlignment * _unpackAlignment;
+    return stride * (height - 1) + rowSize;
+}
+
+void GlCapture::flush() {
+    _file.write((const char*)_buffer.data(), _buffer.size());
+    _buffer.clear();
+}
+
+void GlCapture::finish() {
+    record(GlCommand::End);
+    flush();
+    _file.seekp(4 * sizeof(uint32_t));
+    int32_t frames = _capturedFrames;
+    _file.write((const char*)&frames, sizeof(frames));
+    _file.seekp(0, std::ios::end);
+    std::cout << "GL capture of " << _capturedFrames << " frame(s) written to " << _filepath << " ("
+        << _file.tellp() / (1024.0 * 1024.0) << " MB)" << std::endl;
+    _file.close();
+
+    removeHooks();
+    _enabled = false;
+    _capturing = false;
+}
+
+// error checks
+// ------------
+void GlCapture::clearErrors() {
+    while (glGetError() != GL_NO_ERROR) {}
+}
+
+void GlCapture::checkErrors(const char* call, const char* file, int line) {
+    bool failed = false;
+    while (GLenum error = glGetError()) {
+        std::cout << "OPENGL ERROR " << call << " " << file << " LINE " << line << ": " << error << "\n";
+        failed = true;
+    }
+    if (failed) {
+        exit(1);
+    }
+}
@@ -0,0 +1,254 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * GL calls and markers of a capture file. Each command is its 16-bit id followed by its arguments
+ * in call order: enums, names and integers as 32 bits, sizes and offsets as 64 bits, pointers as
+ * a kind byte (GlPointer) then the size and bytes of the data or the offset.
+ * Values are appended only, so that older captures stay readable.
+ */
+enum class GlCommand : uint16_t {
+    // markers
+    CaptureBegin,            // End of the setup calls, the captured frames follow
+    FrameEnd,                // End of a captured frame
+    End,                     // End of the capture
+
+    // state
+    ActiveTexture,
+    BlendFunc,
+    Clear,
+    ClearColor,
+    DepthFunc,
+    DepthMask,
+    Disable,
+    Enable,
+    PixelStorei,
+    Scissor,
+    Viewport,
+
+    // objects
+    GenBuffers,
+    GenFramebuffers,
+    GenRenderbuffers,
+    GenTextures,
+    GenVertexArrays,
+    DeleteBuffers,
+    DeleteFramebuffers,
+    DeleteRenderbuffers,
+    DeleteTextures,
+    DeleteVertexArrays,
+    BindBuffer,
+    BindFramebuffer,
+    BindRenderbuffer,
+    BindTexture,
+    BindVertexArray,
+
+    // data
+    BufferData,
+    TexImage2D,
+    TexParameteri,
+    GenerateMipmap,
+    RenderbufferStorage,
+    FramebufferRenderbuffer,
+    FramebufferTexture2D,
+    VertexAttribPointer,
+    EnableVertexAttribArray,
+
+    // shaders
+    CreateShader,
+    ShaderSource,
+    CompileShader,
+    DeleteShader,
+    CreateProgram,
+    AttachShader,
+    LinkProgram,
+    ValidateProgram,
+    UseProgram,
+    GetUniformLocation,
+    Uniform1i,
+    Uniform1f,
+    Uniform2fv,
+    Uniform3fv,
+    Uniform4fv,
+    UniformMatrix4fv,
+
+    // draws
+    DrawArrays,
+    DrawElements,
+
+    // data updates, appended so that older captures keep their command values
+    BufferSubData,
+    TexSubImage2D,
+    // uniform blocks
+    BindBufferRange,
+    GetUniformBlockIndex,
+    UniformBlockBinding,
+    // block-compressed textures
+    CompressedTexImage2D,
+    CompressedTexSubImage2D,
+    // array textures
+    TexImage3D,
+    TexSubImage3D,
+    CompressedTexImage3D,
+    CompressedTexSubImage3D,
+
+    Count
+};
+
+/**
+ * How a pointer argument is stored.
+ */
+enum class GlPointer : uint8_t {
+    Null,       // nullptr
+    Data,       // Client memory, its bytes are stored
+    Offset      // Offset into a bound buffer object
+};
+
+/**
+ * Records the GL calls of the application, with the contents of the buffers and textures they
+ * upload, into a binary file that tools/glReplay re-issues without the original assets.
+ * The functions loaded by glad are replaced by recording hooks, so no call site changes and
+ * nothing is hooked when the capture is disabled. Everything from init() on is recorded, as the
+ * captured frames need the objects created before them; draws and clears of the default
+ * framebuffer are dropped until the first captured frame, draws into framebuffer objects are
+ * kept since they fill textures (environment bakes). GL thread only.
+ */
+class GlCapture {
+public:
+    // First bytes of a capture file, "GLCP"
+    static constexpr uint32_t MAGIC = 0x50434C47;
+    static constexpr uint32_t VERSION = 1;
+
+    /**
+     * @return The capture shared by the whole application.
+     */
+    static GlCapture& get();
+
+    /**
+     * Opens the capture file and hooks the GL functions, the context must be current and glad loaded.
+     * @param filepath Destination capture file.
+     * @param startFrame Frames ended before the capture window, negative to wait for captureFrames().
+     * @param frameCount Frames in the capture window.
+     * @param width Width of the default framebuffer.
+     * @param height Height of the default framebuffer.
+     * @return false if the file cannot be created.
+     */
+    bool init(const std::string& filepath, int startFrame, int frameCount, int width, int height);
+
+    /**
+     * @return true from init() until the capture file is complete.
+     */
+    bool isEnabled() const { return _enabled; }
+
+    /**
+     * @return true while frames are being captured.
+     */
+    bool isCapturing() const { return _capturing; }
+
+    /**
+     * Starts the capture window at the next frame, when init() was given no start frame.
+     */
+    void captureFrames();
+
+    /**
+     * Closes the current frame, called by the GL thread after the buffer swap. Completes the
+     * file and restores the GL functions after the last captured frame.
+     */
+    void endFrame();
+
+    /**
+     * Writes a command and its arguments, for the hooks.
+     */
+    template<typename... Args>
+    void record(GlCommand command, const Args&... args) {
+        write((uint16_t)command);
+        (write(args), ...);
+    }
+
+    /**
+     * Appends a fixed-size value, for the hooks.
+     */
+    template<typename T>
+    void write(const T& value) {
+        const uint8_t* bytes = (const uint8_t*)&value;
+        _buffer.insert(_buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    /**
+     * Appends a pointer argument, for the hooks.
+     * @param pointer The pointer.
+     * @param size Bytes read from client memory.
+     * @param bufferBound true if the pointer is an offset into a bound buffer object.
+     */
+    void writePointer(const void* pointer, size_t size, bool bufferBound);
+
+    /**
+     * @return true if draws and clears are recorded: in the capture window, or into a framebuffer object.
+     */
+    bool isRecordingDraws() const { return _capturing || _drawFramebuffer != 0; }
+
+    /**
+     * @return The bytes read by glTexImage2D with the current unpack alignment.
+     */
+    size_t getImageSize(GLsizei width, GLsizei height, GLenum format, GLenum type) const;
+
+    /**
+     * @return true if a pixel unpack buffer is bound, texture data pointers are then offsets.
+     */
+    bool isPixelUnpackBufferBound() const { return _pixelUnpackBuffer != 0; }
+
+    // Bindings and state that change how arguments are recorded, kept up to date by the hooks
+    void setDrawFramebuffer(GLuint framebuffer) { _drawFramebuffer = framebuffer; }
+    void setPixelUnpackBuffer(GLuint buffer) { _pixelUnpackBuffer = buffer; }
+    void setUnpackAlignment(GLint alignment) { _unpackAlignment = alignment; }
+
+    /**
+     * Clears the GL error flags, before a call checked by glCheck.
+     */
+    static void clearErrors();
+
+    /**
+     * Prints the GL errors raised by a call and exits if there are any.
+     * @param call The checked call, as text.
+     * @param file Source file of the call.
+     * @param line Source line of the call.
+     */
+    static void checkErrors(const char* call, const char* file, int line);
+
+private:
+    bool _enabled = false;
+    bool _capturing = false;
+    int _startFrame = -1;
+    int _frameCount = 1;
+    int _frame = 0;              // Frames ended since init()
+    int _capturedFrames = 0;
+
+    GLuint _drawFramebuffer = 0;
+    GLuint _pixelUnpackBuffer = 0;
+    GLint _unpackAlignment = 4;
+
+    std::string _filepath;
+    std::ofstream _file;
+    std::vector<uint8_t> _buffer; // Commands not written yet, flushed at every frame end
+
+    /**
+     * Writes the buffered commands to the file.
+     */
+    void flush();
+
+    /**
+     * Completes the file and restores the GL functions.
+     */
+    void finish();
+};
+
+// Checks the GL errors of a call in debug builds, the call alone in release builds
+#ifdef NDEBUG
+#define glCheck(x) x
+#else
+#define glCheck(x) do { GlCapture::clearErrors(); x; GlCapture::checkErrors(#x, __FILE__, __LINE__); } while (0)
+#endif
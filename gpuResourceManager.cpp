@@ -0,0 +1,291 @@
+#include "gpuResourceManager.h"
+#include <algorithm>
+
+/**
+ * Bytes per texel as stored by drivers, three channels padded to four.
+ */
+static size_t bytesPerTexel(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R8: return 1;
+    case GL_RG8: return 2;
+    case GL_R16F: return 2;
+    case GL_RG16F: return 4;
+    case GL_RGB16F: return 8;
+    case GL_RGBA16F: return 8;
+    case GL_RGB32F: return 16;
+    case GL_RGBA32F: return 16;
+    default: return 4;
+    }
+}
+
+/**
+ * Bytes per 4x4 block of the block-compressed formats, 0 for the others.
+ */
+static size_t bytesPerBlock(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_COMPRESSED_RED_RGTC1: return 8;
+    case GL_COMPRESSED_RG_RGTC2: return 16;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM_ARB: return 16;
+    default: return 0;
+    }
+}
+
+/**
+ * Pixel format and type accepted with a sized internal format, to allocate levels without data.
+ */
+static void pixelFormat(GLenum internalFormat, GLenum& format, GLenum& type) {
+    switch (internalFormat) {
+    case GL_R8: format = GL_RED; type = GL_UNSIGNED_BYTE; break;
+    case GL_RG8: format = GL_RG; type = GL_UNSIGNED_BYTE; break;
+    case GL_RGB8: format = GL_RGB; type = GL_UNSIGNED_BYTE; break;
+    case GL_R16F: format = GL_RED; type = GL_FLOAT; break;
+    case GL_RG16F: format = GL_RG; type = GL_FLOAT; break;
+    case GL_RGB16F: case GL_RGB32F: format = GL_RGB; type = GL_FLOAT; break;
+    case GL_RGBA16F: case GL_RGBA32F: format = GL_RGBA; type = GL_FLOAT; break;
+    default: format = GL_RGBA; type = GL_UNSIGNED_BYTE; break;
+    }
+}
+
+GpuResourceManager& GpuResourceManager::get() {
+    static GpuResourceManager manager;
+    return manager;
+}
+
+size_t GpuResourceManager::KeyHash::operator()(const GpuResourceKey& key) const {
+    // FNV-1a over the fields
+    uint64_t hash = 14695981039346656037ull;
+    const uint64_t fields[] = { (uint64_t)key.kind, key.target, key.format, (uint64_t)key.width, (uint64_t)key.height, (uint64_t)key.levels, (uint64_t)key.layers, key.bytes };
+    for (uint64_t field : fields) {
+        hash = (hash ^ field) * 1099511628211ull;
+    }
+    return (size_t)hash;
+}
+
+int GpuResourceManager::fullMipLevels(int width, int height) {
+    int levels = 1;
+    for (int size = std::max(width, height); size > 1; size /= 2) {
+        ++levels;
+    }
+    return levels;
+}
+
+size_t GpuResourceManager::textureBytes(GLenum target, GLenum internalFormat, int width, int height, int levels, int layers) {
+    size_t blockBytes = bytesPerBlock(internalFormat);
+    size_t bytes = 0;
+    for (int level = 0; level < levels; ++level) {
+        size_t levelWidth = std::max(1, width >> level), levelHeight = std::max(1, height >> level);
+        bytes += blockBytes ? (levelWidth + 3) / 4 * ((levelHeight + 3) / 4) * blockBytes : levelWidth * levelHeight * bytesPerTexel(internalFormat);
+    }
+    if (target == GL_TEXTURE_2D_ARRAY) {
+        return bytes * layers;
+    }
+    return bytes * (target == GL_TEXTURE_CUBE_MAP ? 6 : 1);
+}
+
+BufferHandle GpuResourceManager::createBuffer(GLenum target, size_t bytes, const void* data, GLenum usage) {
+    GpuResourceKey key;
+    key.kind = GpuResourceKind::Buffer;
+    key.format = usage;
+    key.bytes = bytes;
+
+    int64_t slot = reuse(key);
+    if (slot >= 0) {
+        GLuint id = _resources[slot].id;
+        glBindBuffer(target, id);
+        if (data) {
+            glBufferSubData(target, 0, bytes, data);
+        }
+        return BufferHandle((uint32_t)slot, id);
+    }
+
+    GLuint id;
+    glGenBuffers(1, &id);
+    glBindBuffer(target, id);
+    glBufferData(target, bytes, data, usage);
+    return BufferHandle(add(id, key, bytes), id);
+}
+
+TextureHandle GpuResourceManager::createTexture(GLenum target, GLenum internalFormat, int width, int height, int levels, int layers) {
+    GpuResourceKey key;
+    key.kind = GpuResourceKind::Texture;
+    key.target = target;
+    key.format = internalFormat;
+    key.width = width;
+    key.height = height;
+    key.levels = levels;
+    key.layers = target == GL_TEXTURE_2D_ARRAY ? layers : 0;
+
+    int64_t slot = reuse(key);
+    if (slot >= 0) {
+        GLuint id = _resources[slot].id;
+        glBindTexture(target, id);
+        // the previous owner may have narrowed the sampled levels
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        return TextureHandle((uint32_t)slot, id);
+    }
+
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(target, id);
+    GLenum format, type;
+    pixelFormat(internalFormat, format, type);
+    size_t blockBytes = bytesPerBlock(internalFormat);
+    int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    for (int level = 0; level < levels; ++level) {
+        int levelWidth = std::max(1, width >> level), levelHeight = std::max(1, height >> level);
+        for (int face = 0; face < faces; ++face) {
+            GLenum faceTarget = faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+            if (blockBytes) {
+                // compressed levels are allocated with their size in blocks, written with glCompressedTexSubImage2D
+                GLsizei imageSize = (GLsizei)((levelWidth + 3) / 4 * ((levelHeight + 3) / 4) * blockBytes);
+                if (target == GL_TEXTURE_2D_ARRAY) {
+                    glCompressedTexImage3D(target, level, internalFormat, levelWidth, levelHeight, layers, 0, imageSize * layers, nullptr);
+                }
+                else {
+                    glCompressedTexImage2D(faceTarget, level, internalFormat, levelWidth, levelHeight, 0, imageSize, nullptr);
+                }
+            }
+            else if (target == GL_TEXTURE_2D_ARRAY) {
+                glTexImage3D(target, level, internalFormat, levelWidth, levelHeight, layers, 0, format, type, nullptr);
+            }
+            else {
+                glTexImage2D(faceTarget, level, internalFormat, levelWidth, levelHeight, 0, format, type, nullptr);
+            }
+        }
+    }
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    return TextureHandle(add(id, key, textureBytes(target, internalFormat, width, height, levels, layers)), id);
+}
+
+FramebufferHandle GpuResourceManager::createFramebuffer() {
+    GpuResourceKey key;
+    key.kind = GpuResourceKind::Framebuffer;
+
+    int64_t slot = reuse(key);
+    if (slot >= 0) {
+        return FramebufferHandle((uint32_t)slot, _resources[slot].id);
+    }
+
+    GLuint id;
+    glGenFramebuffers(1, &id);
+    return FramebufferHandle(add(id, key, 0), id);
+}
+
+RenderbufferHandle GpuResourceManager::createRenderbuffer(GLenum internalFormat, int width, int height) {
+    GpuResourceKey key;
+    key.kind = GpuResourceKind::Renderbuffer;
+    key.format = internalFormat;
+    key.width = width;
+    key.height = height;
+
+    int64_t slot = reuse(key);
+    if (slot >= 0) {
+        GLuint id = _resources[slot].id;
+        glBindRenderbuffer(GL_RENDERBUFFER, id);
+        return RenderbufferHandle((uint32_t)slot, id);
+    }
+
+    GLuint id;
+    glGenRenderbuffers(1, &id);
+    glBindRenderbuffer(GL_RENDERBUFFER, id);
+    glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+    return RenderbufferHandle(add(id, key, (size_t)width * height * 4), id);
+}
+
+int64_t GpuResourceManager::reuse(const GpuResourceKey& key) {
+    auto it = _pool.find(key);
+    if (it == _pool.end() || it->second.empty()) {
+        ++_poolMisses;
+        return -1;
+    }
+    // the most recently released one, the least likely to have been paged out by the driver
+    uint32_t slot = it->second.back();
+    it->second.pop_back();
+    Resource& resource = _resources[slot];
+    resource.references = 1;
+    _pooledBytes -= resource.bytes;
+    _usedBytes += resource.bytes;
+    --_pooledCount;
+    ++_poolHits;
+    return slot;
+}
+
+uint32_t GpuResourceManager::add(GLuint id, const GpuResourceKey& key, size_t bytes) {
+    uint32_t slot;
+    if (!_freeSlots.empty()) {
+        slot = _freeSlots.back();
+        _freeSlots.pop_back();
+    }
+    else {
+        slot = (uint32_t)_resources.size();
+        _resources.emplace_back();
+    }
+    Resource& resource = _resources[slot];
+    resource.id = id;
+    resource.key = key;
+    resource.bytes = bytes;
+    resource.references = 1;
+    _usedBytes += bytes;
+    return slot;
+}
+
+void GpuResourceManager::release(uint32_t slot) {
+    Resource& resource = _resources[slot];
+    if (--resource.references > 0) {
+        return;
+    }
+    _usedBytes -= resource.bytes;
+    _pooledBytes += resource.bytes;
+    resource.released = ++_releaseCount;
+    _pool[resource.key].push_back(slot);
+    ++_pooledCount;
+    _releaseOrder.emplace_back(slot, resource.released);
+
+    // reused objects leave their entry behind, drop them before they outnumber the pool
+    if (_releaseOrder.size() > 1024 && _releaseOrder.size() > 2 * _pooledCount) {
+        _releaseOrder.erase(std::remove_if(_releaseOrder.begin(), _releaseOrder.end(), [this](const std::pair<uint32_t, uint64_t>& entry) {
+            const Resource& pooled = _resources[entry.first];
+            return pooled.references > 0 || pooled.id == 0 || pooled.released != entry.second;
+            }), _releaseOrder.end());
+    }
+}
+
+bool GpuResourceManager::deleteOldest() {
+    while (!_releaseOrder.empty()) {
+        auto [slot, released] = _releaseOrder.front();
+        _releaseOrder.pop_front();
+        Resource& resource = _resources[slot];
+        if (resource.references > 0 || resource.id == 0 || resource.released != released) {
+            continue;
+        }
+
+        std::vector<uint32_t>& pooled = _pool[resource.key];
+        pooled.erase(std::find(pooled.begin(), pooled.end(), slot));
+        switch (resource.key.kind) {
+        case GpuResourceKind::Buffer: glDeleteBuffers(1, &resource.id); break;
+        case GpuResourceKind::Texture: glDeleteTextures(1, &resource.id); break;
+        case GpuResourceKind::Framebuffer: glDeleteFramebuffers(1, &resource.id); break;
+        case GpuResourceKind::Renderbuffer: glDeleteRenderbuffers(1, &resource.id); break;
+        }
+        _pooledBytes -= resource.bytes;
+        --_pooledCount;
+        resource.id = 0;
+        resource.bytes = 0;
+        _freeSlots.push_back(slot);
+        return true;
+    }
+    return false;
+}
+
+void GpuResourceManager::trim() {
+    while (_pooledBytes > _poolLimit || (isOverBudget() && _pooledBytes > 0)) {
+        if (!deleteOldest()) {
+            break;
+        }
+    }
+}
+
+void GpuResourceManager::releasePool() {
+    while (deleteOldest()) {
+    }
+}
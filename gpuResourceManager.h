@@ -0,0 +1,288 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Kinds of GL objects owned by the GpuResourceManager.
+ */
+enum class GpuResourceKind : uint8_t {
+    Buffer,
+    Texture,
+    Framebuffer,
+    Renderbuffer
+};
+
+/**
+ * What makes two GL objects interchangeable: released objects are reused for requests of the same key.
+ */
+struct GpuResourceKey {
+    GpuResourceKind kind = GpuResourceKind::Buffer;
+    GLenum target = 0;          // Texture target, 0 for the other kinds
+    GLenum format = 0;          // Internal format of textures and renderbuffers, usage of buffers
+    int width = 0, height = 0;  // Size of textures and renderbuffers
+    int levels = 0;             // Mip levels of textures
+    int layers = 0;             // Layers of array textures
+    size_t bytes = 0;           // Size of buffers
+
+    bool operator==(const GpuResourceKey& other) const {
+        return kind == other.kind && target == other.target && format == other.format && width == other.width
+            && height == other.height && levels == other.levels && layers == other.layers && bytes == other.bytes;
+    }
+};
+
+template<GpuResourceKind Kind>
+class GpuHandle;
+
+using BufferHandle = GpuHandle<GpuResourceKind::Buffer>;
+using TextureHandle = GpuHandle<GpuResourceKind::Texture>;
+using FramebufferHandle = GpuHandle<GpuResourceKind::Framebuffer>;
+using RenderbufferHandle = GpuHandle<GpuResourceKind::Renderbuffer>;
+
+/**
+ * Owns the GL buffers, textures, framebuffers and renderbuffers of the application, handed out
+ * as reference-counted handles. An object whose last handle is released is not deleted but kept
+ * in a pool, and the next request of the same size and format gets it back instead of a new one,
+ * so that switching between models or environments of similar sizes does not allocate VRAM.
+ * The pool is trimmed, least recently released first, to its own limit and to the VRAM budget;
+ * objects still referenced are never deleted, their owners (the environment cache) evict them.
+ * GL objects are only created and deleted on the GL thread, by create*() and trim().
+ */
+class GpuResourceManager {
+public:
+    /**
+     * @return The resource manager shared by the whole application.
+     */
+    static GpuResourceManager& get();
+
+    /**
+     * Creates a buffer, or reuses a released one of the same size, and fills it.
+     * @param target Binding point the buffer is left bound to.
+     * @param bytes Size of the buffer.
+     * @param data Contents of the buffer, nullptr to leave them undefined.
+     * @param usage Usage hint of the buffer.
+     */
+    BufferHandle createBuffer(GLenum target, size_t bytes, const void* data, GLenum usage = GL_STATIC_DRAW);
+
+    /**
+     * Creates a texture with storage for its mip levels, or reuses a released one of the same
+     * size and format. The texture is left bound to its target, its contents are undefined and
+     * are written with glTexSubImage2D or by rendering to it, or with glCompressedTexSubImage2D
+     * for the block-compressed formats (their 3D versions for array textures).
+     * @param target GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D_ARRAY.
+     * @param internalFormat Sized internal format, e.g. GL_RGBA8, GL_RGB16F or GL_COMPRESSED_RGBA_BPTC_UNORM_ARB.
+     * @param width Width of the first level.
+     * @param height Height of the first level.
+     * @param levels Mip levels allocated, see fullMipLevels().
+     * @param layers Layers of a GL_TEXTURE_2D_ARRAY, ignored for the other targets.
+     */
+    TextureHandle createTexture(GLenum target, GLenum internalFormat, int width, int height, int levels, int layers = 1);
+
+    /**
+     * Creates a framebuffer, or reuses a released one. Its attachments are those of its previous use.
+     */
+    FramebufferHandle createFramebuffer();
+
+    /**
+     * Creates a renderbuffer, or reuses a released one of the same size and format.
+     * @param internalFormat Format of the renderbuffer, e.g. GL_DEPTH_COMPONENT24.
+     * @param width Width in pixels.
+     * @param height Height in pixels.
+     */
+    RenderbufferHandle createRenderbuffer(GLenum internalFormat, int width, int height);
+
+    /**
+     * Deletes released objects, least recently released first, until the pool fits its limit
+     * and the resident objects fit the budget. Cheap when they already do. GL thread only.
+     */
+    void trim();
+
+    /**
+     * Deletes every released object. GL thread only.
+     */
+    void releasePool();
+
+    /**
+     * Sets the VRAM budget of the resident objects, referenced and pooled.
+     * @param bytes The budget, 0 for none.
+     */
+    void setBudget(size_t bytes) { _budget = bytes; }
+
+    /**
+     * @return The VRAM budget, 0 for none.
+     */
+    size_t getBudget() const { return _budget; }
+
+    /**
+     * Sets the most VRAM kept by released objects waiting for reuse.
+     * @param bytes The limit, 0 to delete objects as soon as they are released (at the next trim()).
+     */
+    void setPoolLimit(size_t bytes) { _poolLimit = bytes; }
+
+    /**
+     * @return true if the resident objects exceed the budget.
+     */
+    bool isOverBudget() const { return _budget > 0 && _usedBytes + _pooledBytes > _budget; }
+
+    /**
+     * @return The bytes of the objects referenced by handles.
+     */
+    size_t getUsedBytes() const { return _usedBytes; }
+
+    /**
+     * @return The bytes of the released objects waiting for reuse.
+     */
+    size_t getPooledBytes() const { return _pooledBytes; }
+
+    /**
+     * @return The requests served by a released object.
+     */
+    uint64_t getPoolHits() const { return _poolHits; }
+
+    /**
+     * @return The requests that created an object.
+     */
+    uint64_t getPoolMisses() const { return _poolMisses; }
+
+    /**
+     * @return The number of levels of a full mip chain.
+     */
+    static int fullMipLevels(int width, int height);
+
+    /**
+     * Estimates the VRAM used by a texture, drivers store three-channel formats with four.
+     * Block-compressed formats count whole 4x4 blocks.
+     * @param target GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D_ARRAY.
+     * @param internalFormat Sized internal format.
+     * @param width Width of the first level.
+     * @param height Height of the first level.
+     * @param levels Mip levels.
+     * @param layers Layers of a GL_TEXTURE_2D_ARRAY.
+     */
+    static size_t textureBytes(GLenum target, GLenum internalFormat, int width, int height, int levels, int layers = 1);
+
+private:
+    template<GpuResourceKind Kind>
+    friend class GpuHandle;
+
+    /**
+     * A GL object and its references.
+     */
+    struct Resource {
+        GLuint id = 0;              // GL name, 0 once deleted
+        GpuResourceKey key;
+        size_t bytes = 0;           // Estimated VRAM
+        uint32_t references = 0;    // Handles on the object, 0 while pooled
+        uint64_t released = 0;      // Release order while pooled, for the LRU trim
+    };
+
+    struct KeyHash {
+        size_t operator()(const GpuResourceKey& key) const;
+    };
+
+    std::vector<Resource> _resources;
+    std::vector<uint32_t> _freeSlots;   // Slots of deleted objects, reused by the next creation
+    // Released objects by key, most recently released last
+    std::unordered_map<GpuResourceKey, std::vector<uint32_t>, KeyHash> _pool;
+    // Released objects in release order as (slot, released), entries of reused objects are skipped
+    std::deque<std::pair<uint32_t, uint64_t>> _releaseOrder;
+    uint64_t _releaseCount = 0;
+    size_t _usedBytes = 0;
+    size_t _pooledBytes = 0;
+    size_t _pooledCount = 0;
+    size_t _budget = 0;
+    size_t _poolLimit = 256 * 1024 * 1024;
+    uint64_t _poolHits = 0;
+    uint64_t _poolMisses = 0;
+
+    /**
+     * Takes a released object of the key out of the pool.
+     * @return Its slot, or -1 if there is none.
+     */
+    int64_t reuse(const GpuResourceKey& key);
+
+    /**
+     * Registers a new object with one reference.
+     * @return Its slot.
+     */
+    uint32_t add(GLuint id, const GpuResourceKey& key, size_t bytes);
+
+    void addReference(uint32_t slot) { ++_resources[slot].references; }
+
+    /**
+     * Drops a reference, the object goes to the pool with the last one.
+     */
+    void release(uint32_t slot);
+
+    /**
+     * Deletes the least recently released object.
+     * @return false if the pool is empty.
+     */
+    bool deleteOldest();
+
+    size_t getBytes(uint32_t slot) const { return _resources[slot].bytes; }
+};
+
+/**
+ * Reference-counted handle on a GL object of the GpuResourceManager. Copies share the object,
+ * it is released to the pool with the last handle. GL thread only.
+ */
+template<GpuResourceKind Kind>
+class GpuHandle {
+public:
+    GpuHandle() = default;
+
+    GpuHandle(const GpuHandle& other) : _slot(other._slot), _id(other._id) {
+        if (_slot != 0) {
+            GpuResourceManager::get().addReference(_slot - 1);
+        }
+    }
+
+    GpuHandle(GpuHandle&& other) noexcept : _slot(other._slot), _id(other._id) {
+        other._slot = 0;
+        other._id = 0;
+    }
+
+    GpuHandle& operator=(GpuHandle other) noexcept {
+        std::swap(_slot, other._slot);
+        std::swap(_id, other._id);
+        return *this;
+    }
+
+    ~GpuHandle() { reset(); }
+
+    /**
+     * Releases the object, the handle is then empty.
+     */
+    void reset() {
+        if (_slot != 0) {
+            GpuResourceManager::get().release(_slot - 1);
+            _slot = 0;
+            _id = 0;
+        }
+    }
+
+    /**
+     * @return The GL name of the object, 0 for an empty handle.
+     */
+    GLuint id() const { return _id; }
+
+    /**
+     * @return The estimated VRAM of the object, 0 for an empty handle.
+     */
+    size_t getBytes() const { return _slot != 0 ? GpuResourceManager::get().getBytes(_slot - 1) : 0; }
+
+    explicit operator bool() const { return _slot != 0; }
+
+private:
+    friend class GpuResourceManager;
+
+    GpuHandle(uint32_t slot, GLuint id) : _slot(slot + 1), _id(id) {}
+
+    uint32_t _slot = 0;     // Slot in the manager plus one, 0 for an empty handle
+    GLuint _id = 0;         // GL name, cached for the draw loops
+};
@@ -0,0 +1,315 @@
+#include "hdrImage.h"
+#include "simd.h"
+#include <ImfRgbaFile.h>
+#include <ImfRgba.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// Scanlines requested per readPixels call. A multiple of the 16 and 32 line blocks
+// of the zip and piz compressors, so the reader threads always get whole blocks.
+static const int EXR_LINES_PER_BLOCK = 64;
+
+/**
+ * Minimal buffered byte reader, the RGBE decoder reads its input one byte at a time.
+ */
+class ByteReader {
+public:
+    explicit ByteReader(std::istream& stream) : _stream(stream), _buffer(1 << 16) {}
+
+    int get() {
+        if (_position == _size) {
+            _stream.read(_buffer.data(), _buffer.size());
+            _size = static_cast<size_t>(_stream.gcount());
+            _position = 0;
+            if (_size == 0) return EOF;
+        }
+        return static_cast<unsigned char>(_buffer[_position++]);
+    }
+
+    bool readLine(std::string& line) {
+        line.clear();
+        int c;
+        while ((c = get()) != EOF && c != '\n') {
+            line += static_cast<char>(c);
+        }
+        return c != EOF || !line.empty();
+    }
+
+private:
+    std::istream& _stream;
+    std::vector<char> _buffer;
+    size_t _size = 0;
+    size_t _position = 0;
+};
+
+void ScanlineDownsampler::init(int srcWidth, int srcHeight, int factor, HdrImage* image) {
+    _image = image;
+    _srcWidth = srcWidth;
+    _factor = factor;
+    _rowsAccumulated = 0;
+    _dstRow = 0;
+
+    // trailing pixels that do not fill a whole block are dropped
+    _image->width = srcWidth / factor;
+    _image->height = srcHeight / factor;
+    _image->pixels.assign(static_cast<size_t>(_image->width) * _image->height * 4, 0);
+    _accum.assign(static_cast<size_t>(_image->width) * 4, 0.0f);
+}
+
+void ScanlineDownsampler::addRow(const float* rgba) {
+    if (_dstRow >= _image->height) {
+        return;
+    }
+
+    // horizontal box filter, one RGBA pixel per SSE register
+    int dstWidth = _image->width;
+    float* accum = _accum.data();
+    for (int x = 0; x < dstWidth; ++x) {
+        const float* src = rgba + static_cast<size_t>(x) * _factor * 4;
+#if defined(SIMD_SSE2)
+        __m128 sum = _mm_loadu_ps(accum + x * 4);
+        for (int k = 0; k < _factor; ++k) {
+            sum = _mm_add_ps(sum, _mm_loadu_ps(src + k * 4));
+        }
+        _mm_storeu_ps(accum + x * 4, sum);
+#else
+        for (int k = 0; k < _factor; ++k) {
+            for (int c = 0; c < 4; ++c) {
+                accum[x * 4 + c] += src[k * 4 + c];
+            }
+        }
+#endif
+    }
+
+    if (++_rowsAccumulated < _factor) {
+        return;
+    }
+
+    // the block is complete, average it and store it as half floats
+    float scale = 1.0f / (_factor * _factor);
+    uint16_t* dst = _image->pixels.data() + static_cast<size_t>(_dstRow) * dstWidth * 4;
+#if defined(SIMD_F16C)
+    __m128 scale4 = _mm_set1_ps(scale);
+    for (int x = 0; x < dstWidth; ++x) {
+        __m128 average = _mm_mul_ps(_mm_loadu_ps(accum + x * 4), scale4);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 4), _mm_cvtps_ph(average, _MM_FROUND_TO_NEAREST_INT));
+    }
+#else
+    for (int i = 0; i < dstWidth * 4; ++i) {
+        dst[i] = half(accum[i] * scale).bits();
+    }
+#endif
+
+    std::fill(_accum.begin(), _accum.end(), 0.0f);
+    _rowsAccumulated = 0;
+    ++_dstRow;
+}
+
+/**
+ * Converts a row of EXR half pixels to RGBA floats.
+ */
+static void halfRowToFloat(const Imf::Rgba* src, int width, float* dst) {
+    for (int x = 0; x < width; ++x) {
+#if defined(SIMD_F16C)
+        __m128i halves = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x));
+        _mm_storeu_ps(dst + x * 4, _mm_cvtph_ps(halves));
+#else
+        dst[x * 4 + 0] = src[x].r;
+        dst[x * 4 + 1] = src[x].g;
+        dst[x * 4 + 2] = src[x].b;
+        dst[x * 4 + 3] = src[x].a;
+#endif
+    }
+}
+
+/**
+ * Converts a row of RGBE pixels to RGBA floats, the same way stb_image does.
+ */
+static void rgbeRowToFloat(const unsigned char* rgbe, int width, float* dst) {
+    for (int x = 0; x < width; ++x) {
+        const unsigned char* pixel = rgbe + x * 4;
+        float f = pixel[3] == 0 ? 0.0f : std::ldexp(1.0f, pixel[3] - (128 + 8));
+        dst[x * 4 + 0] = pixel[0] * f;
+        dst[x * 4 + 1] = pixel[1] * f;
+        dst[x * 4 + 2] = pixel[2] * f;
+        dst[x * 4 + 3] = 1.0f;
+    }
+}
+
+/**
+ * Reads one RGBE scanline, either flat or with the adaptive run-length encoding.
+ * @return false on truncated data or on the old run-length encoding, which is not handled.
+ */
+static bool readRgbeScanline(ByteReader& reader, int width, unsigned char* rgbe) {
+    unsigned char header[4];
+    for (int i = 0; i < 4; ++i) {
+        int c = reader.get();
+        if (c == EOF) return false;
+        header[i] = static_cast<unsigned char>(c);
+    }
+
+    bool encoded = width >= 8 && width < 0x8000 && header[0] == 2 && header[1] == 2 && (header[2] & 0x80) == 0;
+    if (!encoded) {
+        // flat scanline, the header already is the first pixel
+        std::memcpy(rgbe, header, 4);
+        for (int i = 4; i < width * 4; ++i) {
+            int c = reader.get();
+            if (c == EOF) return false;
+            rgbe[i] = static_cast<unsigned char>(c);
+        }
+        // (1, 1, 1, n) pixels are repeat markers of the old encoding
+        for (int x = 0; x < width; ++x) {
+            if (rgbe[x * 4] == 1 && rgbe[x * 4 + 1] == 1 && rgbe[x * 4 + 2] == 1) return false;
+        }
+        return true;
+    }
+
+    if (((header[2] << 8) | header[3]) != width) return false;
+
+    // each channel is stored as its own run-length encoded plane
+    for (int channel = 0; channel < 4; ++channel) {
+        int x = 0;
+        while (x < width) {
+            int count = reader.get();
+            if (count == EOF || count == 0 || count == 128) return false;
+            if (count > 128) {
+                count -= 128;
+                int value = reader.get();
+                if (value == EOF || x + count > width) return false;
+                for (; count > 0; --count) {
+                    rgbe[(x++) * 4 + channel] = static_cast<unsigned char>(value);
+                }
+            }
+            else {
+                if (x + count > width) return false;
+                for (; count > 0; --count) {
+                    int value = reader.get();
+                    if (value == EOF) return false;
+                    rgbe[(x++) * 4 + channel] = static_cast<unsigned char>(value);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Loads a whole .hdr file with stb_image, for files the streaming reader rejects.
+ */
+static bool loadHdrWithStb(const std::string& filepath, int targetWidth, HdrImage& image) {
+    int width, height, channels;
+    float* data = stbi_loadf(filepath.c_str(), &width, &height, &channels, 4);
+    if (!data) {
+        std::cerr << "Failed to load HDR image: " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    ScanlineDownsampler downsampler;
+    downsampler.init(width, height, HdrImageLoader::downsampleFactor(width, targetWidth), &image);
+    for (int y = 0; y < height; ++y) {
+        downsampler.addRow(data + static_cast<size_t>(y) * width * 4);
+    }
+
+    stbi_image_free(data);
+    return true;
+}
+
+int HdrImageLoader::downsampleFactor(int width, int targetWidth) {
+    return std::max(1, width / std::max(1, targetWidth));
+}
+
+bool HdrImageLoader::load(const std::string& filepath, int targetWidth, HdrImage& image) {
+    std::string extension = std::filesystem::path(filepath).extension().string();
+    if (extension == ".exr") {
+        return loadExr(filepath, targetWidth, image);
+    }
+    if (extension == ".hdr") {
+        return loadHdr(filepath, targetWidth, image);
+    }
+    std::cerr << "Unsupported environment format: " << filepath << std::endl;
+    return false;
+}
+
+bool HdrImageLoader::loadExr(const std::string& filepath, int targetWidth, HdrImage& image) {
+    try {
+        // Open the EXR image file, with one decoding thread per core
+        int threadCount = std::max(1u, std::thread::hardware_concurrency());
+        Imf::RgbaInputFile file(filepath.c_str(), threadCount);
+
+        // Get the data window of the EXR file, which specifies the valid pixel region
+        Imath::Box2i dw = file.dataWindow();
+        int width = dw.max.x - dw.min.x + 1;
+        int height = dw.max.y - dw.min.y + 1;
+
+        ScanlineDownsampler downsampler;
+        downsampler.init(width, height, downsampleFactor(width, targetWidth), &image);
+
+        // Only one block of scanlines is resident at a time
+        std::vector<Imf::Rgba> block(static_cast<size_t>(width) * EXR_LINES_PER_BLOCK);
+        std::vector<float> row(static_cast<size_t>(width) * 4);
+        for (int y = dw.min.y; y <= dw.max.y; y += EXR_LINES_PER_BLOCK) {
+            int lastY = std::min(y + EXR_LINES_PER_BLOCK - 1, dw.max.y);
+
+            // point the framebuffer at the block so that scanline y lands on its first row
+            file.setFrameBuffer(block.data() - dw.min.x - static_cast<ptrdiff_t>(y) * width, 1, width);
+            file.readPixels(y, lastY);
+
+            for (int line = 0; line <= lastY - y; ++line) {
+                halfRowToFloat(&block[static_cast<size_t>(line) * width], width, row.data());
+                downsampler.addRow(row.data());
+            }
+        }
+        return true;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Failed to load EXR: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool HdrImageLoader::loadHdr(const std::string& filepath, int targetWidth, HdrImage& image) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open HDR image: " << filepath << std::endl;
+        return false;
+    }
+    ByteReader reader(file);
+
+    // header: magic line, variables, empty line, then the resolution string
+    std::string line;
+    if (!reader.readLine(line) || line.rfind("#?", 0) != 0) {
+        return loadHdrWithStb(filepath, targetWidth, image);
+    }
+    while (reader.readLine(line) && !line.empty()) {
+        if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe") {
+            return loadHdrWithStb(filepath, targetWidth, image);
+        }
+    }
+
+    // only the standard top to bottom, left to right orientation is streamed
+    int width = 0, height = 0;
+    if (!reader.readLine(line) || std::sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2 || width <= 0 || height <= 0) {
+        return loadHdrWithStb(filepath, targetWidth, image);
+    }
+
+    ScanlineDownsampler downsampler;
+    downsampler.init(width, height, downsampleFactor(width, targetWidth), &image);
+
+    std::vector<unsigned char> rgbe(static_cast<size_t>(width) * 4);
+    std::vector<float> row(static_cast<size_t>(width) * 4);
+    for (int y = 0; y < height; ++y) {
+        if (!readRgbeScanline(reader, width, rgbe.data())) {
+            return loadHdrWithStb(filepath, targetWidth, image);
+        }
+        rgbeRowToFloat(rgbe.data(), width, row.data());
+        downsampler.addRow(row.data());
+    }
+    return true;
+}
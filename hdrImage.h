@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * RGBA half-float image decoded from an HDR or EXR environment file.
+ * Rows are stored top row first, as they come out of the file.
+ */
+struct HdrImage {
+    int width = 0;                  // Width of the image in pixels
+    int height = 0;                 // Height of the image in pixels
+    std::vector<uint16_t> pixels;   // RGBA half-float values, 4 per pixel
+};
+
+/**
+ * Box-filters source scanlines by an integer factor as they are decoded and writes
+ * the result to an HdrImage as half floats. Only one row of accumulators is kept,
+ * so the full-size source image never has to be held in memory.
+ */
+class ScanlineDownsampler {
+public:
+    /**
+     * Prepares the downsampler and allocates the destination image.
+     * @param srcWidth Width of the source image in pixels.
+     * @param srcHeight Height of the source image in pixels.
+     * @param factor Downsampling factor applied on both axes (1 keeps the size).
+     * @param image Destination image, resized to srcWidth / factor x srcHeight / factor.
+     */
+    void init(int srcWidth, int srcHeight, int factor, HdrImage* image);
+
+    /**
+     * Accumulates one source scanline. Rows must be added top to bottom.
+     * @param rgba srcWidth RGBA float pixels.
+     */
+    void addRow(const float* rgba);
+
+private:
+    HdrImage* _image = nullptr;     // Destination image
+    std::vector<float> _accum;      // Running RGBA sums of the destination row being built
+    int _srcWidth = 0;              // Width of the source image
+    int _factor = 1;                // Downsampling factor
+    int _rowsAccumulated = 0;       // Source rows summed into _accum so far
+    int _dstRow = 0;                // Next destination row to write
+};
+
+namespace HdrImageLoader {
+
+    /**
+     * Computes the largest integer downsampling factor that keeps at least targetWidth pixels.
+     * @param width Source width in pixels.
+     * @param targetWidth Smallest width wanted after downsampling.
+     * @return The downsampling factor, at least 1.
+     */
+    int downsampleFactor(int width, int targetWidth);
+
+    /**
+     * Loads an .exr or .hdr environment, streaming it through a ScanlineDownsampler.
+     * @param filepath Path to the environment file.
+     * @param targetWidth Resolution needed by the caller, images at least twice as wide are box-filtered down.
+     * @param image Receives the decoded pixels.
+     * @return true on success, false if the file could not be read.
+     */
+    bool load(const std::string& filepath, int targetWidth, HdrImage& image);
+
+    /**
+     * Streams an OpenEXR file in blocks of scanlines with OpenEXR's multithreaded reader.
+     * @see load
+     */
+    bool loadExr(const std::string& filepath, int targetWidth, HdrImage& image);
+
+    /**
+     * Streams a Radiance RGBE (.hdr) file scanline by scanline.
+     * Falls back to stb_image for layouts the streaming reader does not handle.
+     * @see load
+     */
+    bool loadHdr(const std::string& filepath, int targetWidth, HdrImage& image);
+}
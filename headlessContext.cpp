@@ -0,0 +1,137 @@
+#include "headlessContext.h"
+#include <glad/glad.h>
+#include <iostream>
+
+#if defined(__linux__)
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+
+/**
+ * @return The surfaceless Mesa display if the EGL client supports it, the default display otherwise.
+ */
+static EGLDisplay getDisplay() {
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (extensions != nullptr && std::strstr(extensions, "EGL_MESA_platform_surfaceless") != nullptr) {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay != nullptr) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY) {
+                return display;
+            }
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool HeadlessContext::init(int width, int height) {
+    EGLDisplay display = getDisplay();
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "Error initializing EGL" << std::endl;
+        return false;
+    }
+    _display = display;
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "No EGL config supports OpenGL pbuffers" << std::endl;
+        return false;
+    }
+
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    if (surface == EGL_NO_SURFACE) {
+        std::cerr << "Error creating EGL pbuffer" << std::endl;
+        return false;
+    }
+    _surface = surface;
+
+    // same context as DisplayManager: OpenGL 4.1 core
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "Error creating OpenGL 4.1 context with EGL" << std::endl;
+        return false;
+    }
+    _context = context;
+
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        std::cerr << "Error making the EGL context current" << std::endl;
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cerr << "Error initializing glad" << std::endl;
+        return false;
+    }
+    std::cout << "Headless context: EGL " << major << "." << minor << ", " << glGetString(GL_RENDERER) << std::endl;
+    return true;
+}
+
+void HeadlessContext::cleanup() {
+    if (_display == nullptr) {
+        return;
+    }
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (_context != nullptr) eglDestroyContext(_display, _context);
+    if (_surface != nullptr) eglDestroySurface(_display, _surface);
+    eglTerminate(_display);
+    _display = _surface = _context = nullptr;
+}
+
+#else
+#include <SDL.h>
+
+bool HeadlessContext::init(int width, int height) {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        std::cerr << "SDL2 could not initialize video" << std::endl;
+        return false;
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    SDL_Window* window = SDL_CreateWindow("3DModelViewer benchmark", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (window == nullptr) {
+        std::cerr << "Error creating SDL Window" << std::endl;
+        return false;
+    }
+    _display = window;
+    _context = SDL_GL_CreateContext(window);
+    if (_context == nullptr) {
+        std::cerr << "Error creating OpenGL Context" << std::endl;
+        return false;
+    }
+    if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) {
+        std::cerr << "Error initializing glad" << std::endl;
+        return false;
+    }
+    // never wait for a display refresh
+    SDL_GL_SetSwapInterval(0);
+    std::cout << "Headless context: hidden SDL window, " << glGetString(GL_RENDERER) << std::endl;
+    return true;
+}
+
+void HeadlessContext::cleanup() {
+    if (_context != nullptr) SDL_GL_DeleteContext(_context);
+    if (_display != nullptr) SDL_DestroyWindow((SDL_Window*)_display);
+    SDL_Quit();
+    _display = _context = nullptr;
+}
+#endif
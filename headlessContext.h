@@ -0,0 +1,33 @@
+#pragma once
+
+/**
+ * Offscreen OpenGL 4.1 context for runs without a display (benchmarks, CI).
+ * On Linux it uses EGL on Mesa's surfaceless platform, so it works without a window system
+ * and with the llvmpipe software rasterizer, and renders into a pbuffer of the requested size
+ * that acts as the default framebuffer. Elsewhere it falls back to a hidden SDL window.
+ */
+class HeadlessContext {
+public:
+    HeadlessContext() {}
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    /**
+     * Creates the context, makes it current and loads the GL functions.
+     * @param width Width of the default framebuffer in pixels.
+     * @param height Height of the default framebuffer in pixels.
+     * @return false if no context could be created, the error is printed.
+     */
+    bool init(int width, int height);
+
+    /**
+     * Destroys the context.
+     */
+    void cleanup();
+
+private:
+    void* _display = nullptr;   // EGLDisplay, or the SDL window on the fallback path
+    void* _surface = nullptr;   // EGLSurface pbuffer
+    void* _context = nullptr;   // EGLContext, or the SDL GL context
+};
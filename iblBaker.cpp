@@ -0,0 +1,580 @@
+#include "iblBaker.h"
+#include "simd.h"
+#include <ImfRgba.h>
+#include <algorithm>
+#include <cmath>
+
+static const float PI = 3.14159265359f;
+
+#if defined(SIMD_AVX2_DISPATCH)
+static bool useAvx2 = cpuSupportsAvx2();
+#else
+static bool useAvx2 = false;
+#endif
+
+void IblBaker::setAvx2Enabled(bool enabled) {
+#if defined(SIMD_AVX2_DISPATCH)
+    useAvx2 = enabled && cpuSupportsAvx2();
+#endif
+}
+
+bool IblBaker::avx2Enabled() {
+    return useAvx2;
+}
+
+void CpuCubemap::allocate(int size, int mipLevels) {
+    this->size = size;
+    this->mipLevels = mipLevels;
+    mipSizes.resize(mipLevels);
+    mipOffsets.resize(mipLevels);
+    size_t offset = 0;
+    for (int mip = 0; mip < mipLevels; ++mip) {
+        mipSizes[mip] = std::max(1, size >> mip);
+        mipOffsets[mip] = (int32_t)offset;
+        offset += (size_t)mipSizes[mip] * mipSizes[mip] * 6 * 3;
+    }
+    pixels.assign(offset, 0.0f);
+}
+
+/**
+ * Convolution samples in tangent space (normal along +Z), as arrays padded to a multiple of 8.
+ * The result of a convolution is scale * sum(weight * sample(direction, lod)).
+ */
+struct SampleTable {
+    std::vector<float> x, y, z, lod, weight;
+    float scale = 1.0f;
+
+    void add(float dx, float dy, float dz, float sampleLod, float sampleWeight) {
+        x.push_back(dx);
+        y.push_back(dy);
+        z.push_back(dz);
+        lod.push_back(sampleLod);
+        weight.push_back(sampleWeight);
+    }
+
+    // padding samples have no weight
+    void pad() {
+        while (x.size() % 8 != 0) {
+            add(0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+        }
+    }
+
+    size_t size() const { return x.size(); }
+};
+
+// Scalar kernels
+// --------------
+
+static void normalize3(float v[3]) {
+    float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 1e-12f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+static void cross3(const float a[3], const float b[3], float out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/**
+ * Direction through the center of a texel, following the OpenGL cubemap face layout.
+ */
+static void texelDirection(int face, int x, int y, int size, float dir[3]) {
+    float sc = 2.0f * (x + 0.5f) / size - 1.0f;
+    float tc = 2.0f * (y + 0.5f) / size - 1.0f;
+    switch (face) {
+    case 0: dir[0] = 1.0f; dir[1] = -tc; dir[2] = -sc; break;
+    case 1: dir[0] = -1.0f; dir[1] = -tc; dir[2] = sc; break;
+    case 2: dir[0] = sc; dir[1] = 1.0f; dir[2] = tc; break;
+    case 3: dir[0] = sc; dir[1] = -1.0f; dir[2] = -tc; break;
+    case 4: dir[0] = sc; dir[1] = -tc; dir[2] = 1.0f; break;
+    default: dir[0] = -sc; dir[1] = -tc; dir[2] = -1.0f; break;
+    }
+    normalize3(dir);
+}
+
+/**
+ * Face and face coordinates in [0, 1] hit by a direction.
+ */
+static void directionToFace(const float dir[3], int& face, float& s, float& t) {
+    float ax = std::fabs(dir[0]), ay = std::fabs(dir[1]), az = std::fabs(dir[2]);
+    float ma, sc, tc;
+    if (ax >= ay && ax >= az) {
+        face = dir[0] >= 0.0f ? 0 : 1;
+        ma = ax;
+        sc = dir[0] >= 0.0f ? -dir[2] : dir[2];
+        tc = -dir[1];
+    }
+    else if (ay >= az) {
+        face = dir[1] >= 0.0f ? 2 : 3;
+        ma = ay;
+        sc = dir[0];
+        tc = dir[1] >= 0.0f ? dir[2] : -dir[2];
+    }
+    else {
+        face = dir[2] >= 0.0f ? 4 : 5;
+        ma = az;
+        sc = dir[2] >= 0.0f ? dir[0] : -dir[0];
+        tc = -dir[1];
+    }
+    s = 0.5f * (sc / ma + 1.0f);
+    t = 0.5f * (tc / ma + 1.0f);
+}
+
+/**
+ * Bilinear sample of one face of one mip level, clamped to the face edges.
+ */
+static void sampleLevel(const CpuCubemap& cube, int mip, int face, float s, float t, float rgb[3]) {
+    int size = cube.mipSizes[mip];
+    float u = std::max(s * size - 0.5f, 0.0f);
+    float v = std::max(t * size - 0.5f, 0.0f);
+    int x0 = std::min((int)u, size - 1), y0 = std::min((int)v, size - 1);
+    int x1 = std::min(x0 + 1, size - 1), y1 = std::min(y0 + 1, size - 1);
+    float fx = u - std::floor(u), fy = v - std::floor(v);
+
+    const float* base = cube.pixels.data() + cube.mipOffsets[mip] + (size_t)face * size * size * 3;
+    const float* p00 = base + ((size_t)y0 * size + x0) * 3;
+    const float* p01 = base + ((size_t)y0 * size + x1) * 3;
+    const float* p10 = base + ((size_t)y1 * size + x0) * 3;
+    const float* p11 = base + ((size_t)y1 * size + x1) * 3;
+    for (int c = 0; c < 3; ++c) {
+        float top = p00[c] + (p01[c] - p00[c]) * fx;
+        float bottom = p10[c] + (p11[c] - p10[c]) * fx;
+        rgb[c] = top + (bottom - top) * fy;
+    }
+}
+
+/**
+ * Trilinear sample of a cubemap, like textureLod.
+ */
+static void sampleCube(const CpuCubemap& cube, const float dir[3], float lod, float rgb[3]) {
+    int face;
+    float s, t;
+    directionToFace(dir, face, s, t);
+
+    lod = std::min(std::max(lod, 0.0f), (float)(cube.mipLevels - 1));
+    int mip0 = (int)lod;
+    int mip1 = std::min(mip0 + 1, cube.mipLevels - 1);
+    float f = lod - mip0;
+
+    sampleLevel(cube, mip0, face, s, t, rgb);
+    if (f > 0.0f && mip1 != mip0) {
+        float next[3];
+        sampleLevel(cube, mip1, face, s, t, next);
+        for (int c = 0; c < 3; ++c) {
+            rgb[c] += (next[c] - rgb[c]) * f;
+        }
+    }
+}
+
+static void convolveScalar(const CpuCubemap& source, const SampleTable& table, const float tangent[3], const float bitangent[3], const float normal[3], float rgb[3]) {
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < table.size(); ++i) {
+        float weight = table.weight[i];
+        if (weight == 0.0f) {
+            continue;
+        }
+        float dir[3];
+        for (int c = 0; c < 3; ++c) {
+            dir[c] = tangent[c] * table.x[i] + bitangent[c] * table.y[i] + normal[c] * table.z[i];
+        }
+        float color[3];
+        sampleCube(source, dir, table.lod[i], color);
+        for (int c = 0; c < 3; ++c) {
+            sum[c] += color[c] * weight;
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        rgb[c] = sum[c] * table.scale;
+    }
+}
+
+// AVX2 kernels, 8 samples per iteration
+// -------------------------------------
+#if defined(SIMD_AVX2_DISPATCH)
+
+SIMD_TARGET_AVX2 static inline void directionToFace8(__m256 x, __m256 y, __m256 z, __m256i& face, __m256& s, __m256& t) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 ax = _mm256_andnot_ps(signMask, x);
+    __m256 ay = _mm256_andnot_ps(signMask, y);
+    __m256 az = _mm256_andnot_ps(signMask, z);
+    __m256 isX = _mm256_and_ps(_mm256_cmp_ps(ax, ay, _CMP_GE_OQ), _mm256_cmp_ps(ax, az, _CMP_GE_OQ));
+    __m256 isY = _mm256_andnot_ps(isX, _mm256_cmp_ps(ay, az, _CMP_GE_OQ));
+
+    // +-1 with the sign of each axis
+    __m256 sx = _mm256_or_ps(one, _mm256_and_ps(signMask, x));
+    __m256 sy = _mm256_or_ps(one, _mm256_and_ps(signMask, y));
+    __m256 sz = _mm256_or_ps(one, _mm256_and_ps(signMask, z));
+
+    // X faces are 0 and 1, Y faces 2 and 3, Z faces 4 and 5, odd for a negative major axis
+    __m256 majorSign = _mm256_blendv_ps(_mm256_blendv_ps(sz, sy, isY), sx, isX);
+    __m256 faceBase = _mm256_blendv_ps(_mm256_blendv_ps(_mm256_set1_ps(4.0f), _mm256_set1_ps(2.0f), isY), _mm256_setzero_ps(), isX);
+    __m256 negative = _mm256_and_ps(_mm256_cmp_ps(majorSign, _mm256_setzero_ps(), _CMP_LT_OQ), one);
+    face = _mm256_cvttps_epi32(_mm256_add_ps(faceBase, negative));
+
+    __m256 ma = _mm256_blendv_ps(_mm256_blendv_ps(az, ay, isY), ax, isX);
+    __m256 negY = _mm256_xor_ps(y, signMask);
+    __m256 sc = _mm256_blendv_ps(_mm256_blendv_ps(_mm256_mul_ps(sz, x), x, isY), _mm256_xor_ps(_mm256_mul_ps(sx, z), signMask), isX);
+    __m256 tc = _mm256_blendv_ps(_mm256_blendv_ps(negY, _mm256_mul_ps(sy, z), isY), negY, isX);
+
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 scale = _mm256_div_ps(half, ma);
+    s = _mm256_fmadd_ps(sc, scale, half);
+    t = _mm256_fmadd_ps(tc, scale, half);
+}
+
+SIMD_TARGET_AVX2 static inline __m256 lerp8(__m256 a, __m256 b, __m256 f) {
+    return _mm256_fmadd_ps(f, _mm256_sub_ps(b, a), a);
+}
+
+SIMD_TARGET_AVX2 static inline void sampleLevel8(const CpuCubemap& cube, __m256i mip, __m256i face, __m256 s, __m256 t, __m256 rgb[3]) {
+    __m256i size = _mm256_i32gather_epi32(cube.mipSizes.data(), mip, 4);
+    __m256i base = _mm256_i32gather_epi32(cube.mipOffsets.data(), mip, 4);
+    __m256 sizef = _mm256_cvtepi32_ps(size);
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 u = _mm256_max_ps(_mm256_fmsub_ps(s, sizef, half), _mm256_setzero_ps());
+    __m256 v = _mm256_max_ps(_mm256_fmsub_ps(t, sizef, half), _mm256_setzero_ps());
+    __m256 u0 = _mm256_floor_ps(u);
+    __m256 v0 = _mm256_floor_ps(v);
+    __m256 fx = _mm256_sub_ps(u, u0);
+    __m256 fy = _mm256_sub_ps(v, v0);
+
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i last = _mm256_sub_epi32(size, one);
+    __m256i x0 = _mm256_min_epi32(_mm256_cvttps_epi32(u0), last);
+    __m256i y0 = _mm256_min_epi32(_mm256_cvttps_epi32(v0), last);
+    __m256i x1 = _mm256_min_epi32(_mm256_add_epi32(x0, one), last);
+    __m256i y1 = _mm256_min_epi32(_mm256_add_epi32(y0, one), last);
+
+    // value offsets of the 4 texels: base + ((face * size + y) * size + x) * 3
+    __m256i three = _mm256_set1_epi32(3);
+    __m256i faceRow = _mm256_mullo_epi32(face, size);
+    __m256i row0 = _mm256_mullo_epi32(_mm256_add_epi32(faceRow, y0), size);
+    __m256i row1 = _mm256_mullo_epi32(_mm256_add_epi32(faceRow, y1), size);
+    __m256i i00 = _mm256_add_epi32(base, _mm256_mullo_epi32(_mm256_add_epi32(row0, x0), three));
+    __m256i i01 = _mm256_add_epi32(base, _mm256_mullo_epi32(_mm256_add_epi32(row0, x1), three));
+    __m256i i10 = _mm256_add_epi32(base, _mm256_mullo_epi32(_mm256_add_epi32(row1, x0), three));
+    __m256i i11 = _mm256_add_epi32(base, _mm256_mullo_epi32(_mm256_add_epi32(row1, x1), three));
+
+    for (int c = 0; c < 3; ++c) {
+        const float* pixels = cube.pixels.data() + c;
+        __m256 p00 = _mm256_i32gather_ps(pixels, i00, 4);
+        __m256 p01 = _mm256_i32gather_ps(pixels, i01, 4);
+        __m256 p10 = _mm256_i32gather_ps(pixels, i10, 4);
+        __m256 p11 = _mm256_i32gather_ps(pixels, i11, 4);
+        rgb[c] = lerp8(lerp8(p00, p01, fx), lerp8(p10, p11, fx), fy);
+    }
+}
+
+SIMD_TARGET_AVX2 static inline void sampleCube8(const CpuCubemap& cube, __m256 x, __m256 y, __m256 z, __m256 lod, __m256 rgb[3]) {
+    __m256i face;
+    __m256 s, t;
+    directionToFace8(x, y, z, face, s, t);
+
+    __m256 maxLod = _mm256_set1_ps((float)(cube.mipLevels - 1));
+    lod = _mm256_min_ps(_mm256_max_ps(lod, _mm256_setzero_ps()), maxLod);
+    __m256 lod0 = _mm256_floor_ps(lod);
+    __m256 f = _mm256_sub_ps(lod, lod0);
+    __m256i mip0 = _mm256_cvttps_epi32(lod0);
+    __m256i mip1 = _mm256_min_epi32(_mm256_add_epi32(mip0, _mm256_set1_epi32(1)), _mm256_set1_epi32(cube.mipLevels - 1));
+
+    sampleLevel8(cube, mip0, face, s, t, rgb);
+    if (_mm256_movemask_ps(_mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_GT_OQ)) != 0) {
+        __m256 next[3];
+        sampleLevel8(cube, mip1, face, s, t, next);
+        for (int c = 0; c < 3; ++c) {
+            rgb[c] = lerp8(rgb[c], next[c], f);
+        }
+    }
+}
+
+SIMD_TARGET_AVX2 static inline float horizontalSum8(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+    return _mm_cvtss_f32(sum);
+}
+
+SIMD_TARGET_AVX2 static void convolveAvx2(const CpuCubemap& source, const SampleTable& table, const float tangent[3], const float bitangent[3], const float normal[3], float rgb[3]) {
+    __m256 t[3], b[3], n[3], sum[3];
+    for (int c = 0; c < 3; ++c) {
+        t[c] = _mm256_set1_ps(tangent[c]);
+        b[c] = _mm256_set1_ps(bitangent[c]);
+        n[c] = _mm256_set1_ps(normal[c]);
+        sum[c] = _mm256_setzero_ps();
+    }
+
+    for (size_t i = 0; i < table.size(); i += 8) {
+        __m256 lx = _mm256_loadu_ps(table.x.data() + i);
+        __m256 ly = _mm256_loadu_ps(table.y.data() + i);
+        __m256 lz = _mm256_loadu_ps(table.z.data() + i);
+        __m256 dir[3];
+        for (int c = 0; c < 3; ++c) {
+            dir[c] = _mm256_fmadd_ps(t[c], lx, _mm256_fmadd_ps(b[c], ly, _mm256_mul_ps(n[c], lz)));
+        }
+
+        __m256 color[3];
+        sampleCube8(source, dir[0], dir[1], dir[2], _mm256_loadu_ps(table.lod.data() + i), color);
+
+        __m256 weight = _mm256_loadu_ps(table.weight.data() + i);
+        for (int c = 0; c < 3; ++c) {
+            sum[c] = _mm256_fmadd_ps(color[c], weight, sum[c]);
+        }
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        rgb[c] = horizontalSum8(sum[c]) * table.scale;
+    }
+}
+#endif
+
+static void convolve(const CpuCubemap& source, const SampleTable& table, const float tangent[3], const float bitangent[3], const float normal[3], float rgb[3]) {
+#if defined(SIMD_AVX2_DISPATCH)
+    if (useAvx2) {
+        convolveAvx2(source, table, tangent, bitangent, normal, rgb);
+        return;
+    }
+#endif
+    convolveScalar(source, table, tangent, bitangent, normal, rgb);
+}
+
+// Sample tables, see irradiance_convolution.fs and prefilter.fs
+// -------------------------------------------------------------
+
+static SampleTable irradianceTable(float lod) {
+    SampleTable table;
+    float sampleDelta = 0.025f;
+    float nrSamples = 0.0f;
+    for (float phi = 0.0f; phi < 2.0f * PI; phi += sampleDelta) {
+        for (float theta = 0.0f; theta < 0.5f * PI; theta += sampleDelta) {
+            // spherical to cartesian (in tangent space), weighted by cos(theta) * sin(theta)
+            table.add(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta), lod, std::cos(theta) * std::sin(theta));
+            nrSamples++;
+        }
+    }
+    table.scale = PI / nrSamples;
+    table.pad();
+    return table;
+}
+
+static float radicalInverseVdC(uint32_t bits) {
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10f; // / 0x100000000
+}
+
+static SampleTable prefilterTable(float roughness, int sourceSize) {
+    // with V = R = N, the GGX samples only depend on the roughness in tangent space
+    const uint32_t SAMPLE_COUNT = 1024u;
+    SampleTable table;
+    float a = roughness * roughness;
+    float totalWeight = 0.0f;
+    for (uint32_t i = 0u; i < SAMPLE_COUNT; ++i) {
+        float xi0 = float(i) / float(SAMPLE_COUNT);
+        float xi1 = radicalInverseVdC(i);
+
+        // GGX importance sampled half vector
+        float phi = 2.0f * PI * xi0;
+        float cosTheta = std::sqrt((1.0f - xi1) / (1.0f + (a * a - 1.0f) * xi1));
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+        float h[3] = { std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta };
+
+        // reflect V = (0, 0, 1) around H
+        float l[3] = { 2.0f * cosTheta * h[0], 2.0f * cosTheta * h[1], 2.0f * cosTheta * h[2] - 1.0f };
+        float NdotL = l[2];
+        if (NdotL <= 0.0f) {
+            continue;
+        }
+
+        // sample from the environment's mip level based on roughness/pdf
+        float a2 = a * a;
+        float NdotH = cosTheta;
+        float denom = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+        float D = a2 / (PI * denom * denom);
+        float pdf = D * NdotH / (4.0f * cosTheta) + 0.0001f;
+        float saTexel = 4.0f * PI / (6.0f * sourceSize * sourceSize);
+        float saSample = 1.0f / (float(SAMPLE_COUNT) * pdf + 0.0001f);
+        float mipLevel = roughness == 0.0f ? 0.0f : 0.5f * std::log2(saSample / saTexel);
+
+        table.add(l[0], l[1], l[2], mipLevel, NdotL);
+        totalWeight += NdotL;
+    }
+    table.scale = 1.0f / totalWeight;
+    table.pad();
+    return table;
+}
+
+// Passes
+// ------
+
+void IblBaker::equirectToCubemap(const HdrImage& image, CpuCubemap& cubemap, ThreadPool& pool) {
+    // half RGBA to float RGB once, the image is sampled many times
+    std::vector<float> rgb((size_t)image.width * image.height * 3);
+    for (size_t i = 0; i < (size_t)image.width * image.height; ++i) {
+        for (int c = 0; c < 3; ++c) {
+            half value;
+            value.setBits(image.pixels[i * 4 + c]);
+            rgb[i * 3 + c] = value;
+        }
+    }
+
+    int size = cubemap.size;
+    pool.parallelFor(6 * size, [&](int row) {
+        int face = row / size, y = row % size;
+        for (int x = 0; x < size; ++x) {
+            float dir[3];
+            texelDirection(face, x, y, size, dir);
+
+            // same mapping and bilinear clamp-to-edge filter as equirectangular_to_cubemap.fs
+            float u = std::atan2(dir[2], dir[0]) * 0.1591f + 0.5f;
+            float v = -std::asin(dir[1]) * 0.3183f + 0.5f;
+            float px = std::min(std::max(u * image.width - 0.5f, 0.0f), (float)(image.width - 1));
+            float py = std::min(std::max(v * image.height - 0.5f, 0.0f), (float)(image.height - 1));
+            int x0 = (int)px, y0 = (int)py;
+            int x1 = std::min(x0 + 1, image.width - 1), y1 = std::min(y0 + 1, image.height - 1);
+            float fx = px - x0, fy = py - y0;
+
+            float* out = cubemap.texel(0, face, x, y);
+            for (int c = 0; c < 3; ++c) {
+                float p00 = rgb[((size_t)y0 * image.width + x0) * 3 + c];
+                float p01 = rgb[((size_t)y0 * image.width + x1) * 3 + c];
+                float p10 = rgb[((size_t)y1 * image.width + x0) * 3 + c];
+                float p11 = rgb[((size_t)y1 * image.width + x1) * 3 + c];
+                float top = p00 + (p01 - p00) * fx;
+                float bottom = p10 + (p11 - p10) * fx;
+                out[c] = top + (bottom - top) * fy;
+            }
+        }
+        });
+}
+
+void IblBaker::generateMipmaps(CpuCubemap& cubemap, ThreadPool& pool) {
+    for (int mip = 1; mip < cubemap.mipLevels; ++mip) {
+        int size = cubemap.mipSizes[mip];
+        int parentSize = cubemap.mipSizes[mip - 1];
+        pool.parallelFor(6 * size, [&](int row) {
+            int face = row / size, y = row % size;
+            int py0 = std::min(2 * y, parentSize - 1), py1 = std::min(2 * y + 1, parentSize - 1);
+            for (int x = 0; x < size; ++x) {
+                int px0 = std::min(2 * x, parentSize - 1), px1 = std::min(2 * x + 1, parentSize - 1);
+                const float* p00 = cubemap.texel(mip - 1, face, px0, py0);
+                const float* p01 = cubemap.texel(mip - 1, face, px1, py0);
+                const float* p10 = cubemap.texel(mip - 1, face, px0, py1);
+                const float* p11 = cubemap.texel(mip - 1, face, px1, py1);
+                float* out = cubemap.texel(mip, face, x, y);
+                for (int c = 0; c < 3; ++c) {
+                    out[c] = 0.25f * (p00[c] + p01[c] + p10[c] + p11[c]);
+                }
+            }
+            });
+    }
+}
+
+void IblBaker::convolveIrradiance(const CpuCubemap& source, CpuCubemap& irradiance, ThreadPool& pool) {
+    // texture() in the GPU pass picks the mip matching the irradiance texel footprint
+    SampleTable table = irradianceTable(std::log2((float)source.size / irradiance.size));
+
+    int size = irradiance.size;
+    pool.parallelFor(6 * size, [&](int row) {
+        int face = row / size, y = row % size;
+        for (int x = 0; x < size; ++x) {
+            float normal[3];
+            texelDirection(face, x, y, size, normal);
+
+            // tangent space calculation from origin point
+            float up[3] = { 0.0f, 1.0f, 0.0f };
+            float right[3];
+            cross3(up, normal, right);
+            if (right[0] * right[0] + right[1] * right[1] + right[2] * right[2] < 1e-12f) {
+                right[0] = 1.0f; right[1] = 0.0f; right[2] = 0.0f;
+            }
+            normalize3(right);
+            cross3(normal, right, up);
+            normalize3(up);
+
+            convolve(source, table, right, up, normal, irradiance.texel(0, face, x, y));
+        }
+        });
+}
+
+void IblBaker::prefilter(const CpuCubemap& source, CpuCubemap& prefilter, ThreadPool& pool) {
+    for (int mip = 0; mip < prefilter.mipLevels; ++mip) {
+        float roughness = (float)mip / (float)(prefilter.mipLevels - 1);
+        SampleTable table = prefilterTable(roughness, source.size);
+
+        int size = prefilter.mipSizes[mip];
+        pool.parallelFor(6 * size, [&](int row) {
+            int face = row / size, y = row % size;
+            for (int x = 0; x < size; ++x) {
+                float normal[3];
+                texelDirection(face, x, y, size, normal);
+
+                // at zero roughness every sample is the normal itself
+                if (mip == 0) {
+                    sampleCube(source, normal, 0.0f, prefilter.texel(mip, face, x, y));
+                    continue;
+                }
+
+                // from tangent-space vector to world-space sample vector
+                float up[3] = { 0.0f, 0.0f, 1.0f };
+                if (std::fabs(normal[2]) >= 0.999f) {
+                    up[0] = 1.0f; up[2] = 0.0f;
+                }
+                float tangent[3], bitangent[3];
+                cross3(up, normal, tangent);
+                normalize3(tangent);
+                cross3(normal, tangent, bitangent);
+
+                convolve(source, table, tangent, bitangent, normal, prefilter.texel(mip, face, x, y));
+            }
+            });
+    }
+}
+
+CubemapImage IblBaker::toCubemapImage(const CpuCubemap& cubemap, int mipLevels) {
+    CubemapImage image;
+    image.size = cubemap.size;
+    image.mipLevels = std::min(mipLevels, cubemap.mipLevels);
+    size_t count = image.mipOffset(image.mipLevels);
+    image.pixels.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+#if defined(SIMD_F16C)
+        image.pixels[i] = _cvtss_sh(cubemap.pixels[i], _MM_FROUND_TO_NEAREST_INT);
+#else
+        image.pixels[i] = half(cubemap.pixels[i]).bits();
+#endif
+    }
+    return image;
+}
+
+BakedEnvironment IblBaker::bake(const HdrImage& image, ThreadPool& pool) {
+    int cubemapMips = 1;
+    while ((CUBEMAP_SIZE >> cubemapMips) > 0) {
+        ++cubemapMips;
+    }
+
+    CpuCubemap cubemap, irradiance, prefiltered;
+    cubemap.allocate(CUBEMAP_SIZE, cubemapMips);
+    irradiance.allocate(IRRADIANCE_SIZE, 1);
+    prefiltered.allocate(PREFILTER_SIZE, PREFILTER_MIP_LEVELS);
+
+    equirectToCubemap(image, cubemap, pool);
+    generateMipmaps(cubemap, pool);
+    convolveIrradiance(cubemap, irradiance, pool);
+    prefilter(cubemap, prefiltered, pool);
+
+    // only mip 0 of the cubemap is displayed, its mip chain was only needed by the convolutions
+    BakedEnvironment baked;
+    baked.cubemap = toCubemapImage(cubemap, 1);
+    baked.irradiance = toCubemapImage(irradiance, 1);
+    baked.prefilter = toCubemapImage(prefiltered, PREFILTER_MIP_LEVELS);
+    return baked;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include "hdrImage.h"
+#include "iblFile.h"
+#include "threadPool.h"
+#include <cstdint>
+#include <vector>
+
+/**
+ * Cubemap with a mip chain stored as RGB floats, in the same layout as CubemapImage.
+ */
+struct CpuCubemap {
+    int size = 0;                           // Size of the mip 0 faces in pixels
+    int mipLevels = 0;                      // Number of mip levels
+    std::vector<float> pixels;              // RGB values, 3 per pixel
+    std::vector<int32_t> mipSizes;          // Face size of each mip level
+    std::vector<int32_t> mipOffsets;        // Offset in values of each mip level
+
+    /**
+     * Allocates the faces and the mip chain, cleared to black.
+     * @param size Size of the mip 0 faces in pixels.
+     * @param mipLevels Number of mip levels.
+     */
+    void allocate(int size, int mipLevels);
+
+    /**
+     * @return Pointer to the RGB values of a texel.
+     */
+    float* texel(int mip, int face, int x, int y) {
+        int s = mipSizes[mip];
+        return pixels.data() + mipOffsets[mip] + ((size_t)(face * s + y) * s + x) * 3;
+    }
+};
+
+/**
+ * CPU implementation of the IBL bake done by Renderer on the GPU, following the same
+ * shaders (equirectangular_to_cubemap.fs, irradiance_convolution.fs and prefilter.fs)
+ * so that the results match within half-float precision. Every pass is spread over the
+ * thread pool row by row; the convolutions use AVX2 when the CPU supports it.
+ */
+namespace IblBaker {
+
+    // Map resolutions, identical to the GPU bake
+    const int CUBEMAP_SIZE = 512;
+    const int IRRADIANCE_SIZE = 32;
+    const int PREFILTER_SIZE = 1024;
+    const int PREFILTER_MIP_LEVELS = 5;
+
+    /**
+     * Enables or disables the AVX2 kernels, they are used by default when supported.
+     * @param enabled false to force the scalar kernels.
+     */
+    void setAvx2Enabled(bool enabled);
+
+    /**
+     * @return true if the AVX2 kernels are in use.
+     */
+    bool avx2Enabled();
+
+    /**
+     * Projects an equirectangular image onto the mip 0 faces of a cubemap.
+     * @param image Equirectangular image, top row first.
+     * @param cubemap Destination, already allocated.
+     * @param pool Worker threads.
+     */
+    void equirectToCubemap(const HdrImage& image, CpuCubemap& cubemap, ThreadPool& pool);
+
+    /**
+     * Fills mip levels 1 and up by averaging 2x2 blocks, like glGenerateMipmap.
+     * @param cubemap The cubemap whose mip 0 is filled.
+     * @param pool Worker threads.
+     */
+    void generateMipmaps(CpuCubemap& cubemap, ThreadPool& pool);
+
+    /**
+     * Convolves the environment into a diffuse irradiance cubemap.
+     * @param source Environment cubemap with its mip chain.
+     * @param irradiance Destination, already allocated.
+     * @param pool Worker threads.
+     */
+    void convolveIrradiance(const CpuCubemap& source, CpuCubemap& irradiance, ThreadPool& pool);
+
+    /**
+     * Prefilters the environment with the GGX distribution, roughness mip / (mipLevels - 1) per mip.
+     * @param source Environment cubemap with its mip chain.
+     * @param prefilter Destination, already allocated.
+     * @param pool Worker threads.
+     */
+    void prefilter(const CpuCubemap& source, CpuCubemap& prefilter, ThreadPool& pool);
+
+    /**
+     * Converts the first mip levels of a cubemap to half floats for an .ibl file.
+     * @param cubemap The cubemap to convert.
+     * @param mipLevels Number of mip levels to keep.
+     * @return The converted cubemap.
+     */
+    CubemapImage toCubemapImage(const CpuCubemap& cubemap, int mipLevels);
+
+    /**
+     * Runs the whole bake.
+     * @param image Equirectangular image, top row first.
+     * @param pool Worker threads.
+     * @return The baked maps.
+     */
+    BakedEnvironment bake(const HdrImage& image, ThreadPool& pool);
+}
@@ -0,0 +1,66 @@
+#include "iblFile.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// "IBL" followed by the format version
+static const char IBL_MAGIC[4] = { 'I', 'B', 'L', '1' };
+
+/**
+ * Fixed-size file header, followed by the cubemap, irradiance and prefilter pixels.
+ */
+struct IblHeader {
+    char magic[4];
+    int32_t sizes[3];
+    int32_t mipLevels[3];
+};
+
+bool IblFile::write(const std::string& filepath, const BakedEnvironment& environment) {
+    const CubemapImage* maps[3] = { &environment.cubemap, &environment.irradiance, &environment.prefilter };
+
+    IblHeader header;
+    std::memcpy(header.magic, IBL_MAGIC, sizeof(IBL_MAGIC));
+    for (int i = 0; i < 3; ++i) {
+        header.sizes[i] = maps[i]->size;
+        header.mipLevels[i] = maps[i]->mipLevels;
+    }
+
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create " << filepath << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const CubemapImage* map : maps) {
+        file.write(reinterpret_cast<const char*>(map->pixels.data()), map->pixels.size() * sizeof(uint16_t));
+    }
+    return (bool)file;
+}
+
+bool IblFile::read(const std::string& filepath, BakedEnvironment& environment) {
+    std::ifstream file(filepath, std::ios::binary);
+    IblHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, IBL_MAGIC, sizeof(IBL_MAGIC)) != 0) {
+        std::cerr << "Not an IBL file: " << filepath << std::endl;
+        return false;
+    }
+
+    CubemapImage* maps[3] = { &environment.cubemap, &environment.irradiance, &environment.prefilter };
+    for (int i = 0; i < 3; ++i) {
+        CubemapImage& map = *maps[i];
+        if (header.sizes[i] <= 0 || header.sizes[i] > 16384 || header.mipLevels[i] <= 0 || header.mipLevels[i] > 15) {
+            std::cerr << "Invalid IBL file: " << filepath << std::endl;
+            return false;
+        }
+        map.size = header.sizes[i];
+        map.mipLevels = header.mipLevels[i];
+        map.pixels.resize(map.mipOffset(map.mipLevels));
+    }
+    for (CubemapImage* map : maps) {
+        if (!file.read(reinterpret_cast<char*>(map->pixels.data()), map->pixels.size() * sizeof(uint16_t))) {
+            std::cerr << "Truncated IBL file: " << filepath << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
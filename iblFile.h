@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * RGB half-float cubemap with its mip chain, stored mip by mip, then face by face
+ * (in GL_TEXTURE_CUBE_MAP_POSITIVE_X order), then row by row.
+ */
+struct CubemapImage {
+    int size = 0;                   // Size of the mip 0 faces in pixels
+    int mipLevels = 0;              // Number of stored mip levels
+    std::vector<uint16_t> pixels;   // RGB half-float values, 3 per pixel
+
+    /**
+     * @return The size of the faces of a mip level.
+     */
+    int mipSize(int mip) const { return size >> mip > 0 ? size >> mip : 1; }
+
+    /**
+     * @return Offset in values of the first face of a mip level.
+     */
+    size_t mipOffset(int mip) const {
+        size_t offset = 0;
+        for (int i = 0; i < mip; ++i) {
+            offset += (size_t)mipSize(i) * mipSize(i) * 6 * 3;
+        }
+        return offset;
+    }
+};
+
+/**
+ * IBL maps baked offline by the bakeEnvironments tool, ready to upload.
+ */
+struct BakedEnvironment {
+    CubemapImage cubemap;           // Environment cubemap, shown as background
+    CubemapImage irradiance;        // Diffuse irradiance map
+    CubemapImage prefilter;         // Specular prefilter map, one roughness per mip
+};
+
+namespace IblFile {
+
+    /**
+     * Writes baked maps to an .ibl file.
+     * @param filepath Destination path.
+     * @param environment The maps to write.
+     * @return true on success.
+     */
+    bool write(const std::string& filepath, const BakedEnvironment& environment);
+
+    /**
+     * Reads baked maps from an .ibl file.
+     * @param filepath Source path.
+     * @param environment Receives the maps.
+     * @return true on success, false if the file is missing, truncated or of another version.
+     */
+    bool read(const std::string& filepath, BakedEnvironment& environment);
+}
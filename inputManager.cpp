@@ -1,5 +1,6 @@
 #include "inputManager.h"
 #include "event.h"
+#include "profiler.h"
 #include <SDL.h>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_opengl3.h>
@@ -9,19 +10,29 @@ void InputManager::init(EventBus* eventBus) {
     _eventBus = eventBus;
 }
 
-void InputManager::handleInputs() {
+bool InputManager::handleInputs(int waitMs) {
     // inputs
     SDL_Event event;
 
-    while (SDL_PollEvent(&event)) {
+    // mouse motion and wheel steps are summed, the camera moves once per frame
+    glm::vec2 moveDelta(0.0f, 0.0f);
+    int zoomSteps = 0;
+
+    // block until the first event or the timeout, then drain the queue
+    bool hasEvent = waitMs > 0 ? SDL_WaitEventTimeout(&event, waitMs) != 0 : SDL_PollEvent(&event) != 0;
+    if (!hasEvent) {
+        return false;
+    }
+
+    PROFILE_SCOPE("input");
+    for (; hasEvent; hasEvent = SDL_PollEvent(&event) != 0) {
         ImGui_ImplSDL2_ProcessEvent(&event);
         if (event.type == SDL_QUIT) {
             std::cout << "Goodbye!" << std::endl;
-            _eventBus->publish(Event(EventType::Quit));
+            _eventBus->post(Event(EventType::Quit));
         }
         if (event.type == SDL_MOUSEMOTION && _isDragging) {
-            glm::vec2 delta = glm::vec2(event.motion.x, event.motion.y) - _lastMousePos;
-            _eventBus->publish(Event(EventType::Move, delta));
+            moveDelta += glm::vec2(event.motion.x, event.motion.y) - _lastMousePos;
             _lastMousePos = glm::vec2(event.motion.x, event.motion.y);
         }
         if (event.type == SDL_MOUSEBUTTONDOWN && event.button.button == SDL_BUTTON_RIGHT) {
@@ -32,13 +43,20 @@ void InputManager::handleInputs() {
             _isDragging = false;
         }
         if (event.type == SDL_MOUSEWHEEL) {
-            _eventBus->publish(Event(EventType::Zoom, event.wheel.y));
+            zoomSteps += event.wheel.y;
         }
         if (event.type == SDL_WINDOWEVENT) {
             if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-                _eventBus->publish(Event(EventType::ResizeSdlWindow));
+                _eventBus->post(Event(EventType::ResizeSdlWindow));
             }
         }
     }
-}
 
+    if (moveDelta.x != 0.0f || moveDelta.y != 0.0f) {
+        _eventBus->post(Event(EventType::Move, moveDelta));
+    }
+    if (zoomSteps != 0) {
+        _eventBus->post(Event(EventType::Zoom, zoomSteps));
+    }
+    return true;
+}
@@ -19,8 +19,10 @@ public:
 
     /**
      * Processes and handles user inputs, including mouse and keyboard events.
+     * @param waitMs Milliseconds to block waiting for the first input, 0 to only poll.
+     * @return true if any SDL event was received, ImGui may need to redraw.
      */
-    void handleInputs();
+    bool handleInputs(int waitMs = 0);
 
 private:
     bool _isDragging = false;        // Tracks whether a dragging action is in progress
@@ -0,0 +1,241 @@
+#include "ktx2File.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#include <basisu_transcoder.h>
+#include <zstd.h>
+
+// «KTX 20»\r\n\x1A\n
+static const uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+// Vulkan formats read, VkFormat values
+static const uint32_t VK_FORMAT_UNDEFINED = 0;
+static const uint32_t VK_FORMAT_R8G8B8_UNORM = 23;
+static const uint32_t VK_FORMAT_R8G8B8_SRGB = 29;
+static const uint32_t VK_FORMAT_R8G8B8A8_UNORM = 37;
+static const uint32_t VK_FORMAT_R8G8B8A8_SRGB = 43;
+static const uint32_t VK_FORMAT_BC4_UNORM_BLOCK = 139;
+static const uint32_t VK_FORMAT_BC5_UNORM_BLOCK = 141;
+static const uint32_t VK_FORMAT_BC7_UNORM_BLOCK = 145;
+static const uint32_t VK_FORMAT_BC7_SRGB_BLOCK = 146;
+
+// Supercompression schemes
+static const uint32_t SUPERCOMPRESSION_NONE = 0;
+static const uint32_t SUPERCOMPRESSION_BASIS_LZ = 1;
+static const uint32_t SUPERCOMPRESSION_ZSTD = 2;
+
+// The transcoder's tables are built once, before the first texture
+static std::once_flag basisInitialized;
+
+/**
+ * File header, followed by the level index.
+ */
+struct Ktx2Header {
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header layout");
+
+/**
+ * Entry of the level index, level 0 first.
+ */
+struct Ktx2Level {
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+bool Ktx2File::isKtx2(const void* data, size_t bytes) {
+    return bytes >= sizeof(KTX2_IDENTIFIER) && std::memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+}
+
+/**
+ * Transcodes the levels of a Basis Universal texture, ETC1S or UASTC. The transcoder reads the
+ * header, the BasisLZ global data and the Zstandard supercompression itself.
+ */
+static bool transcodeBasis(const uint8_t* data, size_t bytes, Ktx2Target target, Ktx2Texture& texture, std::string& error) {
+    std::call_once(basisInitialized, basist::basisu_transcoder_init);
+    basist::ktx2_transcoder transcoder;
+    if (bytes > UINT32_MAX || !transcoder.init(data, (uint32_t)bytes)) {
+        error = "invalid Basis Universal texture";
+        return false;
+    }
+    if (transcoder.get_faces() != 1 || transcoder.get_layers() > 1) {
+        error = "only 2D textures are supported";
+        return false;
+    }
+    if (transcoder.get_width() > 16384 || transcoder.get_height() > 16384) {
+        error = "invalid size";
+        return false;
+    }
+    if (!transcoder.start_transcoding()) {
+        error = "invalid Basis Universal global data";
+        return false;
+    }
+
+    texture = Ktx2Texture();
+    texture.compressed = target == Ktx2Target::BC7;
+    texture.width = (int)transcoder.get_width();
+    texture.height = (int)transcoder.get_height();
+    texture.levels = (int)std::max(1u, transcoder.get_levels());
+    texture.alpha = transcoder.get_has_alpha();
+    texture.blocks.codec = TextureCodec::BC7;
+    basist::transcoder_texture_format format = texture.compressed ? basist::transcoder_texture_format::cTFBC7_RGBA
+        : basist::transcoder_texture_format::cTFRGBA32;
+    for (int level = 0; level < texture.levels; ++level) {
+        basist::ktx2_image_level_info info;
+        if (!transcoder.get_image_level_info(info, level, 0, 0)) {
+            error = "invalid level " + std::to_string(level);
+            return false;
+        }
+        // BC7 levels are sized in blocks, RGBA8 ones in pixels
+        int width = std::max(1, texture.width >> level), height = std::max(1, texture.height >> level);
+        size_t size = texture.compressed ? CompressedTexture::levelBytes(TextureCodec::BC7, width, height) : (size_t)width * height * 4;
+        uint32_t capacity = texture.compressed ? info.m_total_blocks : (uint32_t)(width * height);
+        if ((int)info.m_orig_width != width || (int)info.m_orig_height != height) {
+            error = "invalid level " + std::to_string(level);
+            return false;
+        }
+        std::vector<uint8_t>& destination = texture.compressed ? texture.blocks.data : texture.pixels;
+        size_t offset = destination.size();
+        destination.resize(offset + size);
+        if (!transcoder.transcode_image_level(level, 0, 0, destination.data() + offset, capacity, format)) {
+            error = "failed to transcode level " + std::to_string(level);
+            return false;
+        }
+        if (texture.compressed) {
+            CompressedMip mip;
+            mip.width = width;
+            mip.height = height;
+            mip.offset = offset;
+            mip.size = size;
+            texture.blocks.mips.push_back(mip);
+        }
+    }
+    return true;
+}
+
+bool Ktx2File::read(const uint8_t* data, size_t bytes, Ktx2Target target, Ktx2Texture& texture, std::string& error) {
+    Ktx2Header header;
+    if (!isKtx2(data, bytes) || bytes < sizeof(header)) {
+        error = "not a KTX2 file";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.supercompressionScheme == SUPERCOMPRESSION_BASIS_LZ || header.vkFormat == VK_FORMAT_UNDEFINED) {
+        return transcodeBasis(data, bytes, target, texture, error);
+    }
+    if (header.supercompressionScheme != SUPERCOMPRESSION_NONE && header.supercompressionScheme != SUPERCOMPRESSION_ZSTD) {
+        error = "supercompression scheme " + std::to_string(header.supercompressionScheme) + " is not supported";
+        return false;
+    }
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) {
+        error = "only 2D textures are supported";
+        return false;
+    }
+    if (header.pixelWidth == 0 || header.pixelWidth > 16384 || header.pixelHeight == 0 || header.pixelHeight > 16384) {
+        error = "invalid size";
+        return false;
+    }
+
+    bool compressed = true;
+    TextureCodec codec = TextureCodec::BC7;
+    int channels = 4;
+    switch (header.vkFormat) {
+    case VK_FORMAT_BC4_UNORM_BLOCK: codec = TextureCodec::BC4; break;
+    case VK_FORMAT_BC5_UNORM_BLOCK: codec = TextureCodec::BC5; break;
+    case VK_FORMAT_BC7_UNORM_BLOCK: case VK_FORMAT_BC7_SRGB_BLOCK: codec = TextureCodec::BC7; break;
+    case VK_FORMAT_R8G8B8A8_UNORM: case VK_FORMAT_R8G8B8A8_SRGB: compressed = false; break;
+    case VK_FORMAT_R8G8B8_UNORM: case VK_FORMAT_R8G8B8_SRGB: compressed = false; channels = 3; break;
+    default:
+        error = "VkFormat " + std::to_string(header.vkFormat) + " is not supported";
+        return false;
+    }
+
+    // no level means the mipmaps are to be generated: only the first one is stored
+    uint32_t levels = std::max(1u, header.levelCount);
+    uint32_t chainLevels = 1;
+    for (uint32_t size = std::max(header.pixelWidth, header.pixelHeight); size > 1; size /= 2) {
+        ++chainLevels;
+    }
+    if (levels > chainLevels) {
+        error = "more levels than the mip chain";
+        return false;
+    }
+    if (sizeof(header) + levels * sizeof(Ktx2Level) > bytes) {
+        error = "truncated level index";
+        return false;
+    }
+    // the uncompressed formats only read the first level, their mipmaps are generated
+    if (!compressed) {
+        levels = 1;
+    }
+
+    texture = Ktx2Texture();
+    texture.compressed = compressed;
+    texture.width = (int)header.pixelWidth;
+    texture.height = (int)header.pixelHeight;
+    texture.blocks.codec = codec;
+    bool zstd = header.supercompressionScheme == SUPERCOMPRESSION_ZSTD;
+    std::vector<uint8_t> inflated;
+    size_t total = 0;
+    for (uint32_t level = 0; level < levels; ++level) {
+        Ktx2Level entry;
+        std::memcpy(&entry, data + sizeof(header) + level * sizeof(Ktx2Level), sizeof(entry));
+        int width = std::max(1, texture.width >> level), height = std::max(1, texture.height >> level);
+        size_t expected = compressed ? CompressedTexture::levelBytes(codec, width, height) : (size_t)width * height * channels;
+        uint64_t levelBytes = zstd ? entry.uncompressedByteLength : entry.byteLength;
+        if (levelBytes != expected || entry.byteOffset > bytes || entry.byteLength > bytes - entry.byteOffset) {
+            error = "invalid level " + std::to_string(level);
+            return false;
+        }
+        const uint8_t* source = data + entry.byteOffset;
+        if (zstd) {
+            // each level is a Zstandard frame of its own
+            inflated.resize(expected);
+            size_t size = ZSTD_decompress(inflated.data(), expected, source, (size_t)entry.byteLength);
+            if (ZSTD_isError(size) || size != expected) {
+                error = "invalid Zstandard data in level " + std::to_string(level);
+                return false;
+            }
+            source = inflated.data();
+        }
+
+        if (!compressed) {
+            // 3 channels are expanded, the rows are tightly packed either way
+            texture.pixels.resize((size_t)width * height * 4);
+            for (size_t i = 0; i < (size_t)width * height; ++i) {
+                std::memcpy(&texture.pixels[i * 4], source + i * channels, channels);
+                if (channels == 3) {
+                    texture.pixels[i * 4 + 3] = 255;
+                }
+            }
+            break;
+        }
+        CompressedMip mip;
+        mip.width = width;
+        mip.height = height;
+        mip.offset = total;
+        mip.size = expected;
+        texture.blocks.mips.push_back(mip);
+        texture.blocks.data.insert(texture.blocks.data.end(), source, source + expected);
+        total += expected;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "textureCompressor.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Format Basis Universal textures are transcoded to, the other formats are read as they are.
+ */
+enum class Ktx2Target : uint8_t {
+    BC7,    // Blocks of every level
+    RGBA8   // Pixels of every level, e.g. to be encoded to BC4 or BC5
+};
+
+/**
+ * Texture read from a KTX2 container: block-compressed with the levels of the file, or RGBA8
+ * pixels, of the first level for the uncompressed formats or of every level for transcoded ones.
+ */
+struct Ktx2Texture {
+    bool compressed = false;        // Levels in blocks, or pixels otherwise
+    CompressedTexture blocks;
+    std::vector<uint8_t> pixels;    // RGBA8 rows of the levels, tightly packed, the first level first
+    int width = 0, height = 0;      // Size of the first level
+    int levels = 1;                 // Levels in pixels
+    bool alpha = false;             // A transcoded texture has an alpha channel
+};
+
+namespace Ktx2File {
+
+    /**
+     * @return true if the data starts with the KTX2 identifier.
+     */
+    bool isKtx2(const void* data, size_t bytes);
+
+    /**
+     * Reads a 2D KTX2 texture of a BC4, BC5 or BC7 format (sRGB variants read as UNORM, as the
+     * other textures are) or of an R8G8B8(A8) format, Zstandard supercompressed or not. Basis
+     * Universal textures (ETC1S in BasisLZ, or UASTC, Zstandard supercompressed or not) are
+     * transcoded with the levels of the file. Thread-safe.
+     * @param data Contents of the file, e.g. an image embedded in a GLB.
+     * @param bytes Size of the contents.
+     * @param target Format Basis Universal textures are transcoded to.
+     * @param texture Receives the texture.
+     * @param error Receives why the texture cannot be read.
+     * @return true on success.
+     */
+    bool read(const uint8_t* data, size_t bytes, Ktx2Target target, Ktx2Texture& texture, std::string& error);
+}
@@ -0,0 +1,493 @@
+#include "mesh.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(SIMD_AVX2_DISPATCH)
+static bool useAvx2 = cpuSupportsAvx2();
+#else
+static bool useAvx2 = false;
+#endif
+
+void VertexTransform::setAvx2Enabled(bool enabled) {
+#if defined(SIMD_AVX2_DISPATCH)
+    useAvx2 = enabled && cpuSupportsAvx2();
+#endif
+}
+
+bool VertexTransform::avx2Enabled() {
+    return useAvx2;
+}
+
+void GeometryArena::allocate(size_t vertexCount, size_t indexCount) {
+    _vertices.resize(vertexCount);
+    _indices.resize(indexCount);
+    _usedVertices = 0;
+    _usedIndices = 0;
+}
+
+void GeometryArena::release() {
+    // swap with empty vectors, clear() would keep the memory
+    std::vector<Vertex>().swap(_vertices);
+    std::vector<GLuint>().swap(_indices);
+    std::vector<CompressedMesh>().swap(_compressed);
+    _residency = GeometryResidency::Keep;
+    _usedVertices = 0;
+    _usedIndices = 0;
+}
+
+ArrayView<Vertex> GeometryArena::takeVertices(size_t count) {
+    ArrayView<Vertex> view(_vertices.data() + _usedVertices, count);
+    _usedVertices += count;
+    return view;
+}
+
+ArrayView<GLuint> GeometryArena::takeIndices(size_t count) {
+    ArrayView<GLuint> view(_indices.data() + _usedIndices, count);
+    _usedIndices += count;
+    return view;
+}
+
+// unit vector to octahedral coordinates in [-1, 1], zero vectors map to +z
+static glm::vec2 octahedralEncode(const glm::vec3& v) {
+    float sum = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if (sum == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    glm::vec2 p = glm::vec2(v.x, v.y) / sum;
+    if (v.z < 0.0f) {
+        p = glm::vec2((1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return p;
+}
+
+static glm::vec3 octahedralDecode(const glm::vec2& p) {
+    glm::vec3 v(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+    if (v.z < 0.0f) {
+        v.x = (1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f);
+        v.y = (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return glm::normalize(v);
+}
+
+static void putUint16(std::vector<uint8_t>& data, uint16_t value) {
+    data.push_back((uint8_t)value);
+    data.push_back((uint8_t)(value >> 8));
+}
+
+static uint16_t getUint16(const uint8_t*& data) {
+    uint16_t value = (uint16_t)(data[0] | (data[1] << 8));
+    data += 2;
+    return value;
+}
+
+static uint16_t quantizeUnorm(float value, float min, float step) {
+    return (uint16_t)std::clamp(std::lround((value - min) / step), 0L, 65535L);
+}
+
+static uint16_t quantizeSnorm(float value) {
+    return (uint16_t)(int16_t)std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f);
+}
+
+static float dequantizeSnorm(uint16_t value) {
+    return (float)(int16_t)value / 32767.0f;
+}
+
+// step of a 16-bit quantization of [min, max], non-zero so flat ranges decode to min
+static float quantizationStep(float min, float max) {
+    return max > min ? (max - min) / 65535.0f : 1.0f;
+}
+
+// bytes per quantized vertex: position 3x16, normal and tangent 2x16 octahedral, uv 2x16
+static const size_t COMPRESSED_VERTEX_SIZE = 18;
+
+GeometryArena::CompressedMesh GeometryArena::compress(const Mesh& mesh) {
+    CompressedMesh compressed;
+    glm::vec3 positionMin(std::numeric_limits<float>::max()), positionMax(std::numeric_limits<float>::lowest());
+    glm::vec2 uvMin(std::numeric_limits<float>::max()), uvMax(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : mesh.vertices) {
+        positionMin = glm::min(positionMin, vertex.position);
+        positionMax = glm::max(positionMax, vertex.position);
+        uvMin = glm::min(uvMin, vertex.uv);
+        uvMax = glm::max(uvMax, vertex.uv);
+        compressed.hasNormals |= vertex.normal != glm::vec3(0.0f);
+        compressed.hasTangents |= vertex.tangent != glm::vec3(0.0f);
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        compressed.positionStep[axis] = quantizationStep(positionMin[axis], positionMax[axis]);
+    }
+    for (int axis = 0; axis < 2; ++axis) {
+        compressed.uvStep[axis] = quantizationStep(uvMin[axis], uvMax[axis]);
+    }
+    compressed.positionMin = positionMin;
+    compressed.uvMin = uvMin;
+
+    // indices of a triangle list are mostly close to the previous one: zigzag deltas as varints
+    compressed.data.reserve(mesh.vertices.size() * COMPRESSED_VERTEX_SIZE + mesh.indices.size() * 2);
+    for (const Vertex& vertex : mesh.vertices) {
+        for (int axis = 0; axis < 3; ++axis) {
+            putUint16(compressed.data, quantizeUnorm(vertex.position[axis], positionMin[axis], compressed.positionStep[axis]));
+        }
+        glm::vec2 normal = octahedralEncode(vertex.normal);
+        glm::vec2 tangent = octahedralEncode(vertex.tangent);
+        putUint16(compressed.data, quantizeSnorm(normal.x));
+        putUint16(compressed.data, quantizeSnorm(normal.y));
+        putUint16(compressed.data, quantizeSnorm(tangent.x));
+        putUint16(compressed.data, quantizeSnorm(tangent.y));
+        for (int axis = 0; axis < 2; ++axis) {
+            putUint16(compressed.data, quantizeUnorm(vertex.uv[axis], uvMin[axis], compressed.uvStep[axis]));
+        }
+    }
+    int64_t previous = 0;
+    for (GLuint index : mesh.indices) {
+        int64_t delta = (int64_t)index - previous;
+        uint64_t zigzag = delta < 0 ? ((uint64_t)(-delta) << 1) - 1 : (uint64_t)delta << 1;
+        do {
+            uint8_t byte = zigzag & 0x7f;
+            zigzag >>= 7;
+            compressed.data.push_back(zigzag ? (uint8_t)(byte | 0x80) : byte);
+        } while (zigzag);
+        previous = index;
+    }
+    compressed.data.shrink_to_fit();
+    return compressed;
+}
+
+void GeometryArena::decompress(const CompressedMesh& compressed, Mesh& mesh) {
+    const uint8_t* data = compressed.data.data();
+    for (Vertex& vertex : mesh.vertices) {
+        for (int axis = 0; axis < 3; ++axis) {
+            vertex.position[axis] = compressed.positionMin[axis] + getUint16(data) * compressed.positionStep[axis];
+        }
+        float nx = dequantizeSnorm(getUint16(data));
+        float ny = dequantizeSnorm(getUint16(data));
+        float tx = dequantizeSnorm(getUint16(data));
+        float ty = dequantizeSnorm(getUint16(data));
+        vertex.normal = compressed.hasNormals ? octahedralDecode(glm::vec2(nx, ny)) : glm::vec3(0.0f);
+        vertex.tangent = compressed.hasTangents ? octahedralDecode(glm::vec2(tx, ty)) : glm::vec3(0.0f);
+        for (int axis = 0; axis < 2; ++axis) {
+            vertex.uv[axis] = compressed.uvMin[axis] + getUint16(data) * compressed.uvStep[axis];
+        }
+    }
+    int64_t previous = 0;
+    for (GLuint& index : mesh.indices) {
+        uint64_t zigzag = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            byte = *data++;
+            zigzag |= (uint64_t)(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        int64_t delta = (zigzag & 1) ? -(int64_t)((zigzag + 1) >> 1) : (int64_t)(zigzag >> 1);
+        previous += delta;
+        index = (GLuint)previous;
+    }
+}
+
+void GeometryArena::setResidency(GeometryResidency residency, std::vector<Mesh>& meshes) {
+    if (residency == _residency) {
+        return;
+    }
+    if (_residency != GeometryResidency::Keep && !restore(meshes)) {
+        std::cerr << "Geometry was dropped, cannot change its residency" << std::endl;
+        return;
+    }
+
+    if (residency == GeometryResidency::Compress) {
+        _compressed.clear();
+        _compressed.reserve(meshes.size());
+        for (const Mesh& mesh : meshes) {
+            _compressed.push_back(compress(mesh));
+        }
+    }
+    if (residency != GeometryResidency::Keep) {
+        std::vector<Vertex>().swap(_vertices);
+        std::vector<GLuint>().swap(_indices);
+        for (Mesh& mesh : meshes) {
+            mesh.vertices = ArrayView<Vertex>();
+            mesh.indices = ArrayView<GLuint>();
+        }
+    }
+    _residency = residency;
+}
+
+bool GeometryArena::restore(std::vector<Mesh>& meshes) {
+    if (_residency == GeometryResidency::Drop) {
+        return false;
+    }
+    if (_residency == GeometryResidency::Keep) {
+        return true;
+    }
+
+    size_t vertexCount = 0, indexCount = 0;
+    for (const Mesh& mesh : meshes) {
+        vertexCount += mesh.vertexCount;
+        indexCount += mesh.indexCount;
+    }
+    allocate(vertexCount, indexCount);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        meshes[i].vertices = takeVertices(meshes[i].vertexCount);
+        meshes[i].indices = takeIndices(meshes[i].indexCount);
+        decompress(_compressed[i], meshes[i]);
+    }
+    std::vector<CompressedMesh>().swap(_compressed);
+    _residency = GeometryResidency::Keep;
+    return true;
+}
+
+size_t GeometryArena::getMeshBytes(size_t meshIndex, const Mesh& mesh) const {
+    switch (_residency) {
+        case GeometryResidency::Keep:
+            return mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * sizeof(GLuint);
+        case GeometryResidency::Compress:
+            return meshIndex < _compressed.size() ? _compressed[meshIndex].data.size() : 0;
+        default:
+            return 0;
+    }
+}
+
+size_t GeometryArena::getBytes() const {
+    size_t bytes = _vertices.size() * sizeof(Vertex) + _indices.size() * sizeof(GLuint);
+    for (const CompressedMesh& compressed : _compressed) {
+        bytes += compressed.data.size();
+    }
+    return bytes;
+}
+
+/**
+ * Rows of the matrices applied to the attributes, as scalars for the kernels.
+ */
+struct VertexMatrices {
+    float position[3][4];   // Upper 3x4 of the transform, translation in the last column
+    float normal[3][3];     // Inverse transpose of the upper 3x3
+    float tangent[3][3];    // Upper 3x3
+};
+
+static VertexMatrices vertexMatrices(const glm::mat4& transform) {
+    VertexMatrices matrices;
+    float a[3][3];
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 4; ++column) {
+            matrices.position[row][column] = transform[column][row];
+        }
+        for (int column = 0; column < 3; ++column) {
+            a[row][column] = matrices.tangent[row][column] = transform[column][row];
+        }
+    }
+
+    // inverse transpose = cofactors / determinant, the sign keeps normals outward on mirrored nodes
+    float cofactor[3][3];
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            int r0 = (row + 1) % 3, r1 = (row + 2) % 3, c0 = (column + 1) % 3, c1 = (column + 2) % 3;
+            cofactor[row][column] = a[r0][c0] * a[r1][c1] - a[r0][c1] * a[r1][c0];
+        }
+    }
+    float determinant = a[0][0] * cofactor[0][0] + a[0][1] * cofactor[0][1] + a[0][2] * cofactor[0][2];
+    float scale = std::abs(determinant) > 1e-30f ? 1.0f / determinant : 0.0f;
+    for (int row = 0; row < 3; ++row) {
+        for (int column = 0; column < 3; ++column) {
+            matrices.normal[row][column] = cofactor[row][column] * scale;
+        }
+    }
+    return matrices;
+}
+
+// Scalar kernel, for the last vertices and CPUs without SSE
+// ----------------------------------------------------------
+
+static void transformScalar(const float* positions, const float* normals, const float* tangents, const float* uvs, size_t begin, size_t end,
+    const VertexMatrices& m, Vertex* vertices, float boundsMin[3], float boundsMax[3]) {
+    for (size_t i = begin; i < end; ++i) {
+        const float* p = positions + i * 3;
+        Vertex& vertex = vertices[i];
+        for (int row = 0; row < 3; ++row) {
+            float value = m.position[row][0] * p[0] + m.position[row][1] * p[1] + m.position[row][2] * p[2] + m.position[row][3];
+            vertex.position[row] = value;
+            boundsMin[row] = std::min(boundsMin[row], value);
+            boundsMax[row] = std::max(boundsMax[row], value);
+        }
+        for (int row = 0; row < 3; ++row) {
+            vertex.normal[row] = normals ? m.normal[row][0] * normals[i * 3] + m.normal[row][1] * normals[i * 3 + 1] + m.normal[row][2] * normals[i * 3 + 2] : 0.0f;
+            vertex.tangent[row] = tangents ? m.tangent[row][0] * tangents[i * 3] + m.tangent[row][1] * tangents[i * 3 + 1] + m.tangent[row][2] * tangents[i * 3 + 2] : 0.0f;
+        }
+        vertex.uv = uvs ? glm::vec2(uvs[i * 3], uvs[i * 3 + 1]) : glm::vec2(0.0f);
+    }
+}
+
+#if defined(SIMD_SSE2)
+// SSE kernel, 4 vertices per iteration
+// ------------------------------------
+
+/**
+ * Loads 4 xyz triples as one register per component, zeros for a null stream.
+ */
+static inline void load4(const float* stream, size_t i, __m128& x, __m128& y, __m128& z) {
+    if (!stream) {
+        x = y = z = _mm_setzero_ps();
+        return;
+    }
+    // a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3
+    __m128 a = _mm_loadu_ps(stream + i * 3);
+    __m128 b = _mm_loadu_ps(stream + i * 3 + 4);
+    __m128 c = _mm_loadu_ps(stream + i * 3 + 8);
+    __m128 x23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    x = _mm_shuffle_ps(a, x23, _MM_SHUFFLE(2, 0, 3, 0));
+    __m128 y01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+    __m128 y23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+    y = _mm_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0));
+    __m128 z01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+    __m128 z23 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+    z = _mm_shuffle_ps(z01, z23, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static inline __m128 dot4(const float row[3], __m128 x, __m128 y, __m128 z) {
+    __m128 sum = _mm_mul_ps(_mm_set1_ps(row[0]), x);
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[1]), y));
+    return _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(row[2]), z));
+}
+
+static void transformSse(const float* positions, const float* normals, const float* tangents, const float* uvs, size_t count,
+    const VertexMatrices& m, Vertex* vertices, float boundsMin[3], float boundsMax[3]) {
+    __m128 minimum[3], maximum[3];
+    for (int c = 0; c < 3; ++c) {
+        minimum[c] = _mm_set1_ps(boundsMin[c]);
+        maximum[c] = _mm_set1_ps(boundsMax[c]);
+    }
+
+    size_t end = count / 4 * 4;
+    alignas(16) float out[9][4];
+    for (size_t i = 0; i < end; i += 4) {
+        __m128 x, y, z, nx, ny, nz, tx, ty, tz;
+        load4(positions, i, x, y, z);
+        load4(normals, i, nx, ny, nz);
+        load4(tangents, i, tx, ty, tz);
+        for (int c = 0; c < 3; ++c) {
+            __m128 position = _mm_add_ps(dot4(m.position[c], x, y, z), _mm_set1_ps(m.position[c][3]));
+            minimum[c] = _mm_min_ps(minimum[c], position);
+            maximum[c] = _mm_max_ps(maximum[c], position);
+            _mm_store_ps(out[c], position);
+            _mm_store_ps(out[3 + c], dot4(m.normal[c], nx, ny, nz));
+            _mm_store_ps(out[6 + c], dot4(m.tangent[c], tx, ty, tz));
+        }
+        for (int k = 0; k < 4; ++k) {
+            Vertex& vertex = vertices[i + k];
+            vertex.position = glm::vec3(out[0][k], out[1][k], out[2][k]);
+            vertex.normal = glm::vec3(out[3][k], out[4][k], out[5][k]);
+            vertex.tangent = glm::vec3(out[6][k], out[7][k], out[8][k]);
+            vertex.uv = uvs ? glm::vec2(uvs[(i + k) * 3], uvs[(i + k) * 3 + 1]) : glm::vec2(0.0f);
+        }
+    }
+
+    alignas(16) float lanes[4];
+    for (int c = 0; c < 3; ++c) {
+        _mm_store_ps(lanes, minimum[c]);
+        boundsMin[c] = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+        _mm_store_ps(lanes, maximum[c]);
+        boundsMax[c] = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+    }
+    transformScalar(positions, normals, tangents, uvs, end, count, m, vertices, boundsMin, boundsMax);
+}
+#endif
+
+#if defined(SIMD_AVX2_DISPATCH)
+// AVX2 kernel, 8 vertices per iteration
+// -------------------------------------
+
+/**
+ * Loads 8 xyz triples as one register per component, zeros for a null stream.
+ */
+SIMD_TARGET_AVX2 static inline void load8(const float* stream, size_t i, __m256& x, __m256& y, __m256& z) {
+    if (!stream) {
+        x = y = z = _mm256_setzero_ps();
+        return;
+    }
+    // triples 0-3 in the low lanes, 4-7 in the high lanes, then the same shuffles as load4
+    const float* p = stream + i * 3;
+    __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+    __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+    __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+    __m256 x23 = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+    x = _mm256_shuffle_ps(a, x23, _MM_SHUFFLE(2, 0, 3, 0));
+    __m256 y01 = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+    __m256 y23 = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+    y = _mm256_shuffle_ps(y01, y23, _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 z01 = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+    __m256 z23 = _mm256_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0));
+    z = _mm256_shuffle_ps(z01, z23, _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+SIMD_TARGET_AVX2 static inline __m256 dot8(const float row[3], __m256 x, __m256 y, __m256 z) {
+    __m256 sum = _mm256_mul_ps(_mm256_set1_ps(row[0]), x);
+    sum = _mm256_fmadd_ps(_mm256_set1_ps(row[1]), y, sum);
+    return _mm256_fmadd_ps(_mm256_set1_ps(row[2]), z, sum);
+}
+
+SIMD_TARGET_AVX2 static void transformAvx2(const float* positions, const float* normals, const float* tangents, const float* uvs, size_t count,
+    const VertexMatrices& m, Vertex* vertices, float boundsMin[3], float boundsMax[3]) {
+    __m256 minimum[3], maximum[3];
+    for (int c = 0; c < 3; ++c) {
+        minimum[c] = _mm256_set1_ps(boundsMin[c]);
+        maximum[c] = _mm256_set1_ps(boundsMax[c]);
+    }
+
+    size_t end = count / 8 * 8;
+    alignas(32) float out[9][8];
+    for (size_t i = 0; i < end; i += 8) {
+        __m256 x, y, z, nx, ny, nz, tx, ty, tz;
+        load8(positions, i, x, y, z);
+        load8(normals, i, nx, ny, nz);
+        load8(tangents, i, tx, ty, tz);
+        for (int c = 0; c < 3; ++c) {
+            __m256 position = _mm256_add_ps(dot8(m.position[c], x, y, z), _mm256_set1_ps(m.position[c][3]));
+            minimum[c] = _mm256_min_ps(minimum[c], position);
+            maximum[c] = _mm256_max_ps(maximum[c], position);
+            _mm256_store_ps(out[c], position);
+            _mm256_store_ps(out[3 + c], dot8(m.normal[c], nx, ny, nz));
+            _mm256_store_ps(out[6 + c], dot8(m.tangent[c], tx, ty, tz));
+        }
+        for (int k = 0; k < 8; ++k) {
+            Vertex& vertex = vertices[i + k];
+            vertex.position = glm::vec3(out[0][k], out[1][k], out[2][k]);
+            vertex.normal = glm::vec3(out[3][k], out[4][k], out[5][k]);
+            vertex.tangent = glm::vec3(out[6][k], out[7][k], out[8][k]);
+            vertex.uv = uvs ? glm::vec2(uvs[(i + k) * 3], uvs[(i + k) * 3 + 1]) : glm::vec2(0.0f);
+        }
+    }
+
+    // reduce the 8 lanes of the bounds
+    for (int c = 0; c < 3; ++c) {
+        __m128 low = _mm_min_ps(_mm256_castps256_ps128(minimum[c]), _mm256_extractf128_ps(minimum[c], 1));
+        low = _mm_min_ps(low, _mm_movehl_ps(low, low));
+        boundsMin[c] = _mm_cvtss_f32(_mm_min_ss(low, _mm_shuffle_ps(low, low, 1)));
+        __m128 high = _mm_max_ps(_mm256_castps256_ps128(maximum[c]), _mm256_extractf128_ps(maximum[c], 1));
+        high = _mm_max_ps(high, _mm_movehl_ps(high, high));
+        boundsMax[c] = _mm_cvtss_f32(_mm_max_ss(high, _mm_shuffle_ps(high, high, 1)));
+    }
+    transformScalar(positions, normals, tangents, uvs, end, count, m, vertices, boundsMin, boundsMax);
+}
+#endif
+
+void VertexTransform::transform(const float* positions, const float* normals, const float* tangents, const float* uvs, size_t count,
+    const glm::mat4& transform, Vertex* vertices, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    VertexMatrices matrices = vertexMatrices(transform);
+    float minimum[3] = { boundsMin.x, boundsMin.y, boundsMin.z };
+    float maximum[3] = { boundsMax.x, boundsMax.y, boundsMax.z };
+#if defined(SIMD_AVX2_DISPATCH)
+    if (useAvx2) {
+        transformAvx2(positions, normals, tangents, uvs, count, matrices, vertices, minimum, maximum);
+    }
+    else
+#endif
+    {
+#if defined(SIMD_SSE2)
+        transformSse(positions, normals, tangents, uvs, count, matrices, vertices, minimum, maximum);
+#else
+        transformScalar(positions, normals, tangents, uvs, 0, count, matrices, vertices, minimum, maximum);
+#endif
+    }
+    boundsMin = glm::vec3(minimum[0], minimum[1], minimum[2]);
+    boundsMax = glm::vec3(maximum[0], maximum[1], maximum[2]);
+}
@@ -1,10 +1,13 @@
 #pragma once
+#include "gpuResourceManager.h"
+#include <cstdint>
 #include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
+#include <limits>
 
 /**
  * Vertex structure representing a single vertex's attributes for rendering.
@@ -30,29 +33,192 @@ enum class TextureType {
  */
 struct Material {
     std::string name;            // Name of the material
-    GLuint diffuse = 0;              // Texture ID for the diffuse map
-    GLuint metalnessRoughness = 0;   // Texture ID for the metalness-roughness map
-    GLuint normal = 0;               // Texture ID for the normal map
+    TextureHandle diffuse;             // Diffuse map, may be shared with other materials
+    TextureHandle metalnessRoughness;  // Metalness-roughness map, may be shared with other materials
+    TextureHandle normal;              // Normal map, may be shared with other materials
 
     glm::vec4 diffuseColor = glm::vec4(2);
     float metalnessFactor = 2;
     float roughnessFactor = 2;
 };
 
+/**
+ * Non-owning view of a contiguous array, for the meshes to refer to the geometry of their scene.
+ */
+template<typename T>
+class ArrayView {
+public:
+    ArrayView() {}
+    ArrayView(T* data, size_t size) : _data(data), _size(size) {}
+
+    T* data() const { return _data; }
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    T* begin() const { return _data; }
+    T* end() const { return _data + _size; }
+    T& operator[](size_t i) const { return _data[i]; }
+
+private:
+    T* _data = nullptr;
+    size_t _size = 0;
+};
+
+class Mesh;
+
+/**
+ * What happens to the CPU copy of the geometry once the meshes are uploaded.
+ */
+enum class GeometryResidency {
+    Keep,       // Vertices and indices stay in RAM
+    Compress,   // Quantized vertices and delta-coded indices stay in RAM, restored on demand
+    Drop        // Freed, the meshes keep their counts and bounds only
+};
+
+/**
+ * CPU geometry of a scene: the vertices and indices of all its meshes in two arrays, sized once
+ * from the counts of the imported scene and released at once.
+ */
+class GeometryArena {
+public:
+    /**
+     * Allocates the arrays, any previous geometry must have been released.
+     * @param vertexCount Vertices of all the meshes.
+     * @param indexCount Indices of all the meshes.
+     */
+    void allocate(size_t vertexCount, size_t indexCount);
+
+    /**
+     * Frees the arrays, the views taken from them become invalid.
+     */
+    void release();
+
+    /**
+     * Takes the next vertices of the arena for a mesh.
+     */
+    ArrayView<Vertex> takeVertices(size_t count);
+
+    /**
+     * Takes the next indices of the arena for a mesh.
+     */
+    ArrayView<GLuint> takeIndices(size_t count);
+
+    /**
+     * Applies a residency policy to the geometry, once the meshes are uploaded. Compressed or
+     * dropped meshes have empty vertex and index views.
+     * @param residency The policy.
+     * @param meshes The meshes whose geometry the arena holds, in the order it was taken.
+     */
+    void setResidency(GeometryResidency residency, std::vector<Mesh>& meshes);
+
+    /**
+     * @return The residency of the geometry.
+     */
+    GeometryResidency getResidency() const { return _residency; }
+
+    /**
+     * Decompresses the geometry back into the arena and points the meshes at it again. Positions,
+     * normals, tangents and texture coordinates come back quantized to 16 bits.
+     * @param meshes The meshes given to setResidency().
+     * @return false if the geometry was dropped.
+     */
+    bool restore(std::vector<Mesh>& meshes);
+
+    /**
+     * @return The bytes held in RAM for a mesh, compressed or not.
+     * @param meshIndex Index of the mesh in the order its geometry was taken.
+     * @param mesh The mesh.
+     */
+    size_t getMeshBytes(size_t meshIndex, const Mesh& mesh) const;
+
+    /**
+     * @return The bytes held by the arena.
+     */
+    size_t getBytes() const;
+
+private:
+    /**
+     * Geometry of a mesh in the compressed residency.
+     */
+    struct CompressedMesh {
+        glm::vec3 positionMin, positionStep;   // position = min + quantized * step
+        glm::vec2 uvMin, uvStep;               // uv = min + quantized * step
+        bool hasNormals = false;               // false when the mesh had no normals, restored as zeros
+        bool hasTangents = false;              // false when the mesh had no tangents, restored as zeros
+        std::vector<uint8_t> data;             // Quantized vertices, then the varint index deltas
+    };
+
+    std::vector<Vertex> _vertices;
+    std::vector<GLuint> _indices;
+    size_t _usedVertices = 0;
+    size_t _usedIndices = 0;
+    GeometryResidency _residency = GeometryResidency::Keep;
+    std::vector<CompressedMesh> _compressed;
+
+    /**
+     * Quantizes the vertices and delta-codes the indices of a mesh.
+     */
+    static CompressedMesh compress(const Mesh& mesh);
+
+    /**
+     * Decodes a compressed mesh into its vertex and index views.
+     */
+    static void decompress(const CompressedMesh& compressed, Mesh& mesh);
+};
+
 /**
  * Mesh class representing a 3D model with vertices, indices, and material.
  */
 class Mesh {
 public:
     std::string name;                 // Name of the mesh
-    std::vector<Vertex> vertices;     // List of vertices in the mesh
-    std::vector<GLuint> indices;      // List of indices for indexed rendering
-    GLuint diffuseTextureId;          // Texture ID for the diffuse map
+    ArrayView<Vertex> vertices;       // Vertices of the mesh, stored by the scene's geometry arena, empty when not resident
+    ArrayView<GLuint> indices;        // Indices for indexed rendering, stored by the scene's geometry arena, empty when not resident
+    size_t vertexCount = 0;           // Number of vertices, resident or not
+    size_t indexCount = 0;            // Number of indices, resident or not
 
     GLuint vao;                       // Vertex Array Object ID
-    GLuint vbo;                       // Vertex Buffer Object ID
-    GLuint ebo;                       // Element Buffer Object ID
+    BufferHandle vbo;                 // Vertex Buffer Object
+    BufferHandle ebo;                 // Element Buffer Object
+    bool uploaded = false;            // The buffers are filled, the mesh can be drawn
 
-    Material material;                // Material associated with the mesh
+    const Material* material = nullptr; // Material of the mesh, owned by the scene
     glm::mat4 transform = glm::mat4(1.0f); // Transformation matrix for the mesh
+
+    // Bounding box of the vertices, empty (min > max) when unknown: the mesh is then never culled
+    glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    float uvDensity = 0.0f;           // Texture coordinate units per world unit, 0 when unknown
+};
+
+/**
+ * CPU kernel of the model import: builds the vertices of a mesh from the attribute streams of the
+ * importer, positions and tangents transformed by the node matrix and normals by its inverse
+ * transpose, and grows the bounding box of the positions. 8 vertices per iteration with AVX2 and
+ * FMA when the CPU supports them, 4 with SSE otherwise.
+ */
+class VertexTransform {
+public:
+    /**
+     * @param positions Positions, count xyz triples (aiVector3D array).
+     * @param normals Normals as xyz triples, null for zero normals.
+     * @param tangents Tangents as xyz triples, null for zero tangents.
+     * @param uvs Texture coordinates as xyz triples (z unused), null for zero coordinates.
+     * @param count Number of vertices.
+     * @param transform Node to world matrix.
+     * @param vertices Destination of count vertices.
+     * @param boundsMin Grown to the minimum of the transformed positions.
+     * @param boundsMax Grown to the maximum of the transformed positions.
+     */
+    static void transform(const float* positions, const float* normals, const float* tangents, const float* uvs, size_t count,
+        const glm::mat4& transform, Vertex* vertices, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+    /**
+     * Enables or disables the AVX2 kernel, it is used by default when supported.
+     */
+    static void setAvx2Enabled(bool enabled);
+
+    /**
+     * @return true if the AVX2 kernel is in use.
+     */
+    static bool avx2Enabled();
 };
@@ -0,0 +1,307 @@
+#include "metricsExporter.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+static void closeSocket(SocketHandle socket) { closesocket(socket); }
+static const int SEND_FLAGS = 0;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+static const SocketHandle INVALID_SOCKET = -1;
+static void closeSocket(SocketHandle socket) { close(socket); }
+// a scraper closing early must fail the send, not raise SIGPIPE (SO_NOSIGPIPE on macOS)
+#if defined(MSG_NOSIGNAL)
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+#endif
+
+// Bucket bounds in seconds: frames around the usual refresh intervals, loads from instant to slow
+static const std::vector<double> FRAME_BUCKETS = { 0.002, 0.004, 0.008, 0.0167, 0.0333, 0.05, 0.1, 0.25, 0.5, 1.0 };
+static const std::vector<double> LOAD_BUCKETS = { 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0, 60.0 };
+// Time the serving thread waits for a connection before checking whether it must stop
+static const int ACCEPT_TIMEOUT_MS = 200;
+// Time a client may take to send its request or read the response, so that a silent one cannot hold the thread
+static const int CLIENT_TIMEOUT_MS = 1000;
+
+void MetricsHistogram::observe(double seconds) {
+    size_t bucket = 0;
+    while (bucket < bounds.size() && seconds > bounds[bucket]) {
+        ++bucket;
+    }
+    ++counts[bucket];
+    sum += seconds;
+    ++count;
+}
+
+/**
+ * @return The resident set size of the process in bytes, 0 if unknown.
+ */
+static size_t residentMemoryBytes() {
+#if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, residentPages = 0;
+    if (statm >> pages >> residentPages) {
+        return residentPages * (size_t)sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return 0;
+}
+
+/**
+ * Writes a histogram with its HELP and TYPE lines, buckets are cumulative.
+ */
+static void writeHistogram(std::ostream& stream, const char* name, const char* help, const MetricsHistogram& histogram) {
+    stream << "# HELP " << name << " " << help << "\n";
+    stream << "# TYPE " << name << " histogram\n";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < histogram.bounds.size(); ++i) {
+        cumulative += histogram.counts[i];
+        stream << name << "_bucket{le=\"" << histogram.bounds[i] << "\"} " << cumulative << "\n";
+    }
+    stream << name << "_bucket{le=\"+Inf\"} " << histogram.count << "\n";
+    stream << name << "_sum " << histogram.sum << "\n";
+    stream << name << "_count " << histogram.count << "\n";
+}
+
+/**
+ * Writes a single-sample metric with its HELP and TYPE lines.
+ */
+static void writeMetric(std::ostream& stream, const char* name, const char* type, const char* help, double value) {
+    stream << "# HELP " << name << " " << help << "\n";
+    stream << "# TYPE " << name << " " << type << "\n";
+    stream << name << " " << value << "\n";
+}
+
+MetricsExporter::MetricsExporter()
+    : _frameSeconds(FRAME_BUCKETS), _gpuFrameSeconds(FRAME_BUCKETS), _modelLoadSeconds(LOAD_BUCKETS), _environmentLoadSeconds(LOAD_BUCKETS) {
+}
+
+MetricsExporter::~MetricsExporter() {
+    _serving = false;
+    if (_server.joinable()) {
+        _server.join();
+    }
+    if (_listenSocket != -1) {
+        closeSocket((SocketHandle)_listenSocket);
+#if defined(_WIN32)
+        WSACleanup();
+#endif
+    }
+}
+
+bool MetricsExporter::init(const std::string& filepath, const std::string& address, int port, int intervalMs) {
+    _filepath = filepath;
+    bool listening = port > 0 && listen(address, port);
+    if (filepath.empty() && !listening) {
+        return false;
+    }
+    if (listening) {
+        _serving = true;
+        _server = std::thread(&MetricsExporter::serve, this);
+        std::cout << "Metrics served on http://" << address << ":" << port << "/metrics" << std::endl;
+    }
+    _interval = std::chrono::milliseconds(std::max(intervalMs, 100));
+    _nextPublish = std::chrono::steady_clock::now();
+    _enabled = true;
+    return true;
+}
+
+void MetricsExporter::observeFrame(double seconds) {
+    if (_enabled) {
+        _frameSeconds.observe(seconds);
+    }
+}
+
+void MetricsExporter::observeProfile(const ProfileFrame& frame) {
+    if (!_enabled || frame.index == _lastProfiledFrame) {
+        return;
+    }
+    _lastProfiledFrame = frame.index;
+    for (const ProfileSample& sample : frame.samples) {
+        if (sample.depth == 0 && sample.thread == 0 && sample.gpuStart >= 0.0 && std::strcmp(sample.name, "frame") == 0) {
+            _gpuFrameSeconds.observe((sample.gpuEnd - sample.gpuStart) / 1000.0);
+        }
+    }
+}
+
+void MetricsExporter::observeModelLoad(double seconds, bool success) {
+    if (!_enabled) {
+        return;
+    }
+    if (success) {
+        _modelLoadSeconds.observe(seconds);
+    }
+    else {
+        ++_modelLoadFailures;
+    }
+}
+
+void MetricsExporter::observeEnvironmentLoad(double seconds) {
+    if (_enabled) {
+        _environmentLoadSeconds.observe(seconds);
+    }
+}
+
+void MetricsExporter::update(const Renderer& renderer) {
+    if (!_enabled || std::chrono::steady_clock::now() < _nextPublish) {
+        return;
+    }
+    _nextPublish = std::chrono::steady_clock::now() + _interval;
+    std::string text = format(renderer);
+
+    // complete files only: write aside, then replace
+    if (!_filepath.empty()) {
+        std::string temporary = _filepath + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary);
+            file << text;
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, _filepath, error);
+        if (error) {
+            std::cerr << "Failed to write " << _filepath << ": " << error.message() << std::endl;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(_publishedMutex);
+    _published = std::move(text);
+}
+
+std::string MetricsExporter::format(const Renderer& renderer) const {
+    std::ostringstream stream;
+    writeHistogram(stream, "viewer_frame_seconds", "Wall time to render and present a frame.", _frameSeconds);
+    if (_gpuFrameSeconds.count > 0) {
+        writeHistogram(stream, "viewer_gpu_frame_seconds", "GPU time of a frame, measured by the profiler.", _gpuFrameSeconds);
+    }
+    writeHistogram(stream, "viewer_model_load_seconds", "Duration of the model loads, import and uploads.", _modelLoadSeconds);
+    writeMetric(stream, "viewer_model_load_failures_total", "counter", "Model loads that failed.", (double)_modelLoadFailures);
+    writeHistogram(stream, "viewer_environment_load_seconds", "Duration of the environment loads, from the request to the end of the bake.", _environmentLoadSeconds);
+    writeMetric(stream, "viewer_environment_cache_hits_total", "counter", "Environment selections served by the baked environment cache.", (double)renderer.getEnvironmentCacheHits());
+    writeMetric(stream, "viewer_environment_cache_misses_total", "counter", "Environment selections that were decoded and baked.", (double)renderer.getEnvironmentCacheMisses());
+
+    size_t resident = residentMemoryBytes();
+    if (resident > 0) {
+        writeMetric(stream, "viewer_resident_memory_bytes", "gauge", "Resident set size of the process.", (double)resident);
+    }
+    const RenderStats& stats = renderer.getStats();
+    stream << "# HELP viewer_vram_bytes Estimated VRAM held by the renderer.\n";
+    stream << "# TYPE viewer_vram_bytes gauge\n";
+    stream << "viewer_vram_bytes{kind=\"meshes\"} " << stats.meshBytes << "\n";
+    stream << "viewer_vram_bytes{kind=\"textures\"} " << stats.textureBytes << "\n";
+    stream << "viewer_vram_bytes{kind=\"environments\"} " << stats.environmentBytes << "\n";
+    writeMetric(stream, "viewer_draw_calls", "gauge", "Draw calls of the last frame.", stats.drawCalls);
+    writeMetric(stream, "viewer_triangles", "gauge", "Triangles submitted by the last frame.", (double)stats.triangles);
+    writeMetric(stream, "viewer_meshes_culled", "gauge", "Meshes culled by the last frame.", stats.meshesCulled);
+    return stream.str();
+}
+
+/**
+ * Bounds the blocking reads and writes on a client, and keeps a closed client from raising SIGPIPE.
+ */
+static void configureClient(SocketHandle client) {
+#if defined(_WIN32)
+    DWORD timeout = CLIENT_TIMEOUT_MS;
+#else
+    timeval timeout = { CLIENT_TIMEOUT_MS / 1000, (CLIENT_TIMEOUT_MS % 1000) * 1000 };
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+#if defined(SO_NOSIGPIPE)
+    int noSignal = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&noSignal, sizeof(noSignal));
+#endif
+}
+
+bool MetricsExporter::listen(const std::string& address, int port) {
+#if defined(_WIN32)
+    WSADATA data;
+    if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+        std::cerr << "Failed to initialize Winsock" << std::endl;
+        return false;
+    }
+#endif
+    SocketHandle listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET) {
+        std::cerr << "Failed to create the metrics socket" << std::endl;
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    sockaddr_in socketAddress = {};
+    socketAddress.sin_family = AF_INET;
+    socketAddress.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1
+        || bind(listenSocket, (const sockaddr*)&socketAddress, sizeof(socketAddress)) != 0
+        || ::listen(listenSocket, 8) != 0) {
+        std::cerr << "Failed to listen on " << address << ":" << port << " for metrics" << std::endl;
+        closeSocket(listenSocket);
+        return false;
+    }
+    _listenSocket = (intptr_t)listenSocket;
+    return true;
+}
+
+void MetricsExporter::serve() {
+    SocketHandle listenSocket = (SocketHandle)_listenSocket;
+    while (_serving) {
+        // wait for a connection, waking up regularly to notice the destruction
+        fd_set sockets;
+        FD_ZERO(&sockets);
+        FD_SET(listenSocket, &sockets);
+        timeval timeout = { 0, ACCEPT_TIMEOUT_MS * 1000 };
+        if (select((int)listenSocket + 1, &sockets, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+        SocketHandle client = accept(listenSocket, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        configureClient(client);
+
+        // the request line is all that matters, it comes in the first packet
+        char request[1024];
+        int received = recv(client, request, sizeof(request) - 1, 0);
+        if (received <= 0) {
+            // closed or silent until the timeout
+            closeSocket(client);
+            continue;
+        }
+        request[received] = '\0';
+
+        std::string body;
+        const char* status = "404 Not Found";
+        if (std::strncmp(request, "GET /metrics ", 13) == 0 || std::strncmp(request, "GET /metrics?", 13) == 0) {
+            status = "200 OK";
+            std::lock_guard<std::mutex> lock(_publishedMutex);
+            body = _published;
+        }
+        std::string response = std::string("HTTP/1.1 ") + status + "\r\n"
+            + "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            + "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            + "Connection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size() && _serving) {
+            int count = send(client, response.data() + sent, (int)(response.size() - sent), SEND_FLAGS);
+            if (count <= 0) {
+                break;
+            }
+            sent += count;
+        }
+        closeSocket(client);
+    }
+}
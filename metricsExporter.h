@@ -0,0 +1,130 @@
+#pragma once
+#include "profiler.h"
+#include "renderer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Distribution of observed durations, written as a Prometheus histogram.
+ */
+struct MetricsHistogram {
+    std::vector<double> bounds;    // Upper bounds of the buckets in seconds, ascending
+    std::vector<uint64_t> counts;  // Observations per bucket, one more than bounds for +Inf
+    double sum = 0.0;              // Sum of the observations in seconds
+    uint64_t count = 0;            // Number of observations
+
+    MetricsHistogram() {}
+
+    /**
+     * @param bounds Upper bounds of the buckets in seconds, ascending.
+     */
+    explicit MetricsHistogram(std::vector<double> bounds) : bounds(std::move(bounds)), counts(this->bounds.size() + 1, 0) {}
+
+    /**
+     * Adds an observation.
+     * @param seconds The observed duration.
+     */
+    void observe(double seconds);
+};
+
+/**
+ * Publishes the render health of the viewer in the Prometheus text format: frame time
+ * histograms, load durations, environment cache hits and misses, memory and the last frame's
+ * render statistics. The metrics are fed by Engine::loop and published every interval to a
+ * file (for node_exporter's textfile collector) and/or to an HTTP endpoint serving /metrics.
+ * Observations are a few additions on the GL thread; formatting and file writes happen once per
+ * interval, the HTTP requests are answered by a thread from the last published text.
+ */
+class MetricsExporter {
+public:
+    MetricsExporter();
+    ~MetricsExporter();
+
+    /**
+     * Enables the exporter.
+     * @param filepath File rewritten at every publication, empty for none. Written through a temporary
+     * file renamed over it, so that readers never see a partial file.
+     * @param address Address the HTTP endpoint listens on.
+     * @param port Port of the HTTP endpoint, 0 for none.
+     * @param intervalMs Time between two publications.
+     * @return false if neither output could be opened.
+     */
+    bool init(const std::string& filepath, const std::string& address, int port, int intervalMs);
+
+    /**
+     * @return true once init() has succeeded.
+     */
+    bool isEnabled() const { return _enabled; }
+
+    /**
+     * Records the time to render and present a frame.
+     * @param seconds Wall time of the frame.
+     */
+    void observeFrame(double seconds);
+
+    /**
+     * Records the GPU time of the last frame read back by the profiler, once per profiled frame.
+     * @param frame The last frame of the profiler.
+     */
+    void observeProfile(const ProfileFrame& frame);
+
+    /**
+     * Records a model load.
+     * @param seconds Duration of the load, import and uploads.
+     * @param success false if the model could not be loaded.
+     */
+    void observeModelLoad(double seconds, bool success);
+
+    /**
+     * Records an environment load, from the request to the end of its bake.
+     * @param seconds Duration of the load.
+     */
+    void observeEnvironmentLoad(double seconds);
+
+    /**
+     * Publishes the metrics if the interval has elapsed, called once per loop iteration.
+     * @param renderer The renderer, for its statistics and cache counters.
+     */
+    void update(const Renderer& renderer);
+
+private:
+    bool _enabled = false;
+    std::chrono::milliseconds _interval{ 10000 };
+    std::chrono::steady_clock::time_point _nextPublish;
+    std::string _filepath;
+
+    MetricsHistogram _frameSeconds;
+    MetricsHistogram _gpuFrameSeconds;
+    MetricsHistogram _modelLoadSeconds;
+    MetricsHistogram _environmentLoadSeconds;
+    uint64_t _modelLoadFailures = 0;
+    uint64_t _lastProfiledFrame = 0;
+
+    // HTTP endpoint: listening socket (platform handle), serving thread and the text it serves
+    intptr_t _listenSocket = -1;
+    std::thread _server;
+    std::atomic<bool> _serving{ false };
+    std::mutex _publishedMutex;
+    std::string _published;
+
+    /**
+     * Formats all the metrics in the Prometheus text exposition format.
+     */
+    std::string format(const Renderer& renderer) const;
+
+    /**
+     * Opens the listening socket of the HTTP endpoint.
+     * @return false if the address cannot be bound.
+     */
+    bool listen(const std::string& address, int port);
+
+    /**
+     * Serving thread: answers GET /metrics with the published text until the exporter is destroyed.
+     */
+    void serve();
+};
@@ -0,0 +1,197 @@
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+// Trace thread id of the GPU timeline
+static const int GPU_TRACE_THREAD = 1000;
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+// Index of the calling thread, 0 for the thread that called init()
+static std::atomic<int> nextThreadIndex(1);
+static thread_local int threadIndex = -1;
+// Scopes opened and not yet closed by the calling thread
+static thread_local std::vector<ProfileSample> openScopes;
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::init(bool gpuTiming) {
+    threadIndex = 0;
+    _gpuTiming = gpuTiming;
+    if (_gpuTiming) {
+        calibrateGpuClock();
+    }
+    _enabled = true;
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Profiler::calibrateGpuClock() {
+    GLint64 gpuTime = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    _gpuOffset = gpuTime * 1e-6 - now();
+}
+
+GLuint Profiler::issueTimestamp() {
+    PendingFrame& pending = _pendingFrames[_frameIndex % FRAME_LATENCY];
+    if (pending.usedQueries == pending.queries.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        pending.queries.push_back(query);
+    }
+    GLuint query = pending.queries[pending.usedQueries++];
+    glQueryCounter(query, GL_TIMESTAMP);
+    return query;
+}
+
+void Profiler::beginScope(const char* name, bool gpu) {
+    if (threadIndex < 0) {
+        threadIndex = nextThreadIndex++;
+    }
+    ProfileSample sample;
+    sample.name = name;
+    sample.depth = (int)openScopes.size();
+    sample.thread = threadIndex;
+    // GL commands are only issued by the main thread
+    if (gpu && _gpuTiming && threadIndex == 0) {
+        sample.gpuQueries[0] = issueTimestamp();
+    }
+    sample.cpuStart = now();
+    openScopes.push_back(sample);
+}
+
+void Profiler::endScope() {
+    ProfileSample sample = openScopes.back();
+    openScopes.pop_back();
+    sample.cpuEnd = now();
+    if (sample.gpuQueries[0] != 0) {
+        sample.gpuQueries[1] = issueTimestamp();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pendingFrames[_frameIndex % FRAME_LATENCY].frame.samples.push_back(sample);
+}
+
+void Profiler::endFrame() {
+    if (!_enabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    PendingFrame& current = _pendingFrames[_frameIndex % FRAME_LATENCY];
+    current.frame.index = _frameIndex;
+    current.inFlight = true;
+    ++_frameIndex;
+
+    // the slot of the next frame holds the oldest frame in flight, its queries are done by now
+    PendingFrame& oldest = _pendingFrames[_frameIndex % FRAME_LATENCY];
+    if (oldest.inFlight) {
+        resolveFrame(oldest);
+    }
+}
+
+void Profiler::flush() {
+    if (!_enabled) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    // oldest first, so that the last ended frame is completed last
+    for (uint64_t i = 1; i < FRAME_LATENCY; ++i) {
+        PendingFrame& pending = _pendingFrames[(_frameIndex + i) % FRAME_LATENCY];
+        if (pending.inFlight) {
+            resolveFrame(pending);
+        }
+    }
+}
+
+void Profiler::resolveFrame(PendingFrame& pending) {
+    for (ProfileSample& sample : pending.frame.samples) {
+        if (sample.gpuQueries[0] == 0) {
+            continue;
+        }
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(sample.gpuQueries[0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(sample.gpuQueries[1], GL_QUERY_RESULT, &end);
+        sample.gpuStart = start * 1e-6 - _gpuOffset;
+        sample.gpuEnd = end * 1e-6 - _gpuOffset;
+        sample.gpuQueries[0] = sample.gpuQueries[1] = 0;
+    }
+    completeFrame(pending.frame);
+    pending.frame.samples.clear();
+    pending.usedQueries = 0;
+    pending.inFlight = false;
+}
+
+void Profiler::completeFrame(ProfileFrame& frame) {
+    // parents before children, in start order
+    std::sort(frame.samples.begin(), frame.samples.end(), [](const ProfileSample& a, const ProfileSample& b) {
+        if (a.thread != b.thread) return a.thread < b.thread;
+        return a.cpuStart < b.cpuStart || (a.cpuStart == b.cpuStart && a.depth < b.depth);
+        });
+    _lastFrame = frame;
+    if (_capturing) {
+        _capturedFrames.push_back(frame);
+        if (_capturedFrames.size() > MAX_CAPTURED_FRAMES) {
+            _capturedFrames.pop_front();
+        }
+    }
+}
+
+void Profiler::startCapture() {
+    _capturedFrames.clear();
+    // the clocks drift apart slowly, realign them for the new capture
+    if (_gpuTiming) {
+        calibrateGpuClock();
+    }
+    _capturing = true;
+}
+
+bool Profiler::exportChromeTrace(const std::string& filepath) const {
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create " << filepath << std::endl;
+        return false;
+    }
+
+    // Chrome trace timestamps are in microseconds
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[\n";
+    std::set<int> threads;
+    bool first = true;
+    for (const ProfileFrame& frame : _capturedFrames) {
+        for (const ProfileSample& sample : frame.samples) {
+            threads.insert(sample.thread);
+            file << (first ? "" : ",\n") << "{\"name\":\"" << sample.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << sample.thread
+                << ",\"ts\":" << sample.cpuStart * 1000.0 << ",\"dur\":" << (sample.cpuEnd - sample.cpuStart) * 1000.0
+                << ",\"args\":{\"frame\":" << frame.index << "}}";
+            first = false;
+            if (sample.gpuStart >= 0.0) {
+                file << ",\n{\"name\":\"" << sample.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << GPU_TRACE_THREAD
+                    << ",\"ts\":" << sample.gpuStart * 1000.0 << ",\"dur\":" << (sample.gpuEnd - sample.gpuStart) * 1000.0
+                    << ",\"args\":{\"frame\":" << frame.index << "}}";
+            }
+        }
+    }
+
+    // thread names
+    threads.insert(0);
+    for (int thread : threads) {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":\""
+            << (thread == 0 ? std::string("Main") : "Worker " + std::to_string(thread)) << "\"}}";
+        first = false;
+    }
+    if (_gpuTiming) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << GPU_TRACE_THREAD << ",\"args\":{\"name\":\"GPU\"}}";
+    }
+    file << "\n]}\n";
+    return (bool)file;
+}
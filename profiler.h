@@ -0,0 +1,194 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * One timed scope of a frame. Times are in milliseconds since the profiler started.
+ */
+struct ProfileSample {
+    const char* name = "";      // Scope name, a string literal
+    int depth = 0;              // Nesting depth on its thread, 0 for top-level scopes
+    int thread = 0;             // Profiler thread index, 0 for the main thread
+    double cpuStart = 0.0;      // CPU start time
+    double cpuEnd = 0.0;        // CPU end time
+    double gpuStart = -1.0;     // GPU start time, negative for CPU-only scopes
+    double gpuEnd = -1.0;       // GPU end time
+    GLuint gpuQueries[2] = { 0, 0 }; // Timestamp queries, until the results are read back
+};
+
+/**
+ * The samples of one frame, complete once the GPU results are read back.
+ */
+struct ProfileFrame {
+    uint64_t index = 0;                 // Frame number
+    std::vector<ProfileSample> samples; // Scopes in end order
+};
+
+/**
+ * Hierarchical CPU/GPU frame profiler. Scopes are opened with the PROFILE_SCOPE and
+ * PROFILE_GPU_SCOPE macros from any thread; GPU scopes must be on the GL thread.
+ * GPU times come from GL_TIMESTAMP queries written at both ends of a scope, so that
+ * scopes can nest (GL_TIME_ELAPSED queries cannot), and are read back a few frames
+ * later from a ring of query pools so that the CPU never waits for the GPU.
+ */
+class Profiler {
+public:
+    // Frames in flight before their GPU queries are read back
+    static const int FRAME_LATENCY = 4;
+    // Frames kept by a capture, older ones are dropped
+    static const size_t MAX_CAPTURED_FRAMES = 600;
+
+    /**
+     * @return The profiler shared by the whole application.
+     */
+    static Profiler& get();
+
+    /**
+     * Enables profiling, scopes are ignored until then.
+     * @param gpuTiming true to time GPU scopes, requires a current GL context.
+     */
+    void init(bool gpuTiming);
+
+    /**
+     * @return true once init() has been called.
+     */
+    bool isEnabled() const { return _enabled; }
+
+    /**
+     * Opens a scope on the calling thread.
+     * @param name Scope name, must outlive the profiler (a string literal).
+     * @param gpu true to also time the GL commands issued within the scope.
+     */
+    void beginScope(const char* name, bool gpu);
+
+    /**
+     * Closes the innermost scope of the calling thread.
+     */
+    void endScope();
+
+    /**
+     * Closes the current frame, called by the GL thread after the buffer swap.
+     * Reads back the GPU times of the oldest frame in flight.
+     */
+    void endFrame();
+
+    /**
+     * Waits for the GPU times of the frames in flight and reads them back, for tools that
+     * need the times of the frame they just ended. getLastFrame() is then the last ended frame.
+     */
+    void flush();
+
+    /**
+     * @return The most recent frame whose GPU times are known.
+     */
+    const ProfileFrame& getLastFrame() const { return _lastFrame; }
+
+    /**
+     * Starts recording completed frames, dropping any previous capture.
+     */
+    void startCapture();
+
+    /**
+     * Stops recording frames, the capture is kept for export.
+     */
+    void stopCapture() { _capturing = false; }
+
+    /**
+     * @return true while frames are being recorded.
+     */
+    bool isCapturing() const { return _capturing; }
+
+    /**
+     * @return The number of recorded frames.
+     */
+    size_t getCapturedFrameCount() const { return _capturedFrames.size(); }
+
+    /**
+     * Writes the recorded frames in the Chrome trace event format (chrome://tracing, Perfetto).
+     * @param filepath Destination JSON file.
+     * @return true on success.
+     */
+    bool exportChromeTrace(const std::string& filepath) const;
+
+private:
+    /**
+     * Query pool and samples of a frame in flight.
+     */
+    struct PendingFrame {
+        ProfileFrame frame;
+        std::vector<GLuint> queries;   // Pool of timestamp queries, reused
+        size_t usedQueries = 0;        // Queries issued this frame
+        bool inFlight = false;         // Ended, GPU times not read back yet
+    };
+
+    bool _enabled = false;
+    bool _gpuTiming = false;
+    bool _capturing = false;
+    uint64_t _frameIndex = 0;
+
+    // Offset from GPU timestamps to profiler time, in milliseconds
+    double _gpuOffset = 0.0;
+
+    // Frames in flight, indexed by frame number modulo FRAME_LATENCY
+    PendingFrame _pendingFrames[FRAME_LATENCY];
+
+    // Protects the current frame's samples, scopes may end on worker threads
+    std::mutex _mutex;
+
+    ProfileFrame _lastFrame;
+    std::deque<ProfileFrame> _capturedFrames;
+
+    /**
+     * @return Milliseconds since the profiler started.
+     */
+    double now() const;
+
+    /**
+     * Measures the offset between the GPU and CPU clocks.
+     */
+    void calibrateGpuClock();
+
+    /**
+     * Issues a timestamp query from the current frame's pool.
+     */
+    GLuint issueTimestamp();
+
+    /**
+     * Reads back the GPU times of a frame in flight and completes it, its pool can then be reused.
+     */
+    void resolveFrame(PendingFrame& pending);
+
+    /**
+     * Stores a completed frame for the overlay and the capture.
+     */
+    void completeFrame(ProfileFrame& frame);
+};
+
+/**
+ * Opens a profiler scope for its lifetime.
+ */
+class ProfileScope {
+public:
+    ProfileScope(const char* name, bool gpu) : _active(Profiler::get().isEnabled()) {
+        if (_active) Profiler::get().beginScope(name, gpu);
+    }
+    ~ProfileScope() {
+        if (_active) Profiler::get().endScope();
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    bool _active;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Times the rest of the enclosing block on the CPU
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+// Times the rest of the enclosing block on the CPU and the GPU, GL thread only
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
@@ -1,25 +1,95 @@
 #include "renderer.h"
 #include "shader.h"
+#include "profiler.h"
+#include "glCapture.h"
 #include <glad/glad.h>
-#include <ImfRgbaFile.h>
-#include <ImfRgba.h>
-#include <ImfArray.h>
-#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
-
-static void glClearAllErrors() {
-    while (glGetError() != GL_NO_ERROR) {}
-}
-
-static bool glCheckErrorStatus(const char* function, int line) {
-    while (GLenum error = glGetError()) {
-        std::cout << "OPENGL ERROR FUNCTION " << function << "LINE " << line << ": " << error << "\n";
-        exit(1);
-    }
-    return false;
-}
-
-#define glCheck(x) glClearAllErrors(); x; glCheckErrorStatus(#x, __LINE__);
+#include <unordered_set>
+
+// Environment map resolutions
+static const int ENVIRONMENT_CUBEMAP_SIZE = 512;
+static const int IRRADIANCE_SIZE = 32;
+static const int PREFILTER_SIZE = 1024;
+static const int PREFILTER_MIP_LEVELS = 5;
+// Largest tile rendered by one bake step
+static const int BAKE_TILE_SIZE = 256;
+// Size of the BRDF integration LUT
+static const int BRDF_LUT_SIZE = 512;
+// Fragments per pixel shown in red by the overdraw mode
+static const float MAX_OVERDRAW = 8.0f;
+// Staging ring of the uploads, a 4K RGBA texture spans two buffers
+static const size_t UPLOAD_SLOT_BYTES = 8 * 1024 * 1024;
+static const int UPLOAD_SLOTS = 4;
+// Shading of the materials whose textures are still uploading
+static const glm::vec4 PENDING_DIFFUSE_COLOR = glm::vec4(0.8f, 0.8f, 0.8f, 1.0f);
+static const float PENDING_METALNESS = 0.0f;
+static const float PENDING_ROUGHNESS = 0.5f;
+// Uniform block binding points
+static const GLuint FRAME_UNIFORMS_BINDING = 0;
+static const GLuint DRAW_UNIFORMS_BINDING = 1;
+// Initial region of a frame in the dynamic buffer ring, about a thousand draws
+static const size_t DYNAMIC_FRAME_BYTES = 256 * 1024;
+static const int DYNAMIC_FRAMES_IN_FLIGHT = 3;
+// Finer texture levels are requested while fewer bytes than this wait in the upload queue
+static const size_t STREAMING_PENDING_BYTES = 16 * 1024 * 1024;
+// Closest distance used for the screen density of a mesh, the camera may be inside its box
+static const float STREAMING_MIN_DISTANCE = 0.1f;
+// Packed materials and texture arrays indexed by pbr.fs (MAX_MATERIALS and MAX_MATERIAL_ARRAYS),
+// the arrays are bound from the texture unit after those of the environment
+static const int MAX_MATERIALS = 256;
+static const int MAX_MATERIAL_ARRAYS = 8;
+static const int MATERIAL_ARRAYS_UNIT = 6;
+static const GLuint MATERIAL_UNIFORMS_BINDING = 2;
+
+/**
+ * Per-frame uniforms, std140 layout of the FrameUniforms block of the shaders.
+ */
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec4 viewPosition;     // xyz
+    glm::vec4 lightDirection;   // xyz
+    glm::vec4 lightColor;       // rgb
+    glm::vec2 viewportSize;
+    float envIntensity;
+    int renderMode;             // Output of pbr.fs
+    int perfMode;               // Output of perf.fs
+    int padding[3];
+};
+static_assert(sizeof(FrameUniforms) == 208, "FrameUniforms must match the std140 layout of the shaders");
+
+/**
+ * Per-draw uniforms, std140 layout of the DrawUniforms block of the shaders.
+ */
+struct DrawUniforms {
+    glm::mat4 model;
+    glm::vec4 diffuseColor;
+    float metalnessFactor;
+    float roughnessFactor;
+    int useNormalMap;
+    float cost;                 // Relative cost of the mesh in the mesh cost mode
+    int materialIndex;          // Block of the material in MaterialUniforms, -1 if not packed
+    int padding[3];
+};
+static_assert(sizeof(DrawUniforms) == 112, "DrawUniforms must match the std140 layout of the shaders");
+
+/**
+ * Parameters of a packed material, std140 layout of an element of the MaterialUniforms block of pbr.fs.
+ */
+struct MaterialUniforms {
+    glm::vec4 diffuseColor;
+    float metalnessFactor;
+    float roughnessFactor;
+    int useNormalMap;
+    int padding;
+    int arrays[4];              // ivec4, texture array of the diffuse, normal and metalness-roughness maps
+    int layers[4];              // ivec4, their layers
+};
+static_assert(sizeof(MaterialUniforms) == 64, "MaterialUniforms must match the std140 layout of pbr.fs");
 
 void Renderer::init(int width, int height) {
     _width = width;
@@ -40,17 +110,52 @@ void Renderer::init(int width, int height) {
     _prefilterShader = Shader("./shaders/cubemap.vs", "./shaders/prefilter.fs");
     _irradianceShader = Shader("./shaders/cubemap.vs", "./shaders/irradiance_convolution.fs");
     _brdfShader = Shader("./shaders/brdf.vs", "./shaders/brdf.fs");
+    _perfShader = Shader("./shaders/perf.vs", "./shaders/perf.fs", "./shaders/perf.gs");
+    _overdrawShader = Shader("./shaders/brdf.vs", "./shaders/overdraw.fs");
+
+    // uniforms that never change: texture units and uniform block bindings
+    _pbrShader.use();
+    _pbrShader.setInt("uPrefilterMap", 0);
+    _pbrShader.setInt("uAlbedoMap", 1);
+    _pbrShader.setInt("uNormalMap", 2);
+    _pbrShader.setInt("uMetalnessRoughnessMap", 3);
+    _pbrShader.setInt("uBrdfLut", 4);
+    _pbrShader.setInt("uIrradianceMap", 5);
+    for (int i = 0; i < MAX_MATERIAL_ARRAYS; ++i) {
+        _pbrShader.setInt(("uMaterialArrays[" + std::to_string(i) + "]").c_str(), MATERIAL_ARRAYS_UNIT + i);
+    }
+    _pbrShader.setUniformBlock("MaterialUniforms", MATERIAL_UNIFORMS_BINDING);
+    _backgroundShader.use();
+    _backgroundShader.setInt("environmentMap", 0);
+    _overdrawShader.use();
+    _overdrawShader.setInt("uOverdraw", 0);
+    _overdrawShader.setFloat("uMaxOverdraw", MAX_OVERDRAW);
+    for (Shader* shader : { &_pbrShader, &_backgroundShader, &_perfShader }) {
+        shader->setUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+        shader->setUniformBlock("DrawUniforms", DRAW_UNIFORMS_BINDING);
+    }
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    _drawUniformsStride = (sizeof(DrawUniforms) + alignment - 1) / alignment * alignment;
+    _frameData.init(GL_UNIFORM_BUFFER, DYNAMIC_FRAME_BYTES, alignment, DYNAMIC_FRAMES_IN_FLIGHT);
+
     // Generate Quad and Cube meshes
     genCube();
     genQuad();
+    bakeBrdfLut();
+    _uploads.init(UPLOAD_SLOT_BYTES, UPLOAD_SLOTS);
 }
 
 std::vector<int> Renderer::getSortedTransparentMeshIndices(const std::vector<Mesh>& meshes, const std::vector<int>& transparentMeshIndices, const glm::vec3& cameraPosition) {
     // Vector to store sorted indices
     std::vector<int> sortedIndices = transparentMeshIndices;
+    sortBackToFront(meshes, sortedIndices.data(), sortedIndices.size(), cameraPosition);
+    return sortedIndices;
+}
 
+void Renderer::sortBackToFront(const std::vector<Mesh>& meshes, int* indices, size_t count, const glm::vec3& cameraPosition) {
     // Sort the indices based on the distance of the mesh from the camera
-    std::sort(sortedIndices.begin(), sortedIndices.end(), [&meshes, &cameraPosition](int a, int b) {
+    std::sort(indices, indices + count, [&meshes, &cameraPosition](int a, int b) {
         // Extract world position from the mesh's transform matrix (translation part)
         glm::vec3 posA = glm::vec3(meshes[a].transform[3][0], meshes[a].transform[3][1], meshes[a].transform[3][2]);
         glm::vec3 posB = glm::vec3(meshes[b].transform[3][0], meshes[b].transform[3][1], meshes[b].transform[3][2]);
@@ -62,41 +167,92 @@ std::vector<int> Renderer::getSortedTransparentMeshIndices(const std::vector<Mes
         // Sort in descending order (farthest to closest)
         return distA > distB;
         });
+}
 
-    return sortedIndices;
+bool Renderer::writeDrawUniforms(const std::vector<Mesh>& meshes, const FrameVector<int>& meshIndices, GLintptr& offset) {
+    uint8_t* blocks = (uint8_t*)_frameData.map(meshIndices.size() * _drawUniformsStride, offset);
+    if (!blocks) {
+        return false;
+    }
+
+    // costs are shown relative to the most expensive mesh
+    double maxCost = 0.0;
+    if (_renderMode == RENDER_MODE_MESH_COST) {
+        for (const MeshCost& cost : _meshCosts) {
+            maxCost = std::max(maxCost, cost.gpuMs);
+        }
+    }
+
+    // written sequentially, the mapping may be write-combined memory
+    for (size_t i = 0; i < meshIndices.size(); ++i) {
+        int index = meshIndices[i];
+        const Mesh& mesh = meshes[index];
+        const Material& material = *mesh.material;
+
+        // factors above 1 select the maps, neutral values stand in for the maps still uploading
+        DrawUniforms draw;
+        draw.model = mesh.transform;
+        bool mapsPending = !material.metalnessRoughness;
+        draw.diffuseColor = material.diffuseColor.r > 1 && !material.diffuse ? PENDING_DIFFUSE_COLOR : material.diffuseColor;
+        draw.metalnessFactor = material.metalnessFactor > 1 && mapsPending ? PENDING_METALNESS : material.metalnessFactor;
+        draw.roughnessFactor = material.roughnessFactor > 1 && mapsPending ? PENDING_ROUGHNESS : material.roughnessFactor;
+        draw.useNormalMap = material.normal.id();
+        draw.cost = maxCost > 0.0 && index < (int)_meshCosts.size() ? (float)(_meshCosts[index].gpuMs / maxCost) : 0.0f;
+        draw.materialIndex = getMaterialIndex(mesh.material);
+        std::memcpy(blocks + i * _drawUniformsStride, &draw, sizeof(draw));
+    }
+    _frameData.unmap();
+    return true;
 }
 
-void Renderer::renderMeshes(const std::vector<Mesh>& meshes, const std::vector<int>& meshIndices) {
+void Renderer::renderMeshes(const std::vector<Mesh>& meshes, const FrameVector<int>& meshIndices) {
+    GLintptr drawOffset;
+    if (meshIndices.empty() || !writeDrawUniforms(meshes, meshIndices, drawOffset)) {
+        return;
+    }
+
     for (int index : meshIndices) {
         const Mesh& mesh = meshes[index];
-
-        // diffuse map
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, mesh.material.diffuse);
-        _pbrShader.setInt("uAlbedoMap", 1);
-        // normal map
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, mesh.material.normal);
-        _pbrShader.setInt("uNormalMap", 2);
-        // metal roughness map
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, mesh.material.metalnessRoughness);
-        _pbrShader.setInt("uMetalnessRoughnessMap", 3);
-
-        _pbrShader.setInt("uUseNormalMap", mesh.material.normal);
-        _pbrShader.setFloat("uMetalnessFactor", mesh.material.metalnessFactor);
-        _pbrShader.setFloat("uRoughnessFactor", mesh.material.roughnessFactor);
-        _pbrShader.setVec4("uDiffuseColor", mesh.material.diffuseColor);
+        const Material& material = *mesh.material;
+
+        // the texture arrays of the packed materials are bound once per frame
+        if (getMaterialIndex(&material) < 0) {
+            // diffuse map
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, material.diffuse.id());
+            // normal map
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, material.normal.id());
+            // metal roughness map
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, material.metalnessRoughness.id());
+            _frameStats.textureBinds += 3;
+        }
 
         // bind buffers
         glBindVertexArray(mesh.vao);
-        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo.id());
 
         // mesh uniforms
-        _pbrShader.setMat4("uModel", mesh.transform);
-
-        // draw mesh
-        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_UNIFORMS_BINDING, _frameData.getBuffer(), drawOffset, sizeof(DrawUniforms));
+        drawOffset += _drawUniformsStride;
+
+        // draw mesh, measured in the mesh cost mode
+        ++_frameStats.drawCalls;
+        _frameStats.triangles += mesh.indexCount / 3;
+        _frameStats.vertices += mesh.vertexCount;
+        if (_measuredDraws) {
+            size_t query = _measuredDraws->meshes.size();
+            glBeginQuery(GL_TIME_ELAPSED, _measuredDraws->time[query]);
+            glBeginQuery(GL_SAMPLES_PASSED, _measuredDraws->samples[query]);
+            glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+            glEndQuery(GL_SAMPLES_PASSED);
+            glEndQuery(GL_TIME_ELAPSED);
+            _measuredDraws->meshes.push_back(index);
+        }
+        else {
+            glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+        }
     }
 }
 
@@ -104,6 +260,33 @@ void Renderer::render(const std::vector<Mesh>& meshes, const std::vector<int>& o
     // set viewport
     glViewport(0, 0, _width, _height);
 
+    // the lists of the previous frame are no longer used
+    _frameArena.reset();
+
+    // frustum culling, then the visible transparent meshes back to front
+    glm::mat4 viewProjection = camera.getPerspective() * camera.getTransform();
+    FrameVector<int> visibleOpaqueIndices = cullMeshes(meshes, opaqueMeshesIndices, viewProjection);
+    FrameVector<int> visibleTransparentIndices = cullMeshes(meshes, transparentMeshesIndices, viewProjection);
+    sortBackToFront(meshes, visibleTransparentIndices.data(), visibleTransparentIndices.size(), camera.getPosition());
+
+    // finer levels for the textures of the meshes close to the camera, coarser for the others
+    streamTextures(meshes, camera);
+
+    // the mesh cost mode draws the meshes twice, shaded then colored by cost
+    size_t draws = visibleOpaqueIndices.size() + visibleTransparentIndices.size();
+    writeFrameUniforms(camera, _renderMode == RENDER_MODE_MESH_COST ? 2 * draws : draws);
+
+    if (_renderMode == RENDER_MODE_OVERDRAW || _renderMode == RENDER_MODE_TRIANGLE_DENSITY) {
+        renderPerformanceView(meshes, visibleOpaqueIndices, visibleTransparentIndices, camera);
+        _frameData.endFrame();
+        endFrameStats();
+        return;
+    }
+    // the mesh cost mode shades the scene as usual and times every draw
+    if (_renderMode == RENDER_MODE_MESH_COST) {
+        beginMeshQueries(meshes);
+    }
+
     // clear buffers
     glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -115,127 +298,555 @@ void Renderer::render(const std::vector<Mesh>& meshes, const std::vector<int>& o
     glDisable(GL_DEPTH_TEST);
     
 
+    // the most recently selected environment that finished baking
+    const Environment& environment = getActiveEnvironment();
+
     if (_showBackground) {
-        // configure background shader
+        PROFILE_GPU_SCOPE("background");
+
+        // configure background shader, the camera is in the frame uniforms
         _backgroundShader.use();
 
         // environment map
         glActiveTexture(GL_TEXTURE0);
-        _backgroundShader.setInt("environmentMap", 0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.envCubemap);
-
-        // pass uniforms
-        _backgroundShader.setMat4("view", camera.getTransform());
-        _backgroundShader.setMat4("projection", camera.getPerspective());
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment.envCubemap.id());
+        ++_frameStats.textureBinds;
 
         // render cube
         renderCube();
     }
 
-    // setup light
-    glm::vec3 lightDirection = glm::normalize(glm::vec3(-.5, -.5, -1));
-    glm::vec3 lightColor(1, 1, 1);
-   
-    // configure PBR Shader
+    // configure PBR Shader, the camera and the light are in the frame uniforms
     // --------------------
     _pbrShader.use();
-    _pbrShader.setInt("uRenderMode", _renderMode);
 
     // prefilter map
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.prefilterMap);
-    _pbrShader.setInt("uPrefilterMap", 0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, environment.prefilterMap.id());
     // environment map
     glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, _environment.brdfLutTexture);
-    _pbrShader.setInt("uBrdfLut", 4);
+    glBindTexture(GL_TEXTURE_2D, _brdfLutTexture.id());
     // irradiance map
     glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.irradianceMap);
-    _pbrShader.setInt("uIrradianceMap", 5);
-
-    // global uniforms
-    _pbrShader.setVec3("uLightDirection", lightDirection);
-    _pbrShader.setVec3("uLightColor", lightColor);
-    _pbrShader.setFloat("uEnvIntensity", _envIntensity);
-    _pbrShader.setMat4("uProjection", camera.getPerspective());
-    _pbrShader.setMat4("uView", camera.getTransform());
-    _pbrShader.setVec3("uViewPosition", camera.getPosition());
+    glBindTexture(GL_TEXTURE_CUBE_MAP, environment.irradianceMap.id());
+    _frameStats.textureBinds += 3;
+    // texture arrays and parameters of the packed materials
+    if (!_materialLayers.empty()) {
+        if (_materialUniformsDirty) {
+            writeMaterialUniforms();
+        }
+        for (size_t i = 0; i < _materialArrays.size(); ++i) {
+            glActiveTexture(GL_TEXTURE0 + MATERIAL_ARRAYS_UNIT + (GLenum)i);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, _materialArrays[i].texture.id());
+        }
+        _frameStats.textureBinds += (int)_materialArrays.size();
+        glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_UNIFORMS_BINDING, _materialBuffer.id(), 0, MAX_MATERIALS * sizeof(MaterialUniforms));
+    }
 
     // Opaque pass
-    glDisable(GL_BLEND);
-    glDepthMask(GL_TRUE);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    
-    renderMeshes(meshes, opaqueMeshesIndices);
+    {
+        PROFILE_GPU_SCOPE("opaque");
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+
+        renderMeshes(meshes, visibleOpaqueIndices);
+    }
 
     // Transparent pass
     // ----------------
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glDepthMask(GL_FALSE);
-    glDisable(GL_CULL_FACE);
-    std::vector<int> sortedTransparentIndices = getSortedTransparentMeshIndices(meshes, transparentMeshesIndices, camera.getPosition());
-    renderMeshes(meshes, sortedTransparentIndices);
+    {
+        PROFILE_GPU_SCOPE("transparent");
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
+        renderMeshes(meshes, visibleTransparentIndices);
+    }
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    // then draw over it with the measured costs
+    if (_measuredDraws) {
+        _measuredDraws = nullptr;
+        renderPerformanceView(meshes, visibleOpaqueIndices, visibleTransparentIndices, camera);
+    }
+    _frameData.endFrame();
+    endFrameStats();
+}
+
+void Renderer::writeFrameUniforms(const Camera& camera, size_t draws) {
+    size_t frameBlockBytes = (sizeof(FrameUniforms) + _drawUniformsStride - 1) / _drawUniformsStride * _drawUniformsStride;
+    _frameData.beginFrame(frameBlockBytes + draws * _drawUniformsStride);
+
+    FrameUniforms frame;
+    frame.projection = camera.getPerspective();
+    frame.view = camera.getTransform();
+    frame.viewPosition = glm::vec4(camera.getPosition(), 1.0f);
+    frame.lightDirection = glm::vec4(glm::normalize(glm::vec3(-.5, -.5, -1)), 0.0f);
+    frame.lightColor = glm::vec4(1, 1, 1, 1);
+    frame.viewportSize = glm::vec2(_width, _height);
+    frame.envIntensity = _envIntensity;
+    frame.renderMode = _renderMode < RENDER_MODE_OVERDRAW ? _renderMode : 0;
+    frame.perfMode = std::max(0, _renderMode - RENDER_MODE_OVERDRAW);
+
+    GLintptr offset;
+    void* block = _frameData.map(sizeof(frame), offset);
+    if (block) {
+        std::memcpy(block, &frame, sizeof(frame));
+        _frameData.unmap();
+        glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, _frameData.getBuffer(), offset, sizeof(frame));
+    }
+}
+
+/**
+ * World space box around the transformed bounds of a mesh.
+ * @param center Receives the center of the box.
+ * @param extent Receives the half size of the box.
+ */
+static void worldBox(const Mesh& mesh, glm::vec3& center, glm::vec3& extent) {
+    glm::vec3 localCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+    glm::vec3 localExtent = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+    center = glm::vec3(mesh.transform * glm::vec4(localCenter, 1.0f));
+    for (int i = 0; i < 3; ++i) {
+        extent[i] = std::abs(mesh.transform[0][i]) * localExtent.x + std::abs(mesh.transform[1][i]) * localExtent.y + std::abs(mesh.transform[2][i]) * localExtent.z;
+    }
+}
+
+FrameVector<int> Renderer::cullMeshes(const std::vector<Mesh>& meshes, const std::vector<int>& meshIndices, const glm::mat4& viewProjection) {
+    // frustum planes from the rows of the matrix, normals pointing inside
+    glm::vec4 planes[6];
+    glm::vec4 w(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    for (int i = 0; i < 3; ++i) {
+        glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        planes[2 * i] = w + row;
+        planes[2 * i + 1] = w - row;
+    }
+
+    FrameVector<int> visible(_frameArena);
+    visible.reserve(meshIndices.size());
+    for (int index : meshIndices) {
+        const Mesh& mesh = meshes[index];
+        // meshes appear once their buffers are uploaded
+        if (!mesh.uploaded) {
+            continue;
+        }
+        // unknown bounds are always drawn
+        if (mesh.boundsMin.x > mesh.boundsMax.x) {
+            visible.push_back(index);
+            continue;
+        }
+
+        glm::vec3 worldCenter, worldExtent;
+        worldBox(mesh, worldCenter, worldExtent);
+
+        // outside if the whole box is behind one of the planes
+        bool outside = false;
+        for (const glm::vec4& plane : planes) {
+            float distance = plane.x * worldCenter.x + plane.y * worldCenter.y + plane.z * worldCenter.z + plane.w;
+            float radius = std::abs(plane.x) * worldExtent.x + std::abs(plane.y) * worldExtent.y + std::abs(plane.z) * worldExtent.z;
+            if (distance < -radius) {
+                outside = true;
+                break;
+            }
+        }
+        if (outside) {
+            ++_frameStats.meshesCulled;
+        }
+        else {
+            visible.push_back(index);
+        }
+    }
+    return visible;
+}
+
+void Renderer::endFrameStats() {
+    _frameStats.programSwitches = (int)Shader::useCount;
+    _frameStats.uniformUploads = (int)Shader::uniformUploadCount;
+    _frameStats.dynamicBytes = _frameData.getBytesWritten();
+    Shader::useCount = 0;
+    Shader::uniformUploadCount = 0;
+
+    // resident VRAM
+    _frameStats.meshBytes = _meshBytes;
+    for (const auto& [texture, bytes] : _textureBytes) {
+        _frameStats.textureBytes += bytes;
+    }
+    for (const Environment& environment : _environments) {
+        _frameStats.environmentBytes += environment.bytes;
+    }
+
+    _stats = _frameStats;
+    _frameStats = RenderStats();
+}
+
+void RenderStats::writeCsvHeader(std::ostream& stream) {
+    stream << "drawCalls,triangles,vertices,meshesCulled,textureBinds,programSwitches,uniformUploads,"
+        << "bufferBytesUploaded,textureBytesUploaded,dynamicBytes,meshBytes,textureBytes,environmentBytes\n";
+}
+
+void RenderStats::writeCsvRow(std::ostream& stream) const {
+    stream << drawCalls << "," << triangles << "," << vertices << "," << meshesCulled << "," << textureBinds << ","
+        << programSwitches << "," << uniformUploads << "," << bufferBytesUploaded << "," << textureBytesUploaded << ","
+        << dynamicBytes << "," << meshBytes << "," << textureBytes << "," << environmentBytes << "\n";
+}
+
+void Renderer::renderPerformanceView(const std::vector<Mesh>& meshes, const FrameVector<int>& opaqueMeshesIndices, const FrameVector<int>& transparentMeshesIndices, const Camera& camera) {
+    PROFILE_GPU_SCOPE("performance view");
+
+    // the camera and the mode are in the frame uniforms
+    _perfShader.use();
+
+    if (_renderMode == RENDER_MODE_OVERDRAW) {
+        // count the fragments that pass the depth test, in the order and with the depth state of the shading passes
+        resizeOverdrawTarget();
+        glBindFramebuffer(GL_FRAMEBUFFER, _overdrawFramebuffer.id());
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_CULL_FACE);
+        renderPerformanceMeshes(meshes, opaqueMeshesIndices);
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
+        renderPerformanceMeshes(meshes, transparentMeshesIndices);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // map the counts to colors
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        _overdrawShader.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, _overdrawTexture.id());
+        ++_frameStats.textureBinds;
+        renderQuad();
+    }
+    else {
+        // nearest surface only, transparent meshes included
+        glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDisable(GL_BLEND);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+        glEnable(GL_CULL_FACE);
+        renderPerformanceMeshes(meshes, opaqueMeshesIndices);
+        glDisable(GL_CULL_FACE);
+        renderPerformanceMeshes(meshes, transparentMeshesIndices);
+    }
     glDepthMask(GL_TRUE);
     glEnable(GL_DEPTH_TEST);
     glDisable(GL_BLEND);
 }
 
+void Renderer::renderPerformanceMeshes(const std::vector<Mesh>& meshes, const FrameVector<int>& meshIndices) {
+    // the blocks hold the relative costs in the mesh cost mode
+    GLintptr drawOffset;
+    if (meshIndices.empty() || !writeDrawUniforms(meshes, meshIndices, drawOffset)) {
+        return;
+    }
+
+    for (int index : meshIndices) {
+        const Mesh& mesh = meshes[index];
+        glBindVertexArray(mesh.vao);
+        glBindBufferRange(GL_UNIFORM_BUFFER, DRAW_UNIFORMS_BINDING, _frameData.getBuffer(), drawOffset, sizeof(DrawUniforms));
+        drawOffset += _drawUniformsStride;
+        glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+        ++_frameStats.drawCalls;
+        _frameStats.triangles += mesh.indexCount / 3;
+        _frameStats.vertices += mesh.vertexCount;
+    }
+}
+
+void Renderer::beginMeshQueries(const std::vector<Mesh>& meshes) {
+    // new scene: start over
+    if (_meshCosts.size() != meshes.size()) {
+        _meshCosts.assign(meshes.size(), MeshCost());
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            _meshCosts[i].name = meshes[i].name;
+            _meshCosts[i].triangles = meshes[i].indexCount / 3;
+        }
+    }
+
+    // read back the draws measured MESH_QUERY_LATENCY frames ago, the GPU is done with them by now
+    MeshQueries& queries = _meshQueries[_meshQueryFrame++ % MESH_QUERY_LATENCY];
+    for (size_t i = 0; i < queries.meshes.size(); ++i) {
+        GLuint64 time = 0, samples = 0;
+        glGetQueryObjectui64v(queries.time[i], GL_QUERY_RESULT, &time);
+        glGetQueryObjectui64v(queries.samples[i], GL_QUERY_RESULT, &samples);
+        if (queries.meshes[i] >= (int)_meshCosts.size()) {
+            continue;
+        }
+        MeshCost& cost = _meshCosts[queries.meshes[i]];
+        double ms = time / 1e6;
+        cost.gpuMs = cost.gpuMs == 0.0 ? ms : cost.gpuMs * 0.9 + ms * 0.1;
+        cost.pixels = samples;
+    }
+    queries.meshes.clear();
+
+    // every mesh is drawn at most once per frame
+    if (queries.time.size() < meshes.size()) {
+        size_t first = queries.time.size();
+        queries.time.resize(meshes.size());
+        queries.samples.resize(meshes.size());
+        glGenQueries((GLsizei)(meshes.size() - first), &queries.time[first]);
+        glGenQueries((GLsizei)(meshes.size() - first), &queries.samples[first]);
+    }
+    _measuredDraws = &queries;
+}
+
+void Renderer::resizeOverdrawTarget() {
+    if (_overdrawFramebuffer && _overdrawWidth == _width && _overdrawHeight == _height) {
+        return;
+    }
+    _overdrawWidth = _width;
+    _overdrawHeight = _height;
+
+    // half floats count exactly up to 2048 layers and can be blended
+    GpuResourceManager& resources = GpuResourceManager::get();
+    _overdrawTexture = resources.createTexture(GL_TEXTURE_2D, GL_R16F, _width, _height, 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    _overdrawDepth = resources.createRenderbuffer(GL_DEPTH_COMPONENT24, _width, _height);
+
+    // the previous target goes back to the pool, a window resized back reuses it
+    if (!_overdrawFramebuffer) {
+        _overdrawFramebuffer = resources.createFramebuffer();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, _overdrawFramebuffer.id());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _overdrawTexture.id(), 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _overdrawDepth.id());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool Renderer::update() {
+    // forget abandoned decodes once their worker is done
+    _discardedDecodes.erase(std::remove_if(_discardedDecodes.begin(), _discardedDecodes.end(), [](std::future<EnvironmentSource>& decode) {
+        return decode.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }), _discardedDecodes.end());
+    // objects released since the last frame, by model or environment switches
+    GpuResourceManager::get().trim();
+
+    bool uploaded = false;
+    if (_uploads.isUploading()) {
+        PROFILE_GPU_SCOPE("uploads");
+        uploaded = _uploads.update(_frameStats.bufferBytesUploaded, _frameStats.textureBytesUploaded);
+        updateStreamedTextures();
+        // a texture array may have arrived, its materials stop using neutral values
+        _materialUniformsDirty |= uploaded && !_materialLayers.empty();
+    }
+
+    if (!_environmentLoad) {
+        return uploaded;
+    }
+    PROFILE_GPU_SCOPE("environment bake");
+    EnvironmentLoad& load = *_environmentLoad;
+
+    // wait for the worker, then start baking
+    if (load.steps.empty()) {
+        if (load.decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return uploaded;
+        }
+        EnvironmentSource source = load.decode.get();
+        if (!source.baked.cubemap.pixels.empty()) {
+            uploadBakedEnvironment(load, source.baked);
+            finishEnvironmentBake();
+            return true;
+        }
+        if (source.image.pixels.empty()) {
+            _environmentLoad.reset();
+            return uploaded;
+        }
+        beginEnvironmentBake(load, source.image);
+    }
+
+    for (int i = 0; i < _bakeStepsPerFrame && load.nextStep < load.steps.size(); ++i) {
+        runBakeStep(load, load.steps[load.nextStep++]);
+    }
+
+    if (load.nextStep == load.steps.size()) {
+        finishEnvironmentBake();
+        return true;
+    }
+    return uploaded;
+}
+
+void Renderer::finishUploads() {
+    PROFILE_GPU_SCOPE("finish uploads");
+    _uploads.finish(_frameStats.bufferBytesUploaded, _frameStats.textureBytesUploaded);
+    updateStreamedTextures();
+    _materialUniformsDirty |= !_materialLayers.empty();
+}
+
+void Renderer::setTextureStreaming(bool enabled, int minSize, size_t budgetBytes) {
+    _textureStreaming = enabled;
+    _streamingMinSize = std::max(minSize, 4);
+    _streamingBudget = budgetBytes;
+}
+
 void Renderer::loadEnvironment(const std::string& filepath) {
-    // pbr: load the HDR environment map
-    // ---------------------------------
-    GLuint hdrTexture = 0;
-    size_t dotPosition = filepath.find_last_of(".");
-    if (dotPosition != std::string::npos && dotPosition == 0) {
+    // already being loaded
+    if (_environmentLoad && _environmentLoad->environment.filepath == filepath) {
         return;
     }
-    std::string extension = filepath.substr(dotPosition + 1);
-    if (extension == "exr") {
-        hdrTexture = loadExrImage(filepath);
+    PROFILE_SCOPE("loadEnvironment");
+    cancelEnvironmentLoad();
+
+    // cache hit: move it to the front, it is rendered from the next frame
+    for (auto it = _environments.begin(); it != _environments.end(); ++it) {
+        if (it->filepath == filepath) {
+            _environments.splice(_environments.begin(), _environments, it);
+            ++_environmentCacheHits;
+            return;
+        }
     }
-    else if (extension == "hdr") {
-        hdrTexture = loadImage(filepath);
+
+    // pbr: load the HDR environment map on a worker thread
+    // ----------------------------------------------------
+    ++_environmentCacheMisses;
+    _environmentLoad = std::make_unique<EnvironmentLoad>();
+    _environmentLoad->environment.filepath = filepath;
+    _environmentLoad->decode = std::async(std::launch::async, [filepath]() {
+        PROFILE_SCOPE("decode environment");
+        EnvironmentSource source;
+        if (std::filesystem::path(filepath).extension() == ".ibl") {
+            if (!IblFile::read(filepath, source.baked)) {
+                source.baked = BakedEnvironment();
+            }
+            return source;
+        }
+        // 4 cubemap faces around the equator, larger images are downsampled while decoding
+        if (!HdrImageLoader::load(filepath, 4 * ENVIRONMENT_CUBEMAP_SIZE, source.image)) {
+            source.image = HdrImage();
+        }
+        return source;
+        });
+}
+
+void Renderer::finishEnvironmentLoading() {
+    while (_environmentLoad) {
+        if (_environmentLoad->decode.valid()) {
+            _environmentLoad->decode.wait();
+        }
+        update();
     }
+}
+
+const Environment& Renderer::getActiveEnvironment() const {
+    static const Environment noEnvironment;
+    return _environments.empty() ? noEnvironment : _environments.front();
+}
 
-    // delete previous textures
-    if (_environment.prefilterMap > 0) glDeleteTextures(1, &_environment.prefilterMap);
-    if (_environment.brdfLutTexture > 0) glDeleteTextures(1, &_environment.brdfLutTexture);
-    if (_environment.irradianceMap > 0) glDeleteTextures(1, &_environment.irradianceMap);
-    if (_environment.envCubemap > 0) glDeleteTextures(1, &_environment.envCubemap);
-    if (_environment.skyTextureId > 0) glDeleteTextures(1, &_environment.skyTextureId);
+void Renderer::setEnvironmentCacheBudget(size_t bytes) {
+    _environmentCacheBudget = bytes;
+    evictEnvironments();
+}
+
+void Renderer::beginEnvironmentBake(EnvironmentLoad& load, const HdrImage& image) {
+    PROFILE_GPU_SCOPE("begin bake");
+    Environment& environment = load.environment;
+    load.hdrTexture = uploadEquirectTexture(image);
 
     // pbr: setup framebuffer
     // ----------------------
-    unsigned int captureFBO;
-    unsigned int captureRBO;
-    glGenFramebuffers(1, &captureFBO);
-    glGenRenderbuffers(1, &captureRBO);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO);
-
-    // pbr: setup cubemap to render to and attach to framebuffer
-    // ---------------------------------------------------------
-    glGenTextures(1, &_environment.envCubemap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.envCubemap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 512, 512, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
+    GpuResourceManager& resources = GpuResourceManager::get();
+    load.captureFBO = resources.createFramebuffer();
+    load.captureRBO = resources.createRenderbuffer(GL_DEPTH_COMPONENT24, ENVIRONMENT_CUBEMAP_SIZE, ENVIRONMENT_CUBEMAP_SIZE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, load.captureFBO.id());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, load.captureRBO.id());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    load.captureRBOSize = ENVIRONMENT_CUBEMAP_SIZE;
+
+    // pbr: setup cubemap to render to, with its mip chain for the prefilter pass
+    // --------------------------------------------------------------------------
+    environment.envCubemap = resources.createTexture(GL_TEXTURE_CUBE_MAP, GL_RGB16F, ENVIRONMENT_CUBEMAP_SIZE, ENVIRONMENT_CUBEMAP_SIZE,
+        GpuResourceManager::fullMipLevels(ENVIRONMENT_CUBEMAP_SIZE, ENVIRONMENT_CUBEMAP_SIZE));
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // enable pre-filter mipmap sampling (combatting visible dots artifact)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    // pbr: create an irradiance cubemap
+    // ---------------------------------
+    environment.irradianceMap = resources.createTexture(GL_TEXTURE_CUBE_MAP, GL_RGB16F, IRRADIANCE_SIZE, IRRADIANCE_SIZE, 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // pbr: create a pre-filter cubemap
+    // --------------------------------
+    // only the first mip levels are prefiltered, rough reflections do not sample the others
+    environment.prefilterMap = resources.createTexture(GL_TEXTURE_CUBE_MAP, GL_RGB16F, PREFILTER_SIZE, PREFILTER_SIZE, PREFILTER_MIP_LEVELS);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // be sure to set minification filter to mip_linear 
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    environment.bytes = environment.envCubemap.getBytes() + environment.irradianceMap.getBytes() + environment.prefilterMap.getBytes();
+
+    // plan the bake: whole faces for the cheap passes, tiles for the prefilter map
+    // ----------------------------------------------------------------------------
+    auto addFaceTiles = [&load](BakePass pass, int mip, int faceSize, int tileSize) {
+        for (int face = 0; face < 6; ++face) {
+            for (int y = 0; y < faceSize; y += tileSize) {
+                for (int x = 0; x < faceSize; x += tileSize) {
+                    BakeStep step;
+                    step.pass = pass;
+                    step.face = face;
+                    step.mip = mip;
+                    step.faceSize = faceSize;
+                    step.x = x;
+                    step.y = y;
+                    step.size = std::min(tileSize, faceSize);
+                    load.steps.push_back(step);
+                }
+            }
+        }
+    };
+    addFaceTiles(BakePass::Cubemap, 0, ENVIRONMENT_CUBEMAP_SIZE, ENVIRONMENT_CUBEMAP_SIZE);
+    BakeStep mipmaps;
+    mipmaps.pass = BakePass::CubemapMipmaps;
+    load.steps.push_back(mipmaps);
+    addFaceTiles(BakePass::Irradiance, 0, IRRADIANCE_SIZE, IRRADIANCE_SIZE);
+    for (int mip = 0; mip < PREFILTER_MIP_LEVELS; ++mip) {
+        addFaceTiles(BakePass::Prefilter, mip, PREFILTER_SIZE >> mip, BAKE_TILE_SIZE);
+    }
+}
+
+void Renderer::uploadBakedEnvironment(EnvironmentLoad& load, const BakedEnvironment& baked) {
+    PROFILE_GPU_SCOPE("upload baked environment");
+    Environment& environment = load.environment;
+    environment.envCubemap = uploadCubemap(baked.cubemap);
+    environment.irradianceMap = uploadCubemap(baked.irradiance);
+    environment.prefilterMap = uploadCubemap(baked.prefilter);
+    environment.bytes = environment.envCubemap.getBytes() + environment.irradianceMap.getBytes() + environment.prefilterMap.getBytes();
+}
+
+void Renderer::runBakeStep(EnvironmentLoad& load, const BakeStep& step) {
+    Environment& environment = load.environment;
+
+    static const char* const stepNames[] = { "bake cubemap", "bake cubemap mipmaps", "bake irradiance", "bake prefilter" };
+    PROFILE_GPU_SCOPE(stepNames[(int)step.pass]);
+
+    if (step.pass == BakePass::CubemapMipmaps) {
+        // then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment.envCubemap.id());
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+        return;
+    }
+
     // pbr: set up projection and view matrices for capturing data onto the 6 cubemap face directions
     // ----------------------------------------------------------------------------------------------
-    glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
-    glm::mat4 captureViews[] =
+    static const glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+    static const glm::mat4 captureViews[] =
     {
         glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
         glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
@@ -245,126 +856,116 @@ void Renderer::loadEnvironment(const std::string& filepath) {
         glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
     };
 
-    // pbr: convert HDR equirectangular environment map to cubemap equivalent
-    // ----------------------------------------------------------------------
-    _equirectangularToCubemapShader.use();
-    _equirectangularToCubemapShader.setInt("equirectangularMap", 0);
-    _equirectangularToCubemapShader.setMat4("projection", captureProjection);
+    // pick the shader, the source and the target map of the pass
+    Shader* shader = nullptr;
+    GLuint target = 0;
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrTexture);
-
-    glViewport(0, 0, 512, 512); // don't forget to configure the viewport to the capture dimensions.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        _equirectangularToCubemapShader.setMat4("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, _environment.envCubemap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        renderCube();
+    if (step.pass == BakePass::Cubemap) {
+        // pbr: convert HDR equirectangular environment map to cubemap equivalent
+        shader = &_equirectangularToCubemapShader;
+        shader->use();
+        shader->setInt("equirectangularMap", 0);
+        glBindTexture(GL_TEXTURE_2D, load.hdrTexture.id());
+        target = environment.envCubemap.id();
+    }
+    else if (step.pass == BakePass::Irradiance) {
+        // pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
+        shader = &_irradianceShader;
+        shader->use();
+        shader->setInt("environmentMap", 0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment.envCubemap.id());
+        target = environment.irradianceMap.id();
+    }
+    else {
+        // pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map.
+        shader = &_prefilterShader;
+        shader->use();
+        shader->setInt("environmentMap", 0);
+        shader->setFloat("roughness", (float)step.mip / (float)(PREFILTER_MIP_LEVELS - 1));
+        glBindTexture(GL_TEXTURE_CUBE_MAP, environment.envCubemap.id());
+        target = environment.prefilterMap.id();
+    }
+    shader->setMat4("projection", captureProjection);
+    shader->setMat4("view", captureViews[step.face]);
+
+    // resize the depth attachment according to mip-level size.
+    glBindFramebuffer(GL_FRAMEBUFFER, load.captureFBO.id());
+    if (load.captureRBOSize != step.faceSize) {
+        load.captureRBO = GpuResourceManager::get().createRenderbuffer(GL_DEPTH_COMPONENT24, step.faceSize, step.faceSize);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, load.captureRBO.id());
+        load.captureRBOSize = step.faceSize;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // then let OpenGL generate mipmaps from first mip face (combatting visible dots artifact)
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.envCubemap);
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    // render the whole face, the scissor keeps only this step's tile
+    glViewport(0, 0, step.faceSize, step.faceSize);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(step.x, step.y, step.size, step.size);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + step.face, target, step.mip);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderCube();
+    glDisable(GL_SCISSOR_TEST);
 
-    // pbr: create an irradiance cubemap, and re-scale capture FBO to irradiance scale.
-    // --------------------------------------------------------------------------------
-    glGenTextures(1, &_environment.irradianceMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.irradianceMap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
+void Renderer::finishEnvironmentBake() {
+    EnvironmentLoad& load = *_environmentLoad;
 
-    // pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
-    // -----------------------------------------------------------------------------
-    _irradianceShader.use();
-    _irradianceShader.setInt("environmentMap", 0);
-    _irradianceShader.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.envCubemap);
+    // release framebuffers and the equirectangular source
+    load.captureFBO.reset();
+    load.captureRBO.reset();
+    load.hdrTexture.reset();
 
-    glViewport(0, 0, 32, 32); // don't forget to configure the viewport to the capture dimensions.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        _irradianceShader.setMat4("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, _environment.irradianceMap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    _environments.push_front(std::move(load.environment));
+    _environmentLoad.reset();
+    evictEnvironments();
+}
 
-        renderCube();
+void Renderer::cancelEnvironmentLoad() {
+    if (!_environmentLoad) {
+        return;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    EnvironmentLoad& load = *_environmentLoad;
 
-    // pbr: create a pre-filter cubemap, and re-scale capture FBO to pre-filter scale.
-    // --------------------------------------------------------------------------------
-    int hires = 1024;
-    glGenTextures(1, &_environment.prefilterMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.prefilterMap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, hires, hires, 0, GL_RGB, GL_FLOAT, nullptr);
+    // the worker cannot be interrupted, keep its future until it is done
+    if (load.decode.valid()) {
+        _discardedDecodes.push_back(std::move(load.decode));
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // be sure to set minification filter to mip_linear 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // generate mipmaps for the cubemap so OpenGL automatically allocates the required memory.
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
-
-    // pbr: run a quasi monte-carlo simulation on the environment lighting to create a prefilter (cube)map.
-    // ----------------------------------------------------------------------------------------------------
-    _prefilterShader.use();
-    _prefilterShader.setInt("environmentMap", 0);
-    _prefilterShader.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, _environment.envCubemap);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-
-    unsigned int maxMipLevels = 5;
-
-    for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
-    {
-        // reisze framebuffer according to mip-level size.
-        unsigned int mipWidth = static_cast<unsigned int>(hires * std::pow(0.5, mip));
-        unsigned int mipHeight = static_cast<unsigned int>(hires * std::pow(0.5, mip));
-        glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
+    // its framebuffers and maps go back to the resource pool
+    _environmentLoad.reset();
+}
 
-        float roughness = (float)mip / (float)(maxMipLevels - 1);
-        _prefilterShader.setFloat("roughness", roughness);
-        for (unsigned int i = 0; i < 6; ++i)
-        {
-            _prefilterShader.setMat4("view", captureViews[i]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, _environment.prefilterMap, mip);
+void Renderer::evictEnvironments() {
+    // released objects go first, they cost nothing to give back
+    GpuResourceManager& resources = GpuResourceManager::get();
+    resources.trim();
 
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            renderCube();
-        }
+    size_t total = 0;
+    for (const Environment& environment : _environments) {
+        total += environment.bytes;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // the least recently used environments are at the back, the active one is never evicted
+    while (_environments.size() > 1 && (total > _environmentCacheBudget || resources.isOverBudget())) {
+        total -= _environments.back().bytes;
+        _environments.pop_back();
+        resources.trim();
+    }
+    if (resources.isOverBudget()) {
+        std::cerr << "GPU resources use " << (resources.getUsedBytes() >> 20) << " MB, over the budget of "
+            << (resources.getBudget() >> 20) << " MB" << std::endl;
+    }
+}
 
+void Renderer::bakeBrdfLut() {
+    PROFILE_GPU_SCOPE("bake BRDF LUT");
     // pbr: generate a 2D LUT from the BRDF equations used.
     // ----------------------------------------------------
-    glGenTextures(1, &_environment.brdfLutTexture);
+    GpuResourceManager& resources = GpuResourceManager::get();
+    FramebufferHandle captureFBO = resources.createFramebuffer();
+    RenderbufferHandle captureRBO = resources.createRenderbuffer(GL_DEPTH_COMPONENT24, BRDF_LUT_SIZE, BRDF_LUT_SIZE);
 
     // pre-allocate enough memory for the LUT texture.
-    glBindTexture(GL_TEXTURE_2D, _environment.brdfLutTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
+    _brdfLutTexture = resources.createTexture(GL_TEXTURE_2D, GL_RG16F, BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1);
     // be sure to set wrapping mode to GL_CLAMP_TO_EDGE
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -372,36 +973,79 @@ void Renderer::loadEnvironment(const std::string& filepath) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     // then re-configure capture framebuffer object and render screen-space quad with BRDF shader.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _environment.brdfLutTexture, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO.id());
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, captureRBO.id());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _brdfLutTexture.id(), 0);
 
-    glViewport(0, 0, 512, 512);
+    glViewport(0, 0, BRDF_LUT_SIZE, BRDF_LUT_SIZE);
     _brdfShader.use();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     renderQuad();
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // the framebuffers are released with their handles
+}
+
+/**
+ * Pixel format of a decoded image, and its internal format, sized so that textures of the same
+ * size and format are recycled.
+ */
+static void imageFormat(int channels, GLenum& format, GLenum& internalFormat) {
+    format = GL_RGB;
+    internalFormat = GL_RGB8;
+    if (channels == 1) { format = GL_RED; internalFormat = GL_R8; }
+    else if (channels == 2) { format = GL_RG; internalFormat = GL_RG8; }
+    else if (channels == 4) { format = GL_RGBA; internalFormat = GL_RGBA8; }
+}
 
-    // delete framebuffers
-    glDeleteFramebuffers(1, &captureFBO);
-    glDeleteRenderbuffers(1, &captureRBO);
+/**
+ * @return The GL internal format of a block compression codec.
+ */
+static GLenum compressedFormat(TextureCodec codec) {
+    if (codec == TextureCodec::BC5) return GL_COMPRESSED_RG_RGTC2;
+    if (codec == TextureCodec::BC4) return GL_COMPRESSED_RED_RGTC1;
+    return GL_COMPRESSED_RGBA_BPTC_UNORM_ARB;
+}
+
+/**
+ * Sets the swizzle of the bound material texture. Compressed metalness-roughness channels are
+ * stored from red, the shader reads roughness in green and metalness in blue; set every time, a
+ * recycled texture keeps the swizzle of its previous use.
+ */
+static void setMaterialSwizzle(GLenum target, TextureType type, GLenum internalFormat) {
+    GLint swizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+    if (type == TextureType::MetalnessRoughness && (internalFormat == GL_COMPRESSED_RG_RGTC2 || internalFormat == GL_COMPRESSED_RED_RGTC1)) {
+        swizzle[1] = GL_RED;
+        swizzle[2] = internalFormat == GL_COMPRESSED_RG_RGTC2 ? GL_GREEN : GL_ZERO;
+    }
+    glTexParameteri(target, GL_TEXTURE_SWIZZLE_R, swizzle[0]);
+    glTexParameteri(target, GL_TEXTURE_SWIZZLE_G, swizzle[1]);
+    glTexParameteri(target, GL_TEXTURE_SWIZZLE_B, swizzle[2]);
+    glTexParameteri(target, GL_TEXTURE_SWIZZLE_A, swizzle[3]);
 }
 
 void Renderer::loadTextureData(const TextureBindingEvent& tbe) {
-    // Determine the image format
-    GLenum format = GL_RGB;
-    if (tbe.channels == 1) format = GL_RED;
-    else if (tbe.channels == 3) format = GL_RGB;
-    else if (tbe.channels == 4) format = GL_RGBA;
-
-    // Load texture in GPU
-    GLuint textureId;
-    glGenTextures(1, &textureId);
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, tbe.width, tbe.height, 0, format, GL_UNSIGNED_BYTE, tbe.imageData);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    PROFILE_GPU_SCOPE("upload texture");
+    // packed with the other textures of the model once its meshes are loaded
+    if (_materialArraysEnabled) {
+        addArrayTextureSource(tbe);
+        return;
+    }
+    uploadMaterialTexture(tbe);
+}
+
+void Renderer::uploadMaterialTexture(const TextureBindingEvent& tbe) {
+    if (tbe.compressed) {
+        loadCompressedTexture(tbe);
+        return;
+    }
+    GLenum format, internalFormat;
+    imageFormat(tbe.channels, format, internalFormat);
+
+    // Allocate the texture in GPU, its contents are streamed by the upload queue
+    TextureHandle texture = GpuResourceManager::get().createTexture(GL_TEXTURE_2D, internalFormat, tbe.width, tbe.height,
+        GpuResourceManager::fullMipLevels(tbe.width, tbe.height));
+    _textureBytes[texture.id()] = texture.getBytes();
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -409,10 +1053,351 @@ void Renderer::loadTextureData(const TextureBindingEvent& tbe) {
     // Unbind the texture
     glBindTexture(GL_TEXTURE_2D, 0);
 
-    // update the texture id for the adequate texture of the material
-    if (tbe.type == TextureType::MetalnessRoughness) tbe.material->metalnessRoughness = textureId;
-    else if (tbe.type == TextureType::Diffuse) tbe.material->diffuse = textureId;
-    else if (tbe.type == TextureType::Normal) tbe.material->normal = textureId;
+    // the adequate texture of the material is set once uploaded, the material is shaded without it meanwhile
+    _uploads.uploadTexture(std::move(texture), format, tbe.width, tbe.height, tbe.channels, tbe.imageData.get(), textureDestination(tbe));
+}
+
+TextureHandle* Renderer::textureDestination(const TextureBindingEvent& tbe) {
+    if (tbe.type == TextureType::MetalnessRoughness) return &tbe.material->metalnessRoughness;
+    if (tbe.type == TextureType::Normal) return &tbe.material->normal;
+    return &tbe.material->diffuse;
+}
+
+void Renderer::loadCompressedTexture(const TextureBindingEvent& tbe) {
+    const CompressedTexture& compressed = *tbe.compressed;
+    TextureHandle* destination = textureDestination(tbe);
+
+    // the coarse levels only, the texture is refined by streamTextures() when the camera gets close
+    int coarsestLevel = 0;
+    if (_textureStreaming) {
+        while (coarsestLevel + 1 < (int)compressed.mips.size() &&
+            std::max(compressed.mips[coarsestLevel].width, compressed.mips[coarsestLevel].height) > _streamingMinSize) {
+            ++coarsestLevel;
+        }
+    }
+    GLuint texture = uploadCompressedLevels(compressed, tbe.type, coarsestLevel, destination);
+    if (coarsestLevel == 0) {
+        return;
+    }
+
+    // the levels are copied, the event and the scene share and then release theirs
+    StreamedTexture& streamed = _streamedTextures.emplace_back();
+    streamed.source = compressed;
+    streamed.type = tbe.type;
+    streamed.material = tbe.material;
+    auto slot = _streamedMaterialSlots.emplace(tbe.material, _materialPixelsPerUv.size());
+    if (slot.second) {
+        _materialPixelsPerUv.push_back(0.0f);
+    }
+    streamed.materialSlot = slot.first->second;
+    streamed.destination = destination;
+    streamed.coarsestLevel = coarsestLevel;
+    streamed.residentLevel = coarsestLevel;
+    streamed.wantedLevel = coarsestLevel;
+    streamed.pendingLevel = coarsestLevel;
+    streamed.pendingId = texture;
+}
+
+GLuint Renderer::uploadCompressedLevels(const CompressedTexture& compressed, TextureType type, int firstLevel, TextureHandle* destination) {
+    GLenum internalFormat = compressedFormat(compressed.codec);
+
+    // every level is uploaded, none is generated
+    const CompressedMip& first = compressed.mips[firstLevel];
+    TextureHandle texture = GpuResourceManager::get().createTexture(GL_TEXTURE_2D, internalFormat, first.width, first.height,
+        (int)compressed.mips.size() - firstLevel);
+    GLuint id = texture.id();
+    _textureBytes[id] = texture.getBytes();
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    setMaterialSwizzle(GL_TEXTURE_2D, type, internalFormat);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    size_t blockBytes = CompressedTexture::blockBytes(compressed.codec);
+    for (size_t level = firstLevel; level < compressed.mips.size(); ++level) {
+        const CompressedMip& mip = compressed.mips[level];
+        bool last = level + 1 == compressed.mips.size();
+        _uploads.uploadCompressedLevel(texture, internalFormat, (int)(level - firstLevel), mip.width, mip.height, blockBytes,
+            compressed.data.data() + mip.offset, last ? destination : nullptr);
+    }
+    return id;
+}
+
+/**
+ * @return The bytes of the levels of a compressed mip chain from the given one down.
+ */
+static size_t levelsBytes(const CompressedTexture& compressed, int firstLevel) {
+    size_t bytes = 0;
+    for (size_t level = firstLevel; level < compressed.mips.size(); ++level) {
+        bytes += compressed.mips[level].size;
+    }
+    return bytes;
+}
+
+void Renderer::streamTextures(const std::vector<Mesh>& meshes, const Camera& camera) {
+    if (_streamedTextures.empty()) {
+        return;
+    }
+    PROFILE_SCOPE("texture streaming");
+
+    // finest screen density of the texture coordinates of each material: pixels per world unit at
+    // the point of the mesh's box closest to the camera, over texture coordinate units per world unit
+    float pixelsPerWorldUnit = 0.5f * _height * camera.getPerspective()[1][1];
+    glm::vec3 eye = camera.getPosition();
+    // slots are reset rather than the containers cleared, nothing is allocated per frame
+    std::fill(_materialPixelsPerUv.begin(), _materialPixelsPerUv.end(), 0.0f);
+    for (const Mesh& mesh : meshes) {
+        if (!mesh.material || mesh.uvDensity <= 0.0f || mesh.boundsMin.x > mesh.boundsMax.x) {
+            continue;
+        }
+        auto slot = _streamedMaterialSlots.find(mesh.material);
+        if (slot == _streamedMaterialSlots.end()) {
+            continue;
+        }
+        glm::vec3 center, extent;
+        worldBox(mesh, center, extent);
+        float distance = glm::length(glm::max(glm::abs(eye - center) - extent, glm::vec3(0.0f)));
+        float pixelsPerUv = pixelsPerWorldUnit / std::max(distance, STREAMING_MIN_DISTANCE) / mesh.uvDensity;
+        float& finest = _materialPixelsPerUv[slot->second];
+        finest = std::max(finest, pixelsPerUv);
+    }
+
+    // first level with about one texel per pixel, the coarsest for materials of no visible density
+    size_t wantedBytes = 0, residentBytes = 0;
+    for (StreamedTexture& streamed : _streamedTextures) {
+        const CompressedMip& first = streamed.source.mips[0];
+        float density = _materialPixelsPerUv[streamed.materialSlot];
+        streamed.wantedLevel = streamed.coarsestLevel;
+        if (density > 0.0f) {
+            float texelsPerPixel = std::max(first.width, first.height) / density;
+            int level = (int)std::floor(std::log2(std::max(texelsPerPixel, 1.0f)));
+            streamed.wantedLevel = std::min(level, streamed.coarsestLevel);
+        }
+        wantedBytes += levelsBytes(streamed.source, streamed.wantedLevel);
+        residentBytes += levelsBytes(streamed.source, streamed.residentLevel);
+    }
+
+    // over budget, the textures whose finest level is the largest are kept one level coarser
+    while (_streamingBudget > 0 && wantedBytes > _streamingBudget) {
+        StreamedTexture* coarser = nullptr;
+        size_t saving = 0;
+        for (StreamedTexture& streamed : _streamedTextures) {
+            if (streamed.wantedLevel < streamed.coarsestLevel && streamed.source.mips[streamed.wantedLevel].size > saving) {
+                coarser = &streamed;
+                saving = streamed.source.mips[streamed.wantedLevel].size;
+            }
+        }
+        if (!coarser) {
+            break;
+        }
+        ++coarser->wantedLevel;
+        wantedBytes -= saving;
+    }
+    bool overBudget = _streamingBudget > 0 && residentBytes > _streamingBudget;
+
+    // one upload at a time per texture; a level of hysteresis before dropping levels, so that
+    // a mesh moving around a boundary does not upload its textures every frame
+    for (StreamedTexture& streamed : _streamedTextures) {
+        if (streamed.pendingLevel >= 0) {
+            continue;
+        }
+        bool finer = streamed.wantedLevel < streamed.residentLevel && _uploads.getPendingBytes() < STREAMING_PENDING_BYTES;
+        bool coarser = streamed.wantedLevel > streamed.residentLevel + (overBudget ? 0 : 1);
+        if (finer || coarser) {
+            streamed.pendingLevel = streamed.wantedLevel;
+            streamed.pendingId = uploadCompressedLevels(streamed.source, streamed.type, streamed.wantedLevel, streamed.destination);
+        }
+    }
+}
+
+void Renderer::updateStreamedTextures() {
+    for (StreamedTexture& streamed : _streamedTextures) {
+        if (streamed.pendingLevel < 0 || streamed.destination->id() != streamed.pendingId) {
+            continue;
+        }
+        // the previous texture went back to the pool when replaced
+        if (streamed.residentId != 0) {
+            _textureBytes.erase(streamed.residentId);
+        }
+        streamed.residentId = streamed.pendingId;
+        streamed.residentLevel = streamed.pendingLevel;
+        streamed.pendingLevel = -1;
+        streamed.pendingId = 0;
+    }
+}
+
+void Renderer::cancelUploads() {
+    _uploads.cancel();
+    // the cancelled textures went back to the pool
+    for (StreamedTexture& streamed : _streamedTextures) {
+        if (streamed.pendingLevel >= 0) {
+            _textureBytes.erase(streamed.pendingId);
+            streamed.pendingLevel = -1;
+            streamed.pendingId = 0;
+        }
+    }
+}
+
+void Renderer::addArrayTextureSource(const TextureBindingEvent& tbe) {
+    ArrayTextureSource& source = _arrayTextureSources.emplace_back();
+    source.material = tbe.material;
+    source.type = tbe.type;
+    source.width = tbe.width;
+    source.height = tbe.height;
+    source.channels = tbe.channels;
+    if (tbe.compressed) {
+        // shared with the event, nothing is copied
+        source.compressed = tbe.compressed;
+        source.internalFormat = compressedFormat(tbe.compressed->codec);
+        source.format = source.internalFormat;
+        source.width = tbe.compressed->mips[0].width;
+        source.height = tbe.compressed->mips[0].height;
+        source.levels = (int)tbe.compressed->mips.size();
+    }
+    else {
+        imageFormat(tbe.channels, source.format, source.internalFormat);
+        source.pixels = tbe.imageData;
+        source.levels = GpuResourceManager::fullMipLevels(tbe.width, tbe.height);
+    }
+}
+
+void Renderer::packMaterialTextures(const std::vector<Mesh>& meshes) {
+    PROFILE_GPU_SCOPE("pack material textures");
+    std::vector<ArrayTextureSource> sources = std::move(_arrayTextureSources);
+    _arrayTextureSources.clear();
+
+    // an array per type, size, format and mip count, split beyond the layers an array can have
+    GLint maxLayers = 256;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    std::vector<MaterialTextureArray> arrays;
+    for (ArrayTextureSource& source : sources) {
+        auto array = std::find_if(arrays.begin(), arrays.end(), [&](const MaterialTextureArray& candidate) {
+            return candidate.type == source.type && candidate.internalFormat == source.internalFormat && candidate.width == source.width
+                && candidate.height == source.height && candidate.levels == source.levels && candidate.layers < maxLayers;
+            });
+        if (array == arrays.end()) {
+            array = arrays.insert(arrays.end(), { source.type, source.internalFormat, source.width, source.height, source.levels });
+        }
+        source.array = (int)(array - arrays.begin());
+        source.layer = array->layers++;
+    }
+
+    // every material of the meshes reads its parameters from the buffer, textured or not
+    std::vector<const Material*> materials;
+    std::unordered_set<const Material*> added;
+    for (const Mesh& mesh : meshes) {
+        if (mesh.material && !_materialIndices.count(mesh.material) && added.insert(mesh.material).second) {
+            materials.push_back(mesh.material);
+        }
+    }
+    if (_materialArrays.size() + arrays.size() > MAX_MATERIAL_ARRAYS || _materialLayers.size() + materials.size() > MAX_MATERIALS) {
+        std::cerr << "The model needs " << arrays.size() << " texture arrays for " << materials.size() << " materials, more than the "
+            << MAX_MATERIAL_ARRAYS << " and " << MAX_MATERIALS << " of pbr.fs: its textures are not packed" << std::endl;
+        for (ArrayTextureSource& source : sources) {
+            TextureBindingEvent tbe(source.material, source.type, source.pixels, source.channels, source.width, source.height);
+            tbe.compressed = source.compressed;
+            uploadMaterialTexture(tbe);
+        }
+        return;
+    }
+    for (const Material* material : materials) {
+        _materialIndices[material] = (int)_materialLayers.size();
+        _materialLayers.push_back({ material });
+    }
+
+    // the uploads keep pointers to the arrays, which are never moved
+    _materialArrays.reserve(MAX_MATERIAL_ARRAYS);
+    size_t firstArray = _materialArrays.size();
+    std::vector<TextureHandle> textures;
+    std::vector<size_t> lastSources(arrays.size());
+    for (size_t i = 0; i < arrays.size(); ++i) {
+        const MaterialTextureArray& array = arrays[i];
+        TextureHandle texture = GpuResourceManager::get().createTexture(GL_TEXTURE_2D_ARRAY, array.internalFormat, array.width, array.height,
+            array.levels, array.layers);
+        _textureBytes[texture.id()] = texture.getBytes();
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        setMaterialSwizzle(GL_TEXTURE_2D_ARRAY, array.type, array.internalFormat);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        textures.push_back(std::move(texture));
+        _materialArrays.push_back(array);
+    }
+    for (size_t i = 0; i < sources.size(); ++i) {
+        lastSources[sources[i].array] = i;
+    }
+
+    // layers in the order the scene decoded them, an array is handed over with its last layer
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const ArrayTextureSource& source = sources[i];
+        size_t arrayIndex = firstArray + source.array;
+        bool last = lastSources[source.array] == i;
+        TextureHandle* destination = last ? &_materialArrays[arrayIndex].texture : nullptr;
+        if (!source.compressed) {
+            _uploads.uploadLayer(textures[source.array], source.format, source.layer, 0, source.width, source.height, source.channels,
+                false, source.pixels.get(), last, destination);
+        }
+        else {
+            const CompressedTexture& compressed = *source.compressed;
+            size_t blockBytes = CompressedTexture::blockBytes(compressed.codec);
+            for (size_t level = 0; level < compressed.mips.size(); ++level) {
+                const CompressedMip& mip = compressed.mips[level];
+                bool lastLevel = level + 1 == compressed.mips.size();
+                _uploads.uploadLayer(textures[source.array], source.format, source.layer, (int)level, mip.width, mip.height, blockBytes,
+                    true, compressed.data.data() + mip.offset, false, lastLevel ? destination : nullptr);
+            }
+        }
+
+        MaterialLayers& layers = _materialLayers[_materialIndices.at(source.material)];
+        layers.arrays[(int)source.type] = (int)arrayIndex;
+        layers.layers[(int)source.type] = source.layer;
+    }
+    _materialUniformsDirty = true;
+}
+
+void Renderer::writeMaterialUniforms() {
+    // the blocks past the packed materials are never indexed
+    _materialBlocks.resize(MAX_MATERIALS * sizeof(MaterialUniforms));
+    for (size_t i = 0; i < _materialLayers.size(); ++i) {
+        const MaterialLayers& layers = _materialLayers[i];
+        const Material& material = *layers.material;
+        bool ready[3];
+        for (int t = 0; t < 3; ++t) {
+            ready[t] = layers.arrays[t] >= 0 && _materialArrays[layers.arrays[t]].texture;
+        }
+
+        // factors above 1 select the maps, as in DrawUniforms
+        MaterialUniforms block;
+        bool mapsPending = !ready[(int)TextureType::MetalnessRoughness];
+        block.diffuseColor = material.diffuseColor.r > 1 && !ready[(int)TextureType::Diffuse] ? PENDING_DIFFUSE_COLOR : material.diffuseColor;
+        block.metalnessFactor = material.metalnessFactor > 1 && mapsPending ? PENDING_METALNESS : material.metalnessFactor;
+        block.roughnessFactor = material.roughnessFactor > 1 && mapsPending ? PENDING_ROUGHNESS : material.roughnessFactor;
+        block.useNormalMap = ready[(int)TextureType::Normal];
+        block.padding = 0;
+        // maps the material does not have are not sampled, any array does
+        for (int t = 0; t < 4; ++t) {
+            block.arrays[t] = t < 3 ? std::max(layers.arrays[t], 0) : 0;
+            block.layers[t] = t < 3 ? std::max(layers.layers[t], 0) : 0;
+        }
+        std::memcpy(_materialBlocks.data() + i * sizeof(MaterialUniforms), &block, sizeof(block));
+    }
+
+    if (!_materialBuffer) {
+        _materialBuffer = GpuResourceManager::get().createBuffer(GL_UNIFORM_BUFFER, _materialBlocks.size(), _materialBlocks.data(), GL_DYNAMIC_DRAW);
+    }
+    else {
+        glBindBuffer(GL_UNIFORM_BUFFER, _materialBuffer.id());
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, _materialLayers.size() * sizeof(MaterialUniforms), _materialBlocks.data());
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    _materialUniformsDirty = false;
+}
+
+int Renderer::getMaterialIndex(const Material* material) const {
+    if (_materialIndices.empty()) {
+        return -1;
+    }
+    auto index = _materialIndices.find(material);
+    return index != _materialIndices.end() ? index->second : -1;
 }
 
 void Renderer::resizeViewport(const glm::vec2& vec2) {
@@ -426,15 +1411,15 @@ void Renderer::loadMesh(Mesh& mesh) {
     glGenVertexArrays(1, &mesh.vao);
     glBindVertexArray(mesh.vao);
 
-    // generate vertex buffer object
-    glGenBuffers(1, &mesh.vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_STATIC_DRAW);
-    
-    // generate element buffer object
-    glGenBuffers(1, &mesh.ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), mesh.indices.data(), GL_STATIC_DRAW);
+    // vertex and element buffer objects, recycled from the previous model when the sizes match,
+    // filled by the upload queue: the mesh is drawn once both are
+    GpuResourceManager& resources = GpuResourceManager::get();
+    mesh.vbo = resources.createBuffer(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), nullptr);
+    mesh.ebo = resources.createBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), nullptr);
+    _uploads.uploadBuffer(mesh.vbo, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex), nullptr);
+    _uploads.uploadBuffer(mesh.ebo, mesh.indices.data(), mesh.indices.size() * sizeof(GLuint), &mesh.uploaded);
+
+    _meshBytes += mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * sizeof(GLuint);
 
     // vertex attrib pointers
     // ----------------------
@@ -459,120 +1444,144 @@ void Renderer::loadMeshes(std::vector<Mesh>& meshes) {
     for (Mesh& mesh : meshes) {
         loadMesh(mesh);
     }
+    // the textures of the materials are all known once the meshes are
+    if (_materialArraysEnabled) {
+        packMaterialTextures(meshes);
+    }
+    // frees the buffers of the previous model that were not recycled, then cached environments if still over budget
+    evictEnvironments();
 }
 
 void Renderer::clearMeshes(const std::vector<Mesh>& meshes) {
-    for (Mesh mesh : meshes) {
-        // delete vao, vbo and ebo
+    // the uploads in progress read the geometry and write the materials of the scene
+    cancelUploads();
+    // costs measured on these meshes are meaningless for the next scene
+    _meshCosts.clear();
+    for (MeshQueries& queries : _meshQueries) {
+        queries.meshes.clear();
+    }
+    for (const Mesh& mesh : meshes) {
+        _meshBytes -= std::min(_meshBytes, mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * sizeof(GLuint));
+        // delete the vao, the vbo and ebo are released to the pool with the meshes
         glDeleteVertexArrays(1, &mesh.vao);
-        glDeleteBuffers(1, &mesh.vbo);
-        glDeleteBuffers(1, &mesh.ebo);
     }
 }
 
 void Renderer::clearTextures(const std::vector<Material>& materials) {
-    for (Material material : materials) {
-        // delete diffuse, normal and metal roughness textures
-        glDeleteTextures(1, &material.diffuse);
-        glDeleteTextures(1, &material.normal);
-        glDeleteTextures(1, &material.metalnessRoughness);
-    }
-}
-
-void Renderer::setRenderMode(int renderMode) {
-    _renderMode = renderMode;
-}
-
-void Renderer::setShowBackground(bool showBackground) {
-    _showBackground = showBackground;
+    // every material texture belongs to the scene, those still uploading included: they are
+    // released to the pool with the materials and the cancelled uploads
+    cancelUploads();
+    _textureBytes.clear();
+    _streamedTextures.clear();
+    _streamedMaterialSlots.clear();
+    _materialPixelsPerUv.clear();
+    _arrayTextureSources.clear();
+    _materialArrays.clear();
+    _materialLayers.clear();
+    _materialIndices.clear();
 }
 
+void Renderer::reportMemory(const std::vector<Mesh>& meshes, const GeometryArena& geometry, const std::vector<Material>& materials, MemoryReport& report) const {
+    report.residency = geometry.getResidency();
+    report.meshes.clear();
+    report.textures.clear();
+    report.environments.clear();
+
+    report.meshes.reserve(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const Mesh& mesh = meshes[i];
+        // the buffers keep the uncompressed geometry whatever the residency
+        report.meshes.push_back({ mesh.name, geometry.getMeshBytes(i, mesh), mesh.vertexCount * sizeof(Vertex) + mesh.indexCount * sizeof(GLuint) });
+    }
 
-void Renderer::flipImageVertically(std::vector<Imf::Rgba>& pixels, int width, int height) {
-    int rowSize = width;  // Number of pixels per row
-    for (int y = 0; y < height / 2; ++y) {
-        // Calculate indices for the top and bottom rows
-        int topIndex = y * rowSize;
-        int bottomIndex = (height - y - 1) * rowSize;
-
-        // Swap the rows
-        for (int x = 0; x < rowSize; ++x) {
-            std::swap(pixels[topIndex + x], pixels[bottomIndex + x]);
+    // textures shared by several materials are listed once
+    static const char* const textureNames[] = { "diffuse", "normal", "metalness/roughness" };
+    std::unordered_map<const TextureHandle*, size_t> streamedBytes;
+    for (const StreamedTexture& streamed : _streamedTextures) {
+        streamedBytes[streamed.destination] = streamed.source.data.size();
+    }
+    std::unordered_set<GLuint> listed;
+    for (const Material& material : materials) {
+        const TextureHandle* textures[] = { &material.diffuse, &material.normal, &material.metalnessRoughness };
+        for (int t = 0; t < 3; ++t) {
+            if (*textures[t] && listed.insert(textures[t]->id()).second) {
+                auto streamed = streamedBytes.find(textures[t]);
+                size_t cpuBytes = streamed != streamedBytes.end() ? streamed->second : 0;
+                report.textures.push_back({ material.name + " " + textureNames[t], cpuBytes, textures[t]->getBytes() });
+            }
         }
     }
-}
-
-GLuint Renderer::loadExrImage(const std::string& filename) {
-    try {
-        // Open the EXR image file specified by 'filename'
-        Imf::RgbaInputFile file(filename.c_str());
-
-        // Get the data window of the EXR file, which specifies the valid pixel region
-        Imath::Box2i dw = file.dataWindow();
-
-        // Calculate the width and height of the image based on the data window dimensions
-        int width = dw.max.x - dw.min.x + 1;
-        int height = dw.max.y - dw.min.y + 1;
-
-        // Create a vector to hold pixel data for the entire image
-        std::vector<Imf::Rgba> pixels(width * height);
-
-        // Set the framebuffer for the input file, which specifies where to store the pixel data
-        file.setFrameBuffer(&pixels[0] - dw.min.x - dw.min.y * width, 1, width);
-
-        // Read the pixel data from the EXR file into the pixel vector
-        file.readPixels(dw.min.y, dw.max.y);
 
-        // flip image for GPU
-        flipImageVertically(pixels, width, height);
-
-        // Convert the pixel data to OpenGL format and create the texture
-        GLuint exrTextureId;
-        glGenTextures(1, &exrTextureId);
-        glBindTexture(GL_TEXTURE_2D, exrTextureId);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, &pixels[0]);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    for (const MaterialTextureArray& array : _materialArrays) {
+        std::string name = std::string(textureNames[(int)array.type]) + " array " + std::to_string(array.width) + "x" + std::to_string(array.height)
+            + ", " + std::to_string(array.layers) + " layers";
+        report.textures.push_back({ name, 0, GpuResourceManager::textureBytes(GL_TEXTURE_2D_ARRAY, array.internalFormat, array.width, array.height,
+            array.levels, array.layers) });
+    }
 
-        return exrTextureId;
+    for (const Environment& environment : _environments) {
+        report.environments.push_back({ environment.filepath, 0, environment.bytes });
     }
-    catch (const std::exception& e) {
-        std::cerr << "Failed to load EXR: " << e.what() << std::endl;
-        exit(-1);
+    if (_environmentLoad) {
+        report.environments.push_back({ _environmentLoad->environment.filepath + " (loading)", 0, _environmentLoad->environment.bytes });
+    }
+    report.environments.push_back({ "BRDF LUT", 0, _brdfLutTexture.getBytes() });
+
+    report.cpuBytes = 0;
+    report.gpuBytes = 0;
+    for (const std::vector<MemoryEntry>* entries : { &report.meshes, &report.textures, &report.environments }) {
+        for (const MemoryEntry& entry : *entries) {
+            report.cpuBytes += entry.cpuBytes;
+            report.gpuBytes += entry.gpuBytes;
+        }
     }
 }
 
-GLuint Renderer::loadImage(const std::string& filepath) {
-    int width, height, channels;
-
-    stbi_set_flip_vertically_on_load(true);
-    float* data = stbi_loadf(filepath.c_str(), &width, &height, &channels, 0);
-    if (!data) {
-        std::cerr << "Failed to load image from memory: " << stbi_failure_reason() << std::endl;
-        exit(-1);
-    }
+void Renderer::setRenderMode(int renderMode) {
+    _renderMode = renderMode;
+}
 
-    // Convert the pixel data to OpenGL format and create the texture
-    GLuint hdrTextureId;
-    glGenTextures(1, &hdrTextureId);
-    glBindTexture(GL_TEXTURE_2D, hdrTextureId);
+void Renderer::setShowBackground(bool showBackground) {
+    _showBackground = showBackground;
+}
 
-    GLenum format = (channels == 3) ? GL_RGB : GL_RGBA;
-    GLenum internalFormat = (channels == 3) ? GL_RGB16F : GL_RGBA16F;
 
-    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, &data[0]);
+TextureHandle Renderer::uploadEquirectTexture(const HdrImage& image) {
+    // rows are uploaded top first, equirectangular_to_cubemap.fs flips v when sampling
+    TextureHandle texture = GpuResourceManager::get().createTexture(GL_TEXTURE_2D, GL_RGBA16F, image.width, image.height, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, GL_RGBA, GL_HALF_FLOAT, image.pixels.data());
+    _frameStats.textureBytesUploaded += (uint64_t)image.width * image.height * 8;
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    stbi_image_free(data);
+    return texture;
+}
+
+TextureHandle Renderer::uploadCubemap(const CubemapImage& image) {
+    TextureHandle texture = GpuResourceManager::get().createTexture(GL_TEXTURE_CUBE_MAP, GL_RGB16F, image.size, image.size, image.mipLevels);
+
+    // rows of 3 half floats are not 4-byte aligned in the smallest mips
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    for (int mip = 0; mip < image.mipLevels; ++mip) {
+        int size = image.mipSize(mip);
+        const uint16_t* pixels = image.pixels.data() + image.mipOffset(mip);
+        for (unsigned int i = 0; i < 6; ++i) {
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, 0, 0, size, size, GL_RGB, GL_HALF_FLOAT, pixels + (size_t)i * size * size * 3);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    _frameStats.textureBytesUploaded += image.pixels.size() * sizeof(uint16_t);
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, image.mipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    return hdrTextureId;
+    return texture;
 }
 
 void Renderer::renderCube() {
@@ -580,6 +1589,9 @@ void Renderer::renderCube() {
     glBindVertexArray(_cubeMesh.vao);
     glCheck(glDrawArrays(GL_TRIANGLES, 0, 36));
     glBindVertexArray(0);
+    ++_frameStats.drawCalls;
+    _frameStats.triangles += 12;
+    _frameStats.vertices += 36;
 }
 
 void Renderer::genCube() {
@@ -629,10 +1641,8 @@ void Renderer::genCube() {
         -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
     };
     glGenVertexArrays(1, &_cubeMesh.vao);
-    glGenBuffers(1, &_cubeMesh.vbo);
     // fill buffer
-    glBindBuffer(GL_ARRAY_BUFFER, _cubeMesh.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    _cubeMesh.vbo = GpuResourceManager::get().createBuffer(GL_ARRAY_BUFFER, sizeof(vertices), vertices);
     // link vertex attributes
     glBindVertexArray(_cubeMesh.vao);
     glEnableVertexAttribArray(0);
@@ -656,10 +1666,8 @@ void Renderer::genQuad() {
     };
     // setup plane VAO
     glGenVertexArrays(1, &_quadMesh.vao);
-    glGenBuffers(1, &_quadMesh.vbo);
     glBindVertexArray(_quadMesh.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, _quadMesh.vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+    _quadMesh.vbo = GpuResourceManager::get().createBuffer(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(1);
@@ -670,5 +1678,8 @@ void Renderer::renderQuad() {
     // bind quad vao and draw
     glBindVertexArray(_quadMesh.vao);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    ++_frameStats.drawCalls;
+    _frameStats.triangles += 2;
+    _frameStats.vertices += 4;
     glBindVertexArray(0);
 }
\ No newline at end of file
@@ -3,20 +3,85 @@
 #include "mesh.h"
 #include "shader.h"
 #include "camera.h"
+#include "environment.h"
+#include "frameArena.h"
+#include "uploadQueue.h"
+#include "dynamicBufferRing.h"
+#include <array>
+#include <list>
+#include <memory>
+#include <ostream>
+#include <unordered_map>
 #include <vector>
-#include <ImfRgba.h>
-
-// Struct to hold environment maps for IBL (Image-Based Lighting)
-struct Environment {
-	GLuint prefilterMap = 0;        // Prefiltered environment map for reflections
-	GLuint brdfLutTexture = 0;      // BRDF LUT texture for specular reflections
-	GLuint irradianceMap = 0;       // Low-resolution irradiance map for diffuse lighting
-	GLuint envCubemap = 0;          // Original environment cubemap
-	GLuint skyTextureId = 0;        // Sky texture ID for background rendering
+
+/**
+ * GPU cost of a mesh, measured by the mesh cost display mode.
+ */
+struct MeshCost {
+	std::string name;          // Name of the mesh
+	size_t triangles = 0;      // Triangles drawn
+	uint64_t pixels = 0;       // Samples that passed the depth test
+	double gpuMs = 0.0;        // GPU time of the draw, smoothed over the last frames
+};
+
+/**
+ * Work submitted by the renderer for one frame and the VRAM it keeps resident.
+ * The per-frame counters cover everything since the previous frame, including loads and bakes.
+ */
+struct RenderStats {
+	int drawCalls = 0;
+	uint64_t triangles = 0;            // Triangles submitted
+	uint64_t vertices = 0;             // Vertices of the submitted meshes
+	int meshesCulled = 0;              // Meshes outside the view frustum, not drawn
+	int textureBinds = 0;
+	int programSwitches = 0;
+	int uniformUploads = 0;
+	uint64_t bufferBytesUploaded = 0;  // Vertex and index data
+	uint64_t textureBytesUploaded = 0; // Texel data, material and environment textures
+	uint64_t dynamicBytes = 0;         // Per-frame and per-draw uniforms written through the dynamic buffer ring
+	size_t meshBytes = 0;              // Resident vertex and index buffers
+	size_t textureBytes = 0;           // Resident material textures with their mipmaps
+	size_t environmentBytes = 0;       // Resident maps of the cached environments
+
+	/**
+	 * Writes the names of the fields as a CSV line.
+	 */
+	static void writeCsvHeader(std::ostream& stream);
+
+	/**
+	 * Writes the fields as a CSV line, in the order of the header.
+	 */
+	void writeCsvRow(std::ostream& stream) const;
+};
+
+/**
+ * Memory held for one resource, in RAM and in VRAM.
+ */
+struct MemoryEntry {
+	std::string name;
+	size_t cpuBytes = 0;
+	size_t gpuBytes = 0;
+};
+
+/**
+ * Breakdown of the memory held by the scene and the renderer, rebuilt after loads by Renderer::reportMemory().
+ */
+struct MemoryReport {
+	GeometryResidency residency = GeometryResidency::Keep; // What the meshes keep in RAM
+	std::vector<MemoryEntry> meshes;        // Vertices and indices of each mesh
+	std::vector<MemoryEntry> textures;      // Material textures, decoded images are freed after upload, streamed mip chains are kept
+	std::vector<MemoryEntry> environments;  // Maps of the cached environments and the BRDF LUT
+	size_t cpuBytes = 0;                    // Sum over all the entries
+	size_t gpuBytes = 0;                    // Sum over all the entries
 };
 
 class Renderer {
 public:
+	// Display modes after the outputs of pbr.fs, drawn with the performance shaders
+	static constexpr int RENDER_MODE_OVERDRAW = 15;
+	static constexpr int RENDER_MODE_TRIANGLE_DENSITY = 16;
+	static constexpr int RENDER_MODE_MESH_COST = 17;
+
 	/**
 	 * Initializes the renderer with specified viewport dimensions.
 	 * Setup opengl capabilities, create shaders and IBL-dedicated geometry
@@ -35,19 +100,109 @@ public:
 	void render(const std::vector<Mesh>& meshes, const std::vector<int>& opaqueMeshesIndices, const std::vector<int>& transparentMeshesIndices, const Camera& camera);
 
 	/**
-	 * Loads environment maps for IBL from the specified file.
-	 * @param filepath The path to the HDR or EXR environment map file.
+	 * Advances background work that must run on the GL thread, called once per frame.
+	 * Uploads the next bytes of the model being loaded and bakes a few steps of the environment
+	 * being loaded, if any.
+	 * @return true if a mesh, a texture or a newly loaded environment became ready and the frame must be redrawn.
+	 */
+	bool update();
+
+	/**
+	 * @return true while mesh or texture contents are being uploaded.
+	 */
+	bool isUploading() const { return _uploads.isUploading(); }
+
+	/**
+	 * Blocks until the queued mesh and texture uploads are complete.
+	 */
+	void finishUploads();
+
+	/**
+	 * Sets how many bytes of mesh and texture contents are uploaded per frame.
+	 * @param bytes The budget, 0 to upload everything queued at the next update().
+	 */
+	void setUploadBudget(size_t bytes) { _uploads.setBytesPerFrame(bytes); }
+
+	/**
+	 * Configures the streaming of the levels of block-compressed material textures: the coarse
+	 * levels are uploaded at load, the finer ones once the meshes using the texture are close
+	 * enough to the camera to show them, and dropped again when they move away.
+	 * @param enabled false to upload every level at load.
+	 * @param minSize Largest size of the levels uploaded at load.
+	 * @param budgetBytes VRAM of the streamed textures, the textures saving the most are kept coarser beyond it; 0 for no budget.
+	 */
+	void setTextureStreaming(bool enabled, int minSize, size_t budgetBytes);
+
+	/**
+	 * Packs the material textures of the next models into 2D array textures, one per texture type,
+	 * size and format, and gives pbr.fs the material parameters in a uniform buffer indexed by
+	 * each draw, so that draws of different materials bind the same textures and parameters.
+	 * The packed textures are not streamed. A model with too many materials or arrays for the
+	 * shader keeps a texture per map.
+	 * @param enabled true to pack the textures.
+	 */
+	void setMaterialTextureArrays(bool enabled) { _materialArraysEnabled = enabled; }
+
+	/**
+	 * @return true while an environment is being decoded or baked.
+	 */
+	bool isLoadingEnvironment() const { return _environmentLoad != nullptr; }
+
+	/**
+	 * Selects the environment maps for IBL from the specified file.
+	 * Cached environments are activated immediately. Others are decoded on a worker thread
+	 * and baked incrementally by update(), the current environment is rendered meanwhile.
+	 * Maps baked offline by the bakeEnvironments tool (.ibl files) are uploaded as they are.
+	 * @param filepath The path to the HDR, EXR or IBL environment map file.
 	 * @see https://learnopengl.com/PBR/IBL/Specular-IBL
 	 */
 	void loadEnvironment(const std::string& filepath);
 
+	/**
+	 * Blocks until the environment being loaded is decoded and fully baked.
+	 */
+	void finishEnvironmentLoading();
+
+	/**
+	 * Sets the VRAM budget of the baked environment cache.
+	 * Least recently used environments are released when it is exceeded, the active one is always kept.
+	 * @param bytes The budget in bytes.
+	 */
+	void setEnvironmentCacheBudget(size_t bytes);
+
+	/**
+	 * Sets how many bake steps (tiles of cubemap faces) run per frame while an environment loads.
+	 * @param steps Number of steps, at least 1.
+	 */
+	void setBakeStepsPerFrame(int steps) { _bakeStepsPerFrame = std::max(1, steps); }
+
+	/**
+	 * @return Environment selections served by the cache since the start.
+	 */
+	size_t getEnvironmentCacheHits() const { return _environmentCacheHits; }
+
+	/**
+	 * @return Environment selections that had to be decoded and baked (or read from an .ibl file) since the start.
+	 */
+	size_t getEnvironmentCacheMisses() const { return _environmentCacheMisses; }
+
+	/**
+	 * @return The environment being rendered, with zero map IDs if none is loaded yet.
+	 */
+	const Environment& getActiveEnvironment() const;
+
 	/**
 	 * Loads texture data into the GPU based on a TextureBindingEvent.
-	 * Create texture and update texture in material
+	 * Create texture and update texture in material, from its compressed mip chain if it has one.
 	 * @param tbe The TextureBindingEvent containing texture information.
 	 */
 	void loadTextureData(const TextureBindingEvent& tbe);
 
+	/**
+	 * @return true if the GPU samples BC7 textures (ARB_texture_compression_bptc), BC4 and BC5 are core.
+	 */
+	static bool supportsBc7() { return GLAD_GL_ARB_texture_compression_bptc != 0; }
+
 	/**
 	 * Loads a single mesh into GPU memory.
 	 * @param mesh The Mesh object to load.
@@ -78,6 +233,30 @@ public:
 	 */
 	void setRenderMode(int displayMode);
 
+	/**
+	 * @return The statistics of the last rendered frame.
+	 */
+	const RenderStats& getStats() const { return _stats; }
+
+	/**
+	 * @return true while the mesh cost display mode measures every frame, the frames must then be redrawn.
+	 */
+	bool isMeasuringMeshCosts() const { return _renderMode == RENDER_MODE_MESH_COST; }
+
+	/**
+	 * @return The cost of each scene mesh by index, empty until the mesh cost display mode measured a frame.
+	 */
+	const std::vector<MeshCost>& getMeshCosts() const { return _meshCosts; }
+
+	/**
+	 * Fills a memory report with the bytes held for each mesh, texture and environment.
+	 * @param meshes The scene meshes, uploaded by loadMeshes().
+	 * @param geometry The arena holding the CPU geometry of the meshes.
+	 * @param materials The scene materials, their textures uploaded by loadTextureData().
+	 * @param report The report, its previous entries are replaced.
+	 */
+	void reportMemory(const std::vector<Mesh>& meshes, const GeometryArena& geometry, const std::vector<Material>& materials, MemoryReport& report) const;
+
 	/**
 	 * Set the background visibility state
 	 * @param bool true to show background
@@ -90,6 +269,23 @@ public:
 	 */
 	void setEnvIntensity(float envIntensity) { _envIntensity = envIntensity; }
 
+	/**
+	 * Sort transparent mesh indices to render from back to front according to camera position
+	 * @param meshes the vector of meshes to render
+	 * @param transparentMeshIndices the indices of transparent meshes
+	 * @param cameraPosition the position of the camera
+	 */
+	static std::vector<int> getSortedTransparentMeshIndices(const std::vector<Mesh>& meshes, const std::vector<int>& transparentMeshIndices, const glm::vec3& cameraPosition);
+
+	/**
+	 * Sort mesh indices in place to render from back to front according to camera position
+	 * @param meshes the vector of meshes to render
+	 * @param indices the indices to sort
+	 * @param count the number of indices
+	 * @param cameraPosition the position of the camera
+	 */
+	static void sortBackToFront(const std::vector<Mesh>& meshes, int* indices, size_t count, const glm::vec3& cameraPosition);
+
 	/**
 	 * Resizes the viewport to new dimensions.
 	 * @param ivec2 A glm::ivec2 specifying the new width and height.
@@ -97,8 +293,21 @@ public:
 	void resizeViewport(const glm::vec2& vec2);
 
 private:
-	// Environment maps for IBL
-	Environment _environment;
+	// Baked environments, most recently used first. The front one is rendered.
+	std::list<Environment> _environments;
+	// Environment being decoded or baked, null when idle
+	std::unique_ptr<EnvironmentLoad> _environmentLoad;
+	// Decodes of abandoned loads, kept until their worker thread finishes
+	std::vector<std::future<EnvironmentSource>> _discardedDecodes;
+	// VRAM budget of the environment cache in bytes
+	size_t _environmentCacheBudget = 512 * 1024 * 1024;
+	// Bake steps run per frame
+	int _bakeStepsPerFrame = 4;
+	// Environment selections found in the cache or not
+	size_t _environmentCacheHits = 0;
+	size_t _environmentCacheMisses = 0;
+	// BRDF integration LUT, independent of the environment
+	TextureHandle _brdfLutTexture;
 	// Basic geometry for screen-space quad and skybox cube
 	Mesh _quadMesh, _cubeMesh;
 	// Shaders for PBR and background rendering
@@ -106,7 +315,7 @@ private:
 	// Current viewport dimensions
 	int _width, _height;
 	// Current render mode
-	int _renderMode;
+	int _renderMode = 0;
 	// Shaders for IBL computing
 	Shader _equirectangularToCubemapShader;
 	Shader _prefilterShader;
@@ -116,19 +325,239 @@ private:
 	bool _showBackground = true;
 	float _envIntensity = 1.0f;
 
+	// Performance display modes
+	Shader _perfShader;
+	Shader _overdrawShader;
+	// Additive fragment count target of the overdraw mode, allocated on first use
+	FramebufferHandle _overdrawFramebuffer;
+	TextureHandle _overdrawTexture;
+	RenderbufferHandle _overdrawDepth;
+	int _overdrawWidth = 0, _overdrawHeight = 0;
+
+	// Per-mesh queries of one frame, read back MESH_QUERY_LATENCY frames later
+	struct MeshQueries {
+		std::vector<GLuint> time;      // GL_TIME_ELAPSED query per draw
+		std::vector<GLuint> samples;   // GL_SAMPLES_PASSED query per draw
+		std::vector<int> meshes;       // Mesh drawn, per query
+	};
+	static constexpr int MESH_QUERY_LATENCY = 3;
+	std::array<MeshQueries, MESH_QUERY_LATENCY> _meshQueries;
+	int _meshQueryFrame = 0;
+	// Queries of the frame being rendered, null when draws are not measured
+	MeshQueries* _measuredDraws = nullptr;
+	std::vector<MeshCost> _meshCosts;
+
+	// Mesh and texture contents streamed to the GPU over several frames
+	UploadQueue _uploads;
+	// Uniform blocks of the frame being rendered and of its draws, see FrameUniforms and DrawUniforms in renderer.cpp
+	DynamicBufferRing _frameData;
+	size_t _drawUniformsStride = 0;   // Bytes between the blocks of two draws, the uniform buffer offset alignment
+
+	// Statistics of the last rendered frame, and of the frame being rendered
+	RenderStats _stats, _frameStats;
+	size_t _meshBytes = 0;
+	std::unordered_map<GLuint, size_t> _textureBytes; // Resident bytes of each material texture
+
+	/**
+	 * Block-compressed material texture whose finest levels are uploaded on demand, see setTextureStreaming().
+	 */
+	struct StreamedTexture {
+		CompressedTexture source;           // Whole mip chain, kept in RAM
+		TextureType type;
+		const Material* material;
+		size_t materialSlot = 0;            // Index of the material in _materialPixelsPerUv
+		TextureHandle* destination;         // Texture of the material, replaced when an upload completes
+		int coarsestLevel = 0;              // First level uploaded at load, always resident
+		int residentLevel = 0;              // First level of the destination
+		int wantedLevel = 0;                // First level the meshes of the material show, updated each frame
+		int pendingLevel = -1;              // First level of the texture being uploaded, -1 when none
+		GLuint residentId = 0, pendingId = 0;
+	};
+	std::vector<StreamedTexture> _streamedTextures;
+	std::unordered_map<const Material*, size_t> _streamedMaterialSlots; // Slot of each material with streamed textures, set at load
+	std::vector<float> _materialPixelsPerUv; // Finest screen density of each slot this frame, 0 when not visible
+	bool _textureStreaming = true;
+	int _streamingMinSize = 256;
+	size_t _streamingBudget = 0;
+
+	/**
+	 * Material textures of one type, size and format, packed as the layers of a 2D array texture.
+	 */
+	struct MaterialTextureArray {
+		TextureType type;
+		GLenum internalFormat;
+		int width, height, levels;
+		int layers = 0;
+		TextureHandle texture;              // Set once every layer is uploaded
+	};
+	/**
+	 * Material texture kept until the textures of its model are packed, see packMaterialTextures().
+	 */
+	struct ArrayTextureSource {
+		Material* material;
+		TextureType type;
+		GLenum internalFormat;
+		GLenum format;                      // Pixel format of an uncompressed image
+		int width, height, channels, levels;
+		std::shared_ptr<const CompressedTexture> compressed; // Mip chain of a compressed texture, null otherwise
+		std::shared_ptr<const unsigned char> pixels;        // Image of an uncompressed texture
+		int array = -1, layer = -1;         // Where it is packed
+	};
+	/**
+	 * Maps of a packed material in the texture arrays, -1 for the maps it does not have.
+	 */
+	struct MaterialLayers {
+		const Material* material;
+		int arrays[3] = { -1, -1, -1 };     // Index in _materialArrays of the diffuse, normal and metalness-roughness maps
+		int layers[3] = { -1, -1, -1 };
+	};
+	bool _materialArraysEnabled = false;
+	std::vector<ArrayTextureSource> _arrayTextureSources;
+	std::vector<MaterialTextureArray> _materialArrays;      // Reserved once, the uploads write into its elements
+	std::vector<MaterialLayers> _materialLayers;            // Indexed by the material index of the draws
+	std::unordered_map<const Material*, int> _materialIndices;
+	BufferHandle _materialBuffer;                           // MaterialUniforms block of the packed materials
+	std::vector<uint8_t> _materialBlocks;                   // Staging of the buffer, kept so that writes do not allocate
+	bool _materialUniformsDirty = false;
+
+	// Transient data of the frame being rendered, released at the start of the next one
+	FrameArena _frameArena;
+
 	/**
 	 * Render a set of meshes
 	 * @param meshes the vector of meshes
 	 * @param meshIndices indices of meshes to render from the meshes vector
 	 */
-	void renderMeshes(const std::vector<Mesh>& meshes, const std::vector<int>& meshIndices);
+	void renderMeshes(const std::vector<Mesh>& meshes, const FrameVector<int>& meshIndices);
 
 	/**
-	 * Sort transparent mesh indices to render from back to front according to camera position
-	 * @param meshes the vector of meshes to render
-	 * @param transparentMeshIndices the indices of transparent meshes
+	 * Allocates a block-compressed texture and queues the upload of its levels, the coarse ones
+	 * only if it is streamed.
+	 * @param tbe The event, with its compressed mip chain.
+	 */
+	void loadCompressedTexture(const TextureBindingEvent& tbe);
+
+	/**
+	 * Allocates a texture for the levels of a compressed mip chain from the given one down and
+	 * queues their upload.
+	 * @param compressed The mip chain.
+	 * @param type Type of the texture, metalness-roughness channels are swizzled.
+	 * @param firstLevel Level of the chain that becomes the first level of the texture.
+	 * @param destination Receives the texture once its levels are uploaded.
+	 * @return The id of the allocated texture.
+	 */
+	GLuint uploadCompressedLevels(const CompressedTexture& compressed, TextureType type, int firstLevel, TextureHandle* destination);
+
+	/**
+	 * Picks the levels of the streamed textures from the screen density of the meshes using them
+	 * and the budget, then queues the uploads of those that change.
+	 * @param meshes The meshes of the scene.
+	 * @param camera The camera of the frame.
+	 */
+	void streamTextures(const std::vector<Mesh>& meshes, const Camera& camera);
+
+	/**
+	 * Records the streamed textures whose upload completed.
+	 */
+	void updateStreamedTextures();
+
+	/**
+	 * Cancels the queued uploads, the streamed textures keep their resident levels.
+	 */
+	void cancelUploads();
+
+	/**
+	 * Allocates the texture of a material map and queues its upload.
+	 * @param tbe The event, with the decoded image or the compressed mip chain.
+	 */
+	void uploadMaterialTexture(const TextureBindingEvent& tbe);
+
+	/**
+	 * Keeps a copy of a material texture to pack it with the others of its model.
+	 * @param tbe The event, with the decoded image or the compressed mip chain.
+	 */
+	void addArrayTextureSource(const TextureBindingEvent& tbe);
+
+	/**
+	 * Registers the materials of the meshes for the material uniform buffer, allocates the texture
+	 * arrays of the kept material textures and queues the uploads of their layers. Falls back to
+	 * a texture per map when the shader cannot index that many materials or arrays.
+	 * @param meshes The meshes of the model.
+	 */
+	void packMaterialTextures(const std::vector<Mesh>& meshes);
+
+	/**
+	 * Writes the MaterialUniforms blocks of the packed materials, neutral values standing in for
+	 * the maps whose array is still uploading.
+	 */
+	void writeMaterialUniforms();
+
+	/**
+	 * @return The index of a packed material in the material uniform buffer, -1 if it is not packed.
+	 */
+	int getMaterialIndex(const Material* material) const;
+
+	/**
+	 * @return The texture of the event's material the event's texture is uploaded to.
+	 */
+	static TextureHandle* textureDestination(const TextureBindingEvent& tbe);
+
+	/**
+	 * Writes the per-frame uniform block and binds it for the frame's passes.
+	 * @param camera The Camera providing the view and projection matrices.
+	 * @param draws Draws of the frame, to reserve their blocks in the dynamic buffer ring.
+	 */
+	void writeFrameUniforms(const Camera& camera, size_t draws);
+
+	/**
+	 * Writes the per-draw uniform blocks of a pass in one range of the dynamic buffer ring.
+	 * @param meshes the vector of meshes
+	 * @param meshIndices indices of the meshes drawn, one block each in this order
+	 * @param offset Receives the offset of the first block, the others follow every _drawUniformsStride bytes.
+	 * @return false if the blocks could not be written, the pass is then skipped.
+	 */
+	bool writeDrawUniforms(const std::vector<Mesh>& meshes, const FrameVector<int>& meshIndices, GLintptr& offset);
+
+	/**
+	 * Frustum culling, counted in the frame statistics.
+	 * @param meshes the vector of meshes
+	 * @param meshIndices indices of meshes to test
+	 * @param viewProjection projection * view matrix of the camera
+	 * @return the indices of the meshes that intersect the view frustum, in the same order, in the frame arena
+	 */
+	FrameVector<int> cullMeshes(const std::vector<Mesh>& meshes, const std::vector<int>& meshIndices, const glm::mat4& viewProjection);
+
+	/**
+	 * Completes the statistics of the frame being rendered and starts the next one.
+	 */
+	void endFrameStats();
+
+	/**
+	 * Renders the overdraw, triangle density or mesh cost view of the scene.
+	 * @param meshes the vector of meshes
+	 * @param opaqueMeshesIndices indices of the opaque meshes
+	 * @param transparentMeshesIndices indices of the transparent meshes, sorted back to front
+	 * @param camera The Camera providing the view and projection matrices.
+	 */
+	void renderPerformanceView(const std::vector<Mesh>& meshes, const FrameVector<int>& opaqueMeshesIndices, const FrameVector<int>& transparentMeshesIndices, const Camera& camera);
+
+	/**
+	 * Draws meshes with the performance shader, colored by mesh cost in the mesh cost mode.
+	 * @param meshes the vector of meshes
+	 * @param meshIndices indices of meshes to render from the meshes vector
+	 */
+	void renderPerformanceMeshes(const std::vector<Mesh>& meshes, const FrameVector<int>& meshIndices);
+
+	/**
+	 * Reads back the oldest per-mesh queries and starts measuring the draws of this frame.
+	 * @param meshes the vector of meshes
+	 */
+	void beginMeshQueries(const std::vector<Mesh>& meshes);
+
+	/**
+	 * (Re)allocates the overdraw target to the viewport size.
 	 */
-	std::vector<int> getSortedTransparentMeshIndices(const std::vector<Mesh>& meshes, const std::vector<int>& transparentMeshIndices, const glm::vec3& cameraPosition);
+	void resizeOverdrawTarget();
 
 	/**
 	 * Generates a cube mesh for the skybox and generating IBL maps
@@ -151,25 +580,59 @@ private:
 	void renderQuad();
 
 	/**
-	 * Flips an EXR image vertically to correct orientation.
-	 * @param pixels A vector of Imf::Rgba representing the image pixels.
-	 * @param width  The width of the image.
-	 * @param height The height of the image.
+	 * Generates the 2D LUT from the BRDF equations used, shared by all environments.
+	 */
+	void bakeBrdfLut();
+
+	/**
+	 * Uploads the decoded image, allocates the environment maps and plans the bake steps.
+	 * @param load The environment load whose decode has completed.
+	 * @param image The decoded equirectangular image.
+	 */
+	void beginEnvironmentBake(EnvironmentLoad& load, const HdrImage& image);
+
+	/**
+	 * Uploads maps baked offline, the environment needs no bake steps.
+	 * @param load The environment load whose decode has completed.
+	 * @param baked The maps read from the .ibl file.
+	 */
+	void uploadBakedEnvironment(EnvironmentLoad& load, const BakedEnvironment& baked);
+
+	/**
+	 * Renders one tile of one face of one of the environment maps.
+	 * @param load The environment being baked.
+	 * @param step The tile to render.
+	 */
+	void runBakeStep(EnvironmentLoad& load, const BakeStep& step);
+
+	/**
+	 * Releases the bake resources and makes the baked environment active.
+	 */
+	void finishEnvironmentBake();
+
+	/**
+	 * Abandons the environment being loaded and releases its partially baked maps.
+	 */
+	void cancelEnvironmentLoad();
+
+	/**
+	 * Releases least recently used environments until the cache fits in its budget and the
+	 * GPU resources fit the VRAM budget of the GpuResourceManager.
 	 */
-	void flipImageVertically(std::vector<Imf::Rgba>& pixels, int width, int height);
+	void evictEnvironments();
 
 	/**
-	 * Loads an EXR image and returns the OpenGL texture ID.
-	 * @param filename The file path to the EXR image.
-	 * @return The GLuint ID of the loaded texture.
+	 * Uploads a decoded equirectangular environment image as a half-float texture.
+	 * @param image The decoded image, stored top row first.
+	 * @return The created texture.
 	 */
-	GLuint loadExrImage(const std::string& filename);
+	TextureHandle uploadEquirectTexture(const HdrImage& image);
 
 	/**
-	 * Loads a HDR image and returns the OpenGL texture ID.
-	 * @param filename The file path to the HDR image.
-	 * @return The GLuint ID of the loaded texture.
+	 * Uploads a half-float cubemap with all its stored mip levels.
+	 * @param image The cubemap to upload.
+	 * @return The created texture.
 	 */
-	GLuint loadImage(const std::string& filepath);
+	TextureHandle uploadCubemap(const CubemapImage& image);
 };
 
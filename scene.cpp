@@ -1,6 +1,14 @@
 #include "scene.h"
+#include "profiler.h"
+#include "ktx2File.h"
+#include "stressScene.h"
+#include "textureCache.h"
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <iostream>
+#include <unordered_map>
 #include <fstream>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
@@ -12,30 +20,111 @@ void Scene::init(EventBus* eventBus, float ratio) {
     camera.init(ratio);
 }
 
-void Scene::loadGlb(std::string filepath) {
-    // free gpu meshes and textures data
-    _eventBus->publish(Event(EventType::ClearGpuMeshesAndTextures));
-    _meshes.clear();
-    _opaqueMeshes.clear();
-    _transparentMeshes.clear();
-    _materials.clear();
+bool Scene::loadGlb(std::string filepath) {
+    PROFILE_GPU_SCOPE("loadGlb");
+
+    clear();
+
+    // read the whole file first, so that disk time is told apart from parsing
+    std::vector<char> fileData;
+    {
+        PROFILE_SCOPE("read file");
+        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            std::cerr << "Error loading GLB model: cannot open " << filepath << std::endl;
+            return false;
+        }
+        fileData.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read(fileData.data(), fileData.size());
+    }
 
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(filepath, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+    const aiScene* scene = nullptr;
+    {
+        PROFILE_SCOPE("import");
+        scene = importer.ReadFileFromMemory(fileData.data(), fileData.size(), aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace, "glb");
+    }
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cerr << "Error loading GLB model: " << importer.GetErrorString() << std::endl;
-        exit(EXIT_FAILURE);
+        return false;
+    }
+    loadScene(scene);
+    return true;
+}
+
+bool Scene::loadStressScene(const std::string& spec) {
+    PROFILE_GPU_SCOPE("loadStressScene");
+
+    StressSceneSettings settings;
+    if (!StressScene::parseSettings(spec, settings)) {
+        return false;
+    }
+    clear();
+
+    aiScene* scene = nullptr;
+    {
+        PROFILE_SCOPE("generate");
+        scene = StressScene::createAssimpScene(StressScene::generate(settings));
     }
+    loadScene(scene);
+    delete scene;
+    return true;
+}
 
-    _materials = processMaterials(scene);
+/**
+ * Counts the meshes, vertices and indices the nodes will create, a mesh once per node referencing it.
+ */
+static void countGeometry(const aiNode* node, const aiScene* scene, size_t& meshCount, size_t& vertexCount, size_t& indexCount) {
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        const aiMesh* assimpMesh = scene->mMeshes[node->mMeshes[i]];
+        ++meshCount;
+        vertexCount += assimpMesh->mNumVertices;
+        indexCount += (size_t)assimpMesh->mNumFaces * 3;
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        countGeometry(node->mChildren[i], scene, meshCount, vertexCount, indexCount);
+    }
+}
+
+/**
+ * Texture coordinate units per world unit of a mesh, the square root of its UV area over its world area.
+ */
+static float uvDensity(const Mesh& mesh) {
+    double worldArea = 0.0, uvArea = 0.0;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const Vertex& a = mesh.vertices[mesh.indices[i]];
+        const Vertex& b = mesh.vertices[mesh.indices[i + 1]];
+        const Vertex& c = mesh.vertices[mesh.indices[i + 2]];
+        worldArea += glm::length(glm::cross(b.position - a.position, c.position - a.position));
+        glm::vec2 u = b.uv - a.uv, v = c.uv - a.uv;
+        uvArea += std::abs(u.x * v.y - u.y * v.x);
+    }
+    return worldArea > 0.0 ? (float)std::sqrt(uvArea / worldArea) : 0.0f;
+}
+
+void Scene::loadScene(const aiScene* scene) {
+    {
+        PROFILE_GPU_SCOPE("materials");
+        _materials = processMaterials(scene);
+    }
+
+    // exact sizes, the meshes are then built in place
+    size_t meshCount = 0, vertexCount = 0, indexCount = 0;
+    countGeometry(scene->mRootNode, scene, meshCount, vertexCount, indexCount);
+    _meshes.reserve(meshCount);
+    _geometry.allocate(vertexCount, indexCount);
 
     // min and max for bounding box processing
     glm::vec3 min(std::numeric_limits<float>::max());
     glm::vec3 max(std::numeric_limits<float>::lowest());
 
     // Process nodes and meshes recursively
-    processNode(scene->mRootNode, scene, glm::mat4(1.0f), min, max);
+    {
+        PROFILE_SCOPE("nodes");
+        processNode(scene->mRootNode, scene, glm::mat4(1.0f), min, max);
+    }
 
     // Center object bounding box on world origin
     glm::vec3 center = (min + max) * 0.5f;
@@ -45,7 +134,30 @@ void Scene::loadGlb(std::string filepath) {
     }
 
     // load meshes to gpu
-    _eventBus->publish(Event(EventType::LoadGpuMeshes));
+    {
+        PROFILE_GPU_SCOPE("upload meshes");
+        _eventBus->publish(Event(EventType::LoadGpuMeshes));
+    }
+}
+
+void Scene::applyGeometryResidency() {
+    // the buffers are filled, the CPU copy is only needed to upload them again;
+    // switching a compressed geometry back to keep restores it
+    PROFILE_SCOPE("geometry residency");
+    _geometry.setResidency(_geometryResidency, _meshes);
+}
+
+void Scene::clear() {
+    // free gpu meshes and textures data
+    {
+        PROFILE_GPU_SCOPE("clear GPU data");
+        _eventBus->publish(Event(EventType::ClearGpuMeshesAndTextures));
+    }
+    _meshes.clear();
+    _opaqueMeshes.clear();
+    _transparentMeshes.clear();
+    _materials.clear();
+    _geometry.release();
 }
 
 void Scene::processNode(aiNode* node, const aiScene* scene, glm::mat4 parentTransform, glm::vec3& min, glm::vec3& max) {
@@ -56,45 +168,41 @@ void Scene::processNode(aiNode* node, const aiScene* scene, glm::mat4 parentTran
     // Process each mesh in this node
     for (unsigned int i = 0; i < node->mNumMeshes; i++) {
         aiMesh* assimpMesh = scene->mMeshes[node->mMeshes[i]];
-        Mesh mesh;
+        Mesh& mesh = _meshes.emplace_back();
         mesh.name = assimpMesh->mName.C_Str();
 
-        // vertices
-        for (unsigned int j = 0; j < assimpMesh->mNumVertices; ++j) {
-            aiVector3D position = assimpMesh->mVertices[j];
-            aiVector3D normal = assimpMesh->mNormals[j];
-            aiVector3D tangent = assimpMesh->mTangents[j];
-            aiVector3D uv = assimpMesh->mTextureCoords[0][j];
-
-            Vertex vertex;
-            vertex.position = glm::vec3(globalTransform * glm::vec4(position.x, position.y, position.z, 1.0f));
-            vertex.normal = glm::vec3(globalTransform * glm::vec4(normal.x, normal.y, normal.z, 0.0f));
-            vertex.uv = glm::vec2(uv.x, uv.y);
-            vertex.tangent = glm::vec3(globalTransform * glm::vec4(tangent.x, tangent.y, tangent.z, 0.0f));
-            mesh.vertices.push_back(vertex);
-
-            min.x = std::min(min.x, vertex.position.x);
-            min.y = std::min(min.y, vertex.position.y);
-            min.z = std::min(min.z, vertex.position.z);
-            max.x = std::max(max.x, vertex.position.x);
-            max.y = std::max(max.y, vertex.position.y);
-            max.z = std::max(max.z, vertex.position.z);
-        }
+        // vertices, transformed to world space with their bounding box
+        mesh.vertices = _geometry.takeVertices(assimpMesh->mNumVertices);
+        mesh.vertexCount = mesh.vertices.size();
+        VertexTransform::transform(&assimpMesh->mVertices[0].x,
+            assimpMesh->mNormals ? &assimpMesh->mNormals[0].x : nullptr,
+            assimpMesh->mTangents ? &assimpMesh->mTangents[0].x : nullptr,
+            assimpMesh->mTextureCoords[0] ? &assimpMesh->mTextureCoords[0][0].x : nullptr,
+            assimpMesh->mNumVertices, globalTransform, mesh.vertices.data(), mesh.boundsMin, mesh.boundsMax);
+        min.x = std::min(min.x, mesh.boundsMin.x);
+        min.y = std::min(min.y, mesh.boundsMin.y);
+        min.z = std::min(min.z, mesh.boundsMin.z);
+        max.x = std::max(max.x, mesh.boundsMax.x);
+        max.y = std::max(max.y, mesh.boundsMax.y);
+        max.z = std::max(max.z, mesh.boundsMax.z);
 
         // faces
+        mesh.indices = _geometry.takeIndices((size_t)assimpMesh->mNumFaces * 3);
+        mesh.indexCount = mesh.indices.size();
+        GLuint* indices = mesh.indices.data();
         for (unsigned int j = 0; j < assimpMesh->mNumFaces; ++j) {
-            aiFace face = assimpMesh->mFaces[j];
-            mesh.indices.push_back(face.mIndices[0]);
-            mesh.indices.push_back(face.mIndices[1]);
-            mesh.indices.push_back(face.mIndices[2]);
+            const aiFace& face = assimpMesh->mFaces[j];
+            indices[j * 3] = face.mIndices[0];
+            indices[j * 3 + 1] = face.mIndices[1];
+            indices[j * 3 + 2] = face.mIndices[2];
         }
+        // vertices are in world space, the scene centering only translates them
+        mesh.uvDensity = uvDensity(mesh);
 
-        mesh.material = _materials[assimpMesh->mMaterialIndex];
+        mesh.material = &_materials[assimpMesh->mMaterialIndex];
         mesh.transform = globalTransform;
 
-        _meshes.push_back(mesh);
-
-        if (mesh.material.diffuseColor.a < 1) {
+        if (mesh.material->diffuseColor.a < 1) {
             _transparentMeshes.push_back(_meshes.size() - 1);
         }
         else {
@@ -109,37 +217,98 @@ void Scene::processNode(aiNode* node, const aiScene* scene, glm::mat4 parentTran
 }
 
 std::vector<Material> Scene::processMaterials(const aiScene* scene) {
-    std::vector<Material> sceneMaterials;
-
+    // built in place, the texture uploads write their ids into the final materials
+    std::vector<Material> sceneMaterials(scene->mNumMaterials);
+
+    // each embedded texture is decoded once per type, whatever the number of materials using it
+    const aiTextureType assimpTypes[3] = { aiTextureType_DIFFUSE, aiTextureType_NORMALS, aiTextureType_METALNESS };
+    const TextureType textureTypes[3] = { TextureType::Diffuse, TextureType::Normal, TextureType::MetalnessRoughness };
+    std::vector<TextureLoad> loads;
+    std::unordered_map<const aiTexture*, size_t> loadIndices[3];
+    std::vector<std::array<int, 3>> materialLoads(scene->mNumMaterials, { -1, -1, -1 });
     for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
         aiMaterial* mat = scene->mMaterials[i];
+        sceneMaterials[i].name = mat->GetName().C_Str();
+        for (int t = 0; t < 3; ++t) {
+            const aiTexture* texture = findEmbeddedTexture(scene, mat, assimpTypes[t]);
+            if (!texture) {
+                continue;
+            }
+            auto found = loadIndices[t].find(texture);
+            if (found == loadIndices[t].end()) {
+                found = loadIndices[t].emplace(texture, loads.size()).first;
+                loads.emplace_back();
+                loads.back().source = texture;
+                loads.back().type = textureTypes[t];
+            }
+            loads[found->second].materials.push_back(&sceneMaterials[i]);
+            materialLoads[i][t] = (int)found->second;
+        }
+    }
+
+    // the events share the images, freed once the last one has been handled
+    stbi_set_flip_vertically_on_load(false);
+    auto publish = [&](TextureLoad& load) {
+        std::shared_ptr<const CompressedTexture> compressed;
+        if (load.isCompressed) {
+            compressed = std::make_shared<CompressedTexture>(std::move(load.compressed));
+        }
+        for (Material* material : load.materials) {
+            TextureBindingEvent event(material, load.type, load.pixels, load.channels, load.width, load.height);
+            event.compressed = compressed;
+            _eventBus->publish(Event(EventType::LoadTextureRenderData, std::move(event)));
+        }
+        load.pixels.reset();
+    };
+    if (_compressTextures && loads.size() > 1) {
+        // encoding dominates, the textures are compressed in parallel then published in order
+        if (!_texturePool) {
+            _texturePool = std::make_unique<ThreadPool>();
+        }
+        _texturePool->parallelFor((int)loads.size(), [&](int i) { prepareTexture(loads[i]); });
+        for (TextureLoad& load : loads) {
+            publish(load);
+        }
+    }
+    else {
+        // one decoded image at a time
+        for (TextureLoad& load : loads) {
+            prepareTexture(load);
+            publish(load);
+        }
+    }
 
-        Material material;
-        material.name = mat->GetName().C_Str();
-        
-        processTexture(scene, mat, aiTextureType_DIFFUSE, TextureType::Diffuse, material);
-        processTexture(scene, mat, aiTextureType_NORMALS, TextureType::Normal, material);
-        processTexture(scene, mat, aiTextureType_METALNESS, TextureType::MetalnessRoughness, material);
+    // the factors only apply to untextured materials
+    for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
+        aiMaterial* mat = scene->mMaterials[i];
+        Material& material = sceneMaterials[i];
+        auto textured = [&](int t) { return materialLoads[i][t] >= 0 && loads[materialLoads[i][t]].width > 0; };
+        bool diffuseTexture = textured(0);
+        bool metalnessRoughnessTexture = textured(2);
 
         aiColor4D color;
         float value = 1.0f;
-        if (material.diffuse == 0 && mat->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS) {
+        if (!diffuseTexture && mat->Get(AI_MATKEY_COLOR_DIFFUSE, color) == AI_SUCCESS) {
             material.diffuseColor = glm::vec4(color.r, color.g, color.b, color.a);
         }
-        if (material.metalnessRoughness == 0 && mat->Get(AI_MATKEY_METALLIC_FACTOR, value) == AI_SUCCESS) {
+        if (!metalnessRoughnessTexture && mat->Get(AI_MATKEY_METALLIC_FACTOR, value) == AI_SUCCESS) {
             material.metalnessFactor = value;
         }
-        if (material.metalnessRoughness == 0 && mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, value) == AI_SUCCESS) {
+        if (!metalnessRoughnessTexture && mat->Get(AI_MATKEY_ROUGHNESS_FACTOR, value) == AI_SUCCESS) {
             material.roughnessFactor = value;
         }
-
-        sceneMaterials.push_back(material);
     }
 
     return sceneMaterials;
 }
 
-void Scene::processTexture(const aiScene* scene, aiMaterial* mat, aiTextureType type, TextureType textureType, Material& material) {
+void Scene::setTextureCompression(bool enabled, bool bc7, const std::string& cacheFolder) {
+    _compressTextures = enabled;
+    _bc7 = bc7;
+    _textureCacheFolder = cacheFolder;
+}
+
+const aiTexture* Scene::findEmbeddedTexture(const aiScene* scene, aiMaterial* mat, aiTextureType type) {
     if (mat->GetTextureCount(type) > 0) {
         aiString texturePath;
         mat->GetTexture(type, 0, &texturePath);
@@ -150,44 +319,164 @@ void Scene::processTexture(const aiScene* scene, aiMaterial* mat, aiTextureType
             int textureIndex = atoi(texturePath.C_Str() + 1);
             if (textureIndex >= 0 && textureIndex < scene->mNumTextures) {
                 // Get the embedded texture
-                const aiTexture* texture = scene->mTextures[textureIndex];
-
-                // Access texture data
-                if (texture->mHeight == 0) {
-                    // Uncompressed texture in memory, e.g., PNG or JPG
-
-                    int width, height, channels;
-                    unsigned char* imageData = nullptr;
-
-                    // If the texture is compressed (e.g., PNG, JPG)
-                    if (texture->mHeight == 0) {
-                        // stb_image expects raw image data in memory to decode
-                        stbi_set_flip_vertically_on_load(false);
-                        imageData = stbi_load_from_memory(reinterpret_cast<stbi_uc*>(texture->pcData), texture->mWidth, &width, &height, &channels, 0);
-                        if (!imageData) {
-                            std::cerr << "Failed to load texture: " << stbi_failure_reason() << std::endl;
-                        }
-                    }
-                    else {
-                        // RAW texture data (uncompressed)
-                        std::cerr << "Unsupported RAW texture format." << std::endl;
-                    }
-
-                    if (imageData) {
-                        // load gpu texture
-                        _eventBus->publish(Event(EventType::LoadTextureRenderData,
-                            TextureBindingEvent(&material, textureType, imageData, channels, width, height)));
-
-                        // After use, don't forget to free the image data
-                        stbi_image_free(imageData);
-                    }
-                }
-                else {
-                    // RAW format (e.g., uncompressed pixel data)
-                    std::cout << "RAW texture data found. Not implemented yet" << std::endl;
-                    exit(-1);
-                }
+                // Image file in memory (PNG, JPG, KTX2), or RAW texels if mHeight is not 0
+                return scene->mTextures[textureIndex];
             }
         }
     }
+    return nullptr;
+}
+
+/**
+ * Picks the block format of a texture type: BC7 for albedo, BC5 for normals (x and y), BC5 for
+ * metalness-roughness, or BC4 when metalness is all zero.
+ * @param rgba Pixels of the first level, 4 bytes each.
+ * @param firstChannel Receives the first channel encoded.
+ */
+static TextureCodec textureCodec(TextureType type, const uint8_t* rgba, int width, int height, int& firstChannel) {
+    firstChannel = 0;
+    if (type == TextureType::Normal) {
+        return TextureCodec::BC5;
+    }
+    if (type != TextureType::MetalnessRoughness) {
+        return TextureCodec::BC7;
+    }
+    // roughness in green, metalness in blue: a single channel for non-metals
+    firstChannel = 1;
+    for (size_t i = 2; i < (size_t)width * height * 4; i += 4) {
+        if (rgba[i] != 0) {
+            return TextureCodec::BC5;
+        }
+    }
+    return TextureCodec::BC4;
+}
+
+/**
+ * Converts normals stored as (RGB=X, A=Y), the layout of toktx --normal_mode, to (X, Y, Z) in RGB.
+ * @param rgba Pixels of every level, 4 bytes each.
+ * @return false if the pixels are not in that layout: their red, green and blue differ.
+ */
+static bool unpackNormalMode(std::vector<uint8_t>& rgba) {
+    // lossy encodings keep gray texels close to gray
+    const int tolerance = 8;
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        if (std::abs(rgba[i] - rgba[i + 1]) > tolerance || std::abs(rgba[i] - rgba[i + 2]) > tolerance) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < rgba.size(); i += 4) {
+        float x = rgba[i] / 127.5f - 1.0f, y = rgba[i + 3] / 127.5f - 1.0f;
+        float z = std::sqrt(std::max(0.0f, 1.0f - x * x - y * y));
+        rgba[i + 1] = rgba[i + 3];
+        rgba[i + 2] = (uint8_t)std::lround((z + 1.0f) * 127.5f);
+        rgba[i + 3] = 255;
+    }
+    return true;
+}
+
+void Scene::prepareTexture(TextureLoad& load) {
+    // BC7 must be supported for the diffuse textures, BC4 and BC5 are core
+    bool compress = _compressTextures && (load.type != TextureType::Diffuse || _bc7);
+    const aiTexture* texture = load.source;
+    // an encoded file (mHeight 0, mWidth in bytes) or raw BGRA texels
+    size_t sourceBytes = texture->mHeight == 0 ? texture->mWidth : (size_t)texture->mWidth * texture->mHeight * sizeof(aiTexel);
+
+    if (texture->mHeight == 0 && Ktx2File::isKtx2(texture->pcData, sourceBytes)) {
+        // block-compressed files are uploaded with their own levels, the others are read as a decoded image.
+        // Basis Universal albedo is transcoded to BC7; the other maps to RGBA8 and encoded below with
+        // the levels of the file, the transcoder's BC4 and BC5 reading other channels than the viewer's
+        PROFILE_SCOPE("read KTX2 texture");
+        Ktx2Target target = load.type == TextureType::Diffuse && compress ? Ktx2Target::BC7 : Ktx2Target::RGBA8;
+        Ktx2Texture ktx2;
+        std::string error;
+        if (!Ktx2File::read(reinterpret_cast<const uint8_t*>(texture->pcData), sourceBytes, target, ktx2, error)) {
+            std::cerr << "Failed to load KTX2 texture: " << error << std::endl;
+            return;
+        }
+        if (ktx2.compressed && ktx2.blocks.codec == TextureCodec::BC7 && !_bc7) {
+            std::cerr << "Failed to load KTX2 texture: BC7 is not supported by the GPU" << std::endl;
+            return;
+        }
+        load.width = ktx2.width;
+        load.height = ktx2.height;
+        if (ktx2.compressed) {
+            load.compressed = std::move(ktx2.blocks);
+            load.isCompressed = true;
+            return;
+        }
+        if (load.type == TextureType::Normal && ktx2.alpha) {
+            unpackNormalMode(ktx2.pixels);
+        }
+        if (compress && ktx2.levels > 1) {
+            PROFILE_SCOPE("compress texture");
+            int firstChannel = 0;
+            TextureCodec codec = textureCodec(load.type, ktx2.pixels.data(), ktx2.width, ktx2.height, firstChannel);
+            load.compressed = TextureCompressor::compressLevels(ktx2.pixels.data(), ktx2.width, ktx2.height, ktx2.levels, codec, firstChannel);
+            load.isCompressed = true;
+            return;
+        }
+        auto pixels = std::make_shared<std::vector<unsigned char>>(std::move(ktx2.pixels));
+        load.pixels = std::shared_ptr<unsigned char>(pixels, pixels->data());
+        load.channels = 4;
+    }
+
+    std::string cachePath;
+    if (!load.pixels && compress && !_textureCacheFolder.empty()) {
+        PROFILE_SCOPE("read cached texture");
+        // the size of raw texels is not in their bytes, an encoded file's is
+        uint32_t width = texture->mHeight != 0 ? texture->mWidth : 0;
+        cachePath = TextureCache::path(_textureCacheFolder, TextureCache::key(texture->pcData, sourceBytes, width, texture->mHeight,
+            (uint32_t)load.type));
+        if (TextureCache::read(cachePath, load.compressed)) {
+            load.isCompressed = true;
+            load.width = load.compressed.mips[0].width;
+            load.height = load.compressed.mips[0].height;
+            return;
+        }
+    }
+
+    if (!load.pixels && texture->mHeight != 0) {
+        // RAW texture data, BGRA texels
+        load.width = (int)texture->mWidth;
+        load.height = (int)texture->mHeight;
+        load.channels = 4;
+        auto pixels = std::make_shared<std::vector<unsigned char>>(sourceBytes);
+        for (size_t i = 0; i < (size_t)load.width * load.height; ++i) {
+            const aiTexel& texel = texture->pcData[i];
+            unsigned char* pixel = &(*pixels)[i * 4];
+            pixel[0] = texel.r;
+            pixel[1] = texel.g;
+            pixel[2] = texel.b;
+            pixel[3] = texel.a;
+        }
+        load.pixels = std::shared_ptr<unsigned char>(pixels, pixels->data());
+    }
+    else if (!load.pixels) {
+        // stb_image expects raw image data in memory to decode, 4 channels for the encoders
+        PROFILE_SCOPE("decode texture");
+        load.pixels.reset(stbi_load_from_memory(reinterpret_cast<stbi_uc*>(texture->pcData), texture->mWidth, &load.width, &load.height,
+            &load.channels, compress ? 4 : 0), stbi_image_free);
+        if (!load.pixels) {
+            std::cerr << "Failed to load texture: " << stbi_failure_reason() << std::endl;
+            load.width = load.height = 0;
+            return;
+        }
+    }
+    if (!compress) {
+        return;
+    }
+
+    {
+        PROFILE_SCOPE("compress texture");
+        int firstChannel = 0;
+        TextureCodec codec = textureCodec(load.type, load.pixels.get(), load.width, load.height, firstChannel);
+        load.compressed = TextureCompressor::compress(load.pixels.get(), load.width, load.height, codec, firstChannel);
+        load.isCompressed = true;
+    }
+    load.pixels.reset();
+
+    if (!cachePath.empty()) {
+        PROFILE_SCOPE("write cached texture");
+        TextureCache::write(cachePath, load.compressed);
+    }
 }
@@ -3,10 +3,12 @@
 #include "shader.h"
 #include "mesh.h"
 #include "event.h"
+#include "threadPool.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <glad/glad.h>
+#include <memory>
 
 /**
  * The Scene class manages all objects, materials, and camera setup required for rendering a 3D scene.
@@ -23,9 +25,30 @@ public:
 
     /**
      * Loads a GLB model from the specified file path, processing its meshes and materials.
+     * The previous model is released first, the scene is left empty if the file cannot be loaded.
      * @param filepath Path to the GLB file to load.
+     * @return false if the file cannot be read or parsed.
      */
-    void loadGlb(std::string filepath);
+    bool loadGlb(std::string filepath);
+
+    /**
+     * Generates a procedural stress scene and loads it in place of the model.
+     * @param spec Stress scene settings, see StressSceneSettings.
+     * @return false if the settings cannot be parsed.
+     */
+    bool loadStressScene(const std::string& spec);
+
+    /**
+     * Releases the meshes and materials of the scene, on the CPU and the GPU.
+     */
+    void clear();
+
+    /**
+     * Builds the materials and meshes of an imported Assimp scene, centers it and uploads it.
+     * The scene must have been cleared first.
+     * @param scene The imported scene.
+     */
+    void loadScene(const aiScene* scene);
 
     /**
      * Provides access to the scene's meshes.
@@ -43,19 +66,67 @@ public:
      */
     std::vector<Material>& getMaterials() { return _materials; }
 
+    /**
+     * @return The arena holding the CPU geometry of the meshes.
+     */
+    const GeometryArena& getGeometry() const { return _geometry; }
+
+    /**
+     * Sets what the meshes keep in RAM once uploaded, for the next loaded scenes and for the
+     * loaded one at its next applyGeometryResidency().
+     * @param residency The residency policy, Keep by default.
+     */
+    void setGeometryResidency(GeometryResidency residency) { _geometryResidency = residency; }
+
+    /**
+     * Applies the residency policy to the geometry of the loaded scene, restoring a compressed
+     * geometry for Keep. The uploads read the geometry, call it once the renderer has uploaded the meshes.
+     */
+    void applyGeometryResidency();
+
+    /**
+     * Sets how the embedded textures of the next loaded models are uploaded. Compressed
+     * textures are encoded to BC7 (diffuse), BC5 (normal) and BC4 or BC5 (metalness-roughness)
+     * on worker threads, or read from the cache when an identical image was encoded before.
+     * @param enabled Compress the textures, on by default.
+     * @param bc7 BC7 is supported by the GPU, the diffuse textures stay uncompressed otherwise.
+     * @param cacheFolder Folder of the compressed textures cache, empty to encode every time.
+     */
+    void setTextureCompression(bool enabled, bool bc7, const std::string& cacheFolder);
+
     //The camera used for viewing the scene.
     Camera camera;
 
 private:
     /**
-     * Processes and attaches a texture to a material from a given Assimp material type.
+     * An embedded texture of a given type, decoded once for all the materials using it.
+     */
+    struct TextureLoad {
+        const aiTexture* source = nullptr;      // Encoded image embedded in the model
+        TextureType type = TextureType::Diffuse;
+        std::vector<Material*> materials;       // Materials using the texture as this type
+        std::shared_ptr<unsigned char> pixels;  // Decoded image, if not compressed, shared with the events
+        int width = 0, height = 0, channels = 0;
+        CompressedTexture compressed;           // Compressed mip chain, if isCompressed
+        bool isCompressed = false;
+    };
+
+    /**
+     * Finds the embedded texture a material uses for a given type.
      * @param scene Pointer to the Assimp scene structure containing the model data.
      * @param mat Pointer to the Assimp material to process.
      * @param type The Assimp texture type (e.g., diffuse, specular).
-     * @param textureType Custom type to categorize textures within the application.
-     * @param material Reference to the Material object where the texture will be stored.
+     * @return The texture, nullptr if the material has none or it is not embedded.
      */
-    void processTexture(const aiScene* scene, aiMaterial* mat, aiTextureType type, TextureType textureType, Material& material);
+    const aiTexture* findEmbeddedTexture(const aiScene* scene, aiMaterial* mat, aiTextureType type);
+
+    /**
+     * Decodes a texture, then compresses it if enabled, or reads it from the cache. KTX2 files
+     * of a block-compressed format are taken as is, with their levels; Basis Universal ones are
+     * transcoded for their texture type, with their levels. Thread-safe.
+     * @param load The texture, receives its pixels or its compressed mip chain.
+     */
+    void prepareTexture(TextureLoad& load);
 
     /**
      *
@@ -72,6 +143,12 @@ private:
     // All the meshes in the scene.
     std::vector<Mesh> _meshes;
 
+    // Vertices and indices of all the meshes
+    GeometryArena _geometry;
+
+    // Applied to the geometry by applyGeometryResidency()
+    GeometryResidency _geometryResidency = GeometryResidency::Keep;
+
     // Meshes using an opaque material
     std::vector<int> _opaqueMeshes;
 
@@ -83,4 +160,12 @@ private:
 
     // Pointer to the EventBus for managing and dispatching events within the scene.
     EventBus* _eventBus;
+
+    // Texture compression settings, see setTextureCompression()
+    bool _compressTextures = true;
+    bool _bc7 = false;
+    std::string _textureCacheFolder;
+
+    // Decodes and compresses the textures, created on the first compressed load
+    std::unique_ptr<ThreadPool> _texturePool;
 };
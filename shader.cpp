@@ -52,7 +52,7 @@ GLuint Shader::createShaderProgram(const std::string& vertexShaderSource, const
     return programObject;
 }
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath) {
     std::string vertexCode;
     std::string fragmentCode;
     std::string geometryCode;
@@ -77,6 +77,14 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         // convert stream into string
         vertexCode = vShaderStream.str();
         fragmentCode = fShaderStream.str();
+        // optional geometry shader
+        if (geometryPath) {
+            gShaderFile.open(geometryPath);
+            std::stringstream gShaderStream;
+            gShaderStream << gShaderFile.rdbuf();
+            gShaderFile.close();
+            geometryCode = gShaderStream.str();
+        }
     }
     catch (std::ifstream::failure& e)
     {
@@ -96,16 +104,31 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     glShaderSource(fragment, 1, &fShaderCode, NULL);
     glCompileShader(fragment);
     checkCompileErrors(fragment, fragmentPath, false);
+    // geometry shader
+    unsigned int geometry = 0;
+    if (geometryPath) {
+        const char* gShaderCode = geometryCode.c_str();
+        geometry = glCreateShader(GL_GEOMETRY_SHADER);
+        glShaderSource(geometry, 1, &gShaderCode, NULL);
+        glCompileShader(geometry);
+        checkCompileErrors(geometry, geometryPath, false);
+    }
     // shader Program
     id = glCreateProgram();
     glAttachShader(id, vertex);
     glAttachShader(id, fragment);
+    if (geometryPath) {
+        glAttachShader(id, geometry);
+    }
     glLinkProgram(id);
     std::string path = std::string("PROGRAM ") + std::string(vertexPath) + " " + std::string(fragmentPath);
     checkCompileErrors(id, path.c_str(), true);
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+    if (geometryPath) {
+        glDeleteShader(geometry);
+    }
 
 }
 
@@ -132,29 +155,43 @@ void Shader::checkCompileErrors(GLuint shader, const char* filename, bool progra
 }
 
 void Shader::use() {
+    ++useCount;
     glUseProgram(id);
 }
 
 void Shader::setInt(const char* name, int value) {
+    ++uniformUploadCount;
     glUniform1i(glGetUniformLocation(id, name), value);
 }
 
 void Shader::setFloat(const char* name, float value) {
+    ++uniformUploadCount;
     glUniform1f(glGetUniformLocation(id, name), value);
 }
 
 void Shader::setVec2(const char* name, glm::vec2 value) {
+    ++uniformUploadCount;
     glUniform2fv(glGetUniformLocation(id, name), 1, &value[0]);
 }
 
 void Shader::setVec3(const char* name, glm::vec3 value) {
+    ++uniformUploadCount;
     glUniform3fv(glGetUniformLocation(id, name), 1, &value[0]);
 }
 
 void Shader::setVec4(const char* name, glm::vec4 value) {
+    ++uniformUploadCount;
     glUniform4fv(glGetUniformLocation(id, name), 1, &value[0]);
 }
 
 void Shader::setMat4(const char* name, glm::mat4 value) {
+    ++uniformUploadCount;
     glUniformMatrix4fv(glGetUniformLocation(id, name), 1, GL_FALSE, &value[0][0]);
-}
\ No newline at end of file
+}
+
+void Shader::setUniformBlock(const char* name, GLuint binding) {
+    GLuint index = glGetUniformBlockIndex(id, name);
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(id, index, binding);
+    }
+}
@@ -16,6 +16,10 @@ public:
     // OpenGL ID for the shader program.
     GLuint id;
 
+    // use() and set*() calls of all shaders, reset by the renderer every frame for its statistics
+    static inline size_t useCount = 0;
+    static inline size_t uniformUploadCount = 0;
+
     /**
      * Default constructor.
      */
@@ -25,8 +29,9 @@ public:
      * Initializes and compiles the shader program from vertex and fragment shader file paths.
      * @param vertexPath Path to the vertex shader source file.
      * @param fragmentPath Path to the fragment shader source file.
+     * @param geometryPath Path to the geometry shader source file, nullptr for none.
      */
-    Shader(const char* vertexPath, const char* fragmentPath);
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
 
     /**
      * Activates the shader program for use in the current OpenGL context.
@@ -75,6 +80,14 @@ public:
      */
     void setMat4(const char* name, glm::mat4 value);
 
+    /**
+     * Assigns a uniform block of the shader program to a binding point, once after creation.
+     * Blocks the program does not use are ignored.
+     * @param name Name of the uniform block in the shader.
+     * @param binding Binding point the block's buffer range is bound to with glBindBufferRange.
+     */
+    void setUniformBlock(const char* name, GLuint binding);
+
 private:
     /**
      * Compiles an individual shader (vertex or fragment) from source.
@@ -1,8 +1,18 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 projection;
-uniform mat4 view;
+// Per-frame uniforms, written once per frame by the renderer (FrameUniforms in renderer.cpp)
+layout(std140) uniform FrameUniforms {
+    mat4 uProjection;
+    mat4 uView;
+    vec4 uViewPosition;     // xyz
+    vec4 uLightDirection;   // xyz
+    vec4 uLightColor;       // rgb
+    vec2 uViewportSize;
+    float uEnvIntensity;
+    int uRenderMode;
+    int uPerfMode;
+};
 
 out vec3 WorldPos;
 
@@ -12,8 +22,8 @@ void main()
 
     mat4 s = mat4(100);
 
-	mat4 rotView = mat4(mat3(view));
-	vec4 clipPos = projection * rotView * vec4(WorldPos, 1.0);
+	mat4 rotView = mat4(mat3(uView));
+	vec4 clipPos = uProjection * rotView * vec4(WorldPos, 1.0);
 
 	gl_Position = clipPos.xyww;
 }
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 TexCoords;
+
+// Fragments per pixel, accumulated by the overdraw pass
+uniform sampler2D uOverdraw;
+// Count shown in red
+uniform float uMaxOverdraw;
+
+// Blue (0) to red (1) color ramp
+vec3 heat(float t)
+{
+    t = clamp(t, 0.0, 1.0);
+    return clamp(vec3(1.5 - abs(4.0 * t - 3.0), 1.5 - abs(4.0 * t - 2.0), 1.5 - abs(4.0 * t - 1.0)), 0.0, 1.0);
+}
+
+void main()
+{
+    float count = texture(uOverdraw, TexCoords).r;
+    // black where nothing is drawn, blue for a single layer
+    FragColor = count < 0.5 ? vec4(0.0, 0.0, 0.0, 1.0) : vec4(heat((count - 1.0) / (uMaxOverdraw - 1.0)), 1.0);
+}
@@ -8,19 +8,47 @@ in mat3 TBN;
 // Output color
 out vec4 fragColor;
 
-// Uniforms for lighting and material
-uniform vec3 uLightDirection; // Change from position to direction
-uniform vec3 uLightColor;
-uniform vec3 uViewPosition;
-uniform float uEnvIntensity;
-uniform int uRenderMode;
-
-uniform vec4 uDiffuseColor;
-uniform float uMetalnessFactor;
-uniform float uRoughnessFactor;
-uniform int uUseNormalMap;
+// Per-frame uniforms, written once per frame by the renderer (FrameUniforms in renderer.cpp)
+layout(std140) uniform FrameUniforms {
+    mat4 uProjection;
+    mat4 uView;
+    vec4 uViewPosition;     // xyz
+    vec4 uLightDirection;   // xyz
+    vec4 uLightColor;       // rgb
+    vec2 uViewportSize;
+    float uEnvIntensity;
+    int uRenderMode;
+    int uPerfMode;
+};
+
+// Per-draw uniforms, written for every draw of a pass (DrawUniforms in renderer.cpp)
+layout(std140) uniform DrawUniforms {
+    mat4 uModel;
+    vec4 uDiffuseColor;
+    float uMetalnessFactor;
+    float uRoughnessFactor;
+    int uUseNormalMap;
+    float uCost;
+    int uMaterialIndex;     // Element of the MaterialUniforms block of pbr.fs, -1 if the material is not packed
+};
+
+// Parameters of the packed materials, their maps are layers of the texture arrays (MaterialUniforms in renderer.cpp)
+const int MAX_MATERIALS = 256;
+const int MAX_MATERIAL_ARRAYS = 8;
+struct Material {
+    vec4 diffuseColor;
+    float metalnessFactor;
+    float roughnessFactor;
+    int useNormalMap;
+    ivec4 arrays;           // Texture array of the diffuse, normal and metalness-roughness maps
+    ivec4 layers;           // Their layers
+};
+layout(std140) uniform MaterialUniforms {
+    Material uMaterials[MAX_MATERIALS];
+};
 
 // Textures
+uniform sampler2DArray uMaterialArrays[MAX_MATERIAL_ARRAYS];
 uniform sampler2D uAlbedoMap;
 uniform sampler2D uNormalMap;
 uniform sampler2D uMetalnessRoughnessMap;
@@ -76,26 +104,55 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }   
 // ----------------------------------------------------------------------------
+// Map of the draw's material, a texture of its own or a layer of a texture array; the material
+// index is the same for the whole draw, so the array index is dynamically uniform
+vec4 materialMap(sampler2D map, int index)
+{
+    if (uMaterialIndex < 0) {
+        return texture(map, fragTexCoords);
+    }
+    int array = uMaterials[uMaterialIndex].arrays[index];
+    return texture(uMaterialArrays[array], vec3(fragTexCoords, uMaterials[uMaterialIndex].layers[index]));
+}
+// ----------------------------------------------------------------------------
 void main()
 {       
-    vec3 normalMap = texture(uNormalMap, fragTexCoords).rgb;
-    vec3 N = normalize(TBN * (normalMap * 2.0 - 1.0));
-    vec3 V = normalize(uViewPosition - fragPosition);
-    if (uUseNormalMap == 0) N = TBN[2];
+    // parameters of the draw, or of its packed material
+    vec4 diffuseColor = uDiffuseColor;
+    float metalnessFactor = uMetalnessFactor;
+    float roughnessFactor = uRoughnessFactor;
+    int useNormalMap = uUseNormalMap;
+    if (uMaterialIndex >= 0) {
+        diffuseColor = uMaterials[uMaterialIndex].diffuseColor;
+        metalnessFactor = uMaterials[uMaterialIndex].metalnessFactor;
+        roughnessFactor = uMaterials[uMaterialIndex].roughnessFactor;
+        useNormalMap = uMaterials[uMaterialIndex].useNormalMap;
+    }
+
+    vec3 normalMap = materialMap(uNormalMap, 1).rgb;
+    vec3 tangentNormal = normalMap * 2.0 - 1.0;
+    // BC5 normal maps only store x and y (blue reads 0), z is rebuilt from the unit length
+    if (normalMap.b == 0.0) {
+        tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+        normalMap.b = tangentNormal.z * 0.5 + 0.5;
+    }
+    vec3 N = normalize(TBN * tangentNormal);
+    vec3 V = normalize(uViewPosition.xyz - fragPosition);
+    if (useNormalMap == 0) N = TBN[2];
     vec3 R = reflect(-V, N);
-    float alpha = uDiffuseColor.a;
+    float alpha = diffuseColor.a;
 
-    vec3 albedo = uDiffuseColor.rgb;
-    float metallic = uMetalnessFactor;
-    float roughness = uRoughnessFactor;
+    vec3 albedo = diffuseColor.rgb;
+    float metallic = metalnessFactor;
+    float roughness = roughnessFactor;
 
     // use maps if set
     if (albedo.r > 1) {
-        albedo = texture(uAlbedoMap, fragTexCoords).rgb;
+        albedo = materialMap(uAlbedoMap, 0).rgb;
         alpha = 1;
     }
-    if (metallic > 1) metallic = texture(uMetalnessRoughnessMap, fragTexCoords).b;
-    if (roughness > 1) roughness = texture(uMetalnessRoughnessMap, fragTexCoords).g;
+    if (metallic > 1) metallic = materialMap(uMetalnessRoughnessMap, 2).b;
+    if (roughness > 1) roughness = materialMap(uMetalnessRoughnessMap, 2).g;
     
 
     // calculate reflectance at normal incidence; if dia-electric (like plastic) use F0 
@@ -107,9 +164,9 @@ void main()
     vec3 Lo = vec3(0.0);
 
     // calculate per-light radiance
-    vec3 L = normalize(-uLightDirection);
+    vec3 L = normalize(-uLightDirection.xyz);
     vec3 H = normalize(V + L);
-    vec3 radiance = uLightColor;
+    vec3 radiance = uLightColor.rgb;
 
     // Cook-Torrance BRDF
     float NDF = DistributionGGX(N, H, roughness);   
@@ -11,10 +11,29 @@ out vec2 fragTexCoords;
 out vec3 fragPosition;
 out mat3 TBN;
 
-// Uniforms for transformation matrices
-uniform mat4 uModel;
-uniform mat4 uView;
-uniform mat4 uProjection;
+// Per-frame uniforms, written once per frame by the renderer (FrameUniforms in renderer.cpp)
+layout(std140) uniform FrameUniforms {
+    mat4 uProjection;
+    mat4 uView;
+    vec4 uViewPosition;     // xyz
+    vec4 uLightDirection;   // xyz
+    vec4 uLightColor;       // rgb
+    vec2 uViewportSize;
+    float uEnvIntensity;
+    int uRenderMode;
+    int uPerfMode;
+};
+
+// Per-draw uniforms, written for every draw of a pass (DrawUniforms in renderer.cpp)
+layout(std140) uniform DrawUniforms {
+    mat4 uModel;
+    vec4 uDiffuseColor;
+    float uMetalnessFactor;
+    float uRoughnessFactor;
+    int uUseNormalMap;
+    float uCost;
+    int uMaterialIndex;     // Element of the MaterialUniforms block of pbr.fs, -1 if the material is not packed
+};
 
 void main()
 {
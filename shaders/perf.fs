@@ -0,0 +1,52 @@
+#version 410 core
+
+flat in float triangleArea;
+
+out vec4 fragColor;
+
+// Per-frame uniforms, written once per frame by the renderer (FrameUniforms in renderer.cpp)
+layout(std140) uniform FrameUniforms {
+    mat4 uProjection;
+    mat4 uView;
+    vec4 uViewPosition;     // xyz
+    vec4 uLightDirection;   // xyz
+    vec4 uLightColor;       // rgb
+    vec2 uViewportSize;
+    float uEnvIntensity;
+    int uRenderMode;
+    int uPerfMode;          // 0: overdraw, 1: triangle density, 2: mesh cost
+};
+
+// Per-draw uniforms, written for every draw of a pass (DrawUniforms in renderer.cpp)
+layout(std140) uniform DrawUniforms {
+    mat4 uModel;
+    vec4 uDiffuseColor;
+    float uMetalnessFactor;
+    float uRoughnessFactor;
+    int uUseNormalMap;
+    float uCost;            // Cost of the mesh relative to the most expensive one
+    int uMaterialIndex;     // Element of the MaterialUniforms block of pbr.fs, -1 if the material is not packed
+};
+
+// Blue (0) to red (1) color ramp
+vec3 heat(float t)
+{
+    t = clamp(t, 0.0, 1.0);
+    return clamp(vec3(1.5 - abs(4.0 * t - 3.0), 1.5 - abs(4.0 * t - 2.0), 1.5 - abs(4.0 * t - 1.0)), 0.0, 1.0);
+}
+
+void main()
+{
+    if (uPerfMode == 0) {
+        // one layer, accumulated by additive blending
+        fragColor = vec4(1.0);
+    }
+    else if (uPerfMode == 1) {
+        // red below one pixel per triangle, blue from 256 pixels:
+        // fragments are shaded by 2x2 quads, small triangles waste most of the quad
+        fragColor = vec4(heat(1.0 - log2(max(triangleArea, 1.0)) / 8.0), 1.0);
+    }
+    else {
+        fragColor = vec4(heat(uCost), 1.0);
+    }
+}
@@ -0,0 +1,42 @@
+#version 410 core
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+// Screen area of the triangle in pixels
+flat out float triangleArea;
+
+// Per-frame uniforms, written once per frame by the renderer (FrameUniforms in renderer.cpp)
+layout(std140) uniform FrameUniforms {
+    mat4 uProjection;
+    mat4 uView;
+    vec4 uViewPosition;     // xyz
+    vec4 uLightDirection;   // xyz
+    vec4 uLightColor;       // rgb
+    vec2 uViewportSize;
+    float uEnvIntensity;
+    int uRenderMode;
+    int uPerfMode;
+};
+
+void main()
+{
+    // triangles crossing the camera plane have no meaningful screen area, count them as large
+    bool behind = false;
+    vec2 p[3];
+    for (int i = 0; i < 3; ++i) {
+        vec4 clip = gl_in[i].gl_Position;
+        behind = behind || clip.w <= 0.0;
+        p[i] = clip.xy / clip.w * 0.5 * uViewportSize;
+    }
+    vec2 e1 = p[1] - p[0];
+    vec2 e2 = p[2] - p[0];
+    float area = behind ? 1e6 : 0.5 * abs(e1.x * e2.y - e2.x * e1.y);
+
+    for (int i = 0; i < 3; ++i) {
+        gl_Position = gl_in[i].gl_Position;
+        triangleArea = area;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
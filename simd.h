@@ -0,0 +1,46 @@
+#pragma once
+
+/**
+ * Compile-time SIMD capability detection shared by the CPU kernels.
+ * SSE2 is part of the x86-64 baseline, wider instruction sets depend on the compiler flags
+ * (/arch:AVX2 on MSVC, -mavx2 -mfma -mf16c on GCC and Clang).
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#include <immintrin.h>
+#endif
+
+// MSVC has no F16C switch, half conversions come with /arch:AVX2
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define SIMD_F16C 1
+#endif
+
+#if defined(SIMD_SSE2)
+#define SIMD_AVX2_DISPATCH 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC emits AVX2 intrinsics without a target switch
+#define SIMD_TARGET_AVX2
+#else
+// Compiles one function for AVX2 and FMA, call it only when cpuSupportsAvx2() is true
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+/**
+ * Runtime check for the AVX2 and FMA kernels.
+ * @return true if the CPU and the OS support AVX2 and FMA.
+ */
+inline bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave || (_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
@@ -0,0 +1,494 @@
+#include "stressScene.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+static const float PI = 3.14159265358979f;
+
+bool StressScene::isSource(const std::string& source) {
+    return source.compare(0, SOURCE_PREFIX.size(), SOURCE_PREFIX) == 0;
+}
+
+bool StressScene::parseSettings(const std::string& spec, StressSceneSettings& settings) {
+    std::string list = isSource(spec) ? spec.substr(SOURCE_PREFIX.size()) : spec;
+    std::istringstream listStream(list);
+    std::string item;
+    while (std::getline(listStream, item, ',')) {
+        if (item.empty()) {
+            continue;
+        }
+        size_t separator = item.find('=');
+        std::string key = item.substr(0, separator);
+        std::string value = separator == std::string::npos ? "" : item.substr(separator + 1);
+        try {
+            if (key == "meshes") settings.meshes = std::stoi(value);
+            else if (key == "triangles") settings.trianglesPerMesh = std::stoi(value);
+            else if (key == "materials") settings.materials = std::stoi(value);
+            else if (key == "texture") settings.textureSize = std::stoi(value);
+            else if (key == "transparent") settings.transparentFraction = std::stof(value);
+            else if (key == "instances") settings.instances = std::stoi(value);
+            else if (key == "seed") settings.seed = (uint32_t)std::stoul(value);
+            else {
+                std::cerr << "Unknown stress scene setting: " << key << std::endl;
+                return false;
+            }
+        }
+        catch (const std::exception&) {
+            std::cerr << "Invalid stress scene value: " << item << std::endl;
+            return false;
+        }
+    }
+    if (settings.meshes < 1 || settings.trianglesPerMesh < 1 || settings.materials < 1 || settings.textureSize < 0
+        || settings.transparentFraction < 0.0f || settings.transparentFraction > 1.0f || settings.instances < 1) {
+        std::cerr << "Stress scene settings out of range: " << spec << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string StressScene::toSource(const StressSceneSettings& settings) {
+    std::ostringstream source;
+    source << SOURCE_PREFIX << "meshes=" << settings.meshes << ",triangles=" << settings.trianglesPerMesh
+        << ",materials=" << settings.materials << ",texture=" << settings.textureSize
+        << ",transparent=" << settings.transparentFraction << ",instances=" << settings.instances << ",seed=" << settings.seed;
+    return source.str();
+}
+
+// generation
+// ----------
+/**
+ * Sphere with a wavy radius, tessellated in a rows x columns grid of about the wanted triangle count.
+ */
+static StressMesh generateMesh(int triangles, float radius, std::mt19937& random) {
+    int rows = std::max(1, (int)std::lround(std::sqrt(triangles / 4.0)));
+    int columns = std::max(3, (int)std::ceil(triangles / (2.0 * rows)));
+    std::uniform_real_distribution<float> waveDistribution(2.0f, 8.0f);
+    float waves = std::floor(waveDistribution(random));
+    float phase = waveDistribution(random);
+
+    StressMesh mesh;
+    size_t vertexCount = (size_t)(rows + 1) * (columns + 1);
+    mesh.positions.reserve(vertexCount);
+    mesh.normals.reserve(vertexCount);
+    mesh.tangents.reserve(vertexCount);
+    mesh.uvs.reserve(vertexCount);
+    for (int row = 0; row <= rows; ++row) {
+        float v = row / (float)rows;
+        float theta = v * PI;
+        for (int column = 0; column <= columns; ++column) {
+            float u = column / (float)columns;
+            float phi = u * 2.0f * PI;
+            glm::vec3 direction(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            float displacement = 1.0f + 0.1f * std::sin(waves * phi + phase) * std::sin(waves * theta);
+            mesh.positions.push_back(direction * radius * displacement);
+            mesh.normals.push_back(direction);
+            mesh.tangents.push_back(glm::vec3(-std::sin(phi), 0.0f, std::cos(phi)));
+            mesh.uvs.push_back(glm::vec2(u, v));
+        }
+    }
+
+    // counter-clockwise seen from outside
+    mesh.indices.reserve((size_t)rows * columns * 6);
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            uint32_t a = row * (columns + 1) + column;
+            uint32_t b = a + columns + 1;
+            mesh.indices.insert(mesh.indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+        }
+    }
+    return mesh;
+}
+
+/**
+ * Checkerboard of two shades of a color with some noise, encoded as PNG.
+ */
+static std::vector<uint8_t> generateTexture(int size, const glm::vec4& color, std::mt19937& random) {
+    std::vector<uint8_t> rgba((size_t)size * size * 4);
+    int cell = std::max(1, size / 8);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            float shade = ((x / cell + y / cell) % 2 == 0) ? 1.0f : 0.6f;
+            uint8_t* pixel = &rgba[((size_t)y * size + x) * 4];
+            for (int c = 0; c < 3; ++c) {
+                int value = (int)(color[c] * shade * 255.0f) + (int)(random() % 16) - 8;
+                pixel[c] = (uint8_t)std::clamp(value, 0, 255);
+            }
+            pixel[3] = 255;
+        }
+    }
+    return StressScene::encodePng(size, size, rgba);
+}
+
+StressSceneData StressScene::generate(const StressSceneSettings& settings) {
+    std::mt19937 random(settings.seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    StressSceneData data;
+
+    // materials, the transparent ones last
+    int transparentMaterials = 0;
+    if (settings.transparentFraction > 0.0f) {
+        transparentMaterials = std::clamp((int)std::lround(settings.materials * settings.transparentFraction), 1, settings.materials);
+    }
+    for (int m = 0; m < settings.materials; ++m) {
+        StressMaterial material;
+        material.color = glm::vec4(0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), 0.2f + 0.8f * unit(random), 1.0f);
+        material.metalness = unit(random);
+        material.roughness = 0.2f + 0.7f * unit(random);
+        if (m >= settings.materials - transparentMaterials) {
+            // the viewer takes the opacity of untextured materials only
+            material.color.a = 0.5f;
+        }
+        else if (settings.textureSize > 0) {
+            material.png = generateTexture(settings.textureSize, material.color, random);
+        }
+        data.materials.push_back(std::move(material));
+    }
+
+    // instances on a grid filling a unit cube, so that the default camera sees the whole scene
+    int total = settings.meshes * settings.instances;
+    int side = std::max(1, (int)std::ceil(std::cbrt((double)total) - 1e-9));
+    float spacing = 1.0f / side;
+    for (int m = 0; m < settings.meshes; ++m) {
+        data.meshes.push_back(generateMesh(settings.trianglesPerMesh, 0.4f * spacing, random));
+        data.meshes.back().material = m % settings.materials;
+    }
+    for (int n = 0; n < total; ++n) {
+        glm::vec3 cell((float)(n % side), (float)(n / side % side), (float)(n / (side * side)));
+        // copies of a mesh are spread over the grid
+        data.instances.push_back({ n % settings.meshes, (cell + 0.5f) * spacing - 0.5f });
+    }
+    return data;
+}
+
+// Assimp scene
+// ------------
+aiScene* StressScene::createAssimpScene(const StressSceneData& data) {
+    aiScene* scene = new aiScene();
+
+    // embedded textures are referenced by "*index"
+    std::vector<int> textureIndices(data.materials.size(), -1);
+    for (size_t m = 0; m < data.materials.size(); ++m) {
+        if (!data.materials[m].png.empty()) {
+            textureIndices[m] = (int)scene->mNumTextures++;
+        }
+    }
+    scene->mTextures = new aiTexture*[std::max(1u, scene->mNumTextures)];
+    scene->mNumMaterials = (unsigned int)data.materials.size();
+    scene->mMaterials = new aiMaterial*[scene->mNumMaterials];
+    for (size_t m = 0; m < data.materials.size(); ++m) {
+        const StressMaterial& source = data.materials[m];
+        aiMaterial* material = new aiMaterial();
+        aiString name("stress" + std::to_string(m));
+        material->AddProperty(&name, AI_MATKEY_NAME);
+        aiColor4D color;
+        color.r = source.color.r;
+        color.g = source.color.g;
+        color.b = source.color.b;
+        color.a = source.color.a;
+        material->AddProperty(&color, 1, AI_MATKEY_COLOR_DIFFUSE);
+        material->AddProperty(&source.metalness, 1, AI_MATKEY_METALLIC_FACTOR);
+        material->AddProperty(&source.roughness, 1, AI_MATKEY_ROUGHNESS_FACTOR);
+        if (textureIndices[m] >= 0) {
+            aiTexture* texture = new aiTexture();
+            texture->mWidth = (unsigned int)source.png.size();
+            texture->mHeight = 0;
+            std::strcpy(texture->achFormatHint, "png");
+            texture->pcData = new aiTexel[(source.png.size() + sizeof(aiTexel) - 1) / sizeof(aiTexel)];
+            std::memcpy(texture->pcData, source.png.data(), source.png.size());
+            scene->mTextures[textureIndices[m]] = texture;
+
+            aiString path("*" + std::to_string(textureIndices[m]));
+            material->AddProperty(&path, AI_MATKEY_TEXTURE(aiTextureType_DIFFUSE, 0));
+        }
+        scene->mMaterials[m] = material;
+    }
+
+    scene->mNumMeshes = (unsigned int)data.meshes.size();
+    scene->mMeshes = new aiMesh*[scene->mNumMeshes];
+    for (size_t i = 0; i < data.meshes.size(); ++i) {
+        const StressMesh& source = data.meshes[i];
+        aiMesh* mesh = new aiMesh();
+        mesh->mName = aiString("stress" + std::to_string(i));
+        mesh->mMaterialIndex = source.material;
+        mesh->mNumVertices = (unsigned int)source.positions.size();
+        mesh->mVertices = new aiVector3D[mesh->mNumVertices];
+        mesh->mNormals = new aiVector3D[mesh->mNumVertices];
+        mesh->mTangents = new aiVector3D[mesh->mNumVertices];
+        mesh->mBitangents = new aiVector3D[mesh->mNumVertices];
+        mesh->mTextureCoords[0] = new aiVector3D[mesh->mNumVertices];
+        mesh->mNumUVComponents[0] = 2;
+        for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+            const glm::vec3& position = source.positions[v];
+            const glm::vec3& normal = source.normals[v];
+            const glm::vec3& tangent = source.tangents[v];
+            glm::vec3 bitangent = glm::cross(normal, tangent);
+            mesh->mVertices[v] = aiVector3D(position.x, position.y, position.z);
+            mesh->mNormals[v] = aiVector3D(normal.x, normal.y, normal.z);
+            mesh->mTangents[v] = aiVector3D(tangent.x, tangent.y, tangent.z);
+            mesh->mBitangents[v] = aiVector3D(bitangent.x, bitangent.y, bitangent.z);
+            mesh->mTextureCoords[0][v] = aiVector3D(source.uvs[v].x, source.uvs[v].y, 0.0f);
+        }
+        mesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+        mesh->mNumFaces = (unsigned int)(source.indices.size() / 3);
+        mesh->mFaces = new aiFace[mesh->mNumFaces];
+        for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+            mesh->mFaces[f].mNumIndices = 3;
+            mesh->mFaces[f].mIndices = new unsigned int[3];
+            std::memcpy(mesh->mFaces[f].mIndices, &source.indices[f * 3], 3 * sizeof(unsigned int));
+        }
+        scene->mMeshes[i] = mesh;
+    }
+
+    // one child node per instance
+    aiNode* root = new aiNode();
+    root->mName = aiString("stress");
+    root->mNumChildren = (unsigned int)data.instances.size();
+    root->mChildren = new aiNode*[std::max(1u, root->mNumChildren)];
+    for (size_t n = 0; n < data.instances.size(); ++n) {
+        aiNode* node = new aiNode();
+        node->mParent = root;
+        node->mNumMeshes = 1;
+        node->mMeshes = new unsigned int[1] { (unsigned int)data.instances[n].first };
+        node->mTransformation.a4 = data.instances[n].second.x;
+        node->mTransformation.b4 = data.instances[n].second.y;
+        node->mTransformation.c4 = data.instances[n].second.z;
+        root->mChildren[n] = node;
+    }
+    scene->mRootNode = root;
+    return scene;
+}
+
+// GLB
+// ---
+/**
+ * Binary chunk of a GLB file being written, with the JSON of its buffer views and accessors.
+ */
+struct GlbBuffer {
+    std::vector<uint8_t> bytes;
+    std::ostringstream bufferViews;
+    std::ostringstream accessors;
+    int bufferViewCount = 0;
+    int accessorCount = 0;
+
+    /**
+     * Appends data as a buffer view, 4-byte aligned.
+     * @param target GL buffer target, 0 for none (images).
+     * @return The buffer view index.
+     */
+    int addBufferView(const void* data, size_t size, int target) {
+        size_t offset = bytes.size();
+        bytes.insert(bytes.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+        bytes.resize((bytes.size() + 3) & ~(size_t)3, 0);
+        bufferViews << (bufferViewCount > 0 ? "," : "") << "{\"buffer\":0,\"byteOffset\":" << offset << ",\"byteLength\":" << size;
+        if (target != 0) {
+            bufferViews << ",\"target\":" << target;
+        }
+        bufferViews << "}";
+        return bufferViewCount++;
+    }
+
+    /**
+     * Appends float vectors as a vertex attribute accessor.
+     * @param components 2 or 3.
+     * @param bounds true to write min and max, required for positions.
+     * @return The accessor index.
+     */
+    int addAttribute(const float* values, size_t count, int components, bool bounds) {
+        int view = addBufferView(values, count * components * sizeof(float), 34962);
+        accessors << (accessorCount > 0 ? "," : "") << "{\"bufferView\":" << view << ",\"componentType\":5126,\"count\":" << count
+            << ",\"type\":\"VEC" << components << "\"";
+        if (bounds && count > 0) {
+            std::vector<float> min(values, values + components), max(values, values + components);
+            for (size_t i = 0; i < count; ++i) {
+                for (int c = 0; c < components; ++c) {
+                    min[c] = std::min(min[c], values[i * components + c]);
+                    max[c] = std::max(max[c], values[i * components + c]);
+                }
+            }
+            accessors << ",\"min\":[" << min[0] << "," << min[1] << "," << min[2] << "],\"max\":[" << max[0] << "," << max[1] << "," << max[2] << "]";
+        }
+        accessors << "}";
+        return accessorCount++;
+    }
+
+    /**
+     * Appends triangle indices as an accessor.
+     * @return The accessor index.
+     */
+    int addIndices(const std::vector<uint32_t>& indices) {
+        int view = addBufferView(indices.data(), indices.size() * sizeof(uint32_t), 34963);
+        accessors << (accessorCount > 0 ? "," : "") << "{\"bufferView\":" << view << ",\"componentType\":5125,\"count\":" << indices.size()
+            << ",\"type\":\"SCALAR\"}";
+        return accessorCount++;
+    }
+};
+
+static void writeUint32(std::ofstream& file, uint32_t value) {
+    file.write((const char*)&value, sizeof(value));
+}
+
+bool StressScene::writeGlb(const StressSceneData& data, const std::string& filepath) {
+    GlbBuffer buffer;
+    buffer.bufferViews << std::setprecision(9);
+    buffer.accessors << std::setprecision(9);
+    std::ostringstream json;
+    json << std::setprecision(9);
+    json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"3DModelViewer stress scene\"},\"scene\":0";
+
+    // nodes
+    json << ",\"scenes\":[{\"nodes\":[";
+    for (size_t n = 0; n < data.instances.size(); ++n) {
+        json << (n > 0 ? "," : "") << n;
+    }
+    json << "]}],\"nodes\":[";
+    for (size_t n = 0; n < data.instances.size(); ++n) {
+        const glm::vec3& translation = data.instances[n].second;
+        json << (n > 0 ? "," : "") << "{\"mesh\":" << data.instances[n].first << ",\"translation\":[" << translation.x << "," << translation.y << "," << translation.z << "]}";
+    }
+
+    // meshes, tangents are left to the importer (aiProcess_CalcTangentSpace) as in most GLB files
+    json << "],\"meshes\":[";
+    for (size_t m = 0; m < data.meshes.size(); ++m) {
+        const StressMesh& mesh = data.meshes[m];
+        int position = buffer.addAttribute(&mesh.positions[0].x, mesh.positions.size(), 3, true);
+        int normal = buffer.addAttribute(&mesh.normals[0].x, mesh.normals.size(), 3, false);
+        int uv = buffer.addAttribute(&mesh.uvs[0].x, mesh.uvs.size(), 2, false);
+        int indices = buffer.addIndices(mesh.indices);
+        json << (m > 0 ? "," : "") << "{\"primitives\":[{\"attributes\":{\"POSITION\":" << position << ",\"NORMAL\":" << normal
+            << ",\"TEXCOORD_0\":" << uv << "},\"indices\":" << indices << ",\"material\":" << mesh.material << "}]}";
+    }
+
+    // materials and their textures
+    json << "],\"materials\":[";
+    std::ostringstream textures, images;
+    int textureCount = 0;
+    for (size_t m = 0; m < data.materials.size(); ++m) {
+        const StressMaterial& material = data.materials[m];
+        json << (m > 0 ? "," : "") << "{\"name\":\"stress" << m << "\",\"pbrMetallicRoughness\":{\"baseColorFactor\":["
+            << material.color.r << "," << material.color.g << "," << material.color.b << "," << material.color.a
+            << "],\"metallicFactor\":" << material.metalness << ",\"roughnessFactor\":" << material.roughness;
+        if (!material.png.empty()) {
+            int view = buffer.addBufferView(material.png.data(), material.png.size(), 0);
+            textures << (textureCount > 0 ? "," : "") << "{\"source\":" << textureCount << "}";
+            images << (textureCount > 0 ? "," : "") << "{\"bufferView\":" << view << ",\"mimeType\":\"image/png\"}";
+            json << ",\"baseColorTexture\":{\"index\":" << textureCount << "}";
+            ++textureCount;
+        }
+        json << "}" << (material.color.a < 1.0f ? ",\"alphaMode\":\"BLEND\"" : "") << "}";
+    }
+    json << "]";
+    if (textureCount > 0) {
+        json << ",\"textures\":[" << textures.str() << "],\"images\":[" << images.str() << "]";
+    }
+    json << ",\"accessors\":[" << buffer.accessors.str() << "],\"bufferViews\":[" << buffer.bufferViews.str()
+        << "],\"buffers\":[{\"byteLength\":" << buffer.bytes.size() << "}]}";
+
+    // header, JSON chunk padded with spaces, binary chunk
+    std::string jsonChunk = json.str();
+    jsonChunk.resize((jsonChunk.size() + 3) & ~(size_t)3, ' ');
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create " << filepath << std::endl;
+        return false;
+    }
+    writeUint32(file, 0x46546C67); // "glTF"
+    writeUint32(file, 2);
+    writeUint32(file, (uint32_t)(12 + 8 + jsonChunk.size() + 8 + buffer.bytes.size()));
+    writeUint32(file, (uint32_t)jsonChunk.size());
+    writeUint32(file, 0x4E4F534A); // "JSON"
+    file.write(jsonChunk.data(), jsonChunk.size());
+    writeUint32(file, (uint32_t)buffer.bytes.size());
+    writeUint32(file, 0x004E4942); // "BIN"
+    file.write((const char*)buffer.bytes.data(), buffer.bytes.size());
+    return (bool)file;
+}
+
+// PNG
+// ---
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+static void appendChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+    appendBigEndian(png, (uint32_t)data.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    appendBigEndian(png, crc32(png.data() + start, png.size() - start));
+}
+
+static uint8_t paethPredictor(int left, int up, int upLeft) {
+    int estimate = left + up - upLeft;
+    int distanceLeft = std::abs(estimate - left);
+    int distanceUp = std::abs(estimate - up);
+    int distanceUpLeft = std::abs(estimate - upLeft);
+    if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft) return (uint8_t)left;
+    if (distanceUp <= distanceUpLeft) return (uint8_t)up;
+    return (uint8_t)upLeft;
+}
+
+std::vector<uint8_t> StressScene::encodePng(int width, int height, const std::vector<uint8_t>& rgba) {
+    // Paeth-filtered rows, the filter most encoders pick for photographic content
+    size_t stride = (size_t)width * 4;
+    std::vector<uint8_t> filtered;
+    filtered.reserve(height * (stride + 1));
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = rgba.data() + y * stride;
+        const uint8_t* previous = y > 0 ? row - stride : nullptr;
+        filtered.push_back(4);
+        for (size_t i = 0; i < stride; ++i) {
+            int left = i >= 4 ? row[i - 4] : 0;
+            int up = previous != nullptr ? previous[i] : 0;
+            int upLeft = previous != nullptr && i >= 4 ? previous[i - 4] : 0;
+            filtered.push_back((uint8_t)(row[i] - paethPredictor(left, up, upLeft)));
+        }
+    }
+
+    // zlib stream of stored deflate blocks
+    std::vector<uint8_t> zlib = { 0x78, 0x01 };
+    for (size_t offset = 0; offset < filtered.size(); offset += 65535) {
+        uint16_t length = (uint16_t)std::min<size_t>(65535, filtered.size() - offset);
+        zlib.push_back(offset + length == filtered.size() ? 1 : 0);
+        zlib.push_back((uint8_t)length);
+        zlib.push_back((uint8_t)(length >> 8));
+        zlib.push_back((uint8_t)~length);
+        zlib.push_back((uint8_t)(~length >> 8));
+        zlib.insert(zlib.end(), filtered.begin() + offset, filtered.begin() + offset + length);
+    }
+    uint32_t adlerA = 1, adlerB = 0;
+    for (uint8_t byte : filtered) {
+        adlerA = (adlerA + byte) % 65521;
+        adlerB = (adlerB + adlerA) % 65521;
+    }
+    appendBigEndian(zlib, (adlerB << 16) | adlerA);
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, width);
+    appendBigEndian(header, height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 bits RGBA
+
+    std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+    return png;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <assimp/scene.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Axes of a procedural stress scene, each can be swept independently.
+ * As a string (the "stress:" model source): "stress:meshes=100,triangles=1000,materials=8,
+ * texture=512,transparent=0.25,instances=4,seed=1", missing keys keep their default.
+ */
+struct StressSceneSettings {
+    int meshes = 100;                // Unique meshes
+    int trianglesPerMesh = 1000;     // Triangles of each unique mesh
+    int materials = 8;               // Unique materials, assigned to the meshes in turn
+    int textureSize = 0;             // Size of the embedded base color texture of each opaque material, 0 for none
+    float transparentFraction = 0.0f; // Fraction of the materials that are transparent (untextured, alpha 0.5)
+    int instances = 1;               // Nodes drawing each unique mesh, meshes * instances draws in total
+    uint32_t seed = 1;               // Random seed, the same settings always give the same scene
+};
+
+/**
+ * Unique mesh of a stress scene.
+ */
+struct StressMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> tangents;
+    std::vector<glm::vec2> uvs;
+    std::vector<uint32_t> indices;
+    int material = 0;
+};
+
+/**
+ * Material of a stress scene.
+ */
+struct StressMaterial {
+    glm::vec4 color = glm::vec4(1.0f);  // Base color, alpha below 1 for transparent materials
+    float metalness = 0.0f;
+    float roughness = 0.5f;
+    std::vector<uint8_t> png;           // Embedded base color texture, empty when untextured
+};
+
+/**
+ * Generated scene, shared by the in-app source and the GLB writer.
+ */
+struct StressSceneData {
+    std::vector<StressMesh> meshes;
+    std::vector<StressMaterial> materials;
+    std::vector<std::pair<int, glm::vec3>> instances;   // Mesh index and translation of each node
+};
+
+namespace StressScene {
+
+    // Model source prefix selecting a stress scene instead of a GLB file
+    const std::string SOURCE_PREFIX = "stress:";
+
+    /**
+     * @param source A model path or a stress scene source.
+     * @return true if the source starts with "stress:".
+     */
+    bool isSource(const std::string& source);
+
+    /**
+     * Reads settings from a "key=value,key=value" list, with or without the "stress:" prefix.
+     * @param spec The settings list.
+     * @param settings Receives the settings, defaults are kept for missing keys.
+     * @return false on an unknown key or an invalid value, the error is printed.
+     */
+    bool parseSettings(const std::string& spec, StressSceneSettings& settings);
+
+    /**
+     * @return The settings as a "stress:" source, parseSettings() reads it back.
+     */
+    std::string toSource(const StressSceneSettings& settings);
+
+    /**
+     * Generates the scene: displaced spheres laid out on a grid that fits a unit cube.
+     * @param settings The scene settings.
+     * @return The generated meshes, materials and instances.
+     */
+    StressSceneData generate(const StressSceneSettings& settings);
+
+    /**
+     * Converts a generated scene to what Assimp returns for a GLB file, for Scene::loadScene().
+     * Textures are embedded compressed (PNG) like in GLB files, so they go through the same decode.
+     * @param data The generated scene.
+     * @return The scene, owned by the caller.
+     */
+    aiScene* createAssimpScene(const StressSceneData& data);
+
+    /**
+     * Writes a generated scene as a binary glTF file.
+     * @param data The generated scene.
+     * @param filepath Destination .glb file.
+     * @return false if the file cannot be written.
+     */
+    bool writeGlb(const StressSceneData& data, const std::string& filepath);
+
+    /**
+     * Encodes an RGBA image as a PNG with Paeth-filtered rows and stored (uncompressed) deflate blocks.
+     * @param width Width in pixels.
+     * @param height Height in pixels.
+     * @param rgba width * height RGBA pixels, top row first.
+     * @return The PNG file contents.
+     */
+    std::vector<uint8_t> encodePng(int width, int height, const std::vector<uint8_t>& rgba);
+}
@@ -0,0 +1,127 @@
+#include "textureCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// "TEX" followed by the format version, the encoder version is stored apart
+static const char TEXTURE_MAGIC[4] = { 'T', 'E', 'X', '1' };
+
+/**
+ * Fixed-size file header, followed by the blocks of every level.
+ */
+struct TextureHeader {
+    char magic[4];
+    uint32_t encoderVersion;
+    uint32_t codec;
+    int32_t width;
+    int32_t height;
+    int32_t levels;
+};
+
+uint64_t TextureCache::key(const void* data, size_t bytes, uint32_t width, uint32_t height, uint32_t variant) {
+    uint64_t hash = 14695981039346656037ull;
+    const uint8_t* bytePointer = (const uint8_t*)data;
+    for (size_t i = 0; i < bytes; ++i) {
+        hash = (hash ^ bytePointer[i]) * 1099511628211ull;
+    }
+    // raw texels of transposed sizes have the same bytes
+    const uint64_t fields[] = { width, height, variant, TextureCompressor::VERSION };
+    for (uint64_t field : fields) {
+        hash = (hash ^ field) * 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string TextureCache::path(const std::string& folder, uint64_t key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.tex", (unsigned long long)key);
+    return (std::filesystem::path(folder) / name).string();
+}
+
+bool TextureCache::read(const std::string& filepath, CompressedTexture& texture) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        // not cached yet
+        return false;
+    }
+    TextureHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, TEXTURE_MAGIC, sizeof(TEXTURE_MAGIC)) != 0) {
+        std::cerr << "Not a cached texture: " << filepath << std::endl;
+        return false;
+    }
+    if (header.encoderVersion != TextureCompressor::VERSION) {
+        return false;
+    }
+    if (header.codec > (uint32_t)TextureCodec::BC7 || header.width <= 0 || header.width > 16384 || header.height <= 0
+        || header.height > 16384 || header.levels <= 0 || header.levels > 15) {
+        std::cerr << "Invalid cached texture: " << filepath << std::endl;
+        return false;
+    }
+
+    // the levels follow from the size, only their count is stored
+    texture.codec = (TextureCodec)header.codec;
+    texture.mips.clear();
+    size_t bytes = 0;
+    for (int level = 0; level < header.levels; ++level) {
+        CompressedMip mip;
+        mip.width = std::max(1, header.width >> level);
+        mip.height = std::max(1, header.height >> level);
+        mip.offset = bytes;
+        mip.size = CompressedTexture::levelBytes(texture.codec, mip.width, mip.height);
+        texture.mips.push_back(mip);
+        bytes += mip.size;
+    }
+    texture.data.resize(bytes);
+    if (!file.read(reinterpret_cast<char*>(texture.data.data()), bytes)) {
+        std::cerr << "Truncated cached texture: " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TextureCache::write(const std::string& filepath, const CompressedTexture& texture) {
+    if (texture.mips.empty()) {
+        return false;
+    }
+    TextureHeader header;
+    std::memcpy(header.magic, TEXTURE_MAGIC, sizeof(TEXTURE_MAGIC));
+    header.encoderVersion = TextureCompressor::VERSION;
+    header.codec = (uint32_t)texture.codec;
+    header.width = texture.mips[0].width;
+    header.height = texture.mips[0].height;
+    header.levels = (int32_t)texture.mips.size();
+
+    std::error_code error;
+    std::filesystem::path destination(filepath);
+    if (destination.has_parent_path()) {
+        std::filesystem::create_directories(destination.parent_path(), error);
+    }
+
+    // complete files only: write aside under a name of this thread, then replace
+    std::string temporary = filepath + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Failed to create " << temporary << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(texture.data.data()), texture.data.size());
+        if (!file) {
+            std::cerr << "Failed to write " << temporary << std::endl;
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, filepath, error);
+    if (error) {
+        std::cerr << "Failed to write " << filepath << ": " << error.message() << std::endl;
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "textureCompressor.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * Disk cache of compressed textures, keyed by the contents of their source image so that a
+ * texture is encoded once whatever model or path it comes from. One file per texture, replaced
+ * atomically: a cache shared by several processes never holds a partial file.
+ */
+namespace TextureCache {
+
+    /**
+     * Builds the key of a texture.
+     * @param data Source image, e.g. the PNG or JPEG bytes embedded in a model, or raw texels.
+     * @param bytes Size of the source image.
+     * @param width Width of raw texels, 0 for an encoded image that stores its own size.
+     * @param height Height of raw texels, 0 for an encoded image.
+     * @param variant What the image is encoded for (e.g. its texture type), textures encoded
+     * differently from the same image get different keys.
+     * @return FNV-1a hash of the image, its size, the variant and TextureCompressor::VERSION.
+     */
+    uint64_t key(const void* data, size_t bytes, uint32_t width, uint32_t height, uint32_t variant);
+
+    /**
+     * @return The path of a texture's file in the cache folder.
+     */
+    std::string path(const std::string& folder, uint64_t key);
+
+    /**
+     * Reads a cached texture.
+     * @param filepath Path returned by path().
+     * @param texture Receives the texture.
+     * @return true on success, false if the file is missing, truncated or of another version.
+     */
+    bool read(const std::string& filepath, CompressedTexture& texture);
+
+    /**
+     * Writes a texture to the cache, creating the folder if needed. Safe to call from several
+     * threads, the last writer of a key wins.
+     * @param filepath Path returned by path().
+     * @param texture The texture to write.
+     * @return true on success.
+     */
+    bool write(const std::string& filepath, const CompressedTexture& texture);
+}
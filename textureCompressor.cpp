@@ -0,0 +1,396 @@
+#include "textureCompressor.h"
+#include "simd.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+// Interpolation weights of the 4-bit BC7 indices, out of 64
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+/**
+ * Writes bit fields least significant bit first, as BC7 blocks are laid out.
+ */
+struct BitWriter {
+    uint8_t* bytes;
+    int position = 0;
+
+    explicit BitWriter(uint8_t* bytes) : bytes(bytes) { std::memset(bytes, 0, 16); }
+
+    void write(uint32_t value, int count) {
+        for (int i = 0; i < count; ++i, ++position) {
+            bytes[position >> 3] |= (uint8_t)(((value >> i) & 1) << (position & 7));
+        }
+    }
+};
+
+static uint32_t readBits(const uint8_t* bytes, int& position, int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; ++i, ++position) {
+        value |= (uint32_t)((bytes[position >> 3] >> (position & 7)) & 1) << i;
+    }
+    return value;
+}
+
+void TextureCompressor::encodeBC4Block(const uint8_t* values, uint8_t* block) {
+    uint8_t low = values[0], high = values[0];
+    for (int i = 1; i < 16; ++i) {
+        low = std::min(low, values[i]);
+        high = std::max(high, values[i]);
+    }
+
+    // first endpoint above the second: 6 values interpolated between them
+    block[0] = high;
+    block[1] = low;
+    uint64_t indices = 0;
+    if (high > low) {
+        int range = high - low;
+        for (int i = 0; i < 16; ++i) {
+            // position from the first endpoint (0) to the second (7), indices 0 and 1 are the endpoints
+            int step = ((high - values[i]) * 7 + range / 2) / range;
+            uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+            indices |= index << (3 * i);
+        }
+    }
+    for (int i = 0; i < 6; ++i) {
+        block[2 + i] = (uint8_t)(indices >> (8 * i));
+    }
+}
+
+/**
+ * Rounds an endpoint to 7 bits and a p-bit, the p-bit shared by the four channels.
+ * @return The squared error of the rounded endpoint.
+ */
+static float quantizeEndpoint(const float endpoint[4], int quantized[4], int& pBit) {
+    float bestError = FLT_MAX;
+    for (int p = 0; p < 2; ++p) {
+        int candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            candidate[c] = std::clamp((int)std::lround((endpoint[c] - p) * 0.5f), 0, 127);
+            float difference = (float)(candidate[c] * 2 + p) - endpoint[c];
+            error += difference * difference;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pBit = p;
+            std::copy(candidate, candidate + 4, quantized);
+        }
+    }
+    return bestError;
+}
+
+/**
+ * Picks the nearest of the 16 palette entries for every texel.
+ * @param texels 16 texels as floats, 4 channels each.
+ * @param palette Entries as planes: 16 reds, 16 greens, 16 blues, 16 alphas.
+ * @param indices Receives the index of each texel.
+ * @return The total squared error.
+ */
+static float selectIndices(const float* texels, const float* palette, int* indices) {
+    float total = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        const float* texel = texels + 4 * i;
+#if defined(SIMD_SSE2)
+        // four palette entries per step, the lanes keep their best entry
+        __m128 r = _mm_set1_ps(texel[0]), g = _mm_set1_ps(texel[1]), b = _mm_set1_ps(texel[2]), a = _mm_set1_ps(texel[3]);
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128i bestIndex = _mm_setzero_si128();
+        __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+        for (int j = 0; j < 16; j += 4) {
+            __m128 dr = _mm_sub_ps(_mm_loadu_ps(palette + j), r);
+            __m128 dg = _mm_sub_ps(_mm_loadu_ps(palette + 16 + j), g);
+            __m128 db = _mm_sub_ps(_mm_loadu_ps(palette + 32 + j), b);
+            __m128 da = _mm_sub_ps(_mm_loadu_ps(palette + 48 + j), a);
+            __m128 error = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+            __m128i less = _mm_castps_si128(_mm_cmplt_ps(error, best));
+            best = _mm_min_ps(error, best);
+            bestIndex = _mm_or_si128(_mm_and_si128(less, index), _mm_andnot_si128(less, bestIndex));
+            index = _mm_add_epi32(index, _mm_set1_epi32(4));
+        }
+        alignas(16) float errors[4];
+        alignas(16) int lanes[4];
+        _mm_store_ps(errors, best);
+        _mm_store_si128((__m128i*)lanes, bestIndex);
+        int lane = 0;
+        for (int k = 1; k < 4; ++k) {
+            if (errors[k] < errors[lane] || (errors[k] == errors[lane] && lanes[k] < lanes[lane])) {
+                lane = k;
+            }
+        }
+        indices[i] = lanes[lane];
+        total += errors[lane];
+#else
+        float best = FLT_MAX;
+        for (int j = 0; j < 16; ++j) {
+            float error = 0.0f;
+            for (int c = 0; c < 4; ++c) {
+                float difference = palette[16 * c + j] - texel[c];
+                error += difference * difference;
+            }
+            if (error < best) {
+                best = error;
+                indices[i] = j;
+            }
+        }
+        total += best;
+#endif
+    }
+    return total;
+}
+
+/**
+ * Quantizes two endpoints and picks the indices of their palette.
+ * @return The total squared error of the block.
+ */
+static float fitEndpoints(const float* texels, const float first[4], const float second[4], int quantized[2][4], int pBits[2], int indices[16]) {
+    quantizeEndpoint(first, quantized[0], pBits[0]);
+    quantizeEndpoint(second, quantized[1], pBits[1]);
+
+    alignas(16) float palette[64];
+    for (int c = 0; c < 4; ++c) {
+        int e0 = quantized[0][c] * 2 + pBits[0];
+        int e1 = quantized[1][c] * 2 + pBits[1];
+        for (int j = 0; j < 16; ++j) {
+            palette[16 * c + j] = (float)(((64 - BC7_WEIGHTS[j]) * e0 + BC7_WEIGHTS[j] * e1 + 32) >> 6);
+        }
+    }
+    return selectIndices(texels, palette, indices);
+}
+
+void TextureCompressor::encodeBC7Block(const uint8_t* texels, uint8_t* block) {
+    float values[64];
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 64; ++i) {
+        values[i] = texels[i];
+        mean[i & 3] += values[i] / 16.0f;
+    }
+
+    // principal axis of the texels by power iteration on their covariance
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; ++i) {
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                covariance[r][c] += (values[4 * i + r] - mean[r]) * (values[4 * i + c] - mean[c]);
+            }
+        }
+    }
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float next[4] = {};
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                next[r] += covariance[r][c] * axis[c];
+            }
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6f) {
+            break;
+        }
+        for (int c = 0; c < 4; ++c) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    // endpoints at the extreme projections on the axis
+    float low = FLT_MAX, high = -FLT_MAX;
+    for (int i = 0; i < 16; ++i) {
+        float t = 0.0f;
+        for (int c = 0; c < 4; ++c) {
+            t += (values[4 * i + c] - mean[c]) * axis[c];
+        }
+        low = std::min(low, t);
+        high = std::max(high, t);
+    }
+    float first[4], second[4];
+    for (int c = 0; c < 4; ++c) {
+        first[c] = std::clamp(mean[c] + axis[c] * low, 0.0f, 255.0f);
+        second[c] = std::clamp(mean[c] + axis[c] * high, 0.0f, 255.0f);
+    }
+
+    int quantized[2][4], pBits[2], indices[16];
+    float error = fitEndpoints(values, first, second, quantized, pBits, indices);
+
+    // least squares endpoints for the chosen indices, kept if they fit better
+    if (error > 0.0f) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax[4] = {}, bx[4] = {};
+        for (int i = 0; i < 16; ++i) {
+            float b = BC7_WEIGHTS[indices[i]] / 64.0f, a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 4; ++c) {
+                ax[c] += a * values[4 * i + c];
+                bx[c] += b * values[4 * i + c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) > 1e-6f) {
+            for (int c = 0; c < 4; ++c) {
+                first[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+                second[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+            }
+            int refinedQuantized[2][4], refinedPBits[2], refinedIndices[16];
+            if (fitEndpoints(values, first, second, refinedQuantized, refinedPBits, refinedIndices) < error) {
+                std::memcpy(quantized, refinedQuantized, sizeof(quantized));
+                std::memcpy(pBits, refinedPBits, sizeof(pBits));
+                std::memcpy(indices, refinedIndices, sizeof(indices));
+            }
+        }
+    }
+
+    // the first index is stored without its top bit: swap the endpoints if it is set
+    if (indices[0] & 8) {
+        std::swap(quantized[0], quantized[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (int& index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    BitWriter bits(block);
+    bits.write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c) {
+        bits.write(quantized[0][c], 7);
+        bits.write(quantized[1][c], 7);
+    }
+    bits.write(pBits[0], 1);
+    bits.write(pBits[1], 1);
+    bits.write(indices[0], 3);
+    for (int i = 1; i < 16; ++i) {
+        bits.write(indices[i], 4);
+    }
+}
+
+void TextureCompressor::decodeBC7Block(const uint8_t* block, uint8_t* texels) {
+    int position = 0;
+    if (readBits(block, position, 7) != 1 << 6) {
+        // not mode 6, shown as opaque magenta
+        for (int i = 0; i < 16; ++i) {
+            texels[4 * i] = 255; texels[4 * i + 1] = 0; texels[4 * i + 2] = 255; texels[4 * i + 3] = 255;
+        }
+        return;
+    }
+    int endpoints[2][4];
+    for (int c = 0; c < 4; ++c) {
+        endpoints[0][c] = readBits(block, position, 7);
+        endpoints[1][c] = readBits(block, position, 7);
+    }
+    int p0 = readBits(block, position, 1), p1 = readBits(block, position, 1);
+    for (int i = 0; i < 16; ++i) {
+        int index = readBits(block, position, i == 0 ? 3 : 4);
+        int w = BC7_WEIGHTS[index];
+        for (int c = 0; c < 4; ++c) {
+            int e0 = endpoints[0][c] * 2 + p0, e1 = endpoints[1][c] * 2 + p1;
+            texels[4 * i + c] = (uint8_t)(((64 - w) * e0 + w * e1 + 32) >> 6);
+        }
+    }
+}
+
+/**
+ * Halves an RGBA8 image with a box filter, the last row and column repeat for odd sizes.
+ */
+static void downsample(const uint8_t* source, int width, int height, std::vector<uint8_t>& destination) {
+    int nextWidth = std::max(1, width / 2), nextHeight = std::max(1, height / 2);
+    destination.resize((size_t)nextWidth * nextHeight * 4);
+    for (int y = 0; y < nextHeight; ++y) {
+        const uint8_t* row0 = source + (size_t)std::min(2 * y, height - 1) * width * 4;
+        const uint8_t* row1 = source + (size_t)std::min(2 * y + 1, height - 1) * width * 4;
+        uint8_t* out = destination.data() + (size_t)y * nextWidth * 4;
+        for (int x = 0; x < nextWidth; ++x) {
+            int x0 = std::min(2 * x, width - 1) * 4, x1 = std::min(2 * x + 1, width - 1) * 4;
+            for (int c = 0; c < 4; ++c) {
+                out[4 * x + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+/**
+ * Encodes one level, the blocks crossing the right and bottom edges repeat the last texels.
+ */
+static void encodeLevel(const uint8_t* rgba, int width, int height, TextureCodec codec, int firstChannel, uint8_t* blocks) {
+    size_t blockBytes = CompressedTexture::blockBytes(codec);
+    int blocksWide = (width + 3) / 4, blocksHigh = (height + 3) / 4;
+    uint8_t texels[64], values[16];
+    for (int by = 0; by < blocksHigh; ++by) {
+        for (int bx = 0; bx < blocksWide; ++bx) {
+            for (int i = 0; i < 16; ++i) {
+                int x = std::min(bx * 4 + (i & 3), width - 1), y = std::min(by * 4 + (i >> 2), height - 1);
+                std::memcpy(texels + 4 * i, rgba + ((size_t)y * width + x) * 4, 4);
+            }
+            uint8_t* block = blocks + ((size_t)by * blocksWide + bx) * blockBytes;
+            if (codec == TextureCodec::BC7) {
+                TextureCompressor::encodeBC7Block(texels, block);
+                continue;
+            }
+            int channels = codec == TextureCodec::BC5 ? 2 : 1;
+            for (int channel = 0; channel < channels; ++channel) {
+                for (int i = 0; i < 16; ++i) {
+                    values[i] = texels[4 * i + firstChannel + channel];
+                }
+                TextureCompressor::encodeBC4Block(values, block + 8 * channel);
+            }
+        }
+    }
+}
+
+CompressedTexture TextureCompressor::compress(const uint8_t* rgba, int width, int height, TextureCodec codec, int firstChannel) {
+    CompressedTexture texture;
+    texture.codec = codec;
+    firstChannel = std::clamp(firstChannel, 0, codec == TextureCodec::BC5 ? 2 : 3);
+
+    // sizes first, the blocks are then encoded in place
+    size_t bytes = 0;
+    for (int w = width, h = height;; w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+        CompressedMip mip;
+        mip.width = w;
+        mip.height = h;
+        mip.offset = bytes;
+        mip.size = CompressedTexture::levelBytes(codec, w, h);
+        texture.mips.push_back(mip);
+        bytes += mip.size;
+        if (w == 1 && h == 1) {
+            break;
+        }
+    }
+    texture.data.resize(bytes);
+
+    std::vector<uint8_t> level, next;
+    const uint8_t* pixels = rgba;
+    for (size_t i = 0; i < texture.mips.size(); ++i) {
+        const CompressedMip& mip = texture.mips[i];
+        if (i > 0) {
+            downsample(pixels, texture.mips[i - 1].width, texture.mips[i - 1].height, next);
+            level.swap(next);
+            pixels = level.data();
+        }
+        encodeLevel(pixels, mip.width, mip.height, codec, firstChannel, texture.data.data() + mip.offset);
+    }
+    return texture;
+}
+
+CompressedTexture TextureCompressor::compressLevels(const uint8_t* rgba, int width, int height, int levels, TextureCodec codec, int firstChannel) {
+    CompressedTexture texture;
+    texture.codec = codec;
+    firstChannel = std::clamp(firstChannel, 0, codec == TextureCodec::BC5 ? 2 : 3);
+
+    size_t bytes = 0;
+    for (int i = 0; i < levels; ++i) {
+        CompressedMip mip;
+        mip.width = std::max(1, width >> i);
+        mip.height = std::max(1, height >> i);
+        mip.offset = bytes;
+        mip.size = CompressedTexture::levelBytes(codec, mip.width, mip.height);
+        texture.mips.push_back(mip);
+        bytes += mip.size;
+    }
+    texture.data.resize(bytes);
+
+    const uint8_t* pixels = rgba;
+    for (const CompressedMip& mip : texture.mips) {
+        encodeLevel(pixels, mip.width, mip.height, codec, firstChannel, texture.data.data() + mip.offset);
+        pixels += (size_t)mip.width * mip.height * 4;
+    }
+    return texture;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * GPU block compression formats, 4x4 texel blocks.
+ */
+enum class TextureCodec : uint8_t {
+    BC4,    // One channel, 8 bytes per block (GL_COMPRESSED_RED_RGTC1)
+    BC5,    // Two channels, 16 bytes per block (GL_COMPRESSED_RG_RGTC2)
+    BC7     // RGBA, 16 bytes per block (GL_COMPRESSED_RGBA_BPTC_UNORM_ARB)
+};
+
+/**
+ * Level of a compressed mip chain.
+ */
+struct CompressedMip {
+    int width = 0, height = 0;  // Size in texels
+    size_t offset = 0;          // Offset of the blocks in CompressedTexture::data
+    size_t size = 0;            // Bytes of the blocks
+};
+
+/**
+ * Block-compressed texture with its full mip chain, blocks stored row by row, level by level.
+ */
+struct CompressedTexture {
+    TextureCodec codec = TextureCodec::BC7;
+    std::vector<CompressedMip> mips;
+    std::vector<uint8_t> data;
+
+    /**
+     * @return The bytes of a 4x4 block of the codec.
+     */
+    static size_t blockBytes(TextureCodec codec) { return codec == TextureCodec::BC4 ? 8 : 16; }
+
+    /**
+     * @return The bytes of a level of the given size.
+     */
+    static size_t levelBytes(TextureCodec codec, int width, int height) {
+        return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(codec);
+    }
+};
+
+namespace TextureCompressor {
+
+    /**
+     * Bumped when the encoders change, so that the textures cached by an older version are encoded again.
+     */
+    constexpr uint32_t VERSION = 1;
+
+    /**
+     * Box-filters an RGBA8 image down its mip chain and encodes every level.
+     * Single-threaded, textures are compressed in parallel by their loader. The block search
+     * uses SSE2 when available.
+     * @param rgba Pixels of the first level, 4 bytes each, rows tightly packed.
+     * @param width Width of the image.
+     * @param height Height of the image.
+     * @param codec Target format.
+     * @param firstChannel Channel encoded first: BC4 encodes it, BC5 encodes it and the next one, BC7 ignores it.
+     * @return The compressed mip chain.
+     */
+    CompressedTexture compress(const uint8_t* rgba, int width, int height, TextureCodec codec, int firstChannel);
+
+    /**
+     * Encodes a mip chain whose levels are given, e.g. the levels of a KTX2 file.
+     * @param rgba Pixels of the levels, 4 bytes each, rows tightly packed, the first level first.
+     * @param width Width of the first level.
+     * @param height Height of the first level.
+     * @param levels Number of levels, each half the size of the previous one.
+     * @param codec Target format.
+     * @param firstChannel Channel encoded first, as for compress().
+     * @return The compressed levels.
+     */
+    CompressedTexture compressLevels(const uint8_t* rgba, int width, int height, int levels, TextureCodec codec, int firstChannel);
+
+    /**
+     * Encodes one 4x4 block of one channel.
+     * @param values The 16 values, row by row.
+     * @param block Receives the 8 bytes of the block.
+     */
+    void encodeBC4Block(const uint8_t* values, uint8_t* block);
+
+    /**
+     * Encodes one 4x4 RGBA block in BC7 mode 6 (one subset, 7-bit endpoints with a shared
+     * p-bit, 4-bit indices), refined by one least squares fit of the endpoints.
+     * @param texels The 16 texels, 4 bytes each, row by row.
+     * @param block Receives the 16 bytes of the block.
+     */
+    void encodeBC7Block(const uint8_t* texels, uint8_t* block);
+
+    /**
+     * Decodes a BC7 mode 6 block, to measure the encoder.
+     * @param block The 16 bytes of the block.
+     * @param texels Receives the 16 texels, 4 bytes each.
+     */
+    void decodeBC7Block(const uint8_t* block, uint8_t* texels);
+}
@@ -0,0 +1,73 @@
+#include "threadPool.h"
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        _workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _jobAvailable.notify_all();
+    for (std::thread& worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push(std::move(job));
+        ++_pendingJobs;
+    }
+    _jobAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _jobsDone.wait(lock, [this]() { return _pendingJobs == 0; });
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& body) {
+    std::atomic<int> next(0);
+    int jobCount = std::min<int>(count, (int)_workers.size());
+    for (int i = 0; i < jobCount; ++i) {
+        submit([&next, &body, count]() {
+            for (int index = next++; index < count; index = next++) {
+                body(index);
+            }
+            });
+    }
+    wait();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobAvailable.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+            // queued jobs are drained before stopping
+            if (_jobs.empty()) {
+                return;
+            }
+            job = std::move(_jobs.front());
+            _jobs.pop();
+        }
+
+        job();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_pendingJobs == 0) {
+            _jobsDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running queued jobs.
+ */
+class ThreadPool {
+public:
+    /**
+     * Starts the worker threads.
+     * @param threadCount Number of workers, 0 for one per core.
+     */
+    explicit ThreadPool(unsigned int threadCount = 0);
+
+    /**
+     * Finishes the queued jobs and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Queues a job, run by the first available worker.
+     * @param job The function to run.
+     */
+    void submit(std::function<void()> job);
+
+    /**
+     * Blocks until every submitted job has completed.
+     */
+    void wait();
+
+    /**
+     * Runs body(i) for every i in [0, count) on the workers and waits for completion.
+     * Indices are handed out one at a time, so uneven iterations balance themselves.
+     * @param count Number of iterations.
+     * @param body The function to run for each index.
+     */
+    void parallelFor(int count, const std::function<void(int)>& body);
+
+    /**
+     * @return The number of worker threads.
+     */
+    unsigned int size() const { return (unsigned int)_workers.size(); }
+
+private:
+    /**
+     * Worker thread body, runs jobs until the pool is destroyed.
+     */
+    void workerLoop();
+
+    std::vector<std::thread> _workers;          // Worker threads
+    std::queue<std::function<void()>> _jobs;    // Jobs not started yet
+    std::mutex _mutex;                          // Protects the queue and the counters
+    std::condition_variable _jobAvailable;      // Signaled when a job is queued or on shutdown
+    std::condition_variable _jobsDone;          // Signaled when the last pending job completes
+    size_t _pendingJobs = 0;                    // Queued plus running jobs
+    bool _stopping = false;                     // Set by the destructor
+};
@@ -0,0 +1,212 @@
+// Offline IBL baker: bakes every .hdr/.exr environment of a folder into .ibl files on the CPU,
+// for machines without a usable GPU. Renderer::loadEnvironment uploads .ibl files without baking.
+//
+// Usage: bakeEnvironments [--input dir] [--output dir] [--threads n] [--scalar]
+//                         [--compare-gpu] [--tolerance t]
+//
+// --input defaults to folder.environments from config.ini and --output to the input folder.
+// --compare-gpu also bakes each environment with Renderer on a hidden window, times it, reads
+// the maps back and reports their difference with the CPU bake. Run it from the project root
+// so that the shaders are found.
+#include "../fileUtils.h"
+#include "../hdrImage.h"
+#include "../iblBaker.h"
+#include "../iblFile.h"
+#include "../renderer.h"
+#include "../threadPool.h"
+#include <ImfRgba.h>
+#include <SDL.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Hidden window and GL 4.1 context for the GPU comparison, same attributes as DisplayManager.
+ */
+struct GpuContext {
+    SDL_Window* window = nullptr;
+    SDL_GLContext context = nullptr;
+
+    bool init() {
+        if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+            std::cerr << "SDL2 could not initialize video" << std::endl;
+            return false;
+        }
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+        SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+        window = SDL_CreateWindow("bakeEnvironments", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+        if (window == nullptr) {
+            std::cerr << "Error creating SDL Window" << std::endl;
+            return false;
+        }
+        context = SDL_GL_CreateContext(window);
+        if (context == nullptr) {
+            std::cerr << "Error creating OpenGL Context" << std::endl;
+            return false;
+        }
+        if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) {
+            std::cerr << "Error initializing glad" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    ~GpuContext() {
+        if (context != nullptr) SDL_GL_DeleteContext(context);
+        if (window != nullptr) SDL_DestroyWindow(window);
+        SDL_Quit();
+    }
+};
+
+/**
+ * Mean relative and max absolute difference between a CPU map and the same GPU map.
+ */
+struct MapError {
+    double meanRelative = 0.0;
+    double maxAbsolute = 0.0;
+};
+
+static MapError compareWithGpu(const CubemapImage& image, GLuint texture) {
+    MapError error;
+    size_t count = 0;
+    std::vector<float> gpu;
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    for (int mip = 0; mip < image.mipLevels; ++mip) {
+        int size = image.mipSize(mip);
+        size_t faceValues = (size_t)size * size * 3;
+        gpu.resize(faceValues);
+        for (int face = 0; face < 6; ++face) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB, GL_FLOAT, gpu.data());
+            const uint16_t* cpu = image.pixels.data() + image.mipOffset(mip) + face * faceValues;
+            for (size_t i = 0; i < faceValues; ++i) {
+                half value;
+                value.setBits(cpu[i]);
+                double difference = std::fabs((double)(float)value - gpu[i]);
+                error.meanRelative += difference / std::max(std::fabs((double)gpu[i]), 0.01);
+                error.maxAbsolute = std::max(error.maxAbsolute, difference);
+            }
+            count += faceValues;
+        }
+    }
+    error.meanRelative /= std::max<size_t>(count, 1);
+    return error;
+}
+
+int main(int argc, char** argv) {
+    FileUtils::ConfigMap configMap = FileUtils::readConfigFile("config.ini");
+    std::string input = FileUtils::getValue(configMap, "folder.environments");
+    std::string output;
+    unsigned int threads = 0;
+    bool compareGpu = false;
+    double tolerance = 0.02;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--input" && hasValue) input = argv[++i];
+        else if (arg == "--output" && hasValue) output = argv[++i];
+        else if (arg == "--threads" && hasValue) threads = (unsigned int)std::stoi(argv[++i]);
+        else if (arg == "--tolerance" && hasValue) tolerance = std::stod(argv[++i]);
+        else if (arg == "--scalar") IblBaker::setAvx2Enabled(false);
+        else if (arg == "--compare-gpu") compareGpu = true;
+        else {
+            std::cerr << "Usage: bakeEnvironments [--input dir] [--output dir] [--threads n] [--scalar] [--compare-gpu] [--tolerance t]" << std::endl;
+            return 1;
+        }
+    }
+    if (output.empty()) {
+        output = input;
+    }
+    if (input.empty() || !std::filesystem::is_directory(input)) {
+        std::cerr << "Environment folder not found: " << input << std::endl;
+        return 1;
+    }
+    std::filesystem::create_directories(output);
+
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(input)) {
+        if (entry.is_regular_file() && (entry.path().extension() == ".hdr" || entry.path().extension() == ".exr")) {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    ThreadPool pool(threads);
+    std::cout << "Baking " << files.size() << " environments with " << pool.size() << " threads, "
+        << (IblBaker::avx2Enabled() ? "AVX2" : "scalar") << " kernels" << std::endl;
+
+    GpuContext gpu;
+    Renderer renderer;
+    if (compareGpu) {
+        if (!gpu.init()) {
+            return 1;
+        }
+        renderer.init(64, 64);
+        // keep a single environment in VRAM
+        renderer.setEnvironmentCacheBudget(0);
+        renderer.setBakeStepsPerFrame(1 << 20);
+    }
+
+    int failures = 0;
+    for (const std::filesystem::path& file : files) {
+        std::filesystem::path target = std::filesystem::path(output) / file.filename().replace_extension(".ibl");
+
+        // same input as the viewer: 4 cubemap faces around the equator
+        Clock::time_point start = Clock::now();
+        HdrImage image;
+        if (!HdrImageLoader::load(file.string(), 4 * IblBaker::CUBEMAP_SIZE, image)) {
+            ++failures;
+            continue;
+        }
+        double decodeMs = elapsedMs(start);
+
+        start = Clock::now();
+        BakedEnvironment baked = IblBaker::bake(image, pool);
+        double bakeMs = elapsedMs(start);
+
+        if (!IblFile::write(target.string(), baked)) {
+            ++failures;
+            continue;
+        }
+        std::cout << file.filename().string() << ": decode " << decodeMs << " ms, CPU bake " << bakeMs << " ms -> " << target.string() << std::endl;
+
+        if (compareGpu) {
+            // decode + bake on the GPU path, as the viewer does it
+            start = Clock::now();
+            renderer.loadEnvironment(file.string());
+            renderer.finishEnvironmentLoading();
+            glFinish();
+            double gpuMs = elapsedMs(start);
+
+            const Environment& environment = renderer.getActiveEnvironment();
+            MapError cubemap = compareWithGpu(baked.cubemap, environment.envCubemap.id());
+            MapError irradiance = compareWithGpu(baked.irradiance, environment.irradianceMap.id());
+            MapError prefilter = compareWithGpu(baked.prefilter, environment.prefilterMap.id());
+            bool match = cubemap.meanRelative <= tolerance && irradiance.meanRelative <= tolerance && prefilter.meanRelative <= tolerance;
+            std::cout << "    GPU decode + bake " << gpuMs << " ms, CPU decode + bake " << decodeMs + bakeMs << " ms" << std::endl;
+            std::cout << "    mean relative error: cubemap " << cubemap.meanRelative << ", irradiance " << irradiance.meanRelative
+                << ", prefilter " << prefilter.meanRelative << (match ? " (match)" : " (MISMATCH)") << std::endl;
+            std::cout << "    max absolute error: cubemap " << cubemap.maxAbsolute << ", irradiance " << irradiance.maxAbsolute
+                << ", prefilter " << prefilter.maxAbsolute << std::endl;
+            if (!match) {
+                ++failures;
+            }
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
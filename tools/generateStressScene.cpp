@@ -0,0 +1,87 @@
+// Writes procedural stress scenes as GLB files, for tools and viewers that only read files and to
+// keep a fixed set of scenes between builds.
+//
+// Usage: generateStressScene [--meshes n] [--triangles n] [--materials n] [--texture size]
+//                            [--transparent fraction] [--instances n] [--seed n]
+//                            [--sweep axis=v1,v2,...] [--output path]
+//
+// Without --sweep a single scene is written to --output (stress.glb by default). With --sweep the
+// other settings stay fixed and one scene per value of the axis (meshes, triangles, materials,
+// texture, transparent, instances or seed) is written to the --output folder (stress by default)
+// as <axis>_<value>.glb, ready for "loadBenchmark --input". The viewer and "--benchmark" can
+// generate the same scenes in memory from a "stress:key=value,..." model source.
+#include "../stressScene.h"
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static void printUsage() {
+    std::cerr << "Usage: generateStressScene [--meshes n] [--triangles n] [--materials n] [--texture size]\n"
+        << "                           [--transparent fraction] [--instances n] [--seed n]\n"
+        << "                           [--sweep axis=v1,v2,...] [--output path]" << std::endl;
+}
+
+/**
+ * Generates and writes one scene, printing its size.
+ */
+static bool writeScene(const StressSceneSettings& settings, const std::string& filepath) {
+    StressSceneData data = StressScene::generate(settings);
+    size_t triangles = 0;
+    for (const auto& [mesh, translation] : data.instances) {
+        triangles += data.meshes[mesh].indices.size() / 3;
+    }
+    if (!StressScene::writeGlb(data, filepath)) {
+        return false;
+    }
+    std::cout << filepath << ": " << data.instances.size() << " draws, " << triangles << " triangles, "
+        << std::filesystem::file_size(filepath) / (1024.0 * 1024.0) << " MB (" << StressScene::toSource(settings) << ")" << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    // the options are the keys of a "stress:" source
+    std::string spec;
+    std::string sweep;
+    std::string output;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--sweep" && hasValue) sweep = argv[++i];
+        else if (arg == "--output" && hasValue) output = argv[++i];
+        else if (arg.compare(0, 2, "--") == 0 && hasValue) spec += arg.substr(2) + "=" + argv[++i] + ",";
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    StressSceneSettings settings;
+    if (!StressScene::parseSettings(spec, settings)) {
+        printUsage();
+        return 1;
+    }
+
+    if (sweep.empty()) {
+        return writeScene(settings, output.empty() ? "stress.glb" : output) ? 0 : 1;
+    }
+
+    size_t separator = sweep.find('=');
+    if (separator == std::string::npos) {
+        printUsage();
+        return 1;
+    }
+    std::string axis = sweep.substr(0, separator);
+    std::filesystem::path folder = output.empty() ? "stress" : output;
+    std::filesystem::create_directories(folder);
+    std::istringstream values(sweep.substr(separator + 1));
+    std::string value;
+    while (std::getline(values, value, ',')) {
+        StressSceneSettings point = settings;
+        if (!StressScene::parseSettings(axis + "=" + value, point)
+            || !writeScene(point, (folder / (axis + "_" + value + ".glb")).string())) {
+            return 1;
+        }
+    }
+    return 0;
+}
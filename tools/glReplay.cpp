@@ -0,0 +1,855 @@
+// GL capture replayer: re-issues the frames of a capture written by the viewer (capture.file in
+// config.ini) in an offscreen context and reports where their time goes, so that a rendering
+// cost reported from the field can be analyzed without the models and environments it used.
+//
+// Usage: glReplay capture.glcap [--loops n] [--warmup n] [--sync] [--output file]
+//
+// The setup calls (object creation, uploads, environment bakes) run once, then the captured
+// frames are replayed --loops times (100 by default) after --warmup loops (10). Each frame is
+// timed on the CPU (submission), on the GPU (GL_TIME_ELAPSED) and end to end (glFinish); each
+// command type gets its call count and CPU time. GL calls are asynchronous, so these call times
+// are driver overhead; --sync waits for the GPU after every call so that they include its work.
+// Results are printed and written as JSON (glReplay.json by default).
+#include "../glCapture.h"
+#include "../headlessContext.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Nearest-rank percentile of sorted values.
+ */
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+// in GlCommand order
+static const char* COMMAND_NAMES[] = {
+    "CaptureBegin", "FrameEnd", "End",
+    "glActiveTexture", "glBlendFunc", "glClear", "glClearColor", "glDepthFunc", "glDepthMask", "glDisable", "glEnable",
+    "glPixelStorei", "glScissor", "glViewport",
+    "glGenBuffers", "glGenFramebuffers", "glGenRenderbuffers", "glGenTextures", "glGenVertexArrays",
+    "glDeleteBuffers", "glDeleteFramebuffers", "glDeleteRenderbuffers", "glDeleteTextures", "glDeleteVertexArrays",
+    "glBindBuffer", "glBindFramebuffer", "glBindRenderbuffer", "glBindTexture", "glBindVertexArray",
+    "glBufferData", "glTexImage2D", "glTexParameteri", "glGenerateMipmap", "glRenderbufferStorage",
+    "glFramebufferRenderbuffer", "glFramebufferTexture2D", "glVertexAttribPointer", "glEnableVertexAttribArray",
+    "glCreateShader", "glShaderSource", "glCompileShader", "glDeleteShader", "glCreateProgram", "glAttachShader",
+    "glLinkProgram", "glValidateProgram", "glUseProgram", "glGetUniformLocation",
+    "glUniform1i", "glUniform1f", "glUniform2fv", "glUniform3fv", "glUniform4fv", "glUniformMatrix4fv",
+    "glDrawArrays", "glDrawElements",
+    "glBufferSubData", "glTexSubImage2D",
+    "glBindBufferRange", "glGetUniformBlockIndex", "glUniformBlockBinding",
+    "glCompressedTexImage2D", "glCompressedTexSubImage2D",
+    "glTexImage3D", "glTexSubImage3D", "glCompressedTexImage3D", "glCompressedTexSubImage3D"
+};
+static_assert(sizeof(COMMAND_NAMES) / sizeof(COMMAND_NAMES[0]) == (size_t)GlCommand::Count, "a command has no name");
+
+/**
+ * Pointer argument read back from a capture.
+ */
+struct CapturedPointer {
+    const void* pointer = nullptr;  // Data in the capture, offset or nullptr
+    size_t size = 0;                // Bytes of data
+};
+
+/**
+ * Reads the commands of a capture loaded in memory.
+ */
+class CaptureReader {
+public:
+    std::vector<uint8_t> data;
+    size_t offset = 0;
+
+    bool atEnd() const { return offset >= data.size(); }
+
+    template<typename T>
+    T read() {
+        T value{};
+        if (offset + sizeof(T) <= data.size()) {
+            std::memcpy(&value, &data[offset], sizeof(T));
+        }
+        offset += sizeof(T);
+        return value;
+    }
+
+    CapturedPointer readPointer() {
+        CapturedPointer result;
+        GlPointer kind = read<GlPointer>();
+        if (kind == GlPointer::Offset) {
+            result.pointer = (const void*)(uintptr_t)read<uint64_t>();
+        }
+        else if (kind == GlPointer::Data) {
+            result.size = (size_t)read<uint64_t>();
+            result.pointer = offset + result.size <= data.size() ? &data[offset] : nullptr;
+            offset += result.size;
+        }
+        return result;
+    }
+};
+
+/**
+ * CPU time of one command type.
+ */
+struct CallStats {
+    uint64_t count = 0;
+    double totalMs = 0.0;
+};
+
+/**
+ * Re-issues captured commands, mapping the recorded object names and uniform locations to the
+ * ones of this context.
+ */
+class Replayer {
+public:
+    using NameMap = std::unordered_map<GLuint, GLuint>;
+
+    bool sync = false;          // Wait for the GPU after every call
+    bool measuring = false;     // Count calls in the statistics
+    double callMs = 0.0;        // Time in GL calls, reset by the caller
+    CallStats stats[(size_t)GlCommand::Count];
+
+    /**
+     * Executes the next command.
+     * @return The command, GlCommand::End at the end of the capture.
+     */
+    GlCommand execute(CaptureReader& reader);
+
+private:
+    NameMap _buffers, _framebuffers, _renderbuffers, _textures, _vertexArrays;
+    NameMap _shaders;           // Shaders and programs, they share their names
+    std::unordered_map<GLuint, std::unordered_map<GLint, GLint>> _uniformLocations; // By replayed program
+    std::unordered_map<GLuint, std::unordered_map<GLuint, GLuint>> _uniformBlockIndices; // By replayed program
+    GLuint _program = 0;
+
+    static GLuint map(const NameMap& names, GLuint name) {
+        auto it = names.find(name);
+        return it == names.end() ? name : it->second;
+    }
+
+    GLint mapLocation(GLint location) const {
+        auto program = _uniformLocations.find(_program);
+        if (program == _uniformLocations.end()) {
+            return location;
+        }
+        auto it = program->second.find(location);
+        return it == program->second.end() ? location : it->second;
+    }
+
+    /**
+     * Runs a GL call and adds its time to the statistics of its command.
+     */
+    template<typename Call>
+    void timed(GlCommand command, Call call) {
+        Clock::time_point start = Clock::now();
+        call();
+        if (sync) {
+            glFinish();
+        }
+        double ms = elapsedMs(start);
+        callMs += ms;
+        if (measuring) {
+            CallStats& entry = stats[(size_t)command];
+            ++entry.count;
+            entry.totalMs += ms;
+        }
+    }
+
+    template<typename Generate>
+    void generate(CaptureReader& reader, GlCommand command, NameMap& names, Generate generateNames) {
+        GLsizei n = reader.read<GLsizei>();
+        CapturedPointer recorded = reader.readPointer();
+        std::vector<GLuint> created(n);
+        timed(command, [&] { generateNames(n, created.data()); });
+        for (GLsizei i = 0; i < n && recorded.pointer != nullptr; ++i) {
+            names[((const GLuint*)recorded.pointer)[i]] = created[i];
+        }
+    }
+
+    template<typename Delete>
+    void remove(CaptureReader& reader, GlCommand command, NameMap& names, Delete deleteNames) {
+        GLsizei n = reader.read<GLsizei>();
+        CapturedPointer recorded = reader.readPointer();
+        std::vector<GLuint> deleted(n);
+        for (GLsizei i = 0; i < n && recorded.pointer != nullptr; ++i) {
+            GLuint name = ((const GLuint*)recorded.pointer)[i];
+            deleted[i] = map(names, name);
+            names.erase(name);
+        }
+        timed(command, [&] { deleteNames(n, deleted.data()); });
+    }
+};
+
+GlCommand Replayer::execute(CaptureReader& reader) {
+    if (reader.atEnd()) {
+        return GlCommand::End;
+    }
+    GlCommand command = (GlCommand)reader.read<uint16_t>();
+    switch (command) {
+    case GlCommand::CaptureBegin:
+    case GlCommand::FrameEnd:
+    case GlCommand::End:
+        break;
+
+    // state
+    case GlCommand::ActiveTexture: {
+        GLenum texture = reader.read<GLenum>();
+        timed(command, [&] { glActiveTexture(texture); });
+        break;
+    }
+    case GlCommand::BlendFunc: {
+        GLenum sfactor = reader.read<GLenum>();
+        GLenum dfactor = reader.read<GLenum>();
+        timed(command, [&] { glBlendFunc(sfactor, dfactor); });
+        break;
+    }
+    case GlCommand::Clear: {
+        GLbitfield mask = reader.read<GLbitfield>();
+        timed(command, [&] { glClear(mask); });
+        break;
+    }
+    case GlCommand::ClearColor: {
+        GLfloat red = reader.read<GLfloat>();
+        GLfloat green = reader.read<GLfloat>();
+        GLfloat blue = reader.read<GLfloat>();
+        GLfloat alpha = reader.read<GLfloat>();
+        timed(command, [&] { glClearColor(red, green, blue, alpha); });
+        break;
+    }
+    case GlCommand::DepthFunc: {
+        GLenum func = reader.read<GLenum>();
+        timed(command, [&] { glDepthFunc(func); });
+        break;
+    }
+    case GlCommand::DepthMask: {
+        GLboolean flag = reader.read<GLboolean>();
+        timed(command, [&] { glDepthMask(flag); });
+        break;
+    }
+    case GlCommand::Disable: {
+        GLenum cap = reader.read<GLenum>();
+        timed(command, [&] { glDisable(cap); });
+        break;
+    }
+    case GlCommand::Enable: {
+        GLenum cap = reader.read<GLenum>();
+        timed(command, [&] { glEnable(cap); });
+        break;
+    }
+    case GlCommand::PixelStorei: {
+        GLenum pname = reader.read<GLenum>();
+        GLint param = reader.read<GLint>();
+        timed(command, [&] { glPixelStorei(pname, param); });
+        break;
+    }
+    case GlCommand::Scissor:
+    case GlCommand::Viewport: {
+        GLint x = reader.read<GLint>();
+        GLint y = reader.read<GLint>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        if (command == GlCommand::Scissor) {
+            timed(command, [&] { glScissor(x, y, width, height); });
+        }
+        else {
+            timed(command, [&] { glViewport(x, y, width, height); });
+        }
+        break;
+    }
+
+    // objects
+    case GlCommand::GenBuffers:
+        generate(reader, command, _buffers, [](GLsizei n, GLuint* names) { glGenBuffers(n, names); });
+        break;
+    case GlCommand::GenFramebuffers:
+        generate(reader, command, _framebuffers, [](GLsizei n, GLuint* names) { glGenFramebuffers(n, names); });
+        break;
+    case GlCommand::GenRenderbuffers:
+        generate(reader, command, _renderbuffers, [](GLsizei n, GLuint* names) { glGenRenderbuffers(n, names); });
+        break;
+    case GlCommand::GenTextures:
+        generate(reader, command, _textures, [](GLsizei n, GLuint* names) { glGenTextures(n, names); });
+        break;
+    case GlCommand::GenVertexArrays:
+        generate(reader, command, _vertexArrays, [](GLsizei n, GLuint* names) { glGenVertexArrays(n, names); });
+        break;
+    case GlCommand::DeleteBuffers:
+        remove(reader, command, _buffers, [](GLsizei n, const GLuint* names) { glDeleteBuffers(n, names); });
+        break;
+    case GlCommand::DeleteFramebuffers:
+        remove(reader, command, _framebuffers, [](GLsizei n, const GLuint* names) { glDeleteFramebuffers(n, names); });
+        break;
+    case GlCommand::DeleteRenderbuffers:
+        remove(reader, command, _renderbuffers, [](GLsizei n, const GLuint* names) { glDeleteRenderbuffers(n, names); });
+        break;
+    case GlCommand::DeleteTextures:
+        remove(reader, command, _textures, [](GLsizei n, const GLuint* names) { glDeleteTextures(n, names); });
+        break;
+    case GlCommand::DeleteVertexArrays:
+        remove(reader, command, _vertexArrays, [](GLsizei n, const GLuint* names) { glDeleteVertexArrays(n, names); });
+        break;
+    case GlCommand::BindBuffer: {
+        GLenum target = reader.read<GLenum>();
+        GLuint buffer = map(_buffers, reader.read<GLuint>());
+        timed(command, [&] { glBindBuffer(target, buffer); });
+        break;
+    }
+    case GlCommand::BindFramebuffer: {
+        GLenum target = reader.read<GLenum>();
+        GLuint framebuffer = map(_framebuffers, reader.read<GLuint>());
+        timed(command, [&] { glBindFramebuffer(target, framebuffer); });
+        break;
+    }
+    case GlCommand::BindRenderbuffer: {
+        GLenum target = reader.read<GLenum>();
+        GLuint renderbuffer = map(_renderbuffers, reader.read<GLuint>());
+        timed(command, [&] { glBindRenderbuffer(target, renderbuffer); });
+        break;
+    }
+    case GlCommand::BindTexture: {
+        GLenum target = reader.read<GLenum>();
+        GLuint texture = map(_textures, reader.read<GLuint>());
+        timed(command, [&] { glBindTexture(target, texture); });
+        break;
+    }
+    case GlCommand::BindVertexArray: {
+        GLuint array = map(_vertexArrays, reader.read<GLuint>());
+        timed(command, [&] { glBindVertexArray(array); });
+        break;
+    }
+
+    // data
+    case GlCommand::BufferData: {
+        GLenum target = reader.read<GLenum>();
+        GLsizeiptr size = (GLsizeiptr)reader.read<int64_t>();
+        GLenum usage = reader.read<GLenum>();
+        CapturedPointer data = reader.readPointer();
+        timed(command, [&] { glBufferData(target, size, data.pointer, usage); });
+        break;
+    }
+    case GlCommand::TexImage2D: {
+        GLenum target = reader.read<GLenum>();
+        GLint level = reader.read<GLint>();
+        GLint internalformat = reader.read<GLint>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        GLint border = reader.read<GLint>();
+        GLenum format = reader.read<GLenum>();
+        GLenum type = reader.read<GLenum>();
+        CapturedPointer pixels = reader.readPointer();
+        timed(command, [&] { glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels.pointer); });
+        break;
+    }
+    case GlCommand::TexParameteri: {
+        GLenum target = reader.read<GLenum>();
+        GLenum pname = reader.read<GLenum>();
+        GLint param = reader.read<GLint>();
+        timed(command, [&] { glTexParameteri(target, pname, param); });
+        break;
+    }
+    case GlCommand::GenerateMipmap: {
+        GLenum target = reader.read<GLenum>();
+        timed(command, [&] { glGenerateMipmap(target); });
+        break;
+    }
+    case GlCommand::RenderbufferStorage: {
+        GLenum target = reader.read<GLenum>();
+        GLenum internalformat = reader.read<GLenum>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        timed(command, [&] { glRenderbufferStorage(target, internalformat, width, height); });
+        break;
+    }
+    case GlCommand::FramebufferRenderbuffer: {
+        GLenum target = reader.read<GLenum>();
+        GLenum attachment = reader.read<GLenum>();
+        GLenum renderbuffertarget = reader.read<GLenum>();
+        GLuint renderbuffer = map(_renderbuffers, reader.read<GLuint>());
+        timed(command, [&] { glFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer); });
+        break;
+    }
+    case GlCommand::FramebufferTexture2D: {
+        GLenum target = reader.read<GLenum>();
+        GLenum attachment = reader.read<GLenum>();
+        GLenum textarget = reader.read<GLenum>();
+        GLuint texture = map(_textures, reader.read<GLuint>());
+        GLint level = reader.read<GLint>();
+        timed(command, [&] { glFramebufferTexture2D(target, attachment, textarget, texture, level); });
+        break;
+    }
+    case GlCommand::VertexAttribPointer: {
+        GLuint index = reader.read<GLuint>();
+        GLint size = reader.read<GLint>();
+        GLenum type = reader.read<GLenum>();
+        GLboolean normalized = reader.read<GLboolean>();
+        GLsizei stride = reader.read<GLsizei>();
+        CapturedPointer pointer = reader.readPointer();
+        timed(command, [&] { glVertexAttribPointer(index, size, type, normalized, stride, pointer.pointer); });
+        break;
+    }
+    case GlCommand::EnableVertexAttribArray: {
+        GLuint index = reader.read<GLuint>();
+        timed(command, [&] { glEnableVertexAttribArray(index); });
+        break;
+    }
+
+    // shaders
+    case GlCommand::CreateShader: {
+        GLenum type = reader.read<GLenum>();
+        GLuint recorded = reader.read<GLuint>();
+        timed(command, [&] { _shaders[recorded] = glCreateShader(type); });
+        break;
+    }
+    case GlCommand::ShaderSource: {
+        GLuint shader = map(_shaders, reader.read<GLuint>());
+        CapturedPointer source = reader.readPointer();
+        const GLchar* string = (const GLchar*)source.pointer;
+        GLint length = (GLint)source.size;
+        timed(command, [&] { glShaderSource(shader, 1, &string, &length); });
+        break;
+    }
+    case GlCommand::CompileShader: {
+        GLuint shader = map(_shaders, reader.read<GLuint>());
+        timed(command, [&] { glCompileShader(shader); });
+        break;
+    }
+    case GlCommand::DeleteShader: {
+        GLuint shader = map(_shaders, reader.read<GLuint>());
+        timed(command, [&] { glDeleteShader(shader); });
+        break;
+    }
+    case GlCommand::CreateProgram: {
+        GLuint recorded = reader.read<GLuint>();
+        timed(command, [&] { _shaders[recorded] = glCreateProgram(); });
+        break;
+    }
+    case GlCommand::AttachShader: {
+        GLuint program = map(_shaders, reader.read<GLuint>());
+        GLuint shader = map(_shaders, reader.read<GLuint>());
+        timed(command, [&] { glAttachShader(program, shader); });
+        break;
+    }
+    case GlCommand::LinkProgram: {
+        GLuint program = map(_shaders, reader.read<GLuint>());
+        timed(command, [&] { glLinkProgram(program); });
+        break;
+    }
+    case GlCommand::ValidateProgram: {
+        GLuint program = map(_shaders, reader.read<GLuint>());
+        timed(command, [&] { glValidateProgram(program); });
+        break;
+    }
+    case GlCommand::UseProgram: {
+        _program = map(_shaders, reader.read<GLuint>());
+        timed(command, [&] { glUseProgram(_program); });
+        break;
+    }
+    case GlCommand::GetUniformLocation: {
+        GLuint program = map(_shaders, reader.read<GLuint>());
+        GLint recorded = reader.read<GLint>();
+        CapturedPointer name = reader.readPointer();
+        GLint location = -1;
+        timed(command, [&] { location = glGetUniformLocation(program, (const GLchar*)name.pointer); });
+        _uniformLocations[program][recorded] = location;
+        break;
+    }
+    case GlCommand::Uniform1i: {
+        GLint location = mapLocation(reader.read<GLint>());
+        GLint v0 = reader.read<GLint>();
+        timed(command, [&] { glUniform1i(location, v0); });
+        break;
+    }
+    case GlCommand::Uniform1f: {
+        GLint location = mapLocation(reader.read<GLint>());
+        GLfloat v0 = reader.read<GLfloat>();
+        timed(command, [&] { glUniform1f(location, v0); });
+        break;
+    }
+    case GlCommand::Uniform2fv:
+    case GlCommand::Uniform3fv:
+    case GlCommand::Uniform4fv: {
+        GLint location = mapLocation(reader.read<GLint>());
+        GLsizei count = reader.read<GLsizei>();
+        const GLfloat* value = (const GLfloat*)reader.readPointer().pointer;
+        if (command == GlCommand::Uniform2fv) {
+            timed(command, [&] { glUniform2fv(location, count, value); });
+        }
+        else if (command == GlCommand::Uniform3fv) {
+            timed(command, [&] { glUniform3fv(location, count, value); });
+        }
+        else {
+            timed(command, [&] { glUniform4fv(location, count, value); });
+        }
+        break;
+    }
+    case GlCommand::UniformMatrix4fv: {
+        GLint location = mapLocation(reader.read<GLint>());
+        GLsizei count = reader.read<GLsizei>();
+        GLboolean transpose = reader.read<GLboolean>();
+        const GLfloat* value = (const GLfloat*)reader.readPointer().pointer;
+        timed(command, [&] { glUniformMatrix4fv(location, count, transpose, value); });
+        break;
+    }
+
+    // draws
+    case GlCommand::DrawArrays: {
+        GLenum mode = reader.read<GLenum>();
+        GLint first = reader.read<GLint>();
+        GLsizei count = reader.read<GLsizei>();
+        timed(command, [&] { glDrawArrays(mode, first, count); });
+        break;
+    }
+    case GlCommand::DrawElements: {
+        GLenum mode = reader.read<GLenum>();
+        GLsizei count = reader.read<GLsizei>();
+        GLenum type = reader.read<GLenum>();
+        CapturedPointer indices = reader.readPointer();
+        timed(command, [&] { glDrawElements(mode, count, type, indices.pointer); });
+        break;
+    }
+
+    // data updates
+    case GlCommand::BufferSubData: {
+        GLenum target = reader.read<GLenum>();
+        GLintptr offset = (GLintptr)reader.read<int64_t>();
+        GLsizeiptr size = (GLsizeiptr)reader.read<int64_t>();
+        CapturedPointer data = reader.readPointer();
+        timed(command, [&] { glBufferSubData(target, offset, size, data.pointer); });
+        break;
+    }
+    case GlCommand::TexSubImage2D: {
+        GLenum target = reader.read<GLenum>();
+        GLint level = reader.read<GLint>();
+        GLint xoffset = reader.read<GLint>();
+        GLint yoffset = reader.read<GLint>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        GLenum format = reader.read<GLenum>();
+        GLenum type = reader.read<GLenum>();
+        CapturedPointer pixels = reader.readPointer();
+        timed(command, [&] { glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels.pointer); });
+        break;
+    }
+    case GlCommand::BindBufferRange: {
+        GLenum target = reader.read<GLenum>();
+        GLuint index = reader.read<GLuint>();
+        GLuint buffer = map(_buffers, reader.read<GLuint>());
+        GLintptr offset = (GLintptr)reader.read<int64_t>();
+        GLsizeiptr size = (GLsizeiptr)reader.read<int64_t>();
+        timed(command, [&] { glBindBufferRange(target, index, buffer, offset, size); });
+        break;
+    }
+    case GlCommand::GetUniformBlockIndex: {
+        GLuint program = map(_shaders, reader.read<GLuint>());
+        GLuint recorded = reader.read<GLuint>();
+        CapturedPointer name = reader.readPointer();
+        GLuint index = GL_INVALID_INDEX;
+        timed(command, [&] { index = glGetUniformBlockIndex(program, (const GLchar*)name.pointer); });
+        _uniformBlockIndices[program][recorded] = index;
+        break;
+    }
+    case GlCommand::UniformBlockBinding: {
+        GLuint program = map(_shaders, reader.read<GLuint>());
+        GLuint recorded = reader.read<GLuint>();
+        GLuint binding = reader.read<GLuint>();
+        auto indices = _uniformBlockIndices.find(program);
+        GLuint index = recorded;
+        if (indices != _uniformBlockIndices.end() && indices->second.count(recorded)) {
+            index = indices->second.at(recorded);
+        }
+        timed(command, [&] { glUniformBlockBinding(program, index, binding); });
+        break;
+    }
+    case GlCommand::CompressedTexImage2D: {
+        GLenum target = reader.read<GLenum>();
+        GLint level = reader.read<GLint>();
+        GLenum internalformat = reader.read<GLenum>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        GLint border = reader.read<GLint>();
+        GLsizei imageSize = reader.read<GLsizei>();
+        CapturedPointer data = reader.readPointer();
+        timed(command, [&] { glCompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data.pointer); });
+        break;
+    }
+    case GlCommand::CompressedTexSubImage2D: {
+        GLenum target = reader.read<GLenum>();
+        GLint level = reader.read<GLint>();
+        GLint xoffset = reader.read<GLint>();
+        GLint yoffset = reader.read<GLint>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        GLenum format = reader.read<GLenum>();
+        GLsizei imageSize = reader.read<GLsizei>();
+        CapturedPointer data = reader.readPointer();
+        timed(command, [&] { glCompressedTexSubImage2D(target, level, xoffset, yoffset, width, height, format, imageSize, data.pointer); });
+        break;
+    }
+    case GlCommand::TexImage3D: {
+        GLenum target = reader.read<GLenum>();
+        GLint level = reader.read<GLint>();
+        GLint internalformat = reader.read<GLint>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        GLsizei depth = reader.read<GLsizei>();
+        GLint border = reader.read<GLint>();
+        GLenum format = reader.read<GLenum>();
+        GLenum type = reader.read<GLenum>();
+        CapturedPointer pixels = reader.readPointer();
+        timed(command, [&] { glTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels.pointer); });
+        break;
+    }
+    case GlCommand::TexSubImage3D: {
+        GLenum target = reader.read<GLenum>();
+        GLint level = reader.read<GLint>();
+        GLint xoffset = reader.read<GLint>();
+        GLint yoffset = reader.read<GLint>();
+        GLint zoffset = reader.read<GLint>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        GLsizei depth = reader.read<GLsizei>();
+        GLenum format = reader.read<GLenum>();
+        GLenum type = reader.read<GLenum>();
+        CapturedPointer pixels = reader.readPointer();
+        timed(command, [&] { glTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels.pointer); });
+        break;
+    }
+    case GlCommand::CompressedTexImage3D: {
+        GLenum target = reader.read<GLenum>();
+        GLint level = reader.read<GLint>();
+        GLenum internalformat = reader.read<GLenum>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        GLsizei depth = reader.read<GLsizei>();
+        GLint border = reader.read<GLint>();
+        GLsizei imageSize = reader.read<GLsizei>();
+        CapturedPointer data = reader.readPointer();
+        timed(command, [&] { glCompressedTexImage3D(target, level, internalformat, width, height, depth, border, imageSize, data.pointer); });
+        break;
+    }
+    case GlCommand::CompressedTexSubImage3D: {
+        GLenum target = reader.read<GLenum>();
+        GLint level = reader.read<GLint>();
+        GLint xoffset = reader.read<GLint>();
+        GLint yoffset = reader.read<GLint>();
+        GLint zoffset = reader.read<GLint>();
+        GLsizei width = reader.read<GLsizei>();
+        GLsizei height = reader.read<GLsizei>();
+        GLsizei depth = reader.read<GLsizei>();
+        GLenum format = reader.read<GLenum>();
+        GLsizei imageSize = reader.read<GLsizei>();
+        CapturedPointer data = reader.readPointer();
+        timed(command, [&] { glCompressedTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data.pointer); });
+        break;
+    }
+
+    default:
+        std::cerr << "Unknown command " << (int)command << " at offset " << reader.offset << ", the capture is corrupt or newer" << std::endl;
+        reader.offset = reader.data.size();
+        return GlCommand::End;
+    }
+    return command;
+}
+
+/**
+ * Quotes a string for JSON, paths may hold backslashes.
+ */
+static std::string jsonString(const std::string& value) {
+    std::string result = "\"";
+    for (char c : value) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+/**
+ * Mean, percentiles and maximum of frame times, as JSON.
+ */
+static std::string jsonTimes(std::vector<double> times) {
+    std::sort(times.begin(), times.end());
+    double mean = std::accumulate(times.begin(), times.end(), 0.0) / std::max<size_t>(times.size(), 1);
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3) << "{ \"mean\": " << mean << ", \"p50\": " << percentile(times, 50.0)
+        << ", \"p95\": " << percentile(times, 95.0) << ", \"p99\": " << percentile(times, 99.0)
+        << ", \"max\": " << (times.empty() ? 0.0 : times.back()) << " }";
+    return json.str();
+}
+
+int main(int argc, char** argv) {
+    std::string capturePath;
+    int loops = 100;
+    int warmup = 10;
+    std::string output = "glReplay.json";
+    Replayer replayer;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--loops" && hasValue) loops = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue) warmup = std::max(0, std::stoi(argv[++i]));
+        else if (arg == "--output" && hasValue) output = argv[++i];
+        else if (arg == "--sync") replayer.sync = true;
+        else if (capturePath.empty() && arg.compare(0, 2, "--") != 0) capturePath = arg;
+        else {
+            capturePath.clear();
+            break;
+        }
+    }
+    if (capturePath.empty()) {
+        std::cerr << "Usage: glReplay capture.glcap [--loops n] [--warmup n] [--sync] [--output file]" << std::endl;
+        return 1;
+    }
+
+    CaptureReader reader;
+    {
+        std::ifstream file(capturePath, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << capturePath << std::endl;
+            return 1;
+        }
+        reader.data.resize((size_t)file.tellg());
+        file.seekg(0);
+        file.read((char*)reader.data.data(), reader.data.size());
+    }
+    uint32_t magic = reader.read<uint32_t>();
+    uint32_t version = reader.read<uint32_t>();
+    int32_t width = reader.read<int32_t>();
+    int32_t height = reader.read<int32_t>();
+    int32_t capturedFrames = reader.read<int32_t>();
+    if (magic != GlCapture::MAGIC || version > GlCapture::VERSION) {
+        std::cerr << capturePath << " is not a GL capture of version " << GlCapture::VERSION << " or older" << std::endl;
+        return 1;
+    }
+
+    HeadlessContext context;
+    if (!context.init(width, height)) {
+        return 1;
+    }
+
+    // setup, once
+    Clock::time_point start = Clock::now();
+    GlCommand command;
+    do {
+        command = replayer.execute(reader);
+    } while (command != GlCommand::CaptureBegin && command != GlCommand::End);
+    glFinish();
+    double setupMs = elapsedMs(start);
+    if (command != GlCommand::CaptureBegin) {
+        std::cerr << capturePath << " holds no captured frame" << std::endl;
+        context.cleanup();
+        return 1;
+    }
+    size_t framesOffset = reader.offset;
+    std::cout << "Setup replayed in " << setupMs << " ms, " << width << "x" << height << ", "
+        << (capturedFrames > 0 ? std::to_string(capturedFrames) : "incomplete capture, all") << " frames" << std::endl;
+
+    // captured frames in a loop, each timed on the CPU, the GPU and end to end
+    GLuint query;
+    glGenQueries(1, &query);
+    std::vector<double> cpuTimes, gpuTimes, frameTimes;
+    int framesPerLoop = 0;
+    for (int loop = 0; loop < warmup + loops; ++loop) {
+        replayer.measuring = loop >= warmup;
+        reader.offset = framesOffset;
+        int frames = 0;
+        while (true) {
+            replayer.callMs = 0.0;
+            Clock::time_point frameStart = Clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            do {
+                command = replayer.execute(reader);
+            } while (command != GlCommand::FrameEnd && command != GlCommand::End);
+            glEndQuery(GL_TIME_ELAPSED);
+            glFinish();
+            double frameMs = elapsedMs(frameStart);
+            if (command == GlCommand::End) {
+                break;
+            }
+            ++frames;
+            if (replayer.measuring) {
+                GLuint64 gpuNs = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpuNs);
+                cpuTimes.push_back(replayer.callMs);
+                gpuTimes.push_back(gpuNs / 1e6);
+                frameTimes.push_back(frameMs);
+            }
+        }
+        framesPerLoop = frames;
+    }
+    glDeleteQueries(1, &query);
+
+    // per command, most expensive first
+    std::vector<size_t> order;
+    for (size_t i = 0; i < (size_t)GlCommand::Count; ++i) {
+        if (replayer.stats[i].count > 0) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return replayer.stats[a].totalMs > replayer.stats[b].totalMs; });
+    size_t replayedFrames = frameTimes.size();
+    if (replayedFrames == 0) {
+        std::cerr << capturePath << " holds no complete frame" << std::endl;
+        context.cleanup();
+        return 1;
+    }
+    std::cout << framesPerLoop << " frames x " << loops << " loops" << (replayer.sync ? ", synchronous calls" : "") << std::endl;
+    std::cout << std::left << std::setw(28) << "command" << std::right << std::setw(14) << "calls/frame" << std::setw(14) << "ms/frame"
+        << std::setw(12) << "us/call" << std::endl;
+    for (size_t i : order) {
+        const CallStats& entry = replayer.stats[i];
+        std::cout << std::left << std::setw(28) << COMMAND_NAMES[i] << std::right << std::fixed << std::setprecision(3)
+            << std::setw(14) << entry.count / (double)replayedFrames << std::setw(14) << entry.totalMs / replayedFrames
+            << std::setw(12) << entry.totalMs * 1000.0 / entry.count << std::endl;
+    }
+    std::cout << "Frame: CPU " << jsonTimes(cpuTimes) << " ms\n       GPU " << jsonTimes(gpuTimes) << " ms\n       total " << jsonTimes(frameTimes) << " ms" << std::endl;
+
+    std::ofstream file(output);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create " << output << std::endl;
+        context.cleanup();
+        return 1;
+    }
+    file << std::fixed << std::setprecision(3);
+    file << "{\n";
+    file << "  \"capture\": " << jsonString(capturePath) << ",\n";
+    file << "  \"renderer\": " << jsonString((const char*)glGetString(GL_RENDERER)) << ",\n";
+    file << "  \"width\": " << width << ",\n";
+    file << "  \"height\": " << height << ",\n";
+    file << "  \"framesPerLoop\": " << framesPerLoop << ",\n";
+    file << "  \"loops\": " << loops << ",\n";
+    file << "  \"sync\": " << (replayer.sync ? "true" : "false") << ",\n";
+    file << "  \"setupMs\": " << setupMs << ",\n";
+    file << "  \"frameMs\": {\n";
+    file << "    \"cpu\": " << jsonTimes(cpuTimes) << ",\n";
+    file << "    \"gpu\": " << jsonTimes(gpuTimes) << ",\n";
+    file << "    \"total\": " << jsonTimes(frameTimes) << "\n";
+    file << "  },\n";
+    file << "  \"calls\": {";
+    for (size_t n = 0; n < order.size(); ++n) {
+        const CallStats& entry = replayer.stats[order[n]];
+        file << (n > 0 ? ",\n" : "\n") << "    \"" << COMMAND_NAMES[order[n]] << "\": { \"perFrame\": " << entry.count / (double)replayedFrames
+            << ", \"msPerFrame\": " << entry.totalMs / replayedFrames << ", \"usPerCall\": " << entry.totalMs * 1000.0 / entry.count << " }";
+    }
+    file << (order.empty() ? "}\n" : "\n  }\n");
+    file << "}\n";
+    std::cout << "Results written to " << output << std::endl;
+    context.cleanup();
+    return 0;
+}
@@ -0,0 +1,298 @@
+// Micro-benchmarks of the CPU kernels of the viewer, with Google Benchmark and synthetic inputs
+// from about 1K to 10M elements, so that optimizations can be measured and regressions caught.
+//
+// Usage: kernelBenchmarks [--benchmark_filter=regex] [--benchmark_format=json] ...
+//
+// Covered: Scene::loadScene (vertex transform and bounding box of processNode), the vertex transform
+// kernel alone with and without AVX2, the back to front
+// sort of transparent meshes, the streaming HDR downsampler (which replaced the vertical flip of
+// environment images), embedded texture decode with stb_image, BC4/BC5/BC7 texture compression
+// (with the PSNR of BC7), FileUtils config parsing and EventBus publish and post/dispatch.
+// No GL context is needed.
+#include "../event.h"
+#include "../fileUtils.h"
+#include "../hdrImage.h"
+#include "../renderer.h"
+#include "../scene.h"
+#include "../stressScene.h"
+#include "../textureCompressor.h"
+#include <benchmark/benchmark.h>
+#include <stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Scene::loadScene
+// ----------------
+/**
+ * Imported scene with a single mesh of vertexCount vertices under a transformed node.
+ */
+static aiScene* createAssimpScene(int vertexCount) {
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    aiMesh* mesh = new aiMesh();
+    mesh->mNumVertices = vertexCount;
+    mesh->mVertices = new aiVector3D[vertexCount];
+    mesh->mNormals = new aiVector3D[vertexCount];
+    mesh->mTangents = new aiVector3D[vertexCount];
+    mesh->mTextureCoords[0] = new aiVector3D[vertexCount];
+    for (int i = 0; i < vertexCount; ++i) {
+        mesh->mVertices[i] = aiVector3D(distribution(random), distribution(random), distribution(random));
+        mesh->mNormals[i] = aiVector3D(0.0f, 1.0f, 0.0f);
+        mesh->mTangents[i] = aiVector3D(1.0f, 0.0f, 0.0f);
+        mesh->mTextureCoords[0][i] = aiVector3D(distribution(random), distribution(random), 0.0f);
+    }
+    mesh->mNumFaces = vertexCount / 3;
+    mesh->mFaces = new aiFace[mesh->mNumFaces];
+    for (unsigned int i = 0; i < mesh->mNumFaces; ++i) {
+        mesh->mFaces[i].mNumIndices = 3;
+        mesh->mFaces[i].mIndices = new unsigned int[3] { i * 3, i * 3 + 1, i * 3 + 2 };
+    }
+
+    aiScene* scene = new aiScene();
+    scene->mNumMeshes = 1;
+    scene->mMeshes = new aiMesh*[1] { mesh };
+    scene->mNumMaterials = 1;
+    scene->mMaterials = new aiMaterial*[1] { new aiMaterial() };
+    scene->mRootNode = new aiNode();
+    scene->mRootNode->mNumMeshes = 1;
+    scene->mRootNode->mMeshes = new unsigned int[1] { 0 };
+    // a non-identity node transform, as in most models
+    scene->mRootNode->mTransformation.a4 = 1.0f;
+    scene->mRootNode->mTransformation.b2 = 2.0f;
+    return scene;
+}
+
+static void BM_SceneLoadScene(benchmark::State& state) {
+    aiScene* assimpScene = createAssimpScene((int)state.range(0));
+    EventBus eventBus;
+    Scene scene;
+    scene.init(&eventBus, 1.0f);
+    for (auto _ : state) {
+        scene.loadScene(assimpScene);
+        benchmark::DoNotOptimize(scene.getMeshes().data());
+        state.PauseTiming();
+        scene.clear();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    delete assimpScene;
+}
+BENCHMARK(BM_SceneLoadScene)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+
+// VertexTransform::transform
+// --------------------------
+static void BM_VertexTransform(benchmark::State& state) {
+    aiScene* assimpScene = createAssimpScene((int)state.range(0));
+    const aiMesh* mesh = assimpScene->mMeshes[0];
+    glm::mat4 transform = glm::transpose(glm::make_mat4(&assimpScene->mRootNode->mTransformation.a1));
+    std::vector<Vertex> vertices(mesh->mNumVertices);
+    bool avx2 = VertexTransform::avx2Enabled();
+    VertexTransform::setAvx2Enabled(state.range(1) != 0);
+    if (state.range(1) != 0 && !VertexTransform::avx2Enabled()) {
+        state.SkipWithError("AVX2 not supported");
+    }
+    for (auto _ : state) {
+        glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(std::numeric_limits<float>::lowest());
+        VertexTransform::transform(&mesh->mVertices[0].x, &mesh->mNormals[0].x, &mesh->mTangents[0].x, &mesh->mTextureCoords[0][0].x,
+            mesh->mNumVertices, transform, vertices.data(), boundsMin, boundsMax);
+        benchmark::DoNotOptimize(vertices.data());
+        benchmark::DoNotOptimize(boundsMin);
+    }
+    VertexTransform::setAvx2Enabled(avx2);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * state.range(0) * (4 * sizeof(aiVector3D) + sizeof(Vertex)));
+    delete assimpScene;
+}
+BENCHMARK(BM_VertexTransform)->ArgsProduct({ { 1000, 100000, 10000000 }, { 0, 1 } })->Unit(benchmark::kMillisecond);
+
+// Renderer::getSortedTransparentMeshIndices
+// -----------------------------------------
+static void BM_SortTransparentMeshes(benchmark::State& state) {
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> distribution(-10.0f, 10.0f);
+    std::vector<Mesh> meshes(state.range(0));
+    std::vector<int> transparentIndices(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        meshes[i].transform = glm::translate(glm::mat4(1.0f), glm::vec3(distribution(random), distribution(random), distribution(random)));
+        transparentIndices[i] = (int)i;
+    }
+    glm::vec3 cameraPosition(0.0f, 1.0f, 20.0f);
+    for (auto _ : state) {
+        std::vector<int> sorted = Renderer::getSortedTransparentMeshIndices(meshes, transparentIndices, cameraPosition);
+        benchmark::DoNotOptimize(sorted.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SortTransparentMeshes)->RangeMultiplier(10)->Range(1000, 100000);
+
+// ScanlineDownsampler
+// -------------------
+// args: source width (height is half of it, as for equirectangular images), factor
+static void BM_ScanlineDownsampler(benchmark::State& state) {
+    int width = (int)state.range(0);
+    int height = width / 2;
+    int factor = (int)state.range(1);
+    std::vector<float> row((size_t)width * 4);
+    for (size_t i = 0; i < row.size(); ++i) {
+        row[i] = (float)(i % 1024) / 64.0f;
+    }
+    HdrImage image;
+    for (auto _ : state) {
+        ScanlineDownsampler downsampler;
+        downsampler.init(width, height, factor, &image);
+        for (int y = 0; y < height; ++y) {
+            downsampler.addRow(row.data());
+        }
+        benchmark::DoNotOptimize(image.pixels.data());
+    }
+    state.SetItemsProcessed(state.iterations() * width * height);
+}
+BENCHMARK(BM_ScanlineDownsampler)->ArgsProduct({ { 1024, 2048, 4096 }, { 1, 2, 4 } })->Unit(benchmark::kMillisecond);
+
+// Embedded texture decode
+// -----------------------
+/**
+ * RGBA PNG of noise, as embedded in GLB files. Rows use the Paeth filter so that unfiltering costs
+ * what it does in real files; the zlib stream uses stored blocks, so the inflate cost of
+ * compressed files is not measured.
+ */
+static std::vector<uint8_t> createPng(int size) {
+    std::mt19937 random(3);
+    std::vector<uint8_t> rgba((size_t)size * size * 4);
+    for (uint8_t& value : rgba) {
+        value = (uint8_t)(random() & 0xFF);
+    }
+    return StressScene::encodePng(size, size, rgba);
+}
+
+static void BM_DecodeEmbeddedTexture(benchmark::State& state) {
+    int size = (int)state.range(0);
+    std::vector<uint8_t> png = createPng(size);
+    for (auto _ : state) {
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(false);
+        unsigned char* imageData = stbi_load_from_memory(png.data(), (int)png.size(), &width, &height, &channels, 0);
+        if (imageData == nullptr) {
+            state.SkipWithError(stbi_failure_reason());
+            break;
+        }
+        benchmark::DoNotOptimize(imageData);
+        stbi_image_free(imageData);
+    }
+    state.SetItemsProcessed(state.iterations() * size * size);
+}
+BENCHMARK(BM_DecodeEmbeddedTexture)->RangeMultiplier(4)->Range(32, 2048)->Unit(benchmark::kMillisecond);
+
+// TextureCompressor
+// -----------------
+static void BM_CompressTexture(benchmark::State& state) {
+    // gradients with a little noise, closer to real albedo than pure noise
+    int size = (int)state.range(0);
+    TextureCodec codec = (TextureCodec)state.range(1);
+    std::mt19937 random(4);
+    std::vector<uint8_t> rgba((size_t)size * size * 4);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            uint8_t* texel = &rgba[((size_t)y * size + x) * 4];
+            texel[0] = (uint8_t)std::min(255, x * 255 / size + (int)(random() & 7));
+            texel[1] = (uint8_t)std::min(255, y * 255 / size + (int)(random() & 7));
+            texel[2] = (uint8_t)((x ^ y) & 0xFF);
+            texel[3] = 255;
+        }
+    }
+    CompressedTexture compressed;
+    for (auto _ : state) {
+        compressed = TextureCompressor::compress(rgba.data(), size, size, codec, 0);
+        benchmark::DoNotOptimize(compressed.data.data());
+    }
+    state.SetItemsProcessed(state.iterations() * size * size);
+
+    // quality of the first level
+    if (codec == TextureCodec::BC7) {
+        double squaredError = 0.0;
+        uint8_t texels[64];
+        for (int by = 0; by < size / 4; ++by) {
+            for (int bx = 0; bx < size / 4; ++bx) {
+                TextureCompressor::decodeBC7Block(&compressed.data[((size_t)by * (size / 4) + bx) * 16], texels);
+                for (int i = 0; i < 64; ++i) {
+                    double difference = (double)texels[i] - rgba[((size_t)(by * 4 + i / 16) * size + bx * 4 + (i / 4) % 4) * 4 + i % 4];
+                    squaredError += difference * difference;
+                }
+            }
+        }
+        double meanError = squaredError / ((double)size * size * 4);
+        state.counters["psnr"] = meanError > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / meanError) : 99.0;
+    }
+}
+BENCHMARK(BM_CompressTexture)->ArgsProduct({ { 256, 1024 }, { (int)TextureCodec::BC4, (int)TextureCodec::BC5, (int)TextureCodec::BC7 } })
+    ->Unit(benchmark::kMillisecond);
+
+// FileUtils::readConfigFile
+// -------------------------
+static void BM_ReadConfigFile(benchmark::State& state) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "kernelBenchmarks.ini";
+    {
+        std::ofstream file(path);
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            if (i % 10 == 0) {
+                file << "# section " << i / 10 << "\n";
+            }
+            file << "section" << i / 10 << ".key" << i << "=\"value number " << i << "\"\n";
+        }
+    }
+    for (auto _ : state) {
+        FileUtils::ConfigMap config = FileUtils::readConfigFile(path.string());
+        benchmark::DoNotOptimize(config.size());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    std::filesystem::remove(path);
+}
+BENCHMARK(BM_ReadConfigFile)->RangeMultiplier(10)->Range(1000, 100000)->Unit(benchmark::kMillisecond);
+
+// EventBus
+// --------
+// one event published to range(0) subscribers
+static void BM_EventBusPublish(benchmark::State& state) {
+    EventBus eventBus;
+    glm::vec2 total(0.0f);
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        eventBus.subscribe(EventType::Move, [&](const Event& event) {
+            total += event.get<glm::vec2>();
+            });
+    }
+    Event event(EventType::Move, glm::vec2(1.0f, 2.0f));
+    for (auto _ : state) {
+        eventBus.publish(event);
+    }
+    benchmark::DoNotOptimize(total);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EventBusPublish)->RangeMultiplier(4)->Range(1, 64);
+
+// range(0) events posted then dispatched, as in a frame
+static void BM_EventBusPostDispatch(benchmark::State& state) {
+    EventBus eventBus;
+    int count = 0;
+    eventBus.subscribe(EventType::Zoom, [&](const Event& event) {
+        count += event.get<int>();
+        });
+    for (auto _ : state) {
+        for (int64_t i = 0; i < state.range(0); ++i) {
+            eventBus.post(Event(EventType::Zoom, 1));
+        }
+        eventBus.dispatch();
+    }
+    benchmark::DoNotOptimize(count);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EventBusPostDispatch)->RangeMultiplier(8)->Range(1, 1024);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,351 @@
+// Load pipeline benchmark: runs Scene::loadGlb over every .glb of a folder in an offscreen
+// context and reports where the load time goes, so that results can be compared between builds.
+//
+// Usage: loadBenchmark [--input dir] [--runs n] [--no-cold] [--csv file] [--json file]
+//
+// --input defaults to folder.models from config.ini. Each file is loaded once with a cold file
+// cache (its pages are dropped with posix_fadvise, unless --no-cold) then --runs times (3 by
+// default) with a warm cache. Phases are the profiler scopes of the load: file read, Assimp
+// import, texture decode and upload (within materials), vertex conversion (nodes) and mesh
+// upload; upload times are given for the CPU and the GPU. Memory is the peak RSS of the load
+// and the bytes requested from operator new (malloc calls, e.g. stb_image's, are not counted).
+// Textures are compressed and cached as texture.compression and texture.cacheFolder of
+// config.ini say, so the first load of a model encodes its textures and the next ones read them.
+// With texture.streaming, only their coarse levels are uploaded, as in the viewer before the
+// first frame; with texture.arrays, they are packed into texture arrays.
+#include "../fileUtils.h"
+#include "../headlessContext.h"
+#include "../profiler.h"
+#include "../renderer.h"
+#include "../scene.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <malloc.h>
+#include <unistd.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// operator new calls since the counters were last reset
+static std::atomic<size_t> allocatedBytes(0);
+static std::atomic<size_t> allocationCount(0);
+
+void* operator new(size_t size) {
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size > 0 ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+/**
+ * Drops the cached pages of a file so that the next read comes from the disk.
+ * @return false if the cache could not be dropped, the run is then warm.
+ */
+static bool evictFromCache(const std::filesystem::path& file) {
+#if defined(__linux__)
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return evicted;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Resets the peak RSS to the current RSS.
+ * @return false if the peak cannot be reset, it is then the peak of the whole process.
+ */
+static bool resetPeakRss() {
+#if defined(__linux__)
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+    clearRefs.flush();
+    return (bool)clearRefs;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @return The peak RSS in bytes, 0 if unknown.
+ */
+static size_t peakRss() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return (size_t)std::stoull(line.substr(6)) * 1024;
+        }
+    }
+#endif
+    return 0;
+}
+
+/**
+ * Timings and memory of one load, one CSV line.
+ */
+struct LoadRecord {
+    std::string file;
+    double fileMB = 0.0;
+    std::string cache;              // "cold" or "warm"
+    int run = 0;
+    bool loaded = false;
+    double totalMs = 0.0;           // loadGlb and glFinish, wall time
+    std::map<std::string, double> cpuMs;    // CPU time of each profiler scope
+    std::map<std::string, double> gpuMs;    // GPU time of each GPU profiler scope
+    int textures = 0;
+    size_t meshes = 0;
+    size_t vertices = 0;
+    double peakRssMB = 0.0;
+    double allocatedMB = 0.0;
+    size_t allocations = 0;
+
+    /**
+     * @return The CSV / JSON columns, in order.
+     */
+    std::vector<std::pair<std::string, std::string>> columns() const {
+        auto number = [](double value) {
+            std::ostringstream stream;
+            stream << std::fixed << std::setprecision(3) << value;
+            return stream.str();
+        };
+        auto cpu = [&](const char* name) { auto it = cpuMs.find(name); return number(it != cpuMs.end() ? it->second : 0.0); };
+        auto gpu = [&](const char* name) { auto it = gpuMs.find(name); return number(it != gpuMs.end() ? it->second : 0.0); };
+        return {
+            { "file", file }, { "fileMB", number(fileMB) }, { "cache", cache }, { "run", std::to_string(run) },
+            { "loaded", loaded ? "1" : "0" }, { "totalMs", number(totalMs) },
+            { "readMs", cpu("read file") }, { "importMs", cpu("import") }, { "materialsMs", cpu("materials") },
+            { "textureDecodeMs", cpu("decode texture") }, { "textureUploadMs", cpu("upload texture") },
+            { "textureUploadGpuMs", gpu("upload texture") }, { "vertexConversionMs", cpu("nodes") },
+            { "meshUploadMs", cpu("upload meshes") }, { "meshUploadGpuMs", gpu("upload meshes") },
+            { "streamedUploadMs", cpu("finish uploads") }, { "streamedUploadGpuMs", gpu("finish uploads") },
+            { "textures", std::to_string(textures) }, { "meshes", std::to_string(meshes) }, { "vertices", std::to_string(vertices) },
+            { "peakRssMB", number(peakRssMB) }, { "allocatedMB", number(allocatedMB) }, { "allocations", std::to_string(allocations) },
+        };
+    }
+};
+
+static LoadRecord loadOnce(Scene& scene, Renderer& renderer, const std::filesystem::path& file, bool cold, int run) {
+    LoadRecord record;
+    record.file = file.filename().string();
+    record.fileMB = std::filesystem::file_size(file) / (1024.0 * 1024.0);
+    record.cache = cold && evictFromCache(file) ? "cold" : "warm";
+    record.run = run;
+
+    resetPeakRss();
+    allocatedBytes = 0;
+    allocationCount = 0;
+
+    Clock::time_point start = Clock::now();
+    record.loaded = scene.loadGlb(file.string());
+    // the viewer streams the contents over the next frames, the benchmark waits for all of them
+    renderer.finishUploads();
+    glFinish();
+    record.totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    record.allocatedMB = allocatedBytes / (1024.0 * 1024.0);
+    record.allocations = allocationCount;
+    record.peakRssMB = peakRss() / (1024.0 * 1024.0);
+    record.meshes = scene.getMeshes().size();
+    for (const Mesh& mesh : scene.getMeshes()) {
+        record.vertices += mesh.vertexCount;
+    }
+
+    // one profiler frame per load
+    Profiler::get().endFrame();
+    Profiler::get().flush();
+    for (const ProfileSample& sample : Profiler::get().getLastFrame().samples) {
+        record.cpuMs[sample.name] += sample.cpuEnd - sample.cpuStart;
+        if (sample.gpuStart >= 0.0) {
+            record.gpuMs[sample.name] += sample.gpuEnd - sample.gpuStart;
+        }
+        if (std::string(sample.name) == "decode texture") {
+            ++record.textures;
+        }
+    }
+
+    // release the model so that the next load starts from the same memory state
+    scene.clear();
+    glFinish();
+#if defined(__linux__)
+    malloc_trim(0);
+#endif
+    return record;
+}
+
+static bool writeCsv(const std::string& filepath, const std::vector<LoadRecord>& records) {
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create " << filepath << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < records.size(); ++i) {
+        std::vector<std::pair<std::string, std::string>> columns = records[i].columns();
+        if (i == 0) {
+            for (size_t c = 0; c < columns.size(); ++c) {
+                file << (c > 0 ? "," : "") << columns[c].first;
+            }
+            file << "\n";
+        }
+        for (size_t c = 0; c < columns.size(); ++c) {
+            file << (c > 0 ? "," : "") << columns[c].second;
+        }
+        file << "\n";
+    }
+    return (bool)file;
+}
+
+static bool writeJson(const std::string& filepath, const std::vector<LoadRecord>& records) {
+    std::ofstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create " << filepath << std::endl;
+        return false;
+    }
+    // file and cache are the only string columns
+    file << "[\n";
+    for (size_t i = 0; i < records.size(); ++i) {
+        file << "  {";
+        std::vector<std::pair<std::string, std::string>> columns = records[i].columns();
+        for (size_t c = 0; c < columns.size(); ++c) {
+            bool quoted = columns[c].first == "file" || columns[c].first == "cache";
+            file << (c > 0 ? ", " : " ") << "\"" << columns[c].first << "\": "
+                << (quoted ? "\"" : "") << columns[c].second << (quoted ? "\"" : "");
+        }
+        file << " }" << (i + 1 < records.size() ? "," : "") << "\n";
+    }
+    file << "]\n";
+    return (bool)file;
+}
+
+int main(int argc, char** argv) {
+    FileUtils::ConfigMap configMap = FileUtils::readConfigFile("config.ini");
+    std::string input = FileUtils::getValue(configMap, "folder.models");
+    int runs = 3;
+    bool cold = true;
+    std::string csvFile = "loadBenchmark.csv";
+    std::string jsonFile = "loadBenchmark.json";
+    bool textureCompression = FileUtils::getValue(configMap, "texture.compression", "1") != "0";
+    std::string textureCacheFolder = FileUtils::getValue(configMap, "texture.cacheFolder", "cache/textures");
+    bool textureStreaming = FileUtils::getValue(configMap, "texture.streaming", "1") != "0";
+    int streamingMinSize = std::stoi(FileUtils::getValue(configMap, "texture.streamingMinSize", "256"));
+    bool textureArrays = FileUtils::getValue(configMap, "texture.arrays", "0") != "0";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--input" && hasValue) input = argv[++i];
+        else if (arg == "--runs" && hasValue) runs = std::max(0, std::stoi(argv[++i]));
+        else if (arg == "--csv" && hasValue) csvFile = argv[++i];
+        else if (arg == "--json" && hasValue) jsonFile = argv[++i];
+        else if (arg == "--no-cold") cold = false;
+        else {
+            std::cerr << "Usage: loadBenchmark [--input dir] [--runs n] [--no-cold] [--csv file] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+    if (!cold && runs == 0) {
+        std::cerr << "--no-cold needs at least one run, --runs 0 would load nothing" << std::endl;
+        return 1;
+    }
+    if (input.empty() || !std::filesystem::is_directory(input)) {
+        std::cerr << "Model folder not found: " << input << std::endl;
+        return 1;
+    }
+
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(input)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".glb") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    // uploads need a context, not the shaders of Renderer::init
+    HeadlessContext context;
+    if (!context.init(64, 64)) {
+        return 1;
+    }
+    Profiler::get().init(true);
+    if (!resetPeakRss()) {
+        std::cout << "The peak RSS cannot be reset, it is the peak of the whole process" << std::endl;
+    }
+
+    EventBus eventBus;
+    Renderer renderer;
+    renderer.setTextureStreaming(textureStreaming, streamingMinSize, 0);
+    renderer.setMaterialTextureArrays(textureArrays);
+    Scene scene;
+    scene.init(&eventBus, 1.0f);
+    scene.setTextureCompression(textureCompression, Renderer::supportsBc7(), textureCacheFolder);
+    eventBus.subscribe(EventType::LoadGpuMeshes, [&](const Event& event) {
+        renderer.loadMeshes(scene.getMeshes());
+        });
+    eventBus.subscribe(EventType::ClearGpuMeshesAndTextures, [&](const Event& event) {
+        renderer.clearMeshes(scene.getMeshes());
+        renderer.clearTextures(scene.getMaterials());
+        });
+    eventBus.subscribe(EventType::LoadTextureRenderData, [&](const Event& event) {
+        renderer.loadTextureData(event.get<TextureBindingEvent>());
+        });
+
+    std::vector<LoadRecord> records;
+    int failures = 0;
+    for (const std::filesystem::path& file : files) {
+        if (cold) {
+            records.push_back(loadOnce(scene, renderer, file, true, 0));
+            if (records.back().cache != "cold") {
+                std::cout << "Could not drop the file cache of " << file.filename().string() << ", cold run is warm" << std::endl;
+            }
+        }
+        for (int run = 0; run < runs; ++run) {
+            records.push_back(loadOnce(scene, renderer, file, false, run));
+        }
+
+        LoadRecord& last = records.back();
+        if (!last.loaded) {
+            ++failures;
+        }
+        std::cout << last.file << ": " << last.totalMs << " ms (" << last.cache << "), read " << last.cpuMs["read file"]
+            << " ms, import " << last.cpuMs["import"] << " ms, textures " << last.cpuMs["materials"]
+            << " ms, vertices " << last.cpuMs["nodes"] << " ms, mesh upload " << last.cpuMs["upload meshes"] << " ms, streamed uploads " << last.cpuMs["finish uploads"]
+            << " ms, peak RSS " << last.peakRssMB << " MB, allocated " << last.allocatedMB << " MB" << std::endl;
+    }
+
+    bool written = writeCsv(csvFile, records) && writeJson(jsonFile, records);
+    if (written) {
+        std::cout << records.size() << " loads written to " << csvFile << " and " << jsonFile << std::endl;
+    }
+    context.cleanup();
+    return failures == 0 && written ? 0 : 1;
+}
@@ -0,0 +1,322 @@
+#include "uploadQueue.h"
+#include "glCapture.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+// Longest wait for a staging buffer in finish(), before checking again
+static const GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+
+/**
+ * Bytes between two rows in a staging buffer, rows start on 4 bytes as GL_UNPACK_ALIGNMENT expects.
+ */
+static size_t stagingRowBytes(size_t rowBytes) {
+    return (rowBytes + 3) & ~(size_t)3;
+}
+
+void UploadQueue::init(size_t slotBytes, int slots) {
+    _slotBytes = slotBytes;
+    _slots.resize(std::max(1, slots));
+    for (Slot& slot : _slots) {
+        slot.buffer = GpuResourceManager::get().createBuffer(GL_COPY_WRITE_BUFFER, slotBytes, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void UploadQueue::uploadBuffer(const BufferHandle& buffer, const void* data, size_t bytes, bool* done) {
+    Job job;
+    job.buffer = buffer;
+    job.data = (const uint8_t*)data;
+    job.size = bytes;
+    job.done = done;
+    if (done) {
+        *done = false;
+    }
+    _pendingBytes += bytes;
+    _jobs.push_back(std::move(job));
+}
+
+void UploadQueue::uploadTexture(TextureHandle texture, GLenum format, int width, int height, int channels, const unsigned char* pixels,
+    TextureHandle* destination) {
+    Job job;
+    job.texture = std::move(texture);
+    job.format = format;
+    job.width = width;
+    job.channels = channels;
+    job.size = height;
+    job.pixels.assign(pixels, pixels + job.rowBytes() * height);
+    job.data = job.pixels.data();
+    job.generateMipmaps = true;
+    job.destination = destination;
+    _pendingBytes += job.pixels.size();
+    _jobs.push_back(std::move(job));
+}
+
+void UploadQueue::uploadCompressedLevel(const TextureHandle& texture, GLenum internalFormat, int level, int width, int height,
+    size_t blockBytes, const uint8_t* blocks, TextureHandle* destination) {
+    Job job;
+    job.texture = texture;
+    job.format = internalFormat;
+    job.width = width;
+    job.height = height;
+    job.channels = (int)blockBytes;
+    job.level = level;
+    job.compressed = true;
+    job.size = (height + 3) / 4;
+    job.pixels.assign(blocks, blocks + job.rowBytes() * job.size);
+    job.data = job.pixels.data();
+    job.destination = destination;
+    _pendingBytes += job.pixels.size();
+    _jobs.push_back(std::move(job));
+}
+
+void UploadQueue::uploadLayer(const TextureHandle& texture, GLenum format, int layer, int level, int width, int height, size_t pixelBytes,
+    bool compressed, const uint8_t* data, bool generateMipmaps, TextureHandle* destination) {
+    Job job;
+    job.texture = texture;
+    job.format = format;
+    job.width = width;
+    job.height = height;
+    job.channels = (int)pixelBytes;
+    job.level = level;
+    job.layer = layer;
+    job.compressed = compressed;
+    job.generateMipmaps = generateMipmaps;
+    job.size = compressed ? (height + 3) / 4 : height;
+    job.pixels.assign(data, data + job.rowBytes() * job.size);
+    job.data = job.pixels.data();
+    job.destination = destination;
+    _pendingBytes += job.pixels.size();
+    _jobs.push_back(std::move(job));
+}
+
+bool UploadQueue::update(uint64_t& bufferBytes, uint64_t& textureBytes) {
+    if (_jobs.empty()) {
+        return false;
+    }
+    return stage(_bytesPerFrame > 0 ? _bytesPerFrame : std::numeric_limits<size_t>::max(), false, bufferBytes, textureBytes);
+}
+
+void UploadQueue::finish(uint64_t& bufferBytes, uint64_t& textureBytes) {
+    while (!_jobs.empty()) {
+        stage(std::numeric_limits<size_t>::max(), true, bufferBytes, textureBytes);
+    }
+}
+
+void UploadQueue::cancel() {
+    // copies already submitted still land in their destinations, which go back to the pool
+    _jobs.clear();
+    _pendingBytes = 0;
+}
+
+bool UploadQueue::stage(size_t budget, bool wait, uint64_t& bufferBytes, uint64_t& textureBytes) {
+    bool completed = completeJobs();
+
+    // the capture only stores the contents of uploads from client memory
+    if (GlCapture::get().isEnabled() || _slots.empty()) {
+        while (!_jobs.empty()) {
+            uploadDirect(_jobs.front(), bufferBytes, textureBytes);
+            completed |= completeJobs();
+        }
+        return completed;
+    }
+
+    size_t staged = 0;
+    while (!_jobs.empty() && staged < budget) {
+        Job& front = _jobs.front();
+        if (front.isTexture() && stagingRowBytes(front.rowBytes()) > _slotBytes) {
+            uploadDirect(front, bufferBytes, textureBytes);
+            completed |= completeJobs();
+            continue;
+        }
+
+        Slot& slot = _slots[_nextSlot];
+        if (!isSlotFree(slot, wait)) {
+            break;
+        }
+        size_t bytes = fillSlot(slot, budget - staged, bufferBytes, textureBytes);
+        _nextSlot = (_nextSlot + 1) % _slots.size();
+        staged += bytes;
+        completed |= completeJobs();
+        if (bytes == 0) {
+            break;
+        }
+    }
+    return completed;
+}
+
+bool UploadQueue::isSlotFree(Slot& slot, bool wait) {
+    if (!slot.fence) {
+        return true;
+    }
+    GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? FENCE_TIMEOUT_NS : 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    return true;
+}
+
+size_t UploadQueue::fillSlot(Slot& slot, size_t budget, uint64_t& bufferBytes, uint64_t& textureBytes) {
+    GLuint staging = slot.buffer.id();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, staging);
+    // the fence says the GPU is done with the previous contents, no need for the driver to synchronize
+    uint8_t* mapped = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, _slotBytes,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) {
+        std::cerr << "Failed to map an upload staging buffer, uploading from client memory" << std::endl;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        Job& front = _jobs.front();
+        size_t bytes = front.isTexture() ? (front.size - front.staged) * front.rowBytes() : front.size - front.staged;
+        uploadDirect(front, bufferBytes, textureBytes);
+        return bytes;
+    }
+
+    // copy the next chunks, several small uploads can share the slot
+    _chunks.clear();
+    size_t used = 0;
+    size_t limit = std::min(_slotBytes, budget);
+    for (size_t i = 0; i < _jobs.size() && used < limit; ++i) {
+        Job& job = _jobs[i];
+        if (job.staged == job.size) {
+            continue;
+        }
+        if (job.isTexture()) {
+            size_t rowBytes = job.rowBytes();
+            size_t stride = stagingRowBytes(rowBytes);
+            size_t offset = stagingRowBytes(used);
+            size_t rows = offset < limit ? std::min(job.size - job.staged, (limit - offset) / stride) : 0;
+            // a budget smaller than a row still moves one row per frame
+            if (rows == 0 && used == 0 && stride <= _slotBytes) {
+                rows = 1;
+            }
+            if (rows == 0) {
+                break;
+            }
+            for (size_t row = 0; row < rows; ++row) {
+                memcpy(mapped + offset + row * stride, job.data + (job.staged + row) * rowBytes, rowBytes);
+            }
+            _chunks.push_back({ i, offset, job.staged, rows });
+            job.staged += rows;
+            used = offset + rows * stride;
+        }
+        else {
+            size_t bytes = std::min(job.size - job.staged, limit - used);
+            memcpy(mapped + used, job.data + job.staged, bytes);
+            _chunks.push_back({ i, used, job.staged, bytes });
+            job.staged += bytes;
+            used += bytes;
+        }
+        if (job.staged < job.size) {
+            break;
+        }
+    }
+
+    if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE) {
+        // the contents were lost (e.g. a display mode change), stage them again next time
+        for (auto it = _chunks.rbegin(); it != _chunks.rend(); ++it) {
+            _jobs[it->job].staged = it->offset;
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return 0;
+    }
+
+    // copy from the staging buffer to the destinations, in submission order
+    for (const Chunk& chunk : _chunks) {
+        Job& job = _jobs[chunk.job];
+        if (job.isTexture()) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging);
+            submitRows(job, chunk.offset, chunk.size, (const void*)chunk.stagingOffset);
+            textureBytes += chunk.size * job.rowBytes();
+            _pendingBytes -= chunk.size * job.rowBytes();
+        }
+        else {
+            glBindBuffer(GL_COPY_READ_BUFFER, staging);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, job.buffer.id());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, chunk.stagingOffset, chunk.offset, chunk.size);
+            bufferBytes += chunk.size;
+            _pendingBytes -= chunk.size;
+        }
+    }
+    // later texture uploads from client memory must not read from the staging buffer
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    return used;
+}
+
+void UploadQueue::uploadDirect(Job& job, uint64_t& bufferBytes, uint64_t& textureBytes) {
+    if (job.isTexture()) {
+        size_t rowBytes = job.rowBytes();
+        size_t rows = job.size - job.staged;
+        // client rows are tightly packed
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        submitRows(job, job.staged, rows, job.data + job.staged * rowBytes);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        textureBytes += rows * rowBytes;
+        _pendingBytes -= rows * rowBytes;
+    }
+    else {
+        size_t bytes = job.size - job.staged;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, job.buffer.id());
+        glBufferSubData(GL_COPY_WRITE_BUFFER, job.staged, bytes, job.data + job.staged);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        bufferBytes += bytes;
+        _pendingBytes -= bytes;
+    }
+    job.staged = job.size;
+}
+
+bool UploadQueue::completeJobs() {
+    bool completed = false;
+    while (!_jobs.empty() && _jobs.front().staged == _jobs.front().size) {
+        Job& job = _jobs.front();
+        if (job.isTexture()) {
+            // the copies before it in the command stream fill the first level, compressed levels are all uploaded
+            if (job.generateMipmaps) {
+                GLenum target = job.layer >= 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+                glBindTexture(target, job.texture.id());
+                glGenerateMipmap(target);
+                glBindTexture(target, 0);
+            }
+            if (job.destination) {
+                *job.destination = std::move(job.texture);
+            }
+        }
+        else if (job.done) {
+            *job.done = true;
+        }
+        _jobs.pop_front();
+        completed = true;
+    }
+    return completed;
+}
+
+void UploadQueue::submitRows(const Job& job, size_t row, size_t rows, const void* data) {
+    if (job.layer >= 0) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, job.texture.id());
+        if (job.compressed) {
+            GLint y = (GLint)row * 4;
+            GLsizei height = std::min((GLsizei)rows * 4, job.height - y);
+            glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, job.level, 0, y, job.layer, job.width, height, 1, job.format,
+                (GLsizei)(rows * job.rowBytes()), data);
+        }
+        else {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, job.level, 0, (GLint)row, job.layer, job.width, (GLsizei)rows, 1, job.format, GL_UNSIGNED_BYTE, data);
+        }
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, job.texture.id());
+    if (job.compressed) {
+        // block rows cover 4 texel rows, the last one may be cut by the level's height
+        GLint y = (GLint)row * 4;
+        GLsizei height = std::min((GLsizei)rows * 4, job.height - y);
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, job.level, 0, y, job.width, height, job.format, (GLsizei)(rows * job.rowBytes()), data);
+    }
+    else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (GLint)row, job.width, (GLsizei)rows, job.format, GL_UNSIGNED_BYTE, data);
+    }
+}
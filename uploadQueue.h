@@ -0,0 +1,217 @@
+#pragma once
+#include "gpuResourceManager.h"
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/**
+ * Streams buffer and texture contents to the GPU over several frames instead of blocking the
+ * frame that loads them. Contents are copied into a ring of staging buffers (pixel buffer
+ * objects for textures), then copied by the GPU into their destination, which does not wait
+ * for the transfer. A fence per staging buffer tells when the GPU is done reading it, so the
+ * ring is refilled without stalling. At most a budget of bytes is staged per frame, and each
+ * upload is completed as soon as its last bytes are submitted: textures get their mipmaps (block
+ * compressed ones are queued level by level) and are handed to their material, buffers mark
+ * their mesh drawable.
+ * While the GL capture is enabled, uploads are done at once from client memory so that the
+ * capture holds their contents. GL thread only.
+ */
+class UploadQueue {
+public:
+    UploadQueue() = default;
+    UploadQueue(const UploadQueue&) = delete;
+    UploadQueue& operator=(const UploadQueue&) = delete;
+
+    /**
+     * Creates the staging ring, the GL context must be current.
+     * @param slotBytes Size of each staging buffer.
+     * @param slots Number of staging buffers.
+     */
+    void init(size_t slotBytes, int slots);
+
+    /**
+     * Sets the most bytes staged per frame.
+     * @param bytes The budget, 0 for none.
+     */
+    void setBytesPerFrame(size_t bytes) { _bytesPerFrame = bytes; }
+
+    /**
+     * Queues the upload of a buffer's contents.
+     * @param buffer The destination buffer, already allocated.
+     * @param data Contents, must stay valid until the upload completes or is cancelled.
+     * @param bytes Size of the contents.
+     * @param done Set to true when the upload completes, may be null.
+     */
+    void uploadBuffer(const BufferHandle& buffer, const void* data, size_t bytes, bool* done);
+
+    /**
+     * Queues the upload of the first level of a texture, copying the image.
+     * @param texture The destination texture, already allocated with its mip levels.
+     * @param format Pixel format of the image, GL_RED, GL_RG, GL_RGB or GL_RGBA.
+     * @param width Width of the image.
+     * @param height Height of the image.
+     * @param channels Bytes per pixel of the image.
+     * @param pixels Image rows, tightly packed.
+     * @param destination Receives the texture with its mipmaps when the upload completes.
+     */
+    void uploadTexture(TextureHandle texture, GLenum format, int width, int height, int channels, const unsigned char* pixels,
+        TextureHandle* destination);
+
+    /**
+     * Queues the upload of one level of a block-compressed texture, copying the blocks. Levels
+     * are not generated: every level is queued, the destination is given with the last one.
+     * @param texture The destination texture, already allocated with its mip levels.
+     * @param internalFormat Compressed format of the texture, e.g. GL_COMPRESSED_RGBA_BPTC_UNORM_ARB.
+     * @param level Mip level written.
+     * @param width Width of the level in texels.
+     * @param height Height of the level in texels.
+     * @param blockBytes Bytes per 4x4 block.
+     * @param blocks Rows of blocks, tightly packed.
+     * @param destination Receives the texture when the upload completes, nullptr for the levels before the last.
+     */
+    void uploadCompressedLevel(const TextureHandle& texture, GLenum internalFormat, int level, int width, int height, size_t blockBytes,
+        const uint8_t* blocks, TextureHandle* destination);
+
+    /**
+     * Queues the upload of one level of one layer of a 2D array texture, copying the image or the
+     * blocks. Uncompressed arrays get the mipmaps of all their layers generated once, with the
+     * last layer queued; compressed ones are queued level by level.
+     * @param texture The destination array, already allocated with its layers and mip levels.
+     * @param format Pixel format of the image (GL_RED, GL_RG, GL_RGB or GL_RGBA), internal format if compressed.
+     * @param layer Layer written.
+     * @param level Mip level written, 0 for uncompressed images.
+     * @param width Width of the level.
+     * @param height Height of the level.
+     * @param pixelBytes Bytes per pixel of the image, per 4x4 block if compressed.
+     * @param compressed The contents are rows of 4x4 blocks.
+     * @param data Rows of the image or of blocks, tightly packed.
+     * @param generateMipmaps Generate the mipmaps of the array once the layer is uploaded.
+     * @param destination Receives the array when the upload completes, nullptr for the layers before the last.
+     */
+    void uploadLayer(const TextureHandle& texture, GLenum format, int layer, int level, int width, int height, size_t pixelBytes,
+        bool compressed, const uint8_t* data, bool generateMipmaps, TextureHandle* destination);
+
+    /**
+     * Stages the next uploads within the frame budget and completes those fully submitted.
+     * @param bufferBytes Incremented by the buffer bytes submitted.
+     * @param textureBytes Incremented by the texture bytes submitted.
+     * @return true if an upload completed.
+     */
+    bool update(uint64_t& bufferBytes, uint64_t& textureBytes);
+
+    /**
+     * Submits and completes every queued upload, waiting for the staging buffers as needed.
+     * @param bufferBytes Incremented by the buffer bytes submitted.
+     * @param textureBytes Incremented by the texture bytes submitted.
+     */
+    void finish(uint64_t& bufferBytes, uint64_t& textureBytes);
+
+    /**
+     * Drops the queued uploads, their destinations are left incomplete.
+     */
+    void cancel();
+
+    /**
+     * @return true while uploads are queued.
+     */
+    bool isUploading() const { return !_jobs.empty(); }
+
+    /**
+     * @return The bytes left to upload.
+     */
+    size_t getPendingBytes() const { return _pendingBytes; }
+
+private:
+    /**
+     * A buffer or texture being uploaded.
+     */
+    struct Job {
+        BufferHandle buffer;                // Destination buffer, or
+        TextureHandle texture;              // destination texture
+        const uint8_t* data = nullptr;      // Contents: buffer data, or texture rows in pixels
+        std::vector<uint8_t> pixels;        // Copy of the image, the decoded one is freed after the load event
+        size_t size = 0;                    // Bytes of a buffer, rows of a texture (of blocks if compressed)
+        size_t staged = 0;                  // Bytes or rows submitted
+        GLenum format = 0;                  // Pixel format of a texture, internal format if compressed
+        int width = 0;                      // Width of a texture
+        int height = 0;                     // Height of a compressed texture level
+        int channels = 0;                   // Bytes per pixel of a texture, per block if compressed
+        int level = 0;                      // Mip level of a compressed texture
+        int layer = -1;                     // Layer of a 2D array texture, -1 for a 2D texture
+        bool compressed = false;            // Rows of 4x4 blocks, written with glCompressedTexSubImage2D
+        bool generateMipmaps = false;       // Mipmaps are generated once the rows are submitted
+        TextureHandle* destination = nullptr;
+        bool* done = nullptr;
+
+        bool isTexture() const { return (bool)texture; }
+        size_t rowBytes() const { return (size_t)(compressed ? (width + 3) / 4 : width) * channels; }
+    };
+
+    /**
+     * A range of a staging buffer copied to a job's destination.
+     */
+    struct Chunk {
+        size_t job;             // Index in _jobs
+        size_t stagingOffset;   // Offset in the staging buffer
+        size_t offset;          // Destination offset in bytes, or first row
+        size_t size;            // Bytes, or rows
+    };
+
+    /**
+     * A staging buffer and the fence of the copies reading it.
+     */
+    struct Slot {
+        BufferHandle buffer;
+        GLsync fence = nullptr;
+    };
+
+    std::vector<Slot> _slots;
+    size_t _slotBytes = 0;
+    size_t _nextSlot = 0;
+    size_t _bytesPerFrame = 16 * 1024 * 1024;
+    std::deque<Job> _jobs;
+    std::vector<Chunk> _chunks;     // Chunks of the slot being filled, kept for their capacity
+    size_t _pendingBytes = 0;
+
+    /**
+     * Stages uploads until the budget is spent or no staging buffer is free.
+     * @param budget Bytes that may be staged.
+     * @param wait Wait for busy staging buffers instead of returning.
+     * @return true if an upload completed.
+     */
+    bool stage(size_t budget, bool wait, uint64_t& bufferBytes, uint64_t& textureBytes);
+
+    /**
+     * @return true if the GPU is done reading the slot, after waiting for it if asked.
+     */
+    bool isSlotFree(Slot& slot, bool wait);
+
+    /**
+     * Fills a free slot with the next chunks and submits their copies.
+     * @return The bytes staged.
+     */
+    size_t fillSlot(Slot& slot, size_t budget, uint64_t& bufferBytes, uint64_t& textureBytes);
+
+    /**
+     * Submits what is left of the first job from client memory, for images with rows larger
+     * than a staging buffer and when the staging buffer cannot be mapped.
+     */
+    void uploadDirect(Job& job, uint64_t& bufferBytes, uint64_t& textureBytes);
+
+    /**
+     * Completes and removes the fully submitted jobs at the front of the queue.
+     * @return true if a job completed.
+     */
+    bool completeJobs();
+
+    /**
+     * Submits rows of a texture job from the bound pixel unpack buffer or client memory.
+     * @param job The texture job.
+     * @param row First row, of blocks if compressed.
+     * @param rows Rows submitted.
+     * @param data Offset in the unpack buffer, or pointer to the rows.
+     */
+    static void submitRows(const Job& job, size_t row, size_t rows, const void* data);
+};